@@ -53,6 +53,10 @@ if(DISABLE_SERIAL_AUTHENTICATION)
     add_compile_options(-DESP3D_DISABLE_SERIAL_AUTHENTICATION_FEATURE=1)
 endif()
 
+if(SERIAL_BAUD_PROBE)
+    add_compile_options(-DESP3D_SERIAL_BAUD_PROBE_FEATURE=1)
+endif()
+
 # Time service
 if(TIME_SERVICE)
     add_compile_options(-DESP3D_TIMESTAMP_FEATURE=1)
@@ -166,6 +170,7 @@ message(STATUS "${Cyan}Telnet Service:  ${White}${TELNET_SERVICE} ${ColourReset}
 message(STATUS "${Cyan}WebSocket Service:  ${White}${WS_SERVICE} ${ColourReset}")
 message(STATUS "${Cyan}Notifications Service:  ${White}${NOTIFICATIONS_SERVICE} ${ColourReset}")
 message(STATUS "${Cyan}USB Serial Service:  ${White}${USB_SERIAL_SERVICE} ${ColourReset}")
+message(STATUS "${Cyan}Serial Baud Probe:  ${White}${SERIAL_BAUD_PROBE} ${ColourReset}")
 message(STATUS "${Cyan}------------------------${ColourReset}")
 message(STATUS "")
 
@@ -102,6 +102,8 @@ const char* help[] = {
     "[ESP410] - display available AP list",
 #endif  // ESP3D_WIFI_FEATURE
     "[ESP420] - display ESP3D current status",
+    "[ESP430](profile) - display/set scheduling profile BALANCED, STREAMING, "
+    "UI and tasks CPU usage",
     "[ESP444](state) - set ESP3D state (RESET/RESTART)",
 #if ESP3D_MDNS_FEATURE
     "[ESP450]display ESP3D list on network",
@@ -118,10 +120,16 @@ const char* help[] = {
     "[ESP610](type=NONE/PUSHOVER/EMAIL/LINE/IFTTT) (AUTO=YES/NO) (T1=token1) "
     "(T2=token2) (TS=Settings)",
 #endif  // ESP3D_NOTIFICATIONS_FEATURE
-    "[ESP700](stream=file name) or (macro name) - read and process/stream "
-    "file/macro",
-    "[ESP701]action=(PAUSE/RESUME/ABORT) - query and control ESP700 stream",
+    "[ESP700](stream=file name) (line=command number in tokenized file) or "
+    "(macro name) - read and process/stream file/macro",
+    "[ESP701]action=(PAUSE/RESUME/ABORT) (layer=number) (travel) - query "
+    "and control ESP700 stream",
     "[ESP702](pause/stop/resume)=(script) - display/set ESP700 stream scripts",
+    "[ESP703](file name) - tokenize file for ESP700 stream, without file name "
+    "display progress",
+    "[ESP704]action=(ADD/REMOVE/CLEAR/START/STOP) (file=file name) "
+    "(start=script) (end=script) (index=job index) - query and control job "
+    "queue",
     "[ESP710]FORMATFS - Format ESP3D Filesystem",
     "[ESP720](path) - List ESP3D Filesystem",
     "[ESP730](Action)=(path) - rmdir / remove / mkdir / exists / create on "
@@ -138,7 +146,7 @@ const char* help[] = {
     "version)(setup=0/1) - "
     "display FW Informations /set time",
     "[ESP900](state) - display/set serial state(ENABLE/DISABLE)",
-    "[ESP901](baud rate) - display/set serial baud rate",
+    "[ESP901](baud rate/PROBE) - display/set/probe serial baud rate",
 #if ESP3D_USB_SERIAL_FEATURE
     "[ESP902](baud rate) - display/set usb-serial baud rate",
     "[ESP950]<SERIAL/USB>  - display/set usb-serial client output",
@@ -197,7 +205,7 @@ const uint cmdlist[] = {
 #if ESP3D_WIFI_FEATURE
     410,
 #endif  // ESP3D_WIFI_FEATURE
-    420, 444,
+    420, 430, 444,
 #if ESP3D_MDNS_FEATURE
     450,
 #endif  // ESP3D_MDNS_FEATURE
@@ -208,7 +216,7 @@ const uint cmdlist[] = {
 #if ESP3D_NOTIFICATIONS_FEATURE
     600, 610,
 #endif  // ESP3D_NOTIFICATIONS_FEATURE
-    700, 701, 702, 710, 720, 730,
+    700, 701, 702, 703, 704, 710, 720, 730,
 #if ESP3D_SD_CARD_FEATURE
     740, 750,
 #endif  // ESP3D_SD_CARD_FEATURE
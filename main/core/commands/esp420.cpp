@@ -275,6 +275,22 @@ void ESP3DCommands::ESP420(int cmd_params_pos, ESP3DMessage *msg) {
                        requestId)) {
     return;
   }
+  // Link with printer since last print start
+  const ESP3DLinkQualityStats &link = gcodeHostService.getLinkStats();
+  tmpstr = "lines: " + std::to_string(link.lines);
+  tmpstr += ", resends: " + std::to_string(link.resends);
+  tmpstr += ", errors: " + std::to_string(link.errors);
+  tmpstr += " (checksum: " + std::to_string(link.checksum_errors);
+  tmpstr += "), timeouts: " + std::to_string(link.timeouts);
+  tmpstr += ", rx overflows: " + std::to_string(link.rx_overflows);
+  tmpstr += ", ack: " + std::to_string(link.ack_latency);
+  tmpstr += " ms, spacing: ";
+  tmpstr += std::to_string(gcodeHostService.getLineSpacing());
+  tmpstr += " ms";
+  if (!dispatchIdValue(json, "Link quality", tmpstr.c_str(), target,
+                       requestId)) {
+    return;
+  }
 
   // wifi
   if (esp3dNetwork.getMode() == ESP3DRadioMode::off ||
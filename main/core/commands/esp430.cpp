@@ -0,0 +1,164 @@
+/*
+  esp3d_commands member
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "authentication/esp3d_authentication.h"
+#include "esp3d_client.h"
+#include "esp3d_commands.h"
+#include "esp3d_scheduling.h"
+#include "esp3d_string.h"
+#if ESP3D_DISPLAY_FEATURE
+#include "esp3d_ui_governor.h"
+#include "esp3d_values.h"
+#endif  // ESP3D_DISPLAY_FEATURE
+
+#define COMMAND_ID 430
+// Get/Set scheduling profile and display tasks CPU usage and ui governor
+// state
+// CPU usage is computed since previous call of the command
+// output is JSON or plain text according parameter
+//[ESP430]<BALANCED/STREAMING/UI> json=<no> pwd=<admin/user>
+void ESP3DCommands::ESP430(int cmd_params_pos, ESP3DMessage* msg) {
+  ESP3DClientType target = msg->origin;
+  ESP3DRequest requestId = msg->request_id;
+  msg->target = target;
+  msg->origin = ESP3DClientType::command;
+  bool json = hasTag(msg, cmd_params_pos, "json");
+  std::string tmpstr;
+#if ESP3D_AUTHENTICATION_FEATURE
+  if (msg->authentication_level == ESP3DAuthenticationLevel::guest) {
+    dispatchAuthenticationError(msg, COMMAND_ID, json);
+    return;
+  }
+#endif  // ESP3D_AUTHENTICATION_FEATURE
+  tmpstr = get_clean_param(msg, cmd_params_pos);
+  if (tmpstr.length() != 0) {
+#if ESP3D_AUTHENTICATION_FEATURE
+    if (msg->authentication_level != ESP3DAuthenticationLevel::admin) {
+      dispatchAuthenticationError(msg, COMMAND_ID, json);
+      return;
+    }
+#endif  // ESP3D_AUTHENTICATION_FEATURE
+    ESP3DSchedulingProfile profile;
+    bool hasError = false;
+    std::string answer = "ok";
+    if (!esp3dScheduling.getProfile(tmpstr.c_str(), profile)) {
+      hasError = true;
+      answer = "Invalid parameter";
+    } else if (!esp3dScheduling.setProfile(profile)) {
+      hasError = true;
+      answer = "Set value failed";
+    } else if (profile != esp3dScheduling.getBootProfile()) {
+      // priorities are already applied but tasks stay on their core
+      answer = "ok, restart to apply cores";
+    }
+    if (!dispatchAnswer(msg, COMMAND_ID, json, hasError, answer.c_str())) {
+      esp3d_log_e("Error sending response to clients");
+    }
+    return;
+  }
+
+  if (json) {
+    tmpstr = "{\"cmd\":\"430\",\"status\":\"ok\",\"data\":[";
+  } else {
+    tmpstr = "Scheduling:\n";
+  }
+  msg->type = ESP3DMessageType::head;
+  if (!dispatch(msg, tmpstr.c_str())) {
+    esp3d_log_e("Error sending response to clients");
+    return;
+  }
+  tmpstr = esp3dScheduling.getProfileName(esp3dScheduling.getProfile());
+  if (esp3dScheduling.getProfile() != esp3dScheduling.getBootProfile()) {
+    tmpstr += " (boot: ";
+    tmpstr +=
+        esp3dScheduling.getProfileName(esp3dScheduling.getBootProfile());
+    tmpstr += ")";
+  }
+  if (!dispatchIdValue(json, "profile", tmpstr.c_str(), target, requestId,
+                       true)) {
+    return;
+  }
+#if ESP3D_DISPLAY_FEATURE
+  // level, number of changes, seconds spent in each level, merged updates
+  tmpstr = esp3dUiGovernor.getLevelName(esp3dUiGovernor.getLevel());
+  tmpstr += " changes: ";
+  tmpstr += std::to_string(esp3dUiGovernor.getLevelChanges());
+  for (uint8_t l = 0; l < static_cast<uint8_t>(ESP3DUiGovernorLevel::count);
+       l++) {
+    ESP3DUiGovernorLevel level = static_cast<ESP3DUiGovernorLevel>(l);
+    tmpstr += " ";
+    tmpstr += esp3dUiGovernor.getLevelName(level);
+    tmpstr += ": ";
+    tmpstr += std::to_string(esp3dUiGovernor.getLevelDuration(level) / 1000);
+    tmpstr += "s";
+  }
+  tmpstr += " merged: ";
+  tmpstr += std::to_string(esp3dTftValues.getCoalescedCount());
+  tmpstr += " stream: ";
+  tmpstr += std::to_string(esp3dUiGovernor.getLinesRate());
+  tmpstr += " lines/s";
+  if (!dispatchIdValue(json, "ui governor", tmpstr.c_str(), target,
+                       requestId)) {
+    return;
+  }
+#endif  // ESP3D_DISPLAY_FEATURE
+  ESP3DTaskUsage* tasks = (ESP3DTaskUsage*)malloc(
+      ESP3D_SCHEDULING_MAX_TASKS * sizeof(ESP3DTaskUsage));
+  int count = tasks ? esp3dScheduling.getTasksUsage(
+                          tasks, ESP3D_SCHEDULING_MAX_TASKS)
+                    : 0;
+  if (count < 0) {
+    if (!dispatchIdValue(json, "tasks",
+                         "CPU usage needs "
+                         "CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS",
+                         target, requestId)) {
+      free(tasks);
+      return;
+    }
+  }
+  for (int i = 0; i < count; i++) {
+    tmpstr = "core: ";
+    tmpstr += tasks[i].core < 0 ? "any" : std::to_string(tasks[i].core);
+    tmpstr += " priority: ";
+    tmpstr += std::to_string(tasks[i].priority);
+    tmpstr += " cpu: ";
+    tmpstr += std::to_string(tasks[i].usage);
+    tmpstr += "%";
+    if (!dispatchIdValue(json, tasks[i].name, tmpstr.c_str(), target,
+                         requestId)) {
+      free(tasks);
+      return;
+    }
+  }
+  free(tasks);
+
+  // end of list
+  if (json) {
+    tmpstr = "]}";
+  } else {
+    tmpstr = "ok\n";
+  }
+  if (!dispatch(tmpstr.c_str(), target, requestId, ESP3DMessageType::tail)) {
+    esp3d_log_e("Error sending answer to clients");
+  }
+}
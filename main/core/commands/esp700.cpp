@@ -26,6 +26,7 @@
 
 // Read / Stream  / Process FS file
 //[ESP700]<filename> json=<no> pwd=<admin/user password>
+//[ESP700]stream=<filename> line=<line> json=<no> pwd=<admin/user password>
 void ESP3DCommands::ESP700(int cmd_params_pos, ESP3DMessage* msg) {
   ESP3DClientType target = msg->origin;
   ESP3DRequest requestId = msg->request_id;
@@ -50,15 +51,23 @@ void ESP3DCommands::ESP700(int cmd_params_pos, ESP3DMessage* msg) {
     esp3d_log_e("Error missing");
   } else {
     bool isMacro = true;
+    uint32_t startLine = 0;
     std::string filename = get_param(msg, cmd_params_pos, "stream=");
     if (filename.length() > 0) {  // it is a stream
       isMacro = false;
+      // restart from a line, only available with tokens file (see ESP703),
+      // line is the record number in tokens file, comments and blank lines
+      // of source file are not counted
+      tmpstr = get_param(msg, cmd_params_pos, "line=");
+      if (tmpstr.length() > 0) {
+        startLine = strtoul(tmpstr.c_str(), nullptr, 10);
+      }
     } else {  // it is a macro
       filename = get_clean_param(msg, cmd_params_pos);
     }
     esp3d_log("Stream: %s", filename.c_str());
     if (gcodeHostService.addStream(filename.c_str(), msg->authentication_level,
-                                   isMacro)) {
+                                   isMacro, startLine)) {
       esp3d_log("Stream: %s added as %s", filename.c_str(),
                 isMacro ? "Macro" : "File");
     } else {
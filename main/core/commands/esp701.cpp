@@ -27,6 +27,8 @@
 
 // Query and Control ESP700 stream
 //[ESP701]action=<PAUSE/RESUME/ABORT> json=<no> pwd=<admin/user password>`
+// PAUSE can be delayed to first line of a layer with layer=<n>, layer=0
+// cancels it, or to next travel move with travel (travel=no cancels it)
 void ESP3DCommands::ESP701(int cmd_params_pos, ESP3DMessage* msg) {
   ESP3DClientType target = msg->origin;
   ESP3DRequest requestId = msg->request_id;
@@ -91,6 +93,28 @@ void ESP3DCommands::ESP701(int cmd_params_pos, ESP3DMessage* msg) {
             ok_msg += std::to_string(script->processedSize);
             ok_msg += "\",\"elapsed\":\"";
             ok_msg += std::to_string(esp3d_hal::millis() - script->id);
+            ok_msg += "\",\"layer\":\"";
+            ok_msg += std::to_string(gcodeHostService.getLayer());
+            ok_msg += "\",\"remaining\":\"";
+            ok_msg += std::to_string(gcodeHostService.getRemainingTime());
+            if (gcodeHostService.getPauseLayer() != 0) {
+              ok_msg += "\",\"pause_layer\":\"";
+              ok_msg += std::to_string(gcodeHostService.getPauseLayer());
+            }
+            if (gcodeHostService.isPauseAtTravel()) {
+              ok_msg += "\",\"pause_travel\":\"yes";
+            }
+            const ESP3DLinkQualityStats& link =
+                gcodeHostService.getLinkStats();
+            ok_msg += "\",\"resends\":\"";
+            ok_msg += std::to_string(link.resends);
+            ok_msg += "\",\"link_errors\":\"";
+            ok_msg += std::to_string(link.errors + link.timeouts +
+                                     link.rx_overflows);
+            ok_msg += "\",\"ack_latency\":\"";
+            ok_msg += std::to_string(link.ack_latency);
+            ok_msg += "\",\"line_spacing\":\"";
+            ok_msg += std::to_string(gcodeHostService.getLineSpacing());
             ok_msg += "\",\"type\":\"";
             ok_msg += std::to_string(static_cast<uint8_t>(script->type));
             if (script->type == ESP3DGcodeHostStreamType::sd_stream ||
@@ -110,7 +134,22 @@ void ESP3DCommands::ESP701(int cmd_params_pos, ESP3DMessage* msg) {
     }
   } else {
     // send command PAUSE/RESUME/ABORT
-    if (tmpstr == "PAUSE") {
+    std::string layer = get_param(msg, cmd_params_pos, "layer=");
+    bool travel = hasTag(msg, cmd_params_pos, "travel");
+    if (tmpstr == "PAUSE" && layer.length() > 0) {
+      char* end = nullptr;
+      long value = strtol(layer.c_str(), &end, 10);
+      if (*end != 0 || value < 0) {
+        hasError = true;
+        error_msg = "Invalid layer";
+      } else {
+        gcodeHostService.pauseAtLayer(value);
+      }
+    } else if (tmpstr == "PAUSE" &&
+               (travel ||
+                get_param(msg, cmd_params_pos, "travel=").length() > 0)) {
+      gcodeHostService.pauseAtTravel(travel);
+    } else if (tmpstr == "PAUSE") {
       if (!gcodeHostService.pause()) {
         hasError = true;
         error_msg = "Failed to pause";
@@ -0,0 +1,98 @@
+/*
+  esp3d_commands member
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "authentication/esp3d_authentication.h"
+#include "esp3d_client.h"
+#include "esp3d_commands.h"
+#include "esp3d_string.h"
+#include "filesystem/esp3d_globalfs.h"
+#include "gcode_host/esp3d_gcode_tokenizer.h"
+
+#define COMMAND_ID 703
+
+// Tokenize G-code file for ESP700 stream, comments are stripped and lines
+// are indexed so stream can be restarted at any line. Tokenization runs in
+// background, result is sent to all clients when done, without file name
+// current tokenization is reported
+//[ESP703]<filename> json=<no> pwd=<admin/user password>
+void ESP3DCommands::ESP703(int cmd_params_pos, ESP3DMessage* msg) {
+  ESP3DClientType target = msg->origin;
+  ESP3DRequest requestId = msg->request_id;
+  (void)requestId;
+  msg->target = target;
+  msg->origin = ESP3DClientType::command;
+  bool hasError = false;
+  std::string error_msg = "Invalid parameters";
+  std::string ok_msg = "ok";
+  bool json = hasTag(msg, cmd_params_pos, "json");
+  std::string tmpstr;
+#if ESP3D_AUTHENTICATION_FEATURE
+  if (msg->authentication_level == ESP3DAuthenticationLevel::guest) {
+    dispatchAuthenticationError(msg, COMMAND_ID, json);
+    return;
+  }
+#endif  // ESP3D_AUTHENTICATION_FEATURE
+  tmpstr = get_clean_param(msg, cmd_params_pos);
+  if (tmpstr.length() == 0) {
+    std::string filename;
+    uint8_t progress = 0;
+    bool running = ESP3DGcodeTokenizer::getBuildStatus(&filename, &progress);
+    if (json) {
+      ok_msg = "{\"status\":\"";
+      ok_msg += running ? "processing" : "idle";
+      ok_msg += "\"";
+      if (running) {
+        ok_msg += ",\"file\":\"";
+        esp3d_string::appendJson(ok_msg, filename);
+        ok_msg += "\",\"progress\":\"";
+        ok_msg += std::to_string(progress);
+        ok_msg += "\"";
+      }
+      ok_msg += "}";
+    } else if (running) {
+      ok_msg = filename + " " + std::to_string(progress) + "%";
+    } else {
+      ok_msg = "idle";
+    }
+  } else if (ESP3DGcodeTokenizer::isBuilding()) {
+    hasError = true;
+    error_msg = "Tokenization already running";
+    esp3d_log_e("Tokenization already running");
+  } else if (!globalFs.accessFS(tmpstr.c_str())) {
+    hasError = true;
+    error_msg = "Cannot access file system";
+    esp3d_log_e("Cannot access file system");
+  } else if (!globalFs.exists(tmpstr.c_str())) {
+    hasError = true;
+    error_msg = "File not found";
+    esp3d_log_e("File not found: %s", tmpstr.c_str());
+    globalFs.releaseFS(tmpstr.c_str());
+  } else if (!ESP3DGcodeTokenizer::startBuild(tmpstr.c_str())) {
+    // file system is released by task only if it started
+    hasError = true;
+    error_msg = "Tokenization failed";
+    esp3d_log_e("Tokenization failed: %s", tmpstr.c_str());
+    globalFs.releaseFS(tmpstr.c_str());
+  } else {
+    ok_msg = "Tokenizing " + tmpstr;
+  }
+  if (!dispatchAnswer(msg, COMMAND_ID, json, hasError,
+                      hasError ? error_msg.c_str() : ok_msg.c_str())) {
+    esp3d_log_e("Error sending response to clients");
+  }
+}
@@ -0,0 +1,149 @@
+/*
+  esp3d_commands member
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include <stdlib.h>
+
+#include "authentication/esp3d_authentication.h"
+#include "esp3d_client.h"
+#include "esp3d_commands.h"
+#include "esp3d_events.h"
+#include "esp3d_string.h"
+#include "filesystem/esp3d_globalfs.h"
+#include "gcode_host/esp3d_gcode_host_service.h"
+#include "gcode_host/esp3d_job_queue.h"
+
+#define COMMAND_ID 704
+
+// Query and control job queue, files are printed one after the other with
+// their own start and end scripts
+//[ESP704]action=<ADD/REMOVE/CLEAR/START/STOP> file=<file name>
+// start=<script> end=<script> index=<job index> json=<no>
+// pwd=<admin/user password>
+void ESP3DCommands::ESP704(int cmd_params_pos, ESP3DMessage* msg) {
+  ESP3DClientType target = msg->origin;
+  ESP3DRequest requestId = msg->request_id;
+  (void)requestId;
+  msg->target = target;
+  msg->origin = ESP3DClientType::command;
+  bool hasError = false;
+  std::string error_msg = "Invalid parameters";
+  std::string ok_msg = "ok";
+  bool json = hasTag(msg, cmd_params_pos, "json");
+  std::string tmpstr;
+#if ESP3D_AUTHENTICATION_FEATURE
+  if (msg->authentication_level == ESP3DAuthenticationLevel::guest) {
+    dispatchAuthenticationError(msg, COMMAND_ID, json);
+    return;
+  }
+#endif  // ESP3D_AUTHENTICATION_FEATURE
+  tmpstr = get_param(msg, cmd_params_pos, "action=");
+  if (tmpstr.length() == 0) {
+    ESP3DJob job;
+    size_t size = esp3dJobQueue.size();
+    const char* status = esp3dJobQueue.isRunning() ? "running" : "stopped";
+    if (json) {
+      ok_msg = "{\"status\":\"";
+      ok_msg += status;
+      ok_msg += "\",\"jobs\":[";
+    } else {
+      ok_msg = status;
+      ok_msg += "\n";
+    }
+    for (size_t i = 0; i < size && esp3dJobQueue.get(i, &job); i++) {
+      if (json) {
+        if (i != 0) {
+          ok_msg += ",";
+        }
+        ok_msg += "{\"index\":\"";
+        ok_msg += std::to_string(i);
+        ok_msg += "\",\"file\":\"";
+        esp3d_string::appendJson(ok_msg, job.filename);
+        ok_msg += "\",\"start\":\"";
+        esp3d_string::appendJson(ok_msg, job.start_script);
+        ok_msg += "\",\"end\":\"";
+        esp3d_string::appendJson(ok_msg, job.end_script);
+        ok_msg += "\"}";
+      } else {
+        ok_msg += std::to_string(i);
+        ok_msg += ": ";
+        ok_msg += job.filename;
+        ok_msg += "\n";
+      }
+    }
+    if (json) {
+      ok_msg += "]}";
+    }
+  } else if (tmpstr == "ADD") {
+    ESP3DJob job;
+    job.filename = get_param(msg, cmd_params_pos, "file=");
+    job.start_script = get_param(msg, cmd_params_pos, "start=");
+    job.end_script = get_param(msg, cmd_params_pos, "end=");
+    job.auth_type = msg->authentication_level;
+    // file is checked when job is prepared or started, SD is busy while
+    // printing so jobs can be added during a print
+    ESP3DFileSystemType fs = globalFs.getFSType(job.filename.c_str());
+    if (fs != ESP3DFileSystemType::flash && fs != ESP3DFileSystemType::sd) {
+      hasError = true;
+      error_msg = "Invalid file";
+    } else if (!ESP3DJobQueue::isValidField(job.filename) ||
+               !ESP3DJobQueue::isValidField(job.start_script) ||
+               !ESP3DJobQueue::isValidField(job.end_script)) {
+      hasError = true;
+      error_msg = "Invalid token parameter";
+    } else if (!esp3dJobQueue.add(job)) {
+      hasError = true;
+      error_msg = esp3dJobQueue.size() >= ESP3D_JOB_QUEUE_MAX_SIZE
+                      ? "Job queue is full"
+                      : "Failed to add job";
+    }
+  } else if (tmpstr == "REMOVE") {
+    std::string index = get_param(msg, cmd_params_pos, "index=");
+    char* end = nullptr;
+    long value = strtol(index.c_str(), &end, 10);
+    if (index.length() == 0 || *end != 0 || value < 0) {
+      hasError = true;
+      error_msg = "Invalid index";
+    } else if (!esp3dJobQueue.remove(value)) {
+      hasError = true;
+      error_msg = "Failed to remove job";
+    }
+  } else if (tmpstr == "CLEAR") {
+    if (!esp3dJobQueue.clear()) {
+      hasError = true;
+      error_msg = "Failed to clear job queue";
+    }
+  } else if (tmpstr == "START") {
+    if (esp3dJobQueue.size() == 0) {
+      hasError = true;
+      error_msg = "Job queue is empty";
+    } else {
+      esp3dJobQueue.start();
+      esp3dEvents.notify(ESP3DEventConsumer::gcode_host);
+    }
+  } else if (tmpstr == "STOP") {
+    // current job is finished, next ones are kept in queue
+    esp3dJobQueue.stop();
+  } else {
+    hasError = true;
+    error_msg = "Invalid parameters";
+  }
+  if (!dispatchAnswer(msg, COMMAND_ID, json, hasError,
+                      hasError ? error_msg.c_str() : ok_msg.c_str())) {
+    esp3d_log_e("Error sending response to clients");
+  }
+}
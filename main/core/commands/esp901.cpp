@@ -22,10 +22,14 @@
 #include "esp3d_commands.h"
 #include "esp3d_settings.h"
 #include "esp3d_string.h"
+#include "gcode_host/esp3d_gcode_host_service.h"
+#include "serial/esp3d_serial_client.h"
 
 #define COMMAND_ID 901
 // Set Serial baudrate
 //[ESP901]<baude rate> json=<no> pwd=<admin password>
+// PROBE finds baud rate printer answers at and saves it, it runs in serial
+// rx task and result is sent to all clients when done
 void ESP3DCommands::ESP901(int cmd_params_pos, ESP3DMessage* msg) {
   ESP3DClientType target = msg->origin;
   ESP3DRequest requestId = msg->request_id;
@@ -49,6 +53,17 @@ void ESP3DCommands::ESP901(int cmd_params_pos, ESP3DMessage* msg) {
     uint32_t br =
         esp3dTftsettings.readUint32(ESP3DSettingIndex::esp3d_baud_rate);
     ok_msg = std::to_string(br);
+  } else if (tmpstr == "PROBE") {
+    if (esp3dCommands.getOutputClient() != ESP3DClientType::serial ||
+        gcodeHostService.getState() != ESP3DGcodeHostState::idle) {
+      hasError = true;
+      error_msg = "Serial is busy";
+    } else if (!serialClient.requestProbe()) {
+      hasError = true;
+      error_msg = "Probe already running";
+    } else {
+      ok_msg = "Probing";
+    }
   } else {
 #if ESP3D_AUTHENTICATION_FEATURE
     if (msg->authentication_level != ESP3DAuthenticationLevel::admin) {
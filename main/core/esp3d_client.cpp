@@ -38,6 +38,7 @@ ESP3DClient::ESP3DClient() {
   _tx_max_size = 1024;
   _rx_mutex = nullptr;
   _tx_mutex = nullptr;
+  _event_consumer = ESP3DEventConsumer::none;
 }
 bool ESP3DClient::clearRxQueue() {
   while (!_rx_queue.empty()) {
@@ -111,6 +112,9 @@ bool ESP3DClient::addRxData(ESP3DMessage* msg) {
       pthread_mutex_unlock(_rx_mutex);
     }
   }
+  if (res) {
+    esp3dEvents.notify(_event_consumer);
+  }
   return res;
 }
 bool ESP3DClient::addTxData(ESP3DMessage* msg) {
@@ -130,6 +134,9 @@ bool ESP3DClient::addTxData(ESP3DMessage* msg) {
   } else {
     esp3d_log_e("no mutex available");
   }
+  if (res) {
+    esp3dEvents.notify(_event_consumer);
+  }
   return res;
 }
 bool ESP3DClient::addFrontTxData(ESP3DMessage* msg) {
@@ -144,6 +151,9 @@ bool ESP3DClient::addFrontTxData(ESP3DMessage* msg) {
       pthread_mutex_unlock(_tx_mutex);
     }
   }
+  if (res) {
+    esp3dEvents.notify(_event_consumer);
+  }
   return res;
 }
 
@@ -158,6 +168,9 @@ ESP3DMessage* ESP3DClient::newMsg() {
     newMsgPtr->authentication_level = ESP3DAuthenticationLevel::guest;
     newMsgPtr->request_id.id = esp_timer_get_time();
     newMsgPtr->type = ESP3DMessageType::head;
+#if ESP3D_TFT_BENCHMARK
+    newMsgPtr->timestamp = esp_timer_get_time();
+#endif  // ESP3D_TFT_BENCHMARK
   }
   return newMsgPtr;
 }
@@ -180,6 +193,9 @@ bool ESP3DClient::copyMsgInfos(ESP3DMessage* newMsgPtr, ESP3DMessage msg) {
   newMsgPtr->authentication_level = msg.authentication_level;
   newMsgPtr->request_id = msg.request_id;
   newMsgPtr->type = msg.type;
+#if ESP3D_TFT_BENCHMARK
+  newMsgPtr->timestamp = msg.timestamp;
+#endif  // ESP3D_TFT_BENCHMARK
   return true;
 }
 
@@ -197,6 +213,9 @@ ESP3DMessage* ESP3DClient::copyMsg(ESP3DMessage msg) {
   if (newMsgPtr) {
     newMsgPtr->request_id = msg.request_id;
     newMsgPtr->type = msg.type;
+#if ESP3D_TFT_BENCHMARK
+    newMsgPtr->timestamp = msg.timestamp;
+#endif  // ESP3D_TFT_BENCHMARK
   }
   return newMsgPtr;
 }
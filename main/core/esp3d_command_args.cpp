@@ -0,0 +1,124 @@
+/*
+  esp3d_command_args
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "esp3d_command_args.h"
+
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+
+#include "esp3d_client.h"
+#include "esp3d_log.h"
+
+ESP3DCommandArgs::ESP3DCommandArgs() {
+  _msg = nullptr;
+  _start = 0;
+  _valid = false;
+  _count = 0;
+}
+
+// Same rules as ESP3DCommands::get_param(): arguments are separated by
+// spaces, a '\' escapes next char and is never part of the value
+bool ESP3DCommandArgs::parse(ESP3DMessage *msg, uint start) {
+  _msg = msg;
+  _start = start;
+  _valid = false;
+  _count = 0;
+  if (!msg || !msg->data) {
+    return false;
+  }
+  size_t pos = 0;
+  bool escaped = false;
+  bool inArg = false;
+  for (uint i = start; i < msg->size; i++) {
+    char c = (char)msg->data[i];
+    if (c == '\\') {
+      escaped = true;
+      continue;
+    }
+    if (isspace((uint8_t)c) && !escaped) {
+      if (inArg) {
+        _buffer[pos++] = 0;
+        inArg = false;
+      }
+      continue;
+    }
+    escaped = false;
+    if (!inArg) {
+      if (_count == ESP3D_COMMAND_ARGS_MAX) {
+        esp3d_log_w("Too many arguments");
+        return false;
+      }
+      _args[_count++] = &_buffer[pos];
+      inArg = true;
+    }
+    // keep room for final 0
+    if (pos + 1 >= ESP3D_COMMAND_ARGS_SIZE) {
+      esp3d_log_w("Arguments are too long");
+      return false;
+    }
+    _buffer[pos++] = c;
+  }
+  if (inArg) {
+    _buffer[pos] = 0;
+  }
+  _valid = true;
+  return true;
+}
+
+const char *ESP3DCommandArgs::get(const char *label) {
+  size_t len = strlen(label);
+  for (uint8_t i = 0; i < _count; i++) {
+    if (strncmp(_args[i], label, len) == 0) {
+      return _args[i] + len;
+    }
+  }
+  return nullptr;
+}
+
+bool ESP3DCommandArgs::hasTag(const char *label) {
+  size_t len = strlen(label);
+  bool found = false;
+  for (uint8_t i = 0; i < _count; i++) {
+    if (strncmp(_args[i], label, len) != 0) {
+      continue;
+    }
+    // label=value has priority on label alone
+    if (_args[i][len] == '=') {
+      const char *value = _args[i] + len + 1;
+      return strcasecmp(value, "YES") == 0 || strcmp(value, "1") == 0 ||
+             strcasecmp(value, "TRUE") == 0;
+    }
+    if (_args[i][len] == 0) {
+      found = true;
+    }
+  }
+  return found;
+}
+
+const char *ESP3DCommandArgs::getClean() {
+  for (uint8_t i = 0; i < _count; i++) {
+    if (strcmp(_args[i], "json") != 0 && strncmp(_args[i], "json=", 5) != 0 &&
+        strncmp(_args[i], "pwd=", 4) != 0) {
+      return _args[i];
+    }
+  }
+  return "";
+}
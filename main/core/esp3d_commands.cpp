@@ -19,6 +19,7 @@
 
 #include "esp3d_commands.h"
 
+#include "esp3d_command_args.h"
 #include "esp3d_settings.h"
 #include "http/esp3d_http_service.h"
 #include "serial/esp3d_serial_client.h"
@@ -45,6 +46,12 @@
 #include "esp3d_string.h"
 #include "gcode_host/esp3d_gcode_host_service.h"
 
+#if ESP3D_TFT_BENCHMARK
+#include "esp_timer.h"
+// runs of each command for each parameters reading
+#define BENCHMARK_LOOPS 20
+#endif  // ESP3D_TFT_BENCHMARK
+
 #if ESP3D_TFT_LOG
 static const char* esp3dclientstr[] = {
     "no_client",  "serial",          "usb_serial", "stream",    "telnet",
@@ -677,11 +684,211 @@ bool ESP3DCommands::dispatch(ESP3DMessage* msg) {
   return sendOk;
 }
 
+// Parameters of file actions commands
+#define FS_ACTIONS "rmdir= remove= mkdir= exists= create="
+
+#define ESP3D_COMMAND(id, level, params)                                \
+  {id, &ESP3DCommands::ESP##id, ESP3DAuthenticationLevel::level, params, \
+   ESP3DCommandOutput::plain_json}
+
+// Commands table, sorted by id so lookup is a binary search, checked at
+// build time
+static constexpr ESP3DCommandDescription commandsTable[] = {
+    ESP3D_COMMAND(0, guest, ""),
+#if ESP3D_WIFI_FEATURE
+    ESP3D_COMMAND(100, user, ""),
+    ESP3D_COMMAND(101, admin, "NOPASSWORD"),
+    ESP3D_COMMAND(102, user, ""),
+    ESP3D_COMMAND(103, user, "IP= MSK= GW= DNS="),
+    ESP3D_COMMAND(104, user, ""),
+    ESP3D_COMMAND(105, user, ""),
+    ESP3D_COMMAND(106, admin, "NOPASSWORD"),
+    ESP3D_COMMAND(107, user, ""),
+    ESP3D_COMMAND(108, user, ""),
+#endif  // ESP3D_WIFI_FEATURE
+    ESP3D_COMMAND(110, user, ""),
+#if ESP3D_WIFI_FEATURE
+    ESP3D_COMMAND(111, user, "ALL"),
+#endif  // ESP3D_WIFI_FEATURE
+    ESP3D_COMMAND(112, user, ""),
+    ESP3D_COMMAND(114, user, ""),
+    ESP3D_COMMAND(115, user, ""),
+#if ESP3D_HTTP_FEATURE
+    ESP3D_COMMAND(120, user, ""),
+    ESP3D_COMMAND(121, user, ""),
+#endif  // ESP3D_HTTP_FEATURE
+#if ESP3D_TELNET_FEATURE
+    ESP3D_COMMAND(130, user, "ON OFF CLOSE"),
+    ESP3D_COMMAND(131, user, ""),
+#endif  // ESP3D_TELNET_FEATURE
+#if ESP3D_TIMESTAMP_FEATURE
+    ESP3D_COMMAND(140, user, "srv1= srv2= srv3= tzone= ntp= time= now sync"),
+#endif  // ESP3D_TIMESTAMP_FEATURE
+#if ESP3D_HTTP_FEATURE && ESP3D_WS_SERVICE_FEATURE
+    ESP3D_COMMAND(160, user, "ON OFF CLOSE"),
+#endif  // ESP3D_HTTP_FEATURE && ESP3D_WS_SERVICE_FEATURE
+#if ESP3D_HTTP_FEATURE && ESP3D_CAMERA_FEATURE
+    ESP3D_COMMAND(170, user, nullptr),
+    ESP3D_COMMAND(171, user, "path= filename="),
+#endif  // ESP3D_HTTP_FEATURE && ESP3D_CAMERA_FEATURE
+#if ESP3D_HTTP_FEATURE && ESP3D_WEBDAV_SERVICES_FEATURE
+    ESP3D_COMMAND(190, user, "ON OFF"),
+#endif  // ESP3D_HTTP_FEATURE && ESP3D_WEBDAV_SERVICES_FEATURE
+#if ESP3D_SD_CARD_FEATURE
+    ESP3D_COMMAND(200, user, "REFRESH RELEASE"),
+#endif  // ESP3D_SD_CARD_FEATURE
+#if ESP3D_SD_CARD_FEATURE && ESP3D_SD_IS_SPI
+    ESP3D_COMMAND(202, user, ""),
+#endif  // ESP3D_SD_CARD_FEATURE && ESP3D_SD_IS_SPI
+#if ESP3D_DISPLAY_FEATURE
+    ESP3D_COMMAND(214, user, ""),
+#endif  // ESP3D_DISPLAY_FEATURE
+#if ESP3D_DISPLAY_FEATURE && LV_USE_SNAPSHOT
+    ESP3D_COMMAND(216, user, ""),
+#endif  // ESP3D_DISPLAY_FEATURE && LV_USE_SNAPSHOT
+    ESP3D_COMMAND(400, user, ""),
+    ESP3D_COMMAND(401, admin, "P= T= V="),
+#if ESP3D_SD_CARD_FEATURE && ESP3D_UPDATE_FEATURE
+    ESP3D_COMMAND(402, user, ""),
+#endif  // ESP3D_SD_CARD_FEATURE && ESP3D_UPDATE_FEATURE
+#if ESP3D_WIFI_FEATURE
+    ESP3D_COMMAND(410, user, ""),
+#endif  // ESP3D_WIFI_FEATURE
+    ESP3D_COMMAND(420, user, "addPreTag"),
+    ESP3D_COMMAND(430, user, ""),
+    ESP3D_COMMAND(444, admin, "RESET RESTART"),
+#if ESP3D_MDNS_FEATURE
+    ESP3D_COMMAND(450, user, ""),
+#endif  // ESP3D_MDNS_FEATURE
+    ESP3D_COMMAND(460, user, "DUMP"),
+#if ESP3D_AUTHENTICATION_FEATURE
+    ESP3D_COMMAND(500, guest, "logout"),
+    ESP3D_COMMAND(510, user, ""),
+    ESP3D_COMMAND(550, admin, ""),
+    ESP3D_COMMAND(555, user, ""),
+#endif  // ESP3D_AUTHENTICATION_FEATURE
+#if ESP3D_NOTIFICATIONS_FEATURE
+    ESP3D_COMMAND(600, user, ""),
+    ESP3D_COMMAND(610, user, "type= T1= T2= TS= AUTO="),
+#endif  // ESP3D_NOTIFICATIONS_FEATURE
+    ESP3D_COMMAND(700, user, "stream= line="),
+    ESP3D_COMMAND(701, user, "action= layer= travel="),
+    ESP3D_COMMAND(702, user, "pause= stop= resume="),
+    ESP3D_COMMAND(703, user, ""),
+    ESP3D_COMMAND(704, user, "action= file= start= end= index="),
+    ESP3D_COMMAND(710, admin, "FORMATFS"),
+    ESP3D_COMMAND(720, user, ""),
+    ESP3D_COMMAND(730, user, FS_ACTIONS),
+#if ESP3D_SD_CARD_FEATURE
+    ESP3D_COMMAND(740, user, ""),
+    ESP3D_COMMAND(750, user, FS_ACTIONS),
+#endif  // ESP3D_SD_CARD_FEATURE
+    ESP3D_COMMAND(780, user, ""),
+    ESP3D_COMMAND(790, user, FS_ACTIONS),
+    ESP3D_COMMAND(800, user, "time= tz= setup="),
+    ESP3D_COMMAND(900, user, "ENABLE DISABLE"),
+    ESP3D_COMMAND(901, admin, "PROBE"),
+#if ESP3D_USB_SERIAL_FEATURE
+    ESP3D_COMMAND(902, admin, ""),
+    ESP3D_COMMAND(950, user, "SERIAL USB"),
+#endif  // ESP3D_USB_SERIAL_FEATURE
+};
+
+#define COMMANDS_COUNT (sizeof(commandsTable) / sizeof(commandsTable[0]))
+
+static constexpr bool isSorted(const ESP3DCommandDescription* table,
+                               size_t size) {
+  return size < 2 ||
+         (table[0].id < table[1].id && isSorted(table + 1, size - 1));
+}
+
+static_assert(isSorted(commandsTable, COMMANDS_COUNT),
+              "Commands table must be sorted by id");
+
+// Arguments of command running in current task, if they could be split
+static thread_local ESP3DCommandArgs* current_args = nullptr;
+// Can be disabled to compare with parameters read from message
+static bool use_args = true;
+
+const ESP3DCommandDescription* ESP3DCommands::getCommand(uint16_t id) {
+  size_t low = 0;
+  size_t high = COMMANDS_COUNT;
+  while (low < high) {
+    size_t mid = (low + high) / 2;
+    if (commandsTable[mid].id == id) {
+      return &commandsTable[mid];
+    }
+    if (commandsTable[mid].id < id) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return nullptr;
+}
+
+// Same rules as commands: guest is only refused, admin is only accepted
+static bool isAllowed(ESP3DAuthenticationLevel current,
+                      ESP3DAuthenticationLevel level) {
+#if ESP3D_AUTHENTICATION_FEATURE
+  switch (level) {
+    case ESP3DAuthenticationLevel::guest:
+      return true;
+    case ESP3DAuthenticationLevel::user:
+      return current != ESP3DAuthenticationLevel::guest;
+    default:
+      return current == ESP3DAuthenticationLevel::admin;
+  }
+#else
+  (void)current;
+  (void)level;
+  return true;
+#endif  // ESP3D_AUTHENTICATION_FEATURE
+}
+
+#if ESP3D_TFT_LOG >= ESP3D_TFT_LOG_LEVEL_ALL
+// Only label=value arguments can be checked, a tag cannot be told apart from
+// a value
+static void checkParams(const ESP3DCommandDescription* command,
+                        ESP3DCommandArgs* args) {
+  if (!command->params) {
+    return;
+  }
+  for (uint8_t i = 0; i < args->count(); i++) {
+    const char* arg = args->at(i);
+    const char* equal = strchr(arg, '=');
+    if (!equal || strncmp(arg, "json=", 5) == 0 ||
+        strncmp(arg, "pwd=", 4) == 0) {
+      continue;
+    }
+    size_t len = equal - arg + 1;
+    bool known = false;
+    const char* p = command->params;
+    while (*p && !known) {
+      const char* end = strchr(p, ' ');
+      size_t size = end ? end - p : strlen(p);
+      known = size == len && strncmp(p, arg, len) == 0;
+      p += size;
+      while (*p == ' ') {
+        p++;
+      }
+    }
+    if (!known) {
+      esp3d_log_w("Unknown parameter %.*s for [ESP%d]", (int)len, arg,
+                  command->id);
+    }
+  }
+}
+#endif  // ESP3D_TFT_LOG >= ESP3D_TFT_LOG_LEVEL_ALL
+
 bool ESP3DCommands::hasTag(ESP3DMessage* msg, uint start, const char* label) {
   if (!msg) {
     esp3d_log_e("no msg for tag %s", label);
     return false;
   }
+  if (current_args && current_args->isFor(msg, start)) {
+    return current_args->hasTag(label);
+  }
   std::string lbl = label;
   // esp3d_log("checking message for tag %s", label);
   uint lenLabel = strlen(label);
@@ -735,6 +942,13 @@ const char* ESP3DCommands::get_param(ESP3DMessage* msg, uint start,
   if (!msg) {
     return "";
   }
+  if (current_args && current_args->isFor(msg, start)) {
+    const char* value = current_args->get(label);
+    if (found) {
+      *found = value != nullptr;
+    }
+    return value ? value : "";
+  }
   return get_param((const char*)msg->data, msg->size, start, label, found);
 }
 
@@ -795,6 +1009,9 @@ const char* ESP3DCommands::get_clean_param(ESP3DMessage* msg, uint start) {
   if (!msg) {
     return "";
   }
+  if (current_args && current_args->isFor(msg, start)) {
+    return current_args->getClean();
+  }
   static std::string value;
   bool prevCharIsEscaped = false;
   uint startp = start;
@@ -841,6 +1058,13 @@ void ESP3DCommands::execute_internal_command(int cmd, int cmd_params_pos,
   if (!msg) {
     return;
   }
+  // arguments are split once for all parameters reads done by command,
+  // previous ones are restored in case of command run by another command
+  ESP3DCommandArgs args;
+  ESP3DCommandArgs* previous_args = current_args;
+  if (use_args && args.parse(msg, cmd_params_pos)) {
+    current_args = &args;
+  }
 #if ESP3D_AUTHENTICATION_FEATURE
   std::string pwd = get_param(msg, cmd_params_pos, "pwd=");
   if (!pwd.empty()) {  // adjust authentication level according
@@ -863,242 +1087,42 @@ void ESP3DCommands::execute_internal_command(int cmd, int cmd_params_pos,
   }
 #endif  // ESP3D_DISABLE_SERIAL_AUTHENTICATION_FEATURE
 #endif  // ESP3D_AUTHENTICATION_FEATURE
-
-  switch (cmd) {
-    case 0:
-      ESP0(cmd_params_pos, msg);
-      break;
-#if ESP3D_WIFI_FEATURE
-    case 100:
-      ESP100(cmd_params_pos, msg);
-      break;
-    case 101:
-      ESP101(cmd_params_pos, msg);
-      break;
-    case 102:
-      ESP102(cmd_params_pos, msg);
-      break;
-    case 103:
-      ESP103(cmd_params_pos, msg);
-      break;
-    case 104:
-      ESP104(cmd_params_pos, msg);
-      break;
-    case 105:
-      ESP105(cmd_params_pos, msg);
-      break;
-    case 106:
-      ESP106(cmd_params_pos, msg);
-      break;
-    case 107:
-      ESP107(cmd_params_pos, msg);
-      break;
-    case 108:
-      ESP108(cmd_params_pos, msg);
-      break;
-#endif  // ESP3D_WIFI_FEATURE
-    case 110:
-      ESP110(cmd_params_pos, msg);
-      break;
-#if ESP3D_WIFI_FEATURE
-    case 111:
-      ESP111(cmd_params_pos, msg);
-      break;
-#endif  // ESP3D_WIFI_FEATURE
-    case 112:
-      ESP112(cmd_params_pos, msg);
-      break;
-    case 114:
-      ESP114(cmd_params_pos, msg);
-      break;
-    case 115:
-      ESP115(cmd_params_pos, msg);
-      break;
-#if ESP3D_HTTP_FEATURE
-    case 120:
-      ESP120(cmd_params_pos, msg);
-      break;
-    case 121:
-      ESP121(cmd_params_pos, msg);
-      break;
-#endif  // ESP3D_HTTP_FEATURE
-
-#if ESP3D_TELNET_FEATURE
-    case 130:
-      ESP130(cmd_params_pos, msg);
-      break;
-    case 131:
-      ESP131(cmd_params_pos, msg);
-      break;
-#endif  // ESP3D_TELNET_FEATURE
-#if ESP3D_TIMESTAMP_FEATURE
-    case 140:
-      ESP140(cmd_params_pos, msg);
-      break;
-#endif  // ESP3D_TIMESTAMP_FEATURE
-#if ESP3D_HTTP_FEATURE
-#if ESP3D_WS_SERVICE_FEATURE
-    case 160:
-      ESP160(cmd_params_pos, msg);
-      break;
-#endif  // ESP3D_WS_SERVICE_FEATURE
-#if ESP3D_CAMERA_FEATURE
-    case 170:
-      ESP170(cmd_params_pos, msg);
-      break;
-    case 171:
-      ESP171(cmd_params_pos, msg);
-      break;
-#endif  // ESP3D_CAMERA_FEATURE
-#if ESP3D_WEBDAV_SERVICES_FEATURE
-    case 190:
-      ESP190(cmd_params_pos, msg);
-      break;
-#endif  // ESP3D_WEBDAV_SERVICES_FEATURE
-#endif  // ESP3D_HTTP_FEATURE
-#if ESP3D_SD_CARD_FEATURE
-    case 200:
-      ESP200(cmd_params_pos, msg);
-      break;
-#if ESP3D_SD_IS_SPI
-    case 202:
-      ESP202(cmd_params_pos, msg);
-      break;
-#endif  // ESP3D_SD_IS_SPI
-#endif  // ESP3D_SD_CARD_FEATURE
-#if ESP3D_DISPLAY_FEATURE
-    case 214:
-      ESP214(cmd_params_pos, msg);
-      break;
-#if LV_USE_SNAPSHOT
-    case 216:
-      ESP216(cmd_params_pos, msg);
-      break;
-#endif  // LV_USE_SNAPSHOT
-#endif  // ESP3D_DISPLAY_FEATURE
-    case 400:
-      ESP400(cmd_params_pos, msg);
-      break;
-    case 401:
-      ESP401(cmd_params_pos, msg);
-      break;
-#if ESP3D_SD_CARD_FEATURE
-#if ESP3D_UPDATE_FEATURE
-    case 402:
-      ESP402(cmd_params_pos, msg);
-      break;
-#endif  // ESP3D_UPDATE_FEATURE
-#endif  // ESP3D_SD_CARD_FEATURE
-#if ESP3D_WIFI_FEATURE
-    case 410:
-      ESP410(cmd_params_pos, msg);
-      break;
-#endif  // ESP3D_WIFI_FEATURE
-    case 420:
-      ESP420(cmd_params_pos, msg);
-      break;
-    case 444:
-      ESP444(cmd_params_pos, msg);
-      break;
-#if ESP3D_MDNS_FEATURE
-    case 450:
-      ESP450(cmd_params_pos, msg);
-      break;
-#endif  // ESP3D_MDNS_FEATURE
-    case 460:
-      ESP460(cmd_params_pos, msg);
-      break;
-#if ESP3D_AUTHENTICATION_FEATURE
-    case 500:
-      ESP500(cmd_params_pos, msg);
-      break;
-    case 510:
-      ESP510(cmd_params_pos, msg);
-      break;
-    case 550:
-      ESP550(cmd_params_pos, msg);
-      break;
-    case 555:
-      ESP555(cmd_params_pos, msg);
-      break;
-#endif  // ESP3D_AUTHENTICATION_FEATURE
-#if ESP3D_NOTIFICATIONS_FEATURE
-    case 600:
-      ESP600(cmd_params_pos, msg);
-      break;
-    case 610:
-      ESP610(cmd_params_pos, msg);
-      break;
-#endif  // ESP3D_NOTIFICATIONS_FEATURE
-    case 700:
-      ESP700(cmd_params_pos, msg);
-      break;
-    case 701:
-      ESP701(cmd_params_pos, msg);
-      break;
-    case 702:
-      ESP702(cmd_params_pos, msg);
-      break;
-    case 710:
-      ESP710(cmd_params_pos, msg);
-      break;
-    case 720:
-      ESP720(cmd_params_pos, msg);
-      break;
-    case 730:
-      ESP730(cmd_params_pos, msg);
-      break;
-#if ESP3D_SD_CARD_FEATURE
-    case 740:
-      ESP740(cmd_params_pos, msg);
-      break;
-    case 750:
-      ESP750(cmd_params_pos, msg);
-      break;
-#endif  // ESP3D_SD_CARD_FEATURE
-    case 780:
-      ESP780(cmd_params_pos, msg);
-      break;
-    case 790:
-      ESP790(cmd_params_pos, msg);
-      break;
-    case 900:
-      ESP900(cmd_params_pos, msg);
-      break;
-    case 800:
-      ESP800(cmd_params_pos, msg);
-      break;
-    case 901:
-      ESP901(cmd_params_pos, msg);
-      break;
-#if ESP3D_USB_SERIAL_FEATURE
-
-    case 902:
-      ESP902(cmd_params_pos, msg);
-      break;
-    case 950:
-      ESP950(cmd_params_pos, msg);
-      break;
-#endif  // #if ESP3D_USB_SERIAL_FEATURE
-    default:
-      msg->target = msg->origin;
-      esp3d_log("Invalid Command: [ESP%d]", cmd);
-      if (hasTag(msg, cmd_params_pos, "json")) {
-        std::string tmpstr = "{\"cmd\":\"[ESP";
-        tmpstr += std::to_string(cmd);
-        tmpstr += "]\",\"status\":\"error\",\"data\":\"Invalid Command\"}";
-        if (!dispatch(msg, tmpstr.c_str())) {
-          esp3d_log_e("Out of memory");
-        }
-      } else {
-        std::string tmpstr = "Invalid Command: [ESP";
-        tmpstr += std::to_string(cmd);
-        tmpstr += "]\n";
-        if (!dispatch(msg, tmpstr.c_str())) {
-          esp3d_log_e("Out of memory");
-        }
+  const ESP3DCommandDescription* command = getCommand(cmd);
+  if (!command) {
+    msg->target = msg->origin;
+    esp3d_log("Invalid Command: [ESP%d]", cmd);
+    if (hasTag(msg, cmd_params_pos, "json")) {
+      std::string tmpstr = "{\"cmd\":\"[ESP";
+      tmpstr += std::to_string(cmd);
+      tmpstr += "]\",\"status\":\"error\",\"data\":\"Invalid Command\"}";
+      if (!dispatch(msg, tmpstr.c_str())) {
+        esp3d_log_e("Out of memory");
+      }
+    } else {
+      std::string tmpstr = "Invalid Command: [ESP";
+      tmpstr += std::to_string(cmd);
+      tmpstr += "]\n";
+      if (!dispatch(msg, tmpstr.c_str())) {
+        esp3d_log_e("Out of memory");
       }
+    }
+  } else if (!isAllowed(msg->authentication_level, command->level)) {
+    // same answer as command would do itself
+    bool json = command->output == ESP3DCommandOutput::json ||
+                (command->output == ESP3DCommandOutput::plain_json &&
+                 hasTag(msg, cmd_params_pos, "json"));
+    msg->target = msg->origin;
+    msg->origin = ESP3DClientType::command;
+    dispatchAuthenticationError(msg, cmd, json);
+  } else {
+#if ESP3D_TFT_LOG >= ESP3D_TFT_LOG_LEVEL_ALL
+    if (current_args == &args) {
+      checkParams(command, &args);
+    }
+#endif  // ESP3D_TFT_LOG >= ESP3D_TFT_LOG_LEVEL_ALL
+    (this->*(command->handler))(cmd_params_pos, msg);
   }
+  current_args = previous_args;
 }
 
 void ESP3DCommands::flush() { serialClient.flush(); }
@@ -1142,3 +1166,37 @@ ESP3DClientType ESP3DCommands::getOutputClient(bool fromSettings) {
             GETCLIENTSTR(_output_client));
   return _output_client;
 }
+
+#if ESP3D_TFT_BENCHMARK
+// Sequence sent by web UI at connection, answers are dropped as origin is
+// no_client, each command is run with split arguments then with parameters
+// read from message
+void ESP3DCommands::benchmark() {
+  const char* sequence[] = {"[ESP800]json=yes", "[ESP400]json=yes",
+                            "[ESP420]json=yes"};
+  for (uint8_t i = 0; i < sizeof(sequence) / sizeof(sequence[0]); i++) {
+    int64_t duration[2] = {0, 0};
+    for (uint8_t mode = 0; mode < 2; mode++) {
+      use_args = mode == 0;
+      for (uint loop = 0; loop < BENCHMARK_LOOPS; loop++) {
+        ESP3DMessage* msg = ESP3DClient::newMsg(
+            ESP3DClientType::no_client, ESP3DClientType::no_client,
+            (const uint8_t*)sequence[i], strlen(sequence[i]),
+            ESP3DAuthenticationLevel::admin);
+        if (!msg) {
+          esp3d_log_e("Out of memory");
+          use_args = true;
+          return;
+        }
+        int64_t start = esp_timer_get_time();
+        process(msg);
+        duration[mode] += esp_timer_get_time() - start;
+      }
+    }
+    esp3d_report("%s: split args %lld us, scanned params %lld us",
+                 sequence[i], duration[0] / BENCHMARK_LOOPS,
+                 duration[1] / BENCHMARK_LOOPS);
+  }
+  use_args = true;
+}
+#endif  // ESP3D_TFT_BENCHMARK
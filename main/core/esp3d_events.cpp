@@ -0,0 +1,95 @@
+/*
+  esp3d_events
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "esp3d_events.h"
+
+#include "esp3d_log.h"
+#include "freertos/task.h"
+
+#if ESP3D_TFT_BENCHMARK
+#include "esp_timer.h"
+// number of samples before reporting latency
+#define ESP3D_LATENCY_REPORT_SAMPLES 100
+#endif  // ESP3D_TFT_BENCHMARK
+
+#define GETEVENTBIT(consumer) ((EventBits_t)1 << static_cast<uint8_t>(consumer))
+
+ESP3DEvents esp3dEvents;
+
+// Event group is statically allocated so it can be used before any task is
+// started and without checking if creation succeeded
+ESP3DEvents::ESP3DEvents() {
+  _event_group = xEventGroupCreateStatic(&_event_group_buffer);
+#if ESP3D_TFT_BENCHMARK
+  _latency_min = INT64_MAX;
+  _latency_max = 0;
+  _latency_total = 0;
+  _latency_count = 0;
+#endif  // ESP3D_TFT_BENCHMARK
+}
+
+ESP3DEvents::~ESP3DEvents() {}
+
+void ESP3DEvents::notify(ESP3DEventConsumer consumer) {
+  if (consumer == ESP3DEventConsumer::none) {
+    return;
+  }
+  xEventGroupSetBits(_event_group, GETEVENTBIT(consumer));
+}
+
+bool ESP3DEvents::wait(ESP3DEventConsumer consumer, uint32_t timeout_ms) {
+  if (consumer == ESP3DEventConsumer::none) {
+    vTaskDelay(pdMS_TO_TICKS(timeout_ms));
+    return false;
+  }
+  // at least one tick to let lower priority tasks run
+  TickType_t ticks = pdMS_TO_TICKS(timeout_ms);
+  if (ticks == 0) {
+    ticks = 1;
+  }
+  EventBits_t bits = xEventGroupWaitBits(_event_group, GETEVENTBIT(consumer),
+                                         pdTRUE, pdFALSE, ticks);
+  return (bits & GETEVENTBIT(consumer)) != 0;
+}
+
+#if ESP3D_TFT_BENCHMARK
+void ESP3DEvents::addLatencySample(int64_t origin_us) {
+  if (origin_us <= 0) {
+    return;
+  }
+  int64_t latency = esp_timer_get_time() - origin_us;
+  if (latency < _latency_min) {
+    _latency_min = latency;
+  }
+  if (latency > _latency_max) {
+    _latency_max = latency;
+  }
+  _latency_total += latency;
+  _latency_count++;
+  if (_latency_count >= ESP3D_LATENCY_REPORT_SAMPLES) {
+    esp3d_report("Response to UI latency: min %lld us, avg %lld us, max %lld us",
+                 _latency_min, _latency_total / _latency_count, _latency_max);
+    _latency_min = INT64_MAX;
+    _latency_max = 0;
+    _latency_total = 0;
+    _latency_count = 0;
+  }
+}
+#endif  // ESP3D_TFT_BENCHMARK
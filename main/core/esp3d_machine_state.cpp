@@ -0,0 +1,134 @@
+/*
+  esp3d_machine_state
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "esp3d_machine_state.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp3d_log.h"
+
+ESP3DMachineState esp3dMachineState;
+
+ESP3DMachineState::ESP3DMachineState() {
+  _mutex = PTHREAD_MUTEX_INITIALIZER;
+  _version = 0;
+  memset(_slots, 0, sizeof(_slots));
+  init();
+}
+
+ESP3DMachineState::~ESP3DMachineState() { pthread_mutex_destroy(&_mutex); }
+
+bool ESP3DMachineState::update(ESP3DValuesIndex index, const char *value) {
+  uint8_t pos = 0;
+  while (pos < _fields_count && _fields[pos].index != index) {
+    pos++;
+  }
+  if (pos == _fields_count) {
+    return false;
+  }
+  if (!value) {
+    value = "";
+  }
+  bool changed = false;
+  if (pthread_mutex_lock(&_mutex) == 0) {
+    ESP3DMachineStateSlot &slot = _slots[pos];
+    if (_fields[pos].type == ESP3DMachineStateType::number) {
+      // same number in another format is not a change
+      char *end = nullptr;
+      double number = strtod(value, &end);
+      bool valid = end != value;
+      changed = slot.version == 0 || valid != slot.valid ||
+                (valid && number != slot.number);
+      slot.valid = valid;
+      slot.number = valid ? number : 0;
+    } else {
+      changed = slot.version == 0 || strncmp(slot.text, value,
+                                             sizeof(slot.text) - 1) != 0;
+      strncpy(slot.text, value, sizeof(slot.text) - 1);
+      slot.text[sizeof(slot.text) - 1] = 0;
+      slot.valid = true;
+    }
+    if (changed) {
+      _version++;
+      slot.version = _version;
+    }
+    if (pthread_mutex_unlock(&_mutex) != 0) {
+      esp3d_log_e("Cannot unlock mutex");
+    }
+  } else {
+    esp3d_log_e("Cannot lock mutex");
+  }
+  return changed;
+}
+
+void ESP3DMachineState::_addField(std::string &json, uint8_t pos) {
+  const ESP3DMachineStateSlot &slot = _slots[pos];
+  if (json.back() != '{') {
+    json += ",";
+  }
+  json += "\"";
+  json += _fields[pos].key;
+  json += "\":";
+  if (!slot.valid) {
+    json += "null";
+  } else if (_fields[pos].type == ESP3DMachineStateType::number) {
+    char number[24];
+    snprintf(number, sizeof(number), "%g", slot.number);
+    json += number;
+  } else {
+    json += "\"";
+    for (const char *p = slot.text; *p; p++) {
+      if (*p == '"' || *p == '\\') {
+        json += '\\';
+        json += *p;
+      } else if ((uint8_t)*p >= 0x20) {
+        json += *p;
+      }
+    }
+    json += "\"";
+  }
+}
+
+// {"v":12,"full":0,"d":{"T0":201.5,"state":"processing"}}
+uint32_t ESP3DMachineState::getDelta(uint32_t since, std::string &json) {
+  uint32_t version = 0;
+  json = "{\"v\":";
+  if (pthread_mutex_lock(&_mutex) == 0) {
+    version = _version;
+    json += std::to_string(version);
+    json += ",\"full\":";
+    json += since == 0 ? "1" : "0";
+    json += ",\"d\":{";
+    for (uint8_t pos = 0; pos < _fields_count; pos++) {
+      if (_slots[pos].version > since) {
+        _addField(json, pos);
+      }
+    }
+    if (pthread_mutex_unlock(&_mutex) != 0) {
+      esp3d_log_e("Cannot unlock mutex");
+    }
+  } else {
+    esp3d_log_e("Cannot lock mutex");
+    json += "0,\"full\":0,\"d\":{";
+  }
+  json += "}}";
+  return version;
+}
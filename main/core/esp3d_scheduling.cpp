@@ -0,0 +1,214 @@
+/*
+  esp3d_scheduling
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "esp3d_scheduling.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp3d_log.h"
+#include "esp3d_settings.h"
+#include "sdkconfig.h"
+
+#define TASK_ROLES static_cast<uint8_t>(ESP3DTaskRole::count)
+
+ESP3DScheduling esp3dScheduling;
+
+const char *schedulingProfileNames[] = {"BALANCED", "STREAMING", "UI"};
+
+ESP3DScheduling::ESP3DScheduling() {
+  _profile = ESP3DSchedulingProfile::balanced;
+  _boot_profile = ESP3DSchedulingProfile::balanced;
+  for (uint8_t r = 0; r < TASK_ROLES; r++) {
+    _handles[r] = nullptr;
+    _default_priorities[r] = 0;
+  }
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+  memset(_last_tasks, 0, sizeof(_last_tasks));
+  memset(_last_counters, 0, sizeof(_last_counters));
+  _last_total = 0;
+#endif  // CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+}
+
+ESP3DScheduling::~ESP3DScheduling() {}
+
+bool ESP3DScheduling::begin() {
+  uint8_t value =
+      esp3dTftsettings.readByte(ESP3DSettingIndex::esp3d_scheduling_profile);
+  if (value >= static_cast<uint8_t>(ESP3DSchedulingProfile::count)) {
+    esp3d_log_e("Invalid scheduling profile %d", value);
+    value = static_cast<uint8_t>(ESP3DSchedulingProfile::balanced);
+  }
+  _profile = static_cast<ESP3DSchedulingProfile>(value);
+  _boot_profile = _profile;
+  esp3d_log("Scheduling profile is %s", getProfileName(_profile));
+  return true;
+}
+
+const char *ESP3DScheduling::getProfileName(ESP3DSchedulingProfile profile) {
+  if (profile >= ESP3DSchedulingProfile::count) {
+    return "";
+  }
+  return schedulingProfileNames[static_cast<uint8_t>(profile)];
+}
+
+bool ESP3DScheduling::getProfile(const char *name,
+                                 ESP3DSchedulingProfile &profile) {
+  for (uint8_t p = 0; p < static_cast<uint8_t>(ESP3DSchedulingProfile::count);
+       p++) {
+    if (strcasecmp(name, schedulingProfileNames[p]) == 0) {
+      profile = static_cast<ESP3DSchedulingProfile>(p);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Tasks can only be pinned at creation, so core always comes from the profile
+// used at boot
+BaseType_t ESP3DScheduling::getCore(ESP3DTaskRole role,
+                                    BaseType_t default_core) {
+  if (_boot_profile == ESP3DSchedulingProfile::streaming &&
+      (role == ESP3DTaskRole::ui || role == ESP3DTaskRole::rendering)) {
+    return ESP3D_SCHEDULING_SECONDARY_CORE;
+  }
+  return default_core;
+}
+
+UBaseType_t ESP3DScheduling::getPriority(ESP3DTaskRole role,
+                                         UBaseType_t default_priority) {
+  return _getPriority(_profile, role, default_priority);
+}
+
+UBaseType_t ESP3DScheduling::_getPriority(ESP3DSchedulingProfile profile,
+                                          ESP3DTaskRole role,
+                                          UBaseType_t default_priority) {
+  bool isUiTask = role == ESP3DTaskRole::ui || role == ESP3DTaskRole::rendering;
+  if (!isUiTask) {
+    return default_priority;
+  }
+  switch (profile) {
+    case ESP3DSchedulingProfile::streaming:
+      return default_priority < ESP3D_SCHEDULING_LOW_PRIORITY
+                 ? default_priority
+                 : ESP3D_SCHEDULING_LOW_PRIORITY;
+    case ESP3DSchedulingProfile::ui:
+      if (default_priority + ESP3D_SCHEDULING_UI_BOOST >=
+          configMAX_PRIORITIES) {
+        return configMAX_PRIORITIES - 1;
+      }
+      return default_priority + ESP3D_SCHEDULING_UI_BOOST;
+    default:
+      return default_priority;
+  }
+}
+
+void ESP3DScheduling::registerTask(ESP3DTaskRole role, TaskHandle_t handle,
+                                   UBaseType_t default_priority) {
+  if (role >= ESP3DTaskRole::count) {
+    return;
+  }
+  _handles[static_cast<uint8_t>(role)] = handle;
+  _default_priorities[static_cast<uint8_t>(role)] = default_priority;
+}
+
+bool ESP3DScheduling::setProfile(ESP3DSchedulingProfile profile) {
+  if (profile >= ESP3DSchedulingProfile::count) {
+    return false;
+  }
+  if (!esp3dTftsettings.writeByte(ESP3DSettingIndex::esp3d_scheduling_profile,
+                                  static_cast<uint8_t>(profile))) {
+    esp3d_log_e("Failed to save scheduling profile");
+    return false;
+  }
+  _profile = profile;
+  for (uint8_t r = 0; r < TASK_ROLES; r++) {
+    if (_handles[r]) {
+      vTaskPrioritySet(_handles[r],
+                       _getPriority(profile, static_cast<ESP3DTaskRole>(r),
+                                    _default_priorities[r]));
+    }
+  }
+  esp3d_log("Scheduling profile set to %s", getProfileName(profile));
+  return true;
+}
+
+// Usage is the part of run time counter used by each task since previous
+// call, so first call gives usage since boot
+int ESP3DScheduling::getTasksUsage(ESP3DTaskUsage *tasks, uint8_t max_count) {
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS && \
+    CONFIG_FREERTOS_USE_TRACE_FACILITY
+  if (!tasks || max_count == 0) {
+    return 0;
+  }
+  UBaseType_t nb = uxTaskGetNumberOfTasks();
+  // some margin in case tasks are created meanwhile
+  nb += 2;
+  TaskStatus_t *status = (TaskStatus_t *)malloc(nb * sizeof(TaskStatus_t));
+  if (!status) {
+    esp3d_log_e("Cannot allocate tasks status");
+    return 0;
+  }
+  uint32_t total = 0;
+  nb = uxTaskGetSystemState(status, nb, &total);
+  uint32_t elapsed = total - _last_total;
+  if (elapsed == 0) {
+    elapsed = 1;
+  }
+  TaskHandle_t current_tasks[ESP3D_SCHEDULING_MAX_TASKS];
+  uint32_t current_counters[ESP3D_SCHEDULING_MAX_TASKS];
+  uint8_t count = 0;
+  for (UBaseType_t i = 0; i < nb && i < ESP3D_SCHEDULING_MAX_TASKS; i++) {
+    uint32_t previous = 0;
+    for (uint8_t j = 0; j < ESP3D_SCHEDULING_MAX_TASKS; j++) {
+      if (_last_tasks[j] == status[i].xHandle) {
+        previous = _last_counters[j];
+        break;
+      }
+    }
+    current_tasks[i] = status[i].xHandle;
+    current_counters[i] = status[i].ulRunTimeCounter;
+    if (count < max_count) {
+      ESP3DTaskUsage &task = tasks[count++];
+      strncpy(task.name, status[i].pcTaskName, sizeof(task.name) - 1);
+      task.name[sizeof(task.name) - 1] = 0;
+      BaseType_t core = xTaskGetAffinity(status[i].xHandle);
+      task.core = core == tskNO_AFFINITY ? -1 : core;
+      task.priority = status[i].uxCurrentPriority;
+      uint64_t usage =
+          ((uint64_t)(status[i].ulRunTimeCounter - previous) * 100) / elapsed;
+      task.usage = usage > 100 ? 100 : usage;
+    }
+  }
+  memset(_last_tasks, 0, sizeof(_last_tasks));
+  for (UBaseType_t i = 0; i < nb && i < ESP3D_SCHEDULING_MAX_TASKS; i++) {
+    _last_tasks[i] = current_tasks[i];
+    _last_counters[i] = current_counters[i];
+  }
+  _last_total = total;
+  free(status);
+  return count;
+#else
+  (void)tasks;
+  (void)max_count;
+  return -1;
+#endif  // CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS &&
+        // CONFIG_FREERTOS_USE_TRACE_FACILITY
+}
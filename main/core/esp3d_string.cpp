@@ -20,6 +20,7 @@
 
 #include "esp3d_string.h"
 
+#include <stdio.h>
 #include <string.h>
 
 #include <algorithm>
@@ -27,28 +28,28 @@
 #include <cstdlib>
 
 #include "esp3d_hal.h"
+#include "esp3d_log.h"
 #if ESP3D_WIFI_FEATURE
 #include "network/esp3d_network.h"
 #endif  // ESP3D_WIFI_FEATURE
+#if ESP3D_TFT_BENCHMARK
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#endif  // ESP3D_TFT_BENCHMARK
 
 // helper to format string float to readable string with precision
 std::string esp3d_string::set_precision(std::string str_value,
                                         uint8_t precision) {
-  static std::string tmp;
-  tmp = str_value;
   double value = std::stod(str_value);
   double rounded =
       std::round(value * std::pow(10, precision)) / std::pow(10, precision);
-  tmp = std::to_string(rounded);
-
-  int pos = tmp.find(".");
-  if (precision == 0) {
-    tmp = tmp.substr(0, pos);
-  } else {
-    tmp = tmp.substr(0, pos + precision + 1);
+  // format on stack, no intermediate strings
+  char buffer[32];
+  int len = snprintf(buffer, sizeof(buffer), "%.*f", precision, rounded);
+  if (len < 0) {
+    return str_value;
   }
-
-  return tmp;
+  return std::string(buffer, len < sizeof(buffer) ? len : sizeof(buffer) - 1);
 }
 
 // Replace all occurrences of oldsubstr by newsubstr and return new string
@@ -74,18 +75,29 @@ const char* esp3d_string::str_replace(const char* currentstr,
 // Trim string function
 const char* esp3d_string::str_trim(const char* str) {
   static std::string s;
-  s = str;
-  auto start = s.begin();
-  while (start != s.end() && std::isspace(*start)) {
+  s = esp3d_string::trimmed(std::string_view(str));
+  return s.c_str();
+}
+
+std::string_view esp3d_string::trimmed(std::string_view str) {
+  size_t start = 0;
+  while (start < str.size() && std::isspace((unsigned char)str[start])) {
     start++;
   }
-  auto end = s.end();
-  do {
+  size_t end = str.size();
+  while (end > start && std::isspace((unsigned char)str[end - 1])) {
     end--;
-  } while (std::distance(start, end) > 0 && std::isspace(*end));
-  s = std::string(start, end + 1);
-  return s.c_str();
+  }
+  return str.substr(start, end - start);
+}
+
+void esp3d_string::trimInPlace(std::string& str) {
+  std::string_view view = esp3d_string::trimmed(std::string_view(str));
+  size_t start = view.data() - str.data();
+  str.erase(start + view.size());
+  str.erase(0, start);
 }
+
 // Upper case string
 void esp3d_string::str_toUpperCase(std::string* str) {
   std::transform(str->begin(), str->end(), str->begin(), ::toupper);
@@ -98,59 +110,84 @@ void esp3d_string::str_toLowerCase(std::string* str) {
 
 // helper to format size to readable string
 const char* esp3d_string::formatBytes(uint64_t bytes) {
-  static char buffer[32];
-  memset(buffer, 0, sizeof(buffer));
+  static char buffer[ESP3D_FORMAT_BYTES_SIZE];
+  return esp3d_string::formatBytesTo(bytes, buffer, sizeof(buffer));
+}
+
+const char* esp3d_string::formatBytesTo(uint64_t bytes, char* buffer,
+                                        size_t size) {
   int res = 0;
   if (bytes < 1024) {
-    res = snprintf(buffer, sizeof(buffer), "%d B", (int)bytes);
+    res = snprintf(buffer, size, "%d B", (int)bytes);
   } else if (bytes < (1024 * 1024)) {
-    res =
-        snprintf(buffer, sizeof(buffer), "%.2f KB", ((float)(bytes / 1024.0)));
+    res = snprintf(buffer, size, "%.2f KB", ((float)(bytes / 1024.0)));
   } else if (bytes < (1024 * 1024 * 1024)) {
-    res = snprintf(buffer, sizeof(buffer), "%.2f MB",
+    res = snprintf(buffer, size, "%.2f MB",
                    ((float)(bytes / 1024.0 / 1024.0)));
   } else {
-    res = snprintf(buffer, sizeof(buffer), "%.2f GB",
+    res = snprintf(buffer, size, "%.2f GB",
                    ((float)(bytes / 1024.0 / 1024.0 / 1024.0)));
   }
   if (res < 0) {
-    strcpy(buffer, "? B");
+    strncpy(buffer, "? B", size);
+    buffer[size - 1] = 0;
   }
   return buffer;
 }
 
 const char* esp3d_string::urlDecode(const char* text) {
-  static char* decoded = nullptr;
-  if (decoded) {
-    free(decoded);
-  }
-  char temp[] = "0x00";
-  unsigned int len = strlen(text);
-  unsigned int i = 0;
-  unsigned int p = 0;
-  decoded = (char*)malloc(len + 1);
-  if (decoded) {
-    while (i < len) {
-      char decodedChar;
-      char encodedChar = text[i++];
-      if ((encodedChar == '%') && (i + 1 < len)) {
-        temp[2] = text[i++];
-        temp[3] = text[i++];
-        decodedChar = strtol(temp, NULL, 16);
+  // keep capacity between calls instead of free / malloc each time
+  static std::string decoded;
+  decoded = text;
+  esp3d_string::urlDecodeStringInPlace(decoded);
+  return decoded.c_str();
+}
+
+static int8_t hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+size_t esp3d_string::urlDecodeInPlace(char* text) {
+  if (!text) {
+    return 0;
+  }
+  char* read = text;
+  char* write = text;
+  while (*read) {
+    // same as strtol: %XY needs 2 chars, invalid digits stop the value
+    if (*read == '%' && read[1] && read[2]) {
+      int8_t high = hex_value(read[1]);
+      int8_t low = hex_value(read[2]);
+      if (high < 0) {
+        *write++ = 0;
+      } else if (low < 0) {
+        *write++ = high;
       } else {
-        if (encodedChar == '+') {
-          decodedChar = ' ';
-        } else {
-          decodedChar = encodedChar;  // normal ascii char
-        }
+        *write++ = (high << 4) | low;
       }
-      decoded[p++] = decodedChar;
+      read += 3;
+    } else if (*read == '+') {
+      *write++ = ' ';
+      read++;
+    } else {
+      *write++ = *read++;
     }
-    decoded[p] = 0x0;
-    return decoded;
-  } else {
-    return nullptr;
   }
+  *write = 0;
+  return write - text;
+}
+
+void esp3d_string::urlDecodeStringInPlace(std::string& str) {
+  str.resize(esp3d_string::urlDecodeInPlace(&str[0]));
 }
 
 bool esp3d_string::endsWith(const char* str, const char* endpart) {
@@ -256,54 +293,80 @@ int esp3d_string::rfind(const char* str, const char* subStr, int start) {
 
 const char* esp3d_string::getPathFromString(const char* str) {
   static std::string path;
-  path = str;
-  int pos = path.find_last_of("/");
-  if (pos != -1) {
-    path = path.substr(0, pos);
-  }
+  path = esp3d_string::getPath(std::string_view(str));
   return path.c_str();
 }
 
+std::string_view esp3d_string::getPath(std::string_view str) {
+  size_t pos = str.find_last_of('/');
+  if (pos != std::string_view::npos) {
+    return str.substr(0, pos);
+  }
+  return str;
+}
+
 const char* esp3d_string::getFilenameFromString(const char* str) {
   static std::string filename;
-  filename = str;
-  int pos = filename.find_last_of("/");
-  if (pos != -1) {
-    if (pos + 1 < filename.length()) {  // check if not last char
-      filename = filename.substr(pos + 1);
-    } else {  // last char is / so remove it and get dirname
-      filename[0] = '\0';
-      pos = filename.find_last_of("/");
-      if (pos != -1) {
-        filename = filename.substr(pos + 1);
-      }
+  filename = esp3d_string::getFilename(std::string_view(str));
+  return filename.c_str();
+}
+
+std::string_view esp3d_string::getFilename(std::string_view str) {
+  // last char is / so remove it and get dirname
+  if (str.size() > 1 && str.back() == '/') {
+    str.remove_suffix(1);
+  }
+  size_t pos = str.find_last_of('/');
+  if (pos != std::string_view::npos) {
+    return str.substr(pos + 1);
+  }
+  return str;
+}
+
+void esp3d_string::appendJson(std::string& out, std::string_view str) {
+  size_t start = 0;
+  for (size_t i = 0; i < str.size(); i++) {
+    char escaped[7];
+    if (str[i] == '"' || str[i] == '\\') {
+      escaped[0] = '\\';
+      escaped[1] = str[i];
+      escaped[2] = 0;
+    } else if ((uint8_t)str[i] < 0x20) {
+      snprintf(escaped, sizeof(escaped), "\\u%04x", (uint8_t)str[i]);
+    } else {
+      continue;
     }
+    // append unescaped part at once
+    out.append(str.substr(start, i - start));
+    out += escaped;
+    start = i + 1;
   }
-  return filename.c_str();
+  out.append(str.substr(start));
 }
 
 const char* esp3d_string::getTimeString(time_t time, bool isGMT) {
-  static char buffer[40];
-  memset(buffer, 0, sizeof(buffer));
-  struct tm* tm_info;
-  struct tm tmstruct;
+  static char buffer[ESP3D_TIME_STRING_SIZE];
+  return esp3d_string::getTimeStringTo(time, isGMT, buffer, sizeof(buffer));
+}
 
+const char* esp3d_string::getTimeStringTo(time_t time, bool isGMT,
+                                          char* buffer, size_t size) {
+  struct tm tmstruct;
+  buffer[0] = 0;
   if (isGMT) {
     // convert to GMT time
-    tm_info = gmtime_r(&time, &tmstruct);
-    strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", tm_info);
+    gmtime_r(&time, &tmstruct);
+    strftime(buffer, size, "%a, %d %b %Y %H:%M:%S GMT", &tmstruct);
   } else {
     // convert to local time
-    tm_info = localtime_r(&time, &tmstruct);
-    strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", tm_info);
-  }
-  if (!isGMT) {
+    localtime_r(&time, &tmstruct);
+    size_t len = strftime(buffer, size, "%Y-%m-%dT%H:%M:%S", &tmstruct);
 #if ESP3D_TIMESTAMP_FEATURE
     // if time zone is set add it
-    strcat(buffer, esp3dTimeService.getTimeZone());
+    strncat(buffer, esp3dTimeService.getTimeZone(), size - len - 1);
 #else
     // add Z to indicate UTC time because no time zone is set
-    strcat(buffer, "Z");
+    strncat(buffer, "Z", size - len - 1);
 #endif  // ESP3D_TIMESTAMP_FEATURE
   }
   return buffer;
@@ -392,4 +455,62 @@ const char* esp3d_string::expandString(const char* s, bool formatspace) {
 #endif  // ESP3D_TIMESTAMP_FEATURE
   }
   return tmp.c_str();
-}
\ No newline at end of file
+}
+#if ESP3D_TFT_BENCHMARK
+#define BENCHMARK_LOOPS 1000
+
+#if CONFIG_HEAP_USE_HOOKS
+// count all allocations done meanwhile, by any task
+static volatile uint32_t benchmark_allocations = 0;
+extern "C" void esp_heap_trace_alloc_hook(void* ptr, size_t size,
+                                          uint32_t caps) {
+  (void)ptr;
+  (void)size;
+  (void)caps;
+  benchmark_allocations++;
+}
+#define BENCHMARK_ALLOCATIONS benchmark_allocations
+#else
+#define BENCHMARK_ALLOCATIONS 0
+#endif  // CONFIG_HEAP_USE_HOOKS
+
+// Same work done by hot paths: trim a command, decode an uri, format a size
+// and a date, allocations are only counted if CONFIG_HEAP_USE_HOOKS is set
+void esp3d_string::benchmark() {
+  const char* command = "  G1 X10.5 Y20.3 E0.25 F1800  \r\n";
+  const char* uri = "/sd/my%20folder/part+1%281%29.gcode";
+  std::string result;
+  size_t total = 0;
+  int64_t start = esp_timer_get_time();
+  uint32_t allocations = BENCHMARK_ALLOCATIONS;
+  for (uint i = 0; i < BENCHMARK_LOOPS; i++) {
+    result = esp3d_string::str_trim(command);
+    total += result.length();
+    result = esp3d_string::urlDecode(uri);
+    total += result.length();
+    total += strlen(esp3d_string::formatBytes(i * 1024));
+    total += strlen(esp3d_string::getTimeString(i, true));
+  }
+  esp3d_report("static buffers: %lld us, %ld allocations for %d loops",
+               esp_timer_get_time() - start,
+               BENCHMARK_ALLOCATIONS - allocations, BENCHMARK_LOOPS);
+  char buffer[ESP3D_TIME_STRING_SIZE];
+  char decoded[64];
+  start = esp_timer_get_time();
+  allocations = BENCHMARK_ALLOCATIONS;
+  for (uint i = 0; i < BENCHMARK_LOOPS; i++) {
+    total += esp3d_string::trimmed(std::string_view(command)).length();
+    strncpy(decoded, uri, sizeof(decoded) - 1);
+    decoded[sizeof(decoded) - 1] = 0;
+    total += esp3d_string::urlDecodeInPlace(decoded);
+    total +=
+        strlen(esp3d_string::formatBytesTo(i * 1024, buffer, sizeof(buffer)));
+    total +=
+        strlen(esp3d_string::getTimeStringTo(i, true, buffer, sizeof(buffer)));
+  }
+  esp3d_report("caller buffers: %lld us, %ld allocations for %d loops",
+               esp_timer_get_time() - start,
+               BENCHMARK_ALLOCATIONS - allocations, BENCHMARK_LOOPS);
+  esp3d_log("Checksum %d", total);
+}
+#endif  // ESP3D_TFT_BENCHMARK
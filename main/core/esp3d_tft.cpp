@@ -28,7 +28,9 @@
 #include "bsp.h"
 #include "esp3d_commands.h"
 #include "esp3d_log.h"
+#include "esp3d_scheduling.h"
 #include "esp3d_settings.h"
+#include "esp3d_string.h"
 #include "esp_heap_caps.h"
 
 #if ESP3D_WIFI_FEATURE
@@ -97,6 +99,11 @@ bool ESP3DTft::begin() {
       esp3d_log_e("Reset NVS failed");
     }
   }
+  // Tasks core and priority depend on scheduling profile
+  esp3dScheduling.begin();
+#if ESP3D_TFT_BENCHMARK
+  esp3d_string::benchmark();
+#endif  // ESP3D_TFT_BENCHMARK
 #if ESP3D_USB_SERIAL_FEATURE
   if (esp3dCommands.getOutputClient(true) == ESP3DClientType::usb_serial) {
     bsp_init_usb();
@@ -143,6 +150,9 @@ bool ESP3DTft::begin() {
     success = esp3dTftnetwork.begin();
   }
 #endif  // ESP3D_WIFI_FEATURE
+#if ESP3D_TFT_BENCHMARK
+  esp3dCommands.benchmark();
+#endif  // ESP3D_TFT_BENCHMARK
   return success && successFs && successSd;
 }
 
@@ -24,9 +24,13 @@
 
 #include <algorithm>
 
+#include "esp3d_events.h"
 #include "esp3d_log.h"
+#include "esp3d_machine_state.h"
 #include "esp3d_string.h"
 #include "esp3d_version.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 ESP3DValues esp3dTftValues;
 
@@ -68,6 +72,15 @@ const char* ESP3DValues::get_string_value(ESP3DValuesIndex index) {
   return nullptr;
 }
 
+bool ESP3DValues::hasPendingUpdates() {
+  bool res = false;
+  if (pthread_mutex_lock(&_mutex) == 0) {
+    res = !_updated_values_queue.empty();
+    pthread_mutex_unlock(&_mutex);
+  }
+  return res;
+}
+
 void ESP3DValues::handle() {
   if (pthread_mutex_lock(&_mutex) == 0) {
     // check if there is something to do
@@ -84,6 +97,9 @@ void ESP3DValues::handle() {
           element.description->callbackFn(element.index, element.value.c_str(),
                                           element.action);
         }
+#if ESP3D_TFT_BENCHMARK
+        esp3dEvents.addLatencySample(element.origin);
+#endif  // ESP3D_TFT_BENCHMARK
         // remove front element from queue
         _updated_values_queue.pop_front();
         nb++;
@@ -98,6 +114,13 @@ void ESP3DValues::handle() {
 bool ESP3DValues::set_string_value(ESP3DValuesIndex index, const char* value,
                                    ESP3DValuesCbAction action) {
   bool result = false;
+  bool merged = false;
+#if ESP3D_HTTP_FEATURE
+  // web clients get state even without display
+  if (action != ESP3DValuesCbAction::Clear) {
+    esp3dMachineState.update(index, value);
+  }
+#endif  // ESP3D_HTTP_FEATURE
   if (_values.size() == 0) {
     // No values list set  - service is ignored
     return true;
@@ -111,9 +134,31 @@ bool ESP3DValues::set_string_value(ESP3DValuesIndex index, const char* value,
                            });
     // is it found ?
     if (it != _values.end()) {
-      // yes found it, push value in queue to be processed later
-      _updated_values_queue.emplace_back(ESP3DValuesData{
-          std::string(value ? value : ""), action, index, &(*it)});
+      // only last value matters for numeric values, strings like status
+      // messages are all kept
+      if (_coalescing && action == ESP3DValuesCbAction::Update &&
+          it->type != ESP3DValuesType::string_t) {
+        for (auto& queued : _updated_values_queue) {
+          if (queued.index == index &&
+              queued.action == ESP3DValuesCbAction::Update) {
+            queued.value = value ? value : "";
+            _coalesced_count++;
+            merged = true;
+            break;
+          }
+        }
+      }
+      if (!merged) {
+        // yes found it, push value in queue to be processed later
+        _updated_values_queue.emplace_back(ESP3DValuesData{
+            std::string(value ? value : ""), action, index, &(*it)});
+#if ESP3D_TFT_BENCHMARK
+        // only values coming from the rendering of a response are measured
+        if (_latency_origin_task == xTaskGetCurrentTaskHandle()) {
+          _updated_values_queue.back().origin = _latency_origin;
+        }
+#endif  // ESP3D_TFT_BENCHMARK
+      }
       result = true;
     } else {
       // not found - error
@@ -125,5 +170,16 @@ bool ESP3DValues::set_string_value(ESP3DValuesIndex index, const char* value,
   } else {
     esp3d_log_e("Cannot lock mutex");
   }
+  // merged value is already notified
+  if (result && !merged) {
+    esp3dEvents.notify(ESP3DEventConsumer::ui);
+  }
   return result;
 }
+
+#if ESP3D_TFT_BENCHMARK
+void ESP3DValues::setLatencyOrigin(int64_t origin) {
+  _latency_origin = origin;
+  _latency_origin_task = origin ? xTaskGetCurrentTaskHandle() : nullptr;
+}
+#endif  // ESP3D_TFT_BENCHMARK
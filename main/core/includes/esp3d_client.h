@@ -28,6 +28,7 @@
 
 #include "authentication/esp3d_authentication_types.h"
 #include "esp3d_client_types.h"
+#include "esp3d_events.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -48,6 +49,9 @@ struct ESP3DMessage {
   ESP3DAuthenticationLevel authentication_level;
   ESP3DRequest request_id;
   ESP3DMessageType type;
+#if ESP3D_TFT_BENCHMARK
+  int64_t timestamp;  // creation time in microseconds
+#endif                // ESP3D_TFT_BENCHMARK
 };
 
 class ESP3DClient {
@@ -68,6 +72,10 @@ class ESP3DClient {
   bool addFrontTxData(ESP3DMessage *msg);
   void setRxMutex(pthread_mutex_t *mutex) { _rx_mutex = mutex; };
   void setTxMutex(pthread_mutex_t *mutex) { _tx_mutex = mutex; };
+  // task to wake up when a message is added to rx or tx queue
+  void setEventConsumer(ESP3DEventConsumer consumer) {
+    _event_consumer = consumer;
+  };
   bool clearRxQueue();
   bool clearTxQueue();
   size_t getRxMsgsCount() { return _rx_queue.size(); }
@@ -96,6 +104,7 @@ class ESP3DClient {
   size_t _tx_max_size;
   pthread_mutex_t *_rx_mutex;
   pthread_mutex_t *_tx_mutex;
+  ESP3DEventConsumer _event_consumer;
 };
 
 #ifdef __cplusplus
@@ -0,0 +1,69 @@
+/*
+  esp3d_command_args
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Max number of arguments of one command
+#define ESP3D_COMMAND_ARGS_MAX 12
+// Max size of all unescaped arguments, each one with its 0
+#define ESP3D_COMMAND_ARGS_SIZE 256
+
+struct ESP3DMessage;
+
+// Arguments of an [ESPxxx] command split once: escape chars are removed and
+// each argument is a 0 terminated string, so lookups are only string
+// compares. If command does not fit, it is not valid and parameters must be
+// read from message as before.
+class ESP3DCommandArgs final {
+ public:
+  ESP3DCommandArgs();
+  bool parse(ESP3DMessage *msg, uint start);
+  // args are only used for the message and position they were parsed from
+  bool isFor(ESP3DMessage *msg, uint start) {
+    return _valid && msg == _msg && start == _start;
+  }
+  uint8_t count() { return _count; }
+  const char *at(uint8_t index) { return index < _count ? _args[index] : ""; }
+  // value of first argument starting with label (e.g. "pwd="), or nullptr
+  const char *get(const char *label);
+  // label=yes/1/true or label alone
+  bool hasTag(const char *label);
+  // first argument which is not json / json=... / pwd=...
+  const char *getClean();
+
+ private:
+  ESP3DMessage *_msg;
+  uint _start;
+  bool _valid;
+  uint8_t _count;
+  const char *_args[ESP3D_COMMAND_ARGS_MAX];
+  char _buffer[ESP3D_COMMAND_ARGS_SIZE];
+};
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
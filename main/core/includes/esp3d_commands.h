@@ -33,6 +33,28 @@
 extern "C" {
 #endif
 
+class ESP3DCommands;
+
+// How command answers, set by json / json=yes tag if both are supported
+enum class ESP3DCommandOutput : uint8_t {
+  plain = 0,
+  json,
+  plain_json,
+};
+
+// One [ESPxxx] command of the commands table, see esp3d_commands.cpp
+struct ESP3DCommandDescription {
+  uint16_t id;
+  void (ESP3DCommands::*handler)(int cmd_params_pos, ESP3DMessage* msg);
+  // lowest authentication level allowed to run command at all, command
+  // can still check a higher level for some of its actions
+  ESP3DAuthenticationLevel level;
+  // space separated list of parameters, "label=" for a parameter with a
+  // value, "LABEL" for a tag, json and pwd= are always accepted
+  const char* params;
+  ESP3DCommandOutput output;
+};
+
 class ESP3DCommands {
  public:
   ESP3DCommands();
@@ -131,6 +153,7 @@ class ESP3DCommands {
   void ESP410(int cmd_params_pos, ESP3DMessage* msg);
 #endif  // ESP3D_WIFI_FEATURE
   void ESP420(int cmd_params_pos, ESP3DMessage* msg);
+  void ESP430(int cmd_params_pos, ESP3DMessage* msg);
   void ESP444(int cmd_params_pos, ESP3DMessage* msg);
 #if ESP3D_MDNS_FEATURE
   void ESP450(int cmd_params_pos, ESP3DMessage* msg);
@@ -149,6 +172,8 @@ class ESP3DCommands {
   void ESP700(int cmd_params_pos, ESP3DMessage* msg);
   void ESP701(int cmd_params_pos, ESP3DMessage* msg);
   void ESP702(int cmd_params_pos, ESP3DMessage* msg);
+  void ESP703(int cmd_params_pos, ESP3DMessage* msg);
+  void ESP704(int cmd_params_pos, ESP3DMessage* msg);
   void ESP710(int cmd_params_pos, ESP3DMessage* msg);
   void ESP720(int cmd_params_pos, ESP3DMessage* msg);
   void ESP730(int cmd_params_pos, ESP3DMessage* msg);
@@ -172,6 +197,10 @@ class ESP3DCommands {
   const char* get_clean_param(ESP3DMessage* msg, uint start);
   bool has_param(ESP3DMessage* msg, uint start);
   bool hasTag(ESP3DMessage* msg, uint start, const char* label);
+  static const ESP3DCommandDescription* getCommand(uint16_t id);
+#if ESP3D_TFT_BENCHMARK
+  void benchmark();
+#endif  // ESP3D_TFT_BENCHMARK
   void flush();
   ESP3DClientType getOutputClient(bool fromSettings = false);
   void setOutputClient(ESP3DClientType output_client) {
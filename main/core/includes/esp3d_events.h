@@ -0,0 +1,70 @@
+/*
+  esp3d_events
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+#include <stdio.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Tasks that can be woken up when some work is pushed for them
+// Each consumer is one bit of the event group, so keep it under 24 entries
+enum class ESP3DEventConsumer : uint8_t {
+  none = 0,
+  stream,      // tftStream task: serial / usb serial rx and tx queues
+  network,     // tftNetwork task: network services
+  ui,          // tftUI task: values update and lvgl
+  rendering,   // esp3d_rendering_rx_task: printer responses parsing
+  gcode_host,  // esp3d_gcode_host_task: streams and acks
+};
+
+class ESP3DEvents final {
+ public:
+  ESP3DEvents();
+  ~ESP3DEvents();
+  // wake up the task consuming the event
+  void notify(ESP3DEventConsumer consumer);
+  // block current task until notified or timeout, return true if notified
+  bool wait(ESP3DEventConsumer consumer, uint32_t timeout_ms);
+#if ESP3D_TFT_BENCHMARK
+  // time spent from printer response reception to ui update
+  void addLatencySample(int64_t origin_us);
+#endif  // ESP3D_TFT_BENCHMARK
+
+ private:
+  EventGroupHandle_t _event_group;
+  StaticEventGroup_t _event_group_buffer;
+#if ESP3D_TFT_BENCHMARK
+  int64_t _latency_min;
+  int64_t _latency_max;
+  int64_t _latency_total;
+  uint32_t _latency_count;
+#endif  // ESP3D_TFT_BENCHMARK
+};
+
+extern ESP3DEvents esp3dEvents;
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
@@ -0,0 +1,88 @@
+/*
+  esp3d_machine_state
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+
+#include "esp3d_values_list.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Max number of fields a target can define
+#define ESP3D_MACHINE_STATE_MAX_FIELDS 24
+// Max size of a text field + 0
+#define ESP3D_MACHINE_STATE_TEXT_SIZE 24
+// Min period (ms) between 2 pushes to same client
+#define ESP3D_MACHINE_STATE_MIN_PERIOD 100
+
+enum class ESP3DMachineStateType : uint8_t {
+  number = 0,  // sent as JSON number, or null if not a number ("?", "#")
+  text,        // sent as JSON string
+};
+
+struct ESP3DMachineStateField {
+  ESP3DValuesIndex index;
+  const char *key;  // short JSON key
+  ESP3DMachineStateType type;
+};
+
+struct ESP3DMachineStateSlot {
+  uint32_t version;  // state version of last change, 0 if never set
+  bool valid;
+  double number;
+  char text[ESP3D_MACHINE_STATE_TEXT_SIZE];
+};
+
+// Typed copy of values the web clients are interested in, each change
+// increases the state version so clients only get fields changed since the
+// version they already have
+class ESP3DMachineState final {
+ public:
+  ESP3DMachineState();
+  ~ESP3DMachineState();
+  // fields list depends on target, see esp3d_machine_state_init.cpp
+  void init();
+  // return true if value is part of state and has changed
+  bool update(ESP3DValuesIndex index, const char *value);
+  uint32_t getVersion() { return _version; }
+  // JSON object of fields changed since version, 0 for all fields
+  // return version of the generated JSON
+  uint32_t getDelta(uint32_t since, std::string &json);
+
+ private:
+  void _addField(std::string &json, uint8_t pos);
+  const ESP3DMachineStateField *_fields;
+  uint8_t _fields_count;
+  ESP3DMachineStateSlot _slots[ESP3D_MACHINE_STATE_MAX_FIELDS];
+  uint32_t _version;
+  pthread_mutex_t _mutex;
+};
+
+extern ESP3DMachineState esp3dMachineState;
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
@@ -0,0 +1,108 @@
+/*
+  esp3d_scheduling
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Max number of tasks reported by getTasksUsage
+#define ESP3D_SCHEDULING_MAX_TASKS 32
+// Core left to network and ui tasks when streaming is favored
+#define ESP3D_SCHEDULING_SECONDARY_CORE 0
+// Priority of degraded tasks when streaming is favored
+#define ESP3D_SCHEDULING_LOW_PRIORITY 1
+// Priority added to ui tasks when ui is favored
+#define ESP3D_SCHEDULING_UI_BOOST 5
+
+// do not change the order, value is stored in settings
+enum class ESP3DSchedulingProfile : uint8_t {
+  balanced = 0,  // cores and priorities from board tasks_def.h
+  streaming,     // gcode host and serial rx alone on their core
+  ui,            // ui and rendering above gcode host
+  count,
+};
+
+// Tasks whose core and priority depend on profile
+enum class ESP3DTaskRole : uint8_t {
+  stream = 0,  // tftStream
+  ui,          // tftUI
+  rendering,   // esp3d_rendering_rx_task
+  gcode_host,  // esp3d_gcode_host_task
+  serial,      // esp3d_serial_rx_task
+  count,
+};
+
+struct ESP3DTaskUsage {
+  char name[configMAX_TASK_NAME_LEN];
+  int8_t core;  // -1 if not pinned
+  uint8_t priority;
+  uint8_t usage;  // percent of one core since previous call
+};
+
+class ESP3DScheduling final {
+ public:
+  ESP3DScheduling();
+  ~ESP3DScheduling();
+  // read profile from settings, must be done before tasks creation
+  bool begin();
+  // core and priority to use at task creation, from board default values
+  BaseType_t getCore(ESP3DTaskRole role, BaseType_t default_core);
+  UBaseType_t getPriority(ESP3DTaskRole role, UBaseType_t default_priority);
+  // created task, so its priority can be changed with profile
+  void registerTask(ESP3DTaskRole role, TaskHandle_t handle,
+                    UBaseType_t default_priority);
+  // priorities are applied immediatly, cores only after restart
+  bool setProfile(ESP3DSchedulingProfile profile);
+  ESP3DSchedulingProfile getProfile() { return _profile; }
+  // profile used when tasks were created
+  ESP3DSchedulingProfile getBootProfile() { return _boot_profile; }
+  const char *getProfileName(ESP3DSchedulingProfile profile);
+  bool getProfile(const char *name, ESP3DSchedulingProfile &profile);
+  // return number of tasks, or -1 if run time stats are not enabled
+  int getTasksUsage(ESP3DTaskUsage *tasks, uint8_t max_count);
+
+ private:
+  UBaseType_t _getPriority(ESP3DSchedulingProfile profile, ESP3DTaskRole role,
+                           UBaseType_t default_priority);
+  ESP3DSchedulingProfile _profile;
+  ESP3DSchedulingProfile _boot_profile;
+  TaskHandle_t _handles[static_cast<uint8_t>(ESP3DTaskRole::count)];
+  UBaseType_t _default_priorities[static_cast<uint8_t>(ESP3DTaskRole::count)];
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+  // run time counters of previous call, to compute usage on the period
+  TaskHandle_t _last_tasks[ESP3D_SCHEDULING_MAX_TASKS];
+  uint32_t _last_counters[ESP3D_SCHEDULING_MAX_TASKS];
+  uint32_t _last_total;
+#endif  // CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+};
+
+extern ESP3DScheduling esp3dScheduling;
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
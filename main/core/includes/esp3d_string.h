@@ -23,6 +23,7 @@
 
 #include <cstring>
 #include <string>
+#include <string_view>
 
 #if ESP3D_TIMESTAMP_FEATURE
 #include "time/esp3d_time_service.h"
@@ -31,6 +32,12 @@
 
 #endif  // ESP3D_TIMESTAMP_FEATURE
 
+// Buffer size for formatBytes, up to "17179869184.00 GB" + 0
+#define ESP3D_FORMAT_BYTES_SIZE 24
+// Buffer size for getTimeString: "Sun, 06 Nov 1994 08:49:37 GMT" + 0 or
+// "1994-11-06T08:49:37+01:00" + 0
+#define ESP3D_TIME_STRING_SIZE 40
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -58,6 +65,27 @@ const char* getFilenameFromString(const char* str);
 const char* getTimeString(time_t time, bool isGMT = false);
 const char* generateUUID(const char* seed = NULL);
 const char* expandString(const char* s, bool formatspace = false);
+
+// Functions above returning const char* use a static buffer, so result must
+// be used before next call from any task. Functions below are thread safe and
+// do not allocate: result is a view on the input or is written in caller
+// buffer
+std::string_view trimmed(std::string_view str);
+void trimInPlace(std::string& str);
+// decoded text is never longer than encoded one, return new length
+size_t urlDecodeInPlace(char* text);
+void urlDecodeStringInPlace(std::string& str);
+const char* formatBytesTo(uint64_t bytes, char* buffer, size_t size);
+const char* getTimeStringTo(time_t time, bool isGMT, char* buffer,
+                            size_t size);
+std::string_view getPath(std::string_view str);
+std::string_view getFilename(std::string_view str);
+// escape " \ and control characters for JSON string, appended to out
+void appendJson(std::string& out, std::string_view str);
+#if ESP3D_TFT_BENCHMARK
+// compare static buffer functions and thread safe ones
+void benchmark();
+#endif  // ESP3D_TFT_BENCHMARK
 }  // namespace esp3d_string
 #ifdef __cplusplus
 }  // extern "C"
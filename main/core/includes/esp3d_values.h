@@ -68,6 +68,9 @@ struct ESP3DValuesData {
   ESP3DValuesCbAction action = ESP3DValuesCbAction::Update;
   ESP3DValuesIndex index = ESP3DValuesIndex::unknown_index;
   ESP3DValuesDescription* description = nullptr;
+#if ESP3D_TFT_BENCHMARK
+  int64_t origin = 0;  // time the source data was received
+#endif                 // ESP3D_TFT_BENCHMARK
 };
 
 class ESP3DValues final {
@@ -77,6 +80,13 @@ class ESP3DValues final {
   bool intialize();
   void clear();
   void handle();
+  bool hasPendingUpdates();
+  // merge numeric updates of same value not yet processed
+  void setCoalescing(bool enable) { _coalescing = enable; }
+  uint32_t getCoalescedCount() { return _coalesced_count; }
+#if ESP3D_TFT_BENCHMARK
+  void setLatencyOrigin(int64_t origin);
+#endif  // ESP3D_TFT_BENCHMARK
   const ESP3DValuesDescription* get_description(ESP3DValuesIndex index);
   const char* get_string_value(ESP3DValuesIndex index);
   bool set_string_value(
@@ -87,6 +97,12 @@ class ESP3DValues final {
   std::list<ESP3DValuesDescription> _values;
   std::list<ESP3DValuesData> _updated_values_queue;
   pthread_mutex_t _mutex;
+  bool _coalescing = false;
+  uint32_t _coalesced_count = 0;
+#if ESP3D_TFT_BENCHMARK
+  int64_t _latency_origin = 0;
+  void* _latency_origin_task = nullptr;
+#endif  // ESP3D_TFT_BENCHMARK
 };
 
 extern ESP3DValues esp3dTftValues;
@@ -26,6 +26,7 @@
 #include "components/symbol_button_component.h"
 #include "esp3d_log.h"
 #include "esp3d_lvgl.h"
+#include "esp3d_screen_manager.h"
 #include "esp3d_string.h"
 #include "esp3d_styles.h"
 #include "esp3d_tft_ui.h"
@@ -346,9 +347,7 @@ void create() {
   lv_obj_t *ui_current_screen = lv_scr_act();
   lv_scr_load(ui_new_screen);
   ESP3DStyle::apply(ui_new_screen, ESP3DStyleType::main_bg);
-  if (lv_obj_is_valid(ui_current_screen)) {
-    lv_obj_del(ui_current_screen);
-  }
+  screenManager::release(ui_current_screen);
 
   homing_done = false;
   btn_back = backButton::create(ui_new_screen);
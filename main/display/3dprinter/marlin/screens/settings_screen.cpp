@@ -34,6 +34,7 @@
 #include "esp3d_log.h"
 #include "esp3d_hal.h"
 #include "esp3d_lvgl.h"
+#include "esp3d_screen_manager.h"
 #include "esp3d_settings.h"
 #include "esp3d_string.h"
 #include "esp3d_styles.h"
@@ -715,9 +716,7 @@ void create() {
   lv_obj_t *ui_current_screen = lv_scr_act();
   lv_scr_load(ui_new_screen);
   ESP3DStyle::apply(ui_new_screen, ESP3DStyleType::main_bg);
-  if (lv_obj_is_valid(ui_current_screen)) {
-    lv_obj_del(ui_current_screen);
-  }
+  screenManager::release(ui_current_screen);
 
   lv_obj_t *btnback = backButton::create(ui_new_screen);
   if (!lv_obj_is_valid(btnback)) {
@@ -27,6 +27,7 @@
 #include "components/symbol_button_component.h"
 #include "esp3d_log.h"
 #include "esp3d_lvgl.h"
+#include "esp3d_screen_manager.h"
 #include "esp3d_styles.h"
 #include "esp3d_tft_ui.h"
 #include "rendering/esp3d_rendering_client.h"
@@ -484,9 +485,7 @@ void create(bool autoleveling) {
   lv_obj_t *ui_current_screen = lv_scr_act();
   lv_scr_load(ui_new_screen);
   ESP3DStyle::apply(ui_new_screen, ESP3DStyleType::main_bg);
-  if (lv_obj_is_valid(ui_current_screen)) {
-    lv_obj_del(ui_current_screen);
-  }
+  screenManager::release(ui_current_screen);
 
   // Button back
   lv_obj_t *btn_back = backButton::create(ui_new_screen);
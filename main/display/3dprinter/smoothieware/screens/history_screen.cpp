@@ -0,0 +1,299 @@
+/*
+  history_screen.cpp - ESP3D screens styles definition
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "screens/history_screen.h"
+
+#include <lvgl.h>
+
+#include "components/back_button_component.h"
+#include "esp3d_log.h"
+#include "esp3d_lvgl.h"
+#include "esp3d_screen_manager.h"
+#include "esp3d_styles.h"
+#include "esp3d_tft_ui.h"
+#include "history/esp3d_history.h"
+#include "screens/temperatures_screen.h"
+
+/**********************
+ *  Namespace
+ **********************/
+namespace historyScreen {
+// Points displayed on chart, each point is the max of several samples
+#define HISTORY_CHART_POINTS 120
+// Chart range in tenth of degree
+#define HISTORY_CHART_MAX 3000
+#define HISTORY_CHART_REFRESH_PERIOD 1000
+#define HISTORY_CHART_SERIES 3
+#define HISTORY_CHART_MAX_SAMPLES_PER_POINT \
+  (ESP3D_HISTORY_LONG_SIZE / HISTORY_CHART_POINTS)
+
+// Static variables
+lv_timer_t *history_screen_delay_timer = NULL;
+lv_timer_t *history_refresh_timer = NULL;
+lv_obj_t *history_chart = NULL;
+lv_chart_series_t *history_series[HISTORY_CHART_SERIES] = {NULL, NULL, NULL};
+const ESP3DHistoryChannel history_channels[HISTORY_CHART_SERIES] = {
+    ESP3DHistoryChannel::ext_0_temperature,
+    ESP3DHistoryChannel::ext_1_temperature,
+    ESP3DHistoryChannel::bed_temperature};
+const lv_palette_t history_colors[HISTORY_CHART_SERIES] = {
+    LV_PALETTE_RED, LV_PALETTE_ORANGE, LV_PALETTE_BLUE};
+const char *history_buttons_map[] = {"10min", "6h", ""};
+ESP3DHistoryResolution history_resolution = ESP3DHistoryResolution::short_term;
+// sequence of next history sample to be added to chart
+uint32_t history_next_sample = 0;
+uint8_t history_target = 0;
+ESP3DScreenType history_screen_return = ESP3DScreenType::main;
+
+// Static functions
+
+/**
+ * @brief Number of history samples merged in one chart point.
+ *
+ * The whole history of the current resolution is displayed on the chart.
+ *
+ * @return The number of samples per point.
+ */
+uint32_t samples_per_point() {
+  uint32_t nb = esp3dHistory.getSize(history_resolution) / HISTORY_CHART_POINTS;
+  if (nb > HISTORY_CHART_MAX_SAMPLES_PER_POINT) {
+    nb = HISTORY_CHART_MAX_SAMPLES_PER_POINT;
+  }
+  return nb > 0 ? nb : 1;
+}
+
+/**
+ * @brief Adds the new history samples to the chart.
+ *
+ * Only complete points are added, the chart is in circular mode so only the new
+ * points are redrawn instead of the whole chart.
+ */
+void history_update_chart() {
+  if (!lv_obj_is_valid(history_chart)) {
+    return;
+  }
+  uint32_t nb = samples_per_point();
+  ESP3DHistorySample samples[HISTORY_CHART_MAX_SAMPLES_PER_POINT];
+  while (esp3dHistory.getSequence(history_resolution) - history_next_sample >=
+         nb) {
+    for (uint8_t s = 0; s < HISTORY_CHART_SERIES; s++) {
+      uint32_t from = history_next_sample;
+      uint32_t count = esp3dHistory.getSamples(
+          history_channels[s], history_resolution, from, samples, nb);
+      lv_coord_t value = LV_CHART_POINT_NONE;
+      for (uint32_t i = 0; i < count; i++) {
+        if (samples[i].max != ESP3D_HISTORY_NO_VALUE &&
+            (value == LV_CHART_POINT_NONE || samples[i].max > value)) {
+          value = samples[i].max;
+        }
+      }
+      lv_chart_set_next_value(history_chart, history_series[s], value);
+    }
+    history_next_sample += nb;
+  }
+}
+
+/**
+ * @brief Fills the chart with the history of the current resolution.
+ *
+ * The first sample is aligned on a point boundary so next updates only add
+ * complete points.
+ */
+void history_fill_chart() {
+  if (!lv_obj_is_valid(history_chart)) {
+    return;
+  }
+  for (uint8_t s = 0; s < HISTORY_CHART_SERIES; s++) {
+    lv_chart_set_all_value(history_chart, history_series[s],
+                           LV_CHART_POINT_NONE);
+  }
+  uint32_t nb = samples_per_point();
+  uint32_t last = esp3dHistory.getSequence(history_resolution);
+  uint32_t span = nb * HISTORY_CHART_POINTS;
+  history_next_sample = last > span ? last - span : 0;
+  history_next_sample -= history_next_sample % nb;
+  history_update_chart();
+}
+
+/**
+ * @brief Timer callback to add new samples to the chart.
+ *
+ * @param timer Pointer to the timer object that triggered the callback.
+ */
+void history_refresh_timer_cb(lv_timer_t *timer) {
+  if (esp3dTftui.get_current_screen() != ESP3DScreenType::history) {
+    return;
+  }
+  history_update_chart();
+}
+
+/**
+ * @brief Deletes the refresh timer when the screen is deleted.
+ *
+ * @param e Pointer to the event object.
+ */
+void event_history_screen_delete_handler(lv_event_t *e) {
+  if (history_refresh_timer) {
+    lv_timer_del(history_refresh_timer);
+    history_refresh_timer = NULL;
+  }
+  history_chart = NULL;
+}
+
+/**
+ * @brief Callback function for the delay timer in the history screen.
+ *
+ * This function is called when the delay timer expires, it goes back to the
+ * temperatures screen.
+ *
+ * @param timer Pointer to the timer object that triggered the callback.
+ */
+void history_screen_delay_timer_cb(lv_timer_t *timer) {
+  if (history_screen_delay_timer &&
+      lv_timer_is_valid(history_screen_delay_timer)) {
+    lv_timer_del(history_screen_delay_timer);
+  }
+  history_screen_delay_timer = NULL;
+  temperaturesScreen::create(history_target, history_screen_return);
+}
+
+/**
+ * @brief Event handler for the back button in the history screen.
+ *
+ * @param e The event object.
+ */
+void event_button_history_back_handler(lv_event_t *e) {
+  esp3d_log("back Clicked");
+  if (ESP3D_BUTTON_ANIMATION_DELAY) {
+    if (history_screen_delay_timer) return;
+    history_screen_delay_timer = lv_timer_create(
+        history_screen_delay_timer_cb, ESP3D_BUTTON_ANIMATION_DELAY, NULL);
+  } else
+    history_screen_delay_timer_cb(NULL);
+}
+
+/**
+ * @brief Callback function for the resolution matrix buttons event.
+ *
+ * The chart is filled again with the history of the selected resolution.
+ *
+ * @param e The event object containing information about the event.
+ */
+void history_matrix_buttons_event_cb(lv_event_t *e) {
+  lv_obj_t *obj = lv_event_get_target(e);
+  uint32_t id = lv_btnmatrix_get_selected_btn(obj);
+  ESP3DHistoryResolution resolution =
+      id == 1 ? ESP3DHistoryResolution::long_term
+              : ESP3DHistoryResolution::short_term;
+  esp3d_log("Button %s clicked", history_buttons_map[id]);
+  if (resolution != history_resolution) {
+    history_resolution = resolution;
+    history_fill_chart();
+  }
+}
+
+/**
+ * @brief Creates the history screen.
+ *
+ * The screen displays a chart of the temperatures history, with a button
+ * matrix to select the resolution and a back button to go back to the
+ * temperatures screen.
+ *
+ * @param target The heater selected on the temperatures screen.
+ * @param screenreturn The screen the temperatures screen returns to.
+ */
+void create(uint8_t target, ESP3DScreenType screenreturn) {
+  esp3dTftui.set_current_screen(ESP3DScreenType::none);
+  history_target = target;
+  history_screen_return = screenreturn;
+  // Screen creation
+  esp3d_log("History screen creation");
+  lv_obj_t *ui_new_screen = lv_obj_create(NULL);
+  if (!lv_obj_is_valid(ui_new_screen)) {
+    esp3d_log_e("Failed to create history screen");
+    return;
+  }
+  // Display new screen and delete old one
+  lv_obj_t *ui_current_screen = lv_scr_act();
+  lv_scr_load(ui_new_screen);
+  ESP3DStyle::apply(ui_new_screen, ESP3DStyleType::main_bg);
+  screenManager::release(ui_current_screen);
+  lv_obj_add_event_cb(ui_new_screen, event_history_screen_delete_handler,
+                      LV_EVENT_DELETE, NULL);
+  // Add back button
+  lv_obj_t *btnback = backButton::create(ui_new_screen);
+  if (!lv_obj_is_valid(btnback)) {
+    esp3d_log_e("Failed to create back button");
+    return;
+  }
+  lv_obj_add_event_cb(btnback, event_button_history_back_handler,
+                      LV_EVENT_CLICKED, NULL);
+  lv_obj_update_layout(btnback);
+
+  // Resolution button matrix
+  lv_obj_t *btnm = lv_btnmatrix_create(ui_new_screen);
+  if (!lv_obj_is_valid(btnm)) {
+    esp3d_log_e("Failed to create button matrix");
+    return;
+  }
+  lv_btnmatrix_set_map(btnm, history_buttons_map);
+  ESP3DStyle::apply(btnm, ESP3DStyleType::buttons_matrix);
+  lv_obj_set_size(btnm, ESP3D_MATRIX_BUTTON_WIDTH * 2,
+                  ESP3D_MATRIX_BUTTON_HEIGHT);
+  lv_btnmatrix_set_btn_ctrl(btnm, static_cast<uint8_t>(history_resolution),
+                            LV_BTNMATRIX_CTRL_CHECKED);
+  lv_obj_align_to(btnm, btnback, LV_ALIGN_OUT_LEFT_BOTTOM,
+                  -ESP3D_BUTTON_PRESSED_OUTLINE, 0);
+  lv_obj_add_event_cb(btnm, history_matrix_buttons_event_cb,
+                      LV_EVENT_VALUE_CHANGED, NULL);
+
+  // Chart
+  history_chart = lv_chart_create(ui_new_screen);
+  if (!lv_obj_is_valid(history_chart)) {
+    esp3d_log_e("Failed to create chart");
+    return;
+  }
+  lv_obj_update_layout(ui_new_screen);
+  lv_obj_set_pos(history_chart, ESP3D_BUTTON_PRESSED_OUTLINE,
+                 ESP3D_BUTTON_PRESSED_OUTLINE);
+  lv_obj_set_size(
+      history_chart, LV_HOR_RES - ESP3D_BUTTON_PRESSED_OUTLINE * 2,
+      lv_obj_get_height(ui_new_screen) - (ESP3D_BUTTON_PRESSED_OUTLINE * 3) -
+          lv_obj_get_height(btnback));
+  lv_obj_set_style_radius(history_chart, ESP3D_CONTAINER_RADIUS, 0);
+  lv_chart_set_type(history_chart, LV_CHART_TYPE_LINE);
+  lv_chart_set_update_mode(history_chart, LV_CHART_UPDATE_MODE_CIRCULAR);
+  lv_chart_set_point_count(history_chart, HISTORY_CHART_POINTS);
+  lv_chart_set_range(history_chart, LV_CHART_AXIS_PRIMARY_Y, 0,
+                     HISTORY_CHART_MAX);
+  lv_chart_set_div_line_count(history_chart, 4, 6);
+  // no dot on points, only lines
+  lv_obj_set_style_size(history_chart, 0, LV_PART_INDICATOR);
+  for (uint8_t s = 0; s < HISTORY_CHART_SERIES; s++) {
+    history_series[s] =
+        lv_chart_add_series(history_chart, lv_palette_main(history_colors[s]),
+                            LV_CHART_AXIS_PRIMARY_Y);
+  }
+  history_fill_chart();
+  history_refresh_timer = lv_timer_create(history_refresh_timer_cb,
+                                          HISTORY_CHART_REFRESH_PERIOD, NULL);
+  esp3dTftui.set_current_screen(ESP3DScreenType::history);
+}
+}  // namespace historyScreen
@@ -24,6 +24,7 @@
 
 #include "esp3d_hal.h"
 #include "esp3d_log.h"
+#include "esp3d_screen_manager.h"
 #include "esp3d_string.h"
 #include "esp3d_styles.h"
 #include "esp3d_tft_ui.h"
@@ -68,6 +69,7 @@ void main_display_stop();
 void main_display_files();
 #endif  // ESP3D_SD_CARD_FEATURE
 void main_display_menu();
+void main_display_all();
 
 /**********************
  *   STATIC VARIABLES
@@ -105,7 +107,13 @@ lv_obj_t *main_btn_menu = nullptr;
  * @param show Boolean value indicating whether to show or hide the fan
  * controls.
  */
-void show_fan_controls(bool show) { show_fan_button = show; }
+void show_fan_controls(bool show) {
+  if (show_fan_button != show) {
+    // layout changed so retained screen must be created again
+    screenManager::evict(ESP3DScreenType::main);
+  }
+  show_fan_button = show;
+}
 
 /**
  * Callback function for handling updates to the value of extruder 0.
@@ -917,6 +925,29 @@ void event_button_stop_handler(lv_event_t *e) {
                        event_confirm_stop_cb);
 }
 
+/**
+ * @brief Updates all the values displayed on the main screen.
+ *
+ * Used when the screen is created and when the retained screen is displayed
+ * again, as values updates are ignored while another screen is displayed.
+ */
+void main_display_all() {
+  main_display_extruder_0();
+  main_display_extruder_1();
+  main_display_bed();
+  main_display_positions();
+  main_display_status_area();
+  main_display_pause();
+  main_display_resume();
+#if ESP3D_SD_CARD_FEATURE
+  main_display_files();
+#endif  // ESP3D_SD_CARD_FEATURE
+  main_display_stop();
+  main_display_menu();
+  main_display_speed();
+  if (show_fan_button) main_display_fan();
+}
+
 /**
  * @brief Creates the main screen.
  *
@@ -944,6 +975,13 @@ void create() {
     }
     intialization_done = true;
   }
+  // Reuse retained screen if any, only values need to be updated
+  if (screenManager::show(ESP3DScreenType::main)) {
+    esp3dTftui.set_current_screen(ESP3DScreenType::main);
+    statusBar::refresh();
+    main_display_all();
+    return;
+  }
   // Background
   lv_obj_t *ui_main_screen = lv_obj_create(NULL);
   if (!lv_obj_is_valid(ui_main_screen)) {
@@ -954,9 +992,8 @@ void create() {
   lv_obj_t *ui_current_screen = lv_scr_act();
   lv_scr_load(ui_main_screen);
   ESP3DStyle::apply(ui_main_screen, ESP3DStyleType::main_bg);
-  if (lv_obj_is_valid(ui_current_screen)) {
-    lv_obj_del(ui_current_screen);
-  }
+  screenManager::release(ui_current_screen);
+  screenManager::retain(ESP3DScreenType::main, ui_main_screen);
 
   lv_obj_t *ui_status_bar_container = statusBar::create(ui_main_screen);
   if (!lv_obj_is_valid(ui_status_bar_container)) {
@@ -1131,19 +1168,6 @@ void create() {
   lv_obj_add_event_cb(main_btn_menu, event_button_menu_handler,
                       LV_EVENT_CLICKED, NULL);
   esp3dTftui.set_current_screen(ESP3DScreenType::main);
-  main_display_extruder_0();
-  main_display_extruder_1();
-  main_display_bed();
-  main_display_positions();
-  main_display_status_area();
-  main_display_pause();
-  main_display_resume();
-#if ESP3D_SD_CARD_FEATURE
-  main_display_files();
-#endif  // ESP3D_SD_CARD_FEATURE
-  main_display_stop();
-  main_display_menu();
-  main_display_speed();
-  if (show_fan_button) main_display_fan();
+  main_display_all();
 }
 }  // namespace mainScreen
\ No newline at end of file
@@ -26,11 +26,13 @@
 #include "components/symbol_button_component.h"
 #include "esp3d_log.h"
 #include "esp3d_lvgl.h"
+#include "esp3d_screen_manager.h"
 #include "esp3d_string.h"
 #include "esp3d_styles.h"
 #include "esp3d_tft_ui.h"
 #include "rendering/esp3d_rendering_client.h"
 #include "screens/filament_screen.h"
+#include "screens/history_screen.h"
 #include "screens/main_screen.h"
 #include "translations/esp3d_translation_service.h"
 
@@ -260,6 +262,40 @@ void event_button_temperatures_back_handler(lv_event_t *e) {
   }
 }
 
+/**
+ * @brief Callback function for the history delay timer.
+ *
+ * This function is called when the delay timer expires. It displays the
+ * temperatures history, which comes back to the current heater.
+ *
+ * @param timer Pointer to the timer object that triggered the callback.
+ */
+void temperatures_screen_history_timer_cb(lv_timer_t *timer) {
+  if (temperatures_screen_delay_timer) {
+    lv_timer_del(temperatures_screen_delay_timer);
+    temperatures_screen_delay_timer = NULL;
+  }
+  historyScreen::create(get_heater_buttons_map_id(heater_buttons_map_id),
+                        screen_return);
+}
+
+/**
+ * @brief Event handler for the history button in the temperatures screen.
+ *
+ * @param e Pointer to the event object.
+ */
+void event_button_temperatures_history_handler(lv_event_t *e) {
+  esp3d_log("history Clicked");
+  if (ESP3D_BUTTON_ANIMATION_DELAY) {
+    if (temperatures_screen_delay_timer) return;
+    temperatures_screen_delay_timer =
+        lv_timer_create(temperatures_screen_history_timer_cb,
+                        ESP3D_BUTTON_ANIMATION_DELAY, NULL);
+  } else {
+    temperatures_screen_history_timer_cb(NULL);
+  }
+}
+
 /**
  * @brief Event callback function for the temperatures text area.
  *
@@ -600,9 +636,7 @@ void create(uint8_t target, ESP3DScreenType screenreturn) {
   lv_obj_t *ui_current_screen = lv_scr_act();
   lv_scr_load(ui_new_screen);
   ESP3DStyle::apply(ui_new_screen, ESP3DStyleType::main_bg);
-  if (lv_obj_is_valid(ui_current_screen)) {
-    lv_obj_del(ui_current_screen);
-  }
+  screenManager::release(ui_current_screen);
 
   // back button
   btnback = backButton::create(ui_new_screen);
@@ -650,6 +684,19 @@ void create(uint8_t target, ESP3DScreenType screenreturn) {
   lv_obj_align_to(btn_power_off_all, btnm_target, LV_ALIGN_OUT_LEFT_BOTTOM,
                   -ESP3D_BUTTON_PRESSED_OUTLINE, 0);
 
+  // History chart
+  lv_obj_t *btn_history = symbolButton::create(
+      ui_new_screen, LV_SYMBOL_GAUGE, ESP3D_MATRIX_BUTTON_WIDTH,
+      ESP3D_MATRIX_BUTTON_HEIGHT);
+  if (!lv_obj_is_valid(btn_history)) {
+    esp3d_log_e("Failed to create history button");
+    return;
+  }
+  lv_obj_align_to(btn_history, btn_power_off_all, LV_ALIGN_OUT_LEFT_BOTTOM,
+                  -ESP3D_BUTTON_PRESSED_OUTLINE, 0);
+  lv_obj_add_event_cb(btn_history, event_button_temperatures_history_handler,
+                      LV_EVENT_CLICKED, NULL);
+
   // Label current heater
   label_current_temperature = lv_label_create(ui_new_screen);
   if (!lv_obj_is_valid(label_current_temperature)) {
@@ -25,6 +25,7 @@
 #include "esp3d_hal.h"
 #include "esp3d_log.h"
 #include "esp3d_lvgl.h"
+#include "esp3d_screen_manager.h"
 #include "esp3d_string.h"
 #include "esp3d_styles.h"
 #include "esp3d_tft_ui.h"
@@ -103,10 +104,7 @@ void create() {
   // Display new screen now and delete old one to save memory
   lv_obj_t *ui_current_screen = lv_scr_act();
   lv_scr_load(ui_screen);
-  // Free old screen
-  if (lv_obj_is_valid(ui_current_screen)) {
-    lv_obj_del(ui_current_screen);
-  }
+  screenManager::release(ui_current_screen);
   // TODO: Add your code here
 
   // Display screen
@@ -24,6 +24,7 @@
 
 #include "esp3d_hal.h"
 #include "esp3d_log.h"
+#include "esp3d_screen_manager.h"
 #include "esp3d_string.h"
 #include "esp3d_styles.h"
 #include "esp3d_tft_ui.h"
@@ -58,6 +59,7 @@ void main_display_stop();
 void main_display_files();
 #endif  // ESP3D_SD_CARD_FEATURE
 void main_display_menu();
+void main_display_all();
 
 /**********************
  *   STATIC VARIABLES
@@ -373,6 +375,18 @@ void event_button_stop_handler(lv_event_t *e) {
                        event_confirm_stop_cb);
 }
 
+void main_display_all() {
+  // main_display_positions();
+  main_display_status_area();
+  main_display_pause();
+  main_display_resume();
+#if ESP3D_SD_CARD_FEATURE
+  main_display_files();
+#endif  // ESP3D_SD_CARD_FEATURE
+  main_display_stop();
+  main_display_menu();
+}
+
 void create() {
   esp3dTftui.set_current_screen(ESP3DScreenType::none);
   // Screen creation
@@ -380,6 +394,13 @@ void create() {
   if (!intialization_done) {
     intialization_done = true;
   }
+  // Reuse retained screen if any, only values need to be updated
+  if (screenManager::show(ESP3DScreenType::main)) {
+    esp3dTftui.set_current_screen(ESP3DScreenType::main);
+    statusBar::refresh();
+    main_display_all();
+    return;
+  }
   // Background
   lv_obj_t *ui_main_screen = lv_obj_create(NULL);
   if (!lv_obj_is_valid(ui_main_screen)) {
@@ -390,9 +411,8 @@ void create() {
   lv_obj_t *ui_current_screen = lv_scr_act();
   lv_scr_load(ui_main_screen);
   ESP3DStyle::apply(ui_main_screen, ESP3DStyleType::main_bg);
-  if (lv_obj_is_valid(ui_current_screen)) {
-    lv_obj_del(ui_current_screen);
-  }
+  screenManager::release(ui_current_screen);
+  screenManager::retain(ESP3DScreenType::main, ui_main_screen);
   // Create status bar
   lv_obj_t *ui_status_bar_container = statusBar::create(ui_main_screen);
   if (!lv_obj_is_valid(ui_status_bar_container)) {
@@ -537,14 +557,6 @@ void create() {
   lv_obj_add_event_cb(main_btn_menu, event_button_menu_handler,
                       LV_EVENT_CLICKED, NULL);
   esp3dTftui.set_current_screen(ESP3DScreenType::main);
-  // main_display_positions();
-  main_display_status_area();
-  main_display_pause();
-  main_display_resume();
-#if ESP3D_SD_CARD_FEATURE
-  main_display_files();
-#endif  // ESP3D_SD_CARD_FEATURE
-  main_display_stop();
-  main_display_menu();
+  main_display_all();
 }
 }  // namespace mainScreen
\ No newline at end of file
@@ -83,6 +83,26 @@ static void event_handler_status_list(lv_event_t *e) {
   }
 }
 
+/**
+ * @brief Updates the status bar label with the current status value.
+ *
+ * Used when a retained screen is displayed again, because updates are ignored
+ * while the main screen is not the current one.
+ */
+void refresh() {
+  const ESP3DValuesDescription *status_bar_desc =
+      esp3dTftValues.get_description(ESP3DValuesIndex::status_bar_label);
+  if (status_bar_desc == nullptr || status_bar_label == nullptr ||
+      !lv_obj_is_valid(status_bar_label)) {
+    return;
+  }
+  std::string svalue_one_line =
+      esp3d_string::str_replace(status_bar_desc->value.c_str(), "\n", "");
+  svalue_one_line =
+      esp3d_string::str_replace(svalue_one_line.c_str(), "\r", "");
+  lv_label_set_text(status_bar_label, svalue_one_line.c_str());
+}
+
 /**
  * @brief Creates a status bar component and adds it to the given screen.
  *
@@ -28,5 +28,6 @@ namespace statusBar {
 bool callback(ESP3DValuesIndex index, const char *value,
               ESP3DValuesCbAction action);
 lv_obj_t *create(lv_obj_t *screen);
+void refresh();
 
 }  // namespace statusBar
@@ -0,0 +1,150 @@
+/*
+  esp3d_screen_manager
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "esp3d_screen_manager.h"
+
+#include "esp3d_log.h"
+#include "esp_heap_caps.h"
+
+namespace screenManager {
+struct ESP3DRetainedScreen {
+  ESP3DScreenType type;
+  lv_obj_t *screen;
+  uint32_t lastUse;
+};
+
+ESP3DRetainedScreen retained_screens[ESP3D_RETAINED_SCREENS_COUNT] = {};
+uint32_t use_counter = 0;
+
+// Memory available for LVGL objects
+static size_t free_memory() {
+#if LV_MEM_CUSTOM
+  // malloc is used, so PSRAM too when available
+  return heap_caps_get_free_size(MALLOC_CAP_8BIT);
+#else
+  lv_mem_monitor_t mon;
+  lv_mem_monitor(&mon);
+  return mon.free_size;
+#endif  // LV_MEM_CUSTOM
+}
+
+static ESP3DRetainedScreen *find(ESP3DScreenType type) {
+  for (uint8_t i = 0; i < ESP3D_RETAINED_SCREENS_COUNT; i++) {
+    if (retained_screens[i].screen != nullptr &&
+        retained_screens[i].type == type) {
+      return &retained_screens[i];
+    }
+  }
+  return nullptr;
+}
+
+static void free_slot(ESP3DRetainedScreen *slot) {
+  lv_obj_t *screen = slot->screen;
+  slot->screen = nullptr;
+  slot->type = ESP3DScreenType::none;
+  slot->lastUse = 0;
+  if (screen != lv_scr_act() && lv_obj_is_valid(screen)) {
+    esp3d_log("Delete retained screen");
+    lv_obj_del(screen);
+  }
+}
+
+// Delete least recently used screens not displayed until enough memory
+static void check_memory() {
+  while (free_memory() < ESP3D_RETAINED_SCREENS_MIN_FREE_MEMORY) {
+    ESP3DRetainedScreen *oldest = nullptr;
+    for (uint8_t i = 0; i < ESP3D_RETAINED_SCREENS_COUNT; i++) {
+      ESP3DRetainedScreen *slot = &retained_screens[i];
+      if (slot->screen != nullptr && slot->screen != lv_scr_act() &&
+          (oldest == nullptr || slot->lastUse < oldest->lastUse)) {
+        oldest = slot;
+      }
+    }
+    if (oldest == nullptr) {
+      return;
+    }
+    esp3d_log_w("Low memory, evict retained screen");
+    free_slot(oldest);
+  }
+}
+
+bool show(ESP3DScreenType type) {
+  ESP3DRetainedScreen *slot = find(type);
+  if (slot == nullptr) {
+    return false;
+  }
+  if (!lv_obj_is_valid(slot->screen)) {
+    slot->screen = nullptr;
+    slot->type = ESP3DScreenType::none;
+    return false;
+  }
+  slot->lastUse = ++use_counter;
+  lv_obj_t *ui_current_screen = lv_scr_act();
+  if (ui_current_screen != slot->screen) {
+    lv_scr_load(slot->screen);
+    release(ui_current_screen);
+  }
+  check_memory();
+  return true;
+}
+
+void retain(ESP3DScreenType type, lv_obj_t *screen) {
+  check_memory();
+  if (free_memory() < ESP3D_RETAINED_SCREENS_MIN_FREE_MEMORY) {
+    esp3d_log_w("Not enough memory to retain screen");
+    return;
+  }
+  ESP3DRetainedScreen *slot = find(type);
+  if (slot == nullptr) {
+    // use empty slot or least recently used one
+    slot = &retained_screens[0];
+    for (uint8_t i = 1; i < ESP3D_RETAINED_SCREENS_COUNT; i++) {
+      if (retained_screens[i].lastUse < slot->lastUse) {
+        slot = &retained_screens[i];
+      }
+    }
+  }
+  if (slot->screen != nullptr && slot->screen != screen) {
+    free_slot(slot);
+  }
+  slot->type = type;
+  slot->screen = screen;
+  slot->lastUse = ++use_counter;
+}
+
+void release(lv_obj_t *screen) {
+  if (!lv_obj_is_valid(screen)) {
+    return;
+  }
+  for (uint8_t i = 0; i < ESP3D_RETAINED_SCREENS_COUNT; i++) {
+    if (retained_screens[i].screen == screen) {
+      return;
+    }
+  }
+  lv_obj_del(screen);
+}
+
+void evict(ESP3DScreenType type) {
+  ESP3DRetainedScreen *slot = find(type);
+  if (slot != nullptr) {
+    free_slot(slot);
+  }
+}
+}  // namespace screenManager
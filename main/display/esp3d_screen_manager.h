@@ -0,0 +1,43 @@
+/*
+  esp3d_screen_manager
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+#include <lvgl.h>
+
+#include "screens/esp3d_screen_type.h"
+
+// Number of screens kept alive when not displayed
+#define ESP3D_RETAINED_SCREENS_COUNT 2
+// Retained screens are deleted when free memory goes under this size
+#define ESP3D_RETAINED_SCREENS_MIN_FREE_MEMORY (24 * 1024)
+
+// Frequently used screens are retained instead of being deleted, so next
+// display only needs to refresh values instead of creating all objects again
+namespace screenManager {
+// Display retained screen of this type if any, delete previous screen if not
+// retained, return false if screen must be created
+bool show(ESP3DScreenType type);
+// Keep screen alive when another screen is displayed
+void retain(ESP3DScreenType type, lv_obj_t *screen);
+// Delete screen unless it is retained
+void release(lv_obj_t *screen);
+// Delete retained screen of this type, e.g. when its layout changed
+void evict(ESP3DScreenType type);
+}  // namespace screenManager
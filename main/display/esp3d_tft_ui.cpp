@@ -22,8 +22,11 @@
 
 #include <string>
 
+#include "esp3d_events.h"
 #include "esp3d_hal.h"
 #include "esp3d_log.h"
+#include "esp3d_scheduling.h"
+#include "esp3d_ui_governor.h"
 #include "esp3d_values.h"
 #include "esp3d_version.h"
 #include "esp_freertos_hooks.h"
@@ -38,6 +41,8 @@
 #define STACKDEPTH UI_STACK_DEPTH
 #define TASKPRIORITY UI_TASK_PRIORITY
 #define TASKCORE UI_TASK_CORE
+// Max sleep time if lvgl has no timer to run and no value is updated
+#define UI_IDLE_TIMEOUT 100  // milliseconds
 
 /**********************
  *  STATIC PROTOTYPES
@@ -81,15 +86,37 @@ static void guiTask(void *pvParameter) {
   create_application();
 
   while (1) {
-    /* Delay 1 tick (assumes FreeRTOS tick is 10ms */
-    esp3d_hal::wait(10);
-
+    uint32_t next_run = UI_IDLE_TIMEOUT;
+    uint32_t values_delay = 0;
     /* Try to take the semaphore, call lvgl related function on success */
     if (pdTRUE == xSemaphoreTake(xGuiSemaphore, portMAX_DELAY)) {
-      esp3dTftValues.handle();
-      lv_task_handler();
+      // adapt refresh rate and values updates to streaming activity
+      esp3dUiGovernor.handle();
+      values_delay = esp3dUiGovernor.getValuesDelay();
+      if (values_delay == 0) {
+        esp3dTftValues.handle();
+        if (!esp3dTftValues.hasPendingUpdates()) {
+          esp3dUiGovernor.setValuesUpdated();
+        }
+      }
+      // time until next lvgl timer (refresh, input device read, animation)
+      next_run = lv_task_handler();
       xSemaphoreGive(xGuiSemaphore);
     }
+    /* Sleep until next lvgl timer or new value to display */
+    if (!esp3dTftValues.hasPendingUpdates()) {
+      if (next_run > UI_IDLE_TIMEOUT) {
+        next_run = UI_IDLE_TIMEOUT;
+      }
+      esp3dEvents.wait(ESP3DEventConsumer::ui, next_run);
+    } else if (values_delay > 0) {
+      // pending values are merged until the governor delay is over, new
+      // values notifications must not wake up the task meanwhile
+      if (next_run > values_delay) {
+        next_run = values_delay;
+      }
+      vTaskDelay(pdMS_TO_TICKS(next_run) > 0 ? pdMS_TO_TICKS(next_run) : 1);
+    }
   }
 
   /* A task should NEVER return */
@@ -108,10 +135,13 @@ bool ESP3DTftUi::begin() {
 
   // Ui creation
   TaskHandle_t xHandle = NULL;
-  BaseType_t res = xTaskCreatePinnedToCore(guiTask, "tftUI", STACKDEPTH, NULL,
-                                           TASKPRIORITY, &xHandle, TASKCORE);
+  BaseType_t res = xTaskCreatePinnedToCore(
+      guiTask, "tftUI", STACKDEPTH, NULL,
+      esp3dScheduling.getPriority(ESP3DTaskRole::ui, TASKPRIORITY), &xHandle,
+      esp3dScheduling.getCore(ESP3DTaskRole::ui, TASKCORE));
   if (res == pdPASS && xHandle) {
     esp3d_log("Created UI Task");
+    esp3dScheduling.registerTask(ESP3DTaskRole::ui, xHandle, TASKPRIORITY);
     return true;
   } else {
     esp3d_log_e("UI Task creation failed");
@@ -121,6 +151,20 @@ bool ESP3DTftUi::begin() {
 
 void ESP3DTftUi::handle() {}
 
+void ESP3DTftUi::set_current_screen(ESP3DScreenType screen) {
+#if ESP3D_TFT_BENCHMARK
+  // screens are set to none when switch starts and to their type once ready
+  if (screen == ESP3DScreenType::none) {
+    _switch_start = esp_timer_get_time();
+  } else if (_current_screen == ESP3DScreenType::none && _switch_start != 0) {
+    esp3d_report("Screen %d ready in %lld us", static_cast<uint8_t>(screen),
+                 esp_timer_get_time() - _switch_start);
+    _switch_start = 0;
+  }
+#endif  // ESP3D_TFT_BENCHMARK
+  _current_screen = screen;
+}
+
 bool ESP3DTftUi::end() {
   // TODO : stop TFT task and delete it
   renderingClient.end();
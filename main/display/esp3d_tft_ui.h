@@ -30,12 +30,15 @@ class ESP3DTftUi final {
   bool begin();
   void handle();
   bool end();
-  void set_current_screen(ESP3DScreenType screen) { _current_screen = screen; }
+  void set_current_screen(ESP3DScreenType screen);
   ESP3DScreenType get_current_screen() { return _current_screen; }
 
  private:
   ESP3DScreenType _current_screen = ESP3DScreenType::none;
   bool _started;
+#if ESP3D_TFT_BENCHMARK
+  int64_t _switch_start = 0;
+#endif  // ESP3D_TFT_BENCHMARK
 };
 
 extern ESP3DTftUi esp3dTftui;
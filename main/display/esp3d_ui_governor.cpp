@@ -0,0 +1,187 @@
+/*
+  esp3d_ui_governor
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "esp3d_ui_governor.h"
+
+#include "esp3d_hal.h"
+#include "esp3d_log.h"
+#include "esp3d_values.h"
+#include "gcode_host/esp3d_gcode_host_service.h"
+#include "lvgl.h"
+
+ESP3DUiGovernor esp3dUiGovernor;
+
+const char *uiGovernorLevelNames[] = {"full", "reduced", "minimal"};
+
+ESP3DUiGovernor::ESP3DUiGovernor() {
+  _level = ESP3DUiGovernorLevel::full;
+  _level_changes = 0;
+  _level_start = 0;
+  for (uint8_t l = 0; l < static_cast<uint8_t>(ESP3DUiGovernorLevel::count);
+       l++) {
+    _level_durations[l] = 0;
+  }
+  _last_values_update = 0;
+  _last_sample = 0;
+  _last_acked_lines = 0;
+  _lines_rate = 0;
+  _best_lines_rate = 0;
+  _base_ack_latency = 0;
+  _degraded = false;
+}
+
+ESP3DUiGovernor::~ESP3DUiGovernor() {}
+
+const char *ESP3DUiGovernor::getLevelName(ESP3DUiGovernorLevel level) {
+  if (level >= ESP3DUiGovernorLevel::count) {
+    return "";
+  }
+  return uiGovernorLevelNames[static_cast<uint8_t>(level)];
+}
+
+uint64_t ESP3DUiGovernor::getLevelDuration(ESP3DUiGovernorLevel level) {
+  if (level >= ESP3DUiGovernorLevel::count) {
+    return 0;
+  }
+  uint64_t duration = _level_durations[static_cast<uint8_t>(level)];
+  if (level == _level) {
+    duration += esp3d_hal::millis() - _level_start;
+  }
+  return duration;
+}
+
+uint32_t ESP3DUiGovernor::getValuesDelay() {
+  uint32_t period = 0;
+  switch (_level) {
+    case ESP3DUiGovernorLevel::reduced:
+      period = ESP3D_UI_GOVERNOR_REDUCED_VALUES_PERIOD;
+      break;
+    case ESP3DUiGovernorLevel::minimal:
+      period = ESP3D_UI_GOVERNOR_MINIMAL_VALUES_PERIOD;
+      break;
+    default:
+      return 0;
+  }
+  int64_t elapsed = esp3d_hal::millis() - _last_values_update;
+  return elapsed >= period ? 0 : period - elapsed;
+}
+
+void ESP3DUiGovernor::setValuesUpdated() {
+  _last_values_update = esp3d_hal::millis();
+}
+
+void ESP3DUiGovernor::handle() {
+  int64_t now = esp3d_hal::millis();
+  ESP3DUiGovernorLevel level = ESP3DUiGovernorLevel::full;
+  if (gcodeHostService.getState() == ESP3DGcodeHostState::processing) {
+    if (_last_sample == 0) {
+      _last_sample = now;
+      _last_acked_lines = gcodeHostService.getAckedLines();
+    } else if (now - _last_sample >= ESP3D_UI_GOVERNOR_SAMPLE_PERIOD) {
+      uint32_t lines = gcodeHostService.getAckedLines();
+      _lines_rate = ((lines - _last_acked_lines) * 1000) / (now - _last_sample);
+      _last_acked_lines = lines;
+      _last_sample = now;
+      uint32_t latency = gcodeHostService.getAckLatency();
+      // first sample of job is the reference
+      if (_base_ack_latency == 0) {
+        _base_ack_latency = latency;
+      }
+      uint32_t max_latency =
+          (_base_ack_latency * ESP3D_UI_GOVERNOR_MAX_ACK_LATENCY_PERCENT) /
+          100;
+      if (max_latency <
+          _base_ack_latency + ESP3D_UI_GOVERNOR_MIN_ACK_LATENCY_MARGIN) {
+        max_latency =
+            _base_ack_latency + ESP3D_UI_GOVERNOR_MIN_ACK_LATENCY_MARGIN;
+      }
+      _degraded = (_base_ack_latency != 0 && latency > max_latency) ||
+                  _lines_rate * 100 <
+                      _best_lines_rate * ESP3D_UI_GOVERNOR_MIN_RATE_PERCENT;
+      // better values are taken at once, worse ones slowly
+      if (latency < _base_ack_latency) {
+        _base_ack_latency = latency;
+      } else {
+        _base_ack_latency +=
+            (latency - _base_ack_latency) / ESP3D_UI_GOVERNOR_DECAY;
+      }
+      if (_lines_rate > _best_lines_rate) {
+        _best_lines_rate = _lines_rate;
+      } else {
+        _best_lines_rate -=
+            (_best_lines_rate - _lines_rate) / ESP3D_UI_GOVERNOR_DECAY;
+      }
+    }
+    level = _degraded ? ESP3DUiGovernorLevel::minimal
+                      : ESP3DUiGovernorLevel::reduced;
+  } else if (_last_sample != 0) {
+    // job is over, next one starts from scratch
+    _last_sample = 0;
+    _lines_rate = 0;
+    _best_lines_rate = 0;
+    _base_ack_latency = 0;
+    _degraded = false;
+  }
+  // any touch gives back full responsiveness
+  if (lv_disp_get_inactive_time(NULL) < ESP3D_UI_GOVERNOR_TOUCH_HOLD) {
+    level = ESP3DUiGovernorLevel::full;
+  }
+  if (level != _level) {
+    _setLevel(level);
+  }
+  // starting a new animation resumes the animation timer
+  if (_level == ESP3DUiGovernorLevel::minimal) {
+    lv_timer_pause(lv_anim_get_timer());
+  }
+}
+
+void ESP3DUiGovernor::_setLevel(ESP3DUiGovernorLevel level) {
+  int64_t now = esp3d_hal::millis();
+  _level_durations[static_cast<uint8_t>(_level)] += now - _level_start;
+  _level_start = now;
+  _level_changes++;
+  uint32_t period = LV_DISP_DEF_REFR_PERIOD;
+  if (level == ESP3DUiGovernorLevel::reduced) {
+    period = ESP3D_UI_GOVERNOR_REDUCED_REFR_PERIOD;
+  } else if (level == ESP3DUiGovernorLevel::minimal) {
+    period = ESP3D_UI_GOVERNOR_MINIMAL_REFR_PERIOD;
+  }
+  lv_timer_t *refr_timer = _lv_disp_get_refr_timer(lv_disp_get_default());
+  if (refr_timer) {
+    lv_timer_set_period(refr_timer, period);
+  }
+  esp3dTftValues.setCoalescing(level != ESP3DUiGovernorLevel::full);
+  // animation timer pauses itself when there is no more animation
+  if (level == ESP3DUiGovernorLevel::minimal) {
+    lv_timer_pause(lv_anim_get_timer());
+  } else if (_level == ESP3DUiGovernorLevel::minimal) {
+    lv_timer_resume(lv_anim_get_timer());
+  }
+#if ESP3D_TFT_BENCHMARK
+  esp3d_report("UI governor %s -> %s, %ld lines/s (best %ld), ack %ld ms",
+               getLevelName(_level), getLevelName(level), _lines_rate,
+               _best_lines_rate, gcodeHostService.getAckLatency());
+#else
+  esp3d_log("UI governor %s -> %s, %ld lines/s (best %ld), ack %ld ms",
+            getLevelName(_level), getLevelName(level), _lines_rate,
+            _best_lines_rate, gcodeHostService.getAckLatency());
+#endif  // ESP3D_TFT_BENCHMARK
+  _level = level;
+}
@@ -0,0 +1,93 @@
+/*
+  esp3d_ui_governor
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Display refresh period (ms) for each level, full is LV_DISP_DEF_REFR_PERIOD
+#define ESP3D_UI_GOVERNOR_REDUCED_REFR_PERIOD 100
+#define ESP3D_UI_GOVERNOR_MINIMAL_REFR_PERIOD 250
+// Values updates are merged and applied at most once per period (ms)
+#define ESP3D_UI_GOVERNOR_REDUCED_VALUES_PERIOD 250
+#define ESP3D_UI_GOVERNOR_MINIMAL_VALUES_PERIOD 1000
+// Full responsiveness is kept this long (ms) after last touch
+#define ESP3D_UI_GOVERNOR_TOUCH_HOLD 10000
+// Streaming is degraded when ack latency is above this percentage of the
+// latency measured at job start, printers do not all answer at same speed
+#define ESP3D_UI_GOVERNOR_MAX_ACK_LATENCY_PERCENT 200
+// and at least this many ms above it, so a fast printer is not too sensitive
+#define ESP3D_UI_GOVERNOR_MIN_ACK_LATENCY_MARGIN 10
+// or when lines per second fall under this percentage of the best rate
+#define ESP3D_UI_GOVERNOR_MIN_RATE_PERCENT 75
+// Reference latency and best rate move by 1/n of the gap to current value
+// at each sample, so a lasting change of the job becomes the new reference
+#define ESP3D_UI_GOVERNOR_DECAY 16
+// Period (ms) used to compute lines per second
+#define ESP3D_UI_GOVERNOR_SAMPLE_PERIOD 1000
+
+enum class ESP3DUiGovernorLevel : uint8_t {
+  full = 0,  // no streaming or user is using the screen
+  reduced,   // streaming: lower refresh rate and merged values updates
+  minimal,   // streaming degraded: animations and spinners paused too
+  count,
+};
+
+class ESP3DUiGovernor final {
+ public:
+  ESP3DUiGovernor();
+  ~ESP3DUiGovernor();
+  // must be called from ui task, with lvgl semaphore taken
+  void handle();
+  ESP3DUiGovernorLevel getLevel() { return _level; }
+  const char *getLevelName(ESP3DUiGovernorLevel level);
+  // delay before pending values can be applied, 0 if now
+  uint32_t getValuesDelay();
+  // all pending values have been applied
+  void setValuesUpdated();
+  uint32_t getLevelChanges() { return _level_changes; }
+  // time spent in level since boot, in ms
+  uint64_t getLevelDuration(ESP3DUiGovernorLevel level);
+  uint32_t getLinesRate() { return _lines_rate; }
+
+ private:
+  void _setLevel(ESP3DUiGovernorLevel level);
+  ESP3DUiGovernorLevel _level;
+  uint32_t _level_changes;
+  int64_t _level_start;
+  uint64_t _level_durations[static_cast<uint8_t>(ESP3DUiGovernorLevel::count)];
+  int64_t _last_values_update;
+  int64_t _last_sample;
+  uint32_t _last_acked_lines;
+  uint32_t _lines_rate;
+  uint32_t _best_lines_rate;
+  uint32_t _base_ack_latency;
+  bool _degraded;
+};
+
+extern ESP3DUiGovernor esp3dUiGovernor;
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
@@ -23,6 +23,7 @@
 #include <lvgl.h>
 
 #include "esp3d_log.h"
+#include "esp3d_screen_manager.h"
 #include "esp3d_styles.h"
 #include "esp3d_tft_ui.h"
 #include "screens/main_screen.h"
@@ -68,9 +69,7 @@ void create() {
   lv_scr_load(ui_new_screen);
   ESP3DStyle::apply(ui_new_screen, ESP3DStyleType::main_bg);
 
-  if (lv_obj_is_valid(ui_current_screen)) {
-    lv_obj_del(ui_current_screen);
-  }
+  screenManager::release(ui_current_screen);
 
   lv_obj_add_event_cb(ui_new_screen, event_button_handler, LV_EVENT_CLICKED,
                       NULL);
@@ -33,9 +33,11 @@
 #include "esp3d_json_settings.h"
 #include "esp3d_log.h"
 #include "esp3d_lvgl.h"
+#include "esp3d_screen_manager.h"
 #include "esp3d_string.h"
 #include "esp3d_styles.h"
 #include "esp3d_tft_ui.h"
+#include "filesystem/esp3d_globalfs.h"
 #include "filesystem/esp3d_sd.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -140,13 +142,13 @@ bool is_in_list(const char *name) {
  * This function clears the files list and then populates it with information
  * about the files present on the SD card. It reads the file extensions filter
  * from the settings, converts it to lowercase, and adds each extension to the
- * files_extensions list. Then, it checks if the SD card is accessible and opens
- * the directory specified by files_path. For each file or directory in the
- * directory, it creates an ESP3DFileDescriptor object and adds it to the
- * files_list. If the file is a directory, it sets the size to "-1". If the file
- * is a playable file, it sets the size to "0" and retrieves the actual file
- * size using the stat function. The file size is then formatted using the
- * formatBytes function and added to the ESP3DFileDescriptor object. Finally,
+ * files_extensions list. Then, it checks if the SD card is accessible and lists
+ * the directory specified by files_path, from the directory cache if the card
+ * did not change. For each file or directory in the directory, it creates an
+ * ESP3DFileDescriptor object and adds it to the files_list. If the file is a
+ * directory, it sets the size to "-1". If the file is a playable file, its
+ * size is formatted using the formatBytes function and added to the
+ * ESP3DFileDescriptor object. Finally,
  * the function logs the name and size of each file found and the total size of
  * the files list.
  *
@@ -175,42 +177,28 @@ void fill_files_list() {
   }
   if (sd.accessFS()) {
     files_has_sd = true;
-    DIR *dir = sd.opendir(files_path.c_str());
-    if (dir) {
-      struct dirent *ent;
-      struct stat entry_stat;
-      while ((ent = readdir(dir)) != NULL) {
+    std::vector<ESP3DDirEntry> entries;
+    std::string dirPath = sd.mount_point();
+    if (files_path != "/") {
+      dirPath += files_path;
+    }
+    if (globalFs.listDir(dirPath.c_str(), entries)) {
+      for (const ESP3DDirEntry &entry : entries) {
         ESP3DFileDescriptor file;
-        if (ent->d_type == DT_DIR) {
-          if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
-            continue;
-          file.name = ent->d_name;
+        if (entry.isDir) {
+          file.name = entry.name;
           file.size = "-1";
           files_list.push_back(file);
         } else {
-          if (!playable_file(ent->d_name)) continue;
-          file.name = ent->d_name;
-          file.size = "0";
-          std::string fullPath = "/";
-          if (files_path != "/") {
-            fullPath = files_path + std::string("/") + ent->d_name;
-          } else {
-            fullPath += ent->d_name;
-          }
-          if (sd.stat(fullPath.c_str(), &entry_stat) == -1) {
-            esp3d_log_e("Failed to stat %s : %s",
-                        ent->d_type == DT_DIR ? "DIR" : "FILE", ent->d_name);
-            continue;
-          }
-          esp3d_log("File size is %ld", entry_stat.st_size);
-          file.size = esp3d_string::formatBytes(entry_stat.st_size);
+          if (!playable_file(entry.name.c_str())) continue;
+          file.name = entry.name;
+          esp3d_log("File size is %d", entry.size);
+          file.size = esp3d_string::formatBytes(entry.size);
           files_list.push_back(file);
         }
         esp3d_log("Found %s, %s", file.name.c_str(), file.size.c_str());
-        esp3d_hal::wait(1);
       }
       esp3d_log("Files list size %d", files_list.size());
-      closedir(dir);
     }
     sd.releaseFS();
   } else {
@@ -365,9 +353,7 @@ void create() {
   lv_obj_t *ui_current_screen = lv_scr_act();
   lv_scr_load(ui_new_screen);
   ESP3DStyle::apply(ui_new_screen, ESP3DStyleType::main_bg);
-  if (lv_obj_is_valid(ui_current_screen)) {
-    lv_obj_del(ui_current_screen);
-  }
+  screenManager::release(ui_current_screen);
 
   // button back
   lv_obj_t *btnback = backButton::create(ui_new_screen);
@@ -25,6 +25,7 @@
 #include <list>
 
 #include "esp3d_log.h"
+#include "esp3d_screen_manager.h"
 #include "esp3d_string.h"
 #include "esp3d_styles.h"
 #include "esp3d_tft_ui.h"
@@ -131,9 +132,7 @@ void create() {
   lv_obj_t *ui_current_screen = lv_scr_act();
   lv_scr_load(ui_status_screen);  // Apply background color
   ESP3DStyle::apply(ui_status_screen, ESP3DStyleType::main_bg);
-  if (lv_obj_is_valid(ui_current_screen)) {
-    lv_obj_del(ui_current_screen);
-  }
+  screenManager::release(ui_current_screen);
 
   // Create screen container
   lv_obj_t *ui_status_screen_container = lv_obj_create(ui_status_screen);
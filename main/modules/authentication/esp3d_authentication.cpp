@@ -20,13 +20,19 @@
 #include "esp3d_authentication.h"
 
 #include <stdio.h>
+#include <string.h>
 
 #include "esp3d_hal.h"
 #include "esp3d_settings.h"
 
 ESP3DAuthenticationService esp3dAuthenthicationService;
 
-ESP3DAuthenticationService::ESP3DAuthenticationService() {}
+ESP3DAuthenticationService::ESP3DAuthenticationService() {
+#if ESP3D_AUTHENTICATION_FEATURE
+  _mutex = PTHREAD_MUTEX_INITIALIZER;
+  _clearTable();
+#endif  // ESP3D_AUTHENTICATION_FEATURE
+}
 ESP3DAuthenticationService::~ESP3DAuthenticationService() {}
 ESP3DAuthenticationLevel ESP3DAuthenticationService::getAuthenticatedLevel(
     const char *pwd) {
@@ -54,8 +60,29 @@ bool ESP3DAuthenticationService::begin() {
 #endif  // ESP3D_AUTHENTICATION_FEATURE
   return true;
 }
+// Oldest webui sessions are on top of heap, so only expired sessions and the
+// ones whose last_time was updated meanwhile are checked
 void ESP3DAuthenticationService::handle() {
-  // TODO  clear time out session
+#if ESP3D_AUTHENTICATION_FEATURE
+  uint64_t timeout = getSessionTimeout();
+  if (timeout == 0) {
+    return;
+  }
+  int64_t now = esp3d_hal::millis();
+  pthread_mutex_lock(&_mutex);
+  while (_heap_size > 0 && now - _heap_time[_heap[0]] >= (int64_t)timeout) {
+    int8_t index = _heap[0];
+    if (now - _records[index].last_time >= (int64_t)timeout) {
+      esp3d_log("Session %s is outdated", _records[index].session_id);
+      _removeRecord(index);
+    } else {
+      // session was used since it was pushed
+      _heap_time[index] = _records[index].last_time;
+      _heapSiftDown(0);
+    }
+  }
+  pthread_mutex_unlock(&_mutex);
+#endif  // ESP3D_AUTHENTICATION_FEATURE
 }
 void ESP3DAuthenticationService::end() {
 #if ESP3D_AUTHENTICATION_FEATURE
@@ -107,38 +134,193 @@ const char *ESP3DAuthenticationService::create_session_id(
   return sessionID;
 }
 
+// FNV-1a hash of session id
+static uint8_t sessionIdHash(const char *sessionId) {
+  uint32_t hash = 2166136261;
+  for (const char *p = sessionId; *p; p++) {
+    hash = (hash ^ (uint8_t)*p) * 16777619;
+  }
+  return hash & (ESP3D_SESSIONS_BUCKETS - 1);
+}
+
+static uint8_t socketHash(int socketId, ESP3DClientType client_type) {
+  return ((uint32_t)socketId * 31 + static_cast<uint8_t>(client_type)) &
+         (ESP3D_SESSIONS_BUCKETS - 1);
+}
+
+int8_t ESP3DAuthenticationService::_findId(const char *sessionId) {
+  for (int8_t i = _id_buckets[sessionIdHash(sessionId)]; i != -1;
+       i = _id_next[i]) {
+    if (strcmp(_records[i].session_id, sessionId) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int8_t ESP3DAuthenticationService::_findSocket(int socketId,
+                                               ESP3DClientType client_type) {
+  if (socketId == -1) {
+    // any socket of this client type
+    for (int8_t i = 0; i < ESP3D_MAX_SESSIONS; i++) {
+      if (_used[i] && _records[i].client_type == client_type) {
+        return i;
+      }
+    }
+    return -1;
+  }
+  for (int8_t i = _socket_buckets[socketHash(socketId, client_type)]; i != -1;
+       i = _socket_next[i]) {
+    if (_records[i].socket_id == socketId &&
+        _records[i].client_type == client_type) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void ESP3DAuthenticationService::_heapSwap(uint8_t a, uint8_t b) {
+  int8_t tmp = _heap[a];
+  _heap[a] = _heap[b];
+  _heap[b] = tmp;
+  _heap_pos[_heap[a]] = a;
+  _heap_pos[_heap[b]] = b;
+}
+
+void ESP3DAuthenticationService::_heapSiftUp(uint8_t pos) {
+  while (pos > 0) {
+    uint8_t parent = (pos - 1) / 2;
+    if (_heap_time[_heap[parent]] <= _heap_time[_heap[pos]]) {
+      break;
+    }
+    _heapSwap(pos, parent);
+    pos = parent;
+  }
+}
+
+void ESP3DAuthenticationService::_heapSiftDown(uint8_t pos) {
+  while (true) {
+    uint8_t smallest = pos;
+    uint8_t left = 2 * pos + 1;
+    uint8_t right = left + 1;
+    if (left < _heap_size &&
+        _heap_time[_heap[left]] < _heap_time[_heap[smallest]]) {
+      smallest = left;
+    }
+    if (right < _heap_size &&
+        _heap_time[_heap[right]] < _heap_time[_heap[smallest]]) {
+      smallest = right;
+    }
+    if (smallest == pos) {
+      break;
+    }
+    _heapSwap(pos, smallest);
+    pos = smallest;
+  }
+}
+
+void ESP3DAuthenticationService::_heapPush(int8_t index) {
+  _heap_time[index] = _records[index].last_time;
+  _heap[_heap_size] = index;
+  _heap_pos[index] = _heap_size;
+  _heap_size++;
+  _heapSiftUp(_heap_size - 1);
+}
+
+void ESP3DAuthenticationService::_heapRemove(int8_t index) {
+  int8_t pos = _heap_pos[index];
+  if (pos < 0) {
+    return;
+  }
+  _heap_size--;
+  if (pos != _heap_size) {
+    _heapSwap(pos, _heap_size);
+    _heapSiftDown(pos);
+    _heapSiftUp(pos);
+  }
+  _heap_pos[index] = -1;
+}
+
+void ESP3DAuthenticationService::_removeRecord(int8_t index) {
+  esp3d_log("Clear session %s", _records[index].session_id);
+  int8_t *link = &_id_buckets[sessionIdHash(_records[index].session_id)];
+  while (*link != -1 && *link != index) {
+    link = &_id_next[*link];
+  }
+  if (*link == index) {
+    *link = _id_next[index];
+  }
+  link = &_socket_buckets[socketHash(_records[index].socket_id,
+                                     _records[index].client_type)];
+  while (*link != -1 && *link != index) {
+    link = &_socket_next[*link];
+  }
+  if (*link == index) {
+    *link = _socket_next[index];
+  }
+  _heapRemove(index);
+  _used[index] = false;
+  _count--;
+}
+
 bool ESP3DAuthenticationService::createRecord(const char *sessionId,
                                               int socketId,
                                               ESP3DAuthenticationLevel level,
                                               ESP3DClientType client_type) {
-  if (strlen(sessionId) == 0) {
+  if (strlen(sessionId) == 0 ||
+      strlen(sessionId) >= sizeof(_records[0].session_id)) {
     return false;
   }
-  ESP3DAuthenticationRecord rec;
+  pthread_mutex_lock(&_mutex);
+  if (_count == ESP3D_MAX_SESSIONS) {
+    if (_heap_size == 0) {
+      pthread_mutex_unlock(&_mutex);
+      esp3d_log_e("Too many sessions");
+      return false;
+    }
+    // drop the least recently used webui session
+    esp3d_log_w("Sessions table full, drop oldest webui session");
+    _removeRecord(_heap[0]);
+  }
+  int8_t index = 0;
+  while (_used[index]) {
+    index++;
+  }
+  ESP3DAuthenticationRecord &rec = _records[index];
   memset(&rec, 0, sizeof(rec));
   rec.level = level;
   rec.client_type = client_type;
   rec.socket_id = socketId;
   strcpy(rec.session_id, sessionId);
   rec.last_time = esp3d_hal::millis();
-  _sessions.push_back(rec);
+  _used[index] = true;
+  _count++;
+  uint8_t bucket = sessionIdHash(sessionId);
+  _id_next[index] = _id_buckets[bucket];
+  _id_buckets[bucket] = index;
+  bucket = socketHash(socketId, client_type);
+  _socket_next[index] = _socket_buckets[bucket];
+  _socket_buckets[bucket] = index;
+  // only webui sessions are not bound to a socket life
+  if (client_type == ESP3DClientType::webui) {
+    _heapPush(index);
+  }
+  pthread_mutex_unlock(&_mutex);
   return true;
 }
 
 bool ESP3DAuthenticationService::clearSession(const char *sessionId) {
   if (sessionId && strlen(sessionId) == 24) {
-    esp3d_log("Clear session %s, size:%d  among %d sessions", sessionId,
-              strlen(sessionId), _sessions.size());
-    for (auto session = _sessions.begin(); session != _sessions.end();
-         ++session) {
-      esp3d_log("checking session %s vs %s, type: %d, socketId: %d", sessionId,
-                session->session_id, static_cast<uint8_t>(session->client_type),
-                session->socket_id);
-      if (strcmp(session->session_id, sessionId) == 0) {
-        esp3d_log("Clear session %s succeed", sessionId);
-        _sessions.erase(session++);
-        return true;
-      }
+    esp3d_log("Clear session %s among %d sessions", sessionId, _count);
+    pthread_mutex_lock(&_mutex);
+    int8_t index = _findId(sessionId);
+    if (index != -1) {
+      _removeRecord(index);
+    }
+    pthread_mutex_unlock(&_mutex);
+    if (index != -1) {
+      esp3d_log("Clear session %s succeed", sessionId);
+      return true;
     }
   } else {
     esp3d_log_w("Empty sessionId");
@@ -149,75 +331,129 @@ bool ESP3DAuthenticationService::clearSession(const char *sessionId) {
 
 void ESP3DAuthenticationService::clearSessions(ESP3DClientType client_type) {
   esp3d_log("Clear all sessions %d", static_cast<uint8_t>(client_type));
-  for (auto session = _sessions.begin(); session != _sessions.end();
-       ++session) {
-    if (session->client_type == client_type) {
-      esp3d_log("Clear session %s succeed", session->session_id);
-      _sessions.erase(session++);
+  pthread_mutex_lock(&_mutex);
+  for (int8_t i = 0; i < ESP3D_MAX_SESSIONS; i++) {
+    if (_used[i] && _records[i].client_type == client_type) {
+      _removeRecord(i);
     }
   }
+  pthread_mutex_unlock(&_mutex);
 }
 
-void ESP3DAuthenticationService::clearAllSessions() { _sessions.clear(); }
-ESP3DAuthenticationRecord *ESP3DAuthenticationService::getRecord(
-    const char *sessionId) {
-  for (auto session = _sessions.begin(); session != _sessions.end();
-       ++session) {
-    if (strcmp(session->session_id, sessionId) == 0) {
-      return &(*session);
-    }
+void ESP3DAuthenticationService::clearAllSessions() {
+  pthread_mutex_lock(&_mutex);
+  _clearTable();
+  pthread_mutex_unlock(&_mutex);
+}
+
+void ESP3DAuthenticationService::_clearTable() {
+  for (int8_t i = 0; i < ESP3D_MAX_SESSIONS; i++) {
+    _used[i] = false;
+    _heap_pos[i] = -1;
+  }
+  for (uint8_t b = 0; b < ESP3D_SESSIONS_BUCKETS; b++) {
+    _id_buckets[b] = -1;
+    _socket_buckets[b] = -1;
   }
-  return NULL;
+  _count = 0;
+  _heap_size = 0;
 }
 
-ESP3DAuthenticationRecord *ESP3DAuthenticationService::getRecord(
-    int socketId, ESP3DClientType client_type) {
-  for (auto session = _sessions.begin(); session != _sessions.end();
-       ++session) {
-    if ((socketId == -1 || session->socket_id == socketId) &&
-        session->client_type == client_type) {
-      esp3d_log("Found session %s", session->session_id);
-      return &(*session);
-    }
+bool ESP3DAuthenticationService::getRecord(const char *sessionId,
+                                           ESP3DAuthenticationRecord *record) {
+  if (!sessionId) {
+    return false;
+  }
+  pthread_mutex_lock(&_mutex);
+  int8_t index = _findId(sessionId);
+  if (index != -1) {
+    *record = _records[index];
   }
-  esp3d_log("Socket session not found");
-  return NULL;
+  pthread_mutex_unlock(&_mutex);
+  return index != -1;
+}
+
+bool ESP3DAuthenticationService::getRecord(int socketId,
+                                           ESP3DClientType client_type,
+                                           ESP3DAuthenticationRecord *record) {
+  pthread_mutex_lock(&_mutex);
+  int8_t index = _findSocket(socketId, client_type);
+  if (index != -1) {
+    *record = _records[index];
+  }
+  pthread_mutex_unlock(&_mutex);
+  if (index == -1) {
+    esp3d_log("Socket session not found");
+    return false;
+  }
+  esp3d_log("Found session %s", record->session_id);
+  return true;
+}
+
+// heap time is not changed, handle() checks last_time again on expiry
+bool ESP3DAuthenticationService::touch(const char *sessionId) {
+  if (!sessionId) {
+    return false;
+  }
+  pthread_mutex_lock(&_mutex);
+  int8_t index = _findId(sessionId);
+  if (index != -1) {
+    _records[index].last_time = esp3d_hal::millis();
+  }
+  pthread_mutex_unlock(&_mutex);
+  return index != -1;
+}
+
+bool ESP3DAuthenticationService::setLevel(const char *sessionId,
+                                          ESP3DAuthenticationLevel level) {
+  if (!sessionId) {
+    return false;
+  }
+  pthread_mutex_lock(&_mutex);
+  int8_t index = _findId(sessionId);
+  if (index != -1) {
+    _records[index].level = level;
+    _records[index].last_time = esp3d_hal::millis();
+  }
+  pthread_mutex_unlock(&_mutex);
+  return index != -1;
 }
 
 bool ESP3DAuthenticationService::updateRecord(
     int socketId, ESP3DClientType client_type,
     ESP3DAuthenticationLevel newlevel) {
-  for (auto session = _sessions.begin(); session != _sessions.end();
-       ++session) {
-    if (session->client_type == client_type && session->socket_id == socketId) {
-      session->level = newlevel;
-      return true;
-    }
+  pthread_mutex_lock(&_mutex);
+  int8_t index = socketId == -1 ? -1 : _findSocket(socketId, client_type);
+  if (index != -1) {
+    _records[index].level = newlevel;
   }
-  return false;
+  pthread_mutex_unlock(&_mutex);
+  return index != -1;
 }
 
 uint8_t ESP3DAuthenticationService::activeSessionsCount(ESP3DClientType type) {
   uint8_t count = 0;
-  for (auto session = _sessions.begin(); session != _sessions.end();
-       ++session) {
-    if (session->client_type == type) {
-      esp3d_log("Session found: %s, socket: %d, lvl: %d ", session->session_id,
-                session->socket_id, static_cast<uint8_t>(session->level));
+  pthread_mutex_lock(&_mutex);
+  for (int8_t i = 0; i < ESP3D_MAX_SESSIONS; i++) {
+    if (_used[i] && _records[i].client_type == type) {
+      esp3d_log("Session found: %s, socket: %d, lvl: %d ",
+                _records[i].session_id, _records[i].socket_id,
+                static_cast<uint8_t>(_records[i].level));
       ++count;
     }
   }
+  pthread_mutex_unlock(&_mutex);
   return count;
 }
 
 void ESP3DAuthenticationService::updateRecords() {
-  for (auto session = _sessions.begin(); session != _sessions.end();
-       ++session) {
-    esp3d_log("session %s, type %d", session->session_id,
-              static_cast<uint8_t>(session->client_type));
-    // todo if type == webui check timestamp and last update
-    // if session timout=0 =>TBD
-    // other : TBD
+  pthread_mutex_lock(&_mutex);
+  for (int8_t i = 0; i < ESP3D_MAX_SESSIONS; i++) {
+    if (_used[i]) {
+      esp3d_log("session %s, type %d", _records[i].session_id,
+                static_cast<uint8_t>(_records[i].client_type));
+    }
   }
+  pthread_mutex_unlock(&_mutex);
 }
 #endif  // #if ESP3D_AUTHENTICATION_FEATURE
\ No newline at end of file
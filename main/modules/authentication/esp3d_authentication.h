@@ -19,6 +19,7 @@
 */
 
 #pragma once
+#include <pthread.h>
 #include <stdio.h>
 
 #include <list>
@@ -33,6 +34,13 @@
 extern "C" {
 #endif
 
+#if ESP3D_AUTHENTICATION_FEATURE
+// Max number of sessions, oldest webui session is dropped when table is full
+#define ESP3D_MAX_SESSIONS 32
+// Hash buckets for session id and socket lookups, must be a power of 2
+#define ESP3D_SESSIONS_BUCKETS 32
+#endif  // ESP3D_AUTHENTICATION_FEATURE
+
 class ESP3DAuthenticationService final {
  public:
   ESP3DAuthenticationService();
@@ -66,9 +74,14 @@ class ESP3DAuthenticationService final {
   bool updateRecord(int socketId, ESP3DClientType client_type,
                     ESP3DAuthenticationLevel newlevel);
   void clearAllSessions();
-  ESP3DAuthenticationRecord *getRecord(const char *sessionId);
-  ESP3DAuthenticationRecord *getRecord(int socketId,
-                                       ESP3DClientType client_type);
+  // records can be removed by other tasks at any time, so callers only get
+  // a copy and change a record by its session id
+  bool getRecord(const char *sessionId, ESP3DAuthenticationRecord *record);
+  bool getRecord(int socketId, ESP3DClientType client_type,
+                 ESP3DAuthenticationRecord *record);
+  // session is used now, false if it does not exist anymore
+  bool touch(const char *sessionId);
+  bool setLevel(const char *sessionId, ESP3DAuthenticationLevel level);
   const char *create_session_id(struct sockaddr_storage source_addr,
                                 int socketId);
   uint8_t activeSessionsCount(ESP3DClientType type);
@@ -78,7 +91,31 @@ class ESP3DAuthenticationService final {
   std::string _admin_pwd;
   std::string _user_pwd;
   uint8_t _session_timeout;
-  std::list<ESP3DAuthenticationRecord> _sessions;
+  // fixed table of records, only accessed with mutex locked
+  ESP3DAuthenticationRecord _records[ESP3D_MAX_SESSIONS];
+  bool _used[ESP3D_MAX_SESSIONS];
+  uint8_t _count;
+  // hash chains of records indexes, -1 is end of chain
+  int8_t _id_buckets[ESP3D_SESSIONS_BUCKETS];
+  int8_t _id_next[ESP3D_MAX_SESSIONS];
+  int8_t _socket_buckets[ESP3D_SESSIONS_BUCKETS];
+  int8_t _socket_next[ESP3D_MAX_SESSIONS];
+  // min-heap of webui records ordered by last_time known when pushed,
+  // last_time can be updated by callers so it is checked again on expiry
+  int8_t _heap[ESP3D_MAX_SESSIONS];
+  int8_t _heap_pos[ESP3D_MAX_SESSIONS];
+  int64_t _heap_time[ESP3D_MAX_SESSIONS];
+  uint8_t _heap_size;
+  pthread_mutex_t _mutex;
+  void _clearTable();
+  int8_t _findId(const char *sessionId);
+  int8_t _findSocket(int socketId, ESP3DClientType client_type);
+  void _removeRecord(int8_t index);
+  void _heapPush(int8_t index);
+  void _heapRemove(int8_t index);
+  void _heapSiftUp(uint8_t pos);
+  void _heapSiftDown(uint8_t pos);
+  void _heapSwap(uint8_t a, uint8_t b);
 #endif  // #if ESP3D_AUTHENTICATION_FEATURE
 };
 
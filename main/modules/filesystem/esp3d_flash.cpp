@@ -31,7 +31,10 @@ ESP3DFlash flashFs;
 ESP3DFlash::ESP3DFlash() {
   _mounted = false;
   _started = false;
+  _change_id = 0;
   _state = ESP3DFsState::unknown;
+  _written_mutex = PTHREAD_MUTEX_INITIALIZER;
+  memset(_written_files, 0, sizeof(_written_files));
 }
 
 ESP3DFileSystemType ESP3DFlash::getFSType(const char* path) {
@@ -68,6 +71,42 @@ void ESP3DFlash::releaseFS(ESP3DFileSystemType FS) {
 #endif  // ESP3D_PATCH_FS_ACCESS_RELEASE
 }
 
+// flash can be accessed by several tasks at once
+void ESP3DFlash::_trackWrittenFile(FILE *fd) {
+  if (pthread_mutex_lock(&_written_mutex) != 0) {
+    return;
+  }
+  bool tracked = false;
+  for (uint8_t i = 0; i < ESP3D_FLASH_MAX_WRITTEN_FILES; i++) {
+    if (_written_files[i] == nullptr) {
+      _written_files[i] = fd;
+      tracked = true;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&_written_mutex);
+  if (!tracked) {
+    esp3d_log_w("Too many files open for writing, close not tracked");
+  }
+}
+
+// false if file was not open for writing
+bool ESP3DFlash::_untrackWrittenFile(FILE *fd) {
+  if (pthread_mutex_lock(&_written_mutex) != 0) {
+    return false;
+  }
+  bool tracked = false;
+  for (uint8_t i = 0; i < ESP3D_FLASH_MAX_WRITTEN_FILES; i++) {
+    if (_written_files[i] == fd) {
+      _written_files[i] = nullptr;
+      tracked = true;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&_written_mutex);
+  return tracked;
+}
+
 ESP3DFsState ESP3DFlash::getState() {
   if (!_mounted) setState(ESP3DFsState::unknown);
   return _state;
@@ -20,12 +20,16 @@
 
 #pragma once
 #include <dirent.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <sys/stat.h>
 
 #include "esp3d_fs_types.h"
 #include "esp_vfs.h"
 
+// Files open for writing, so closing them changes the change id
+#define ESP3D_FLASH_MAX_WRITTEN_FILES 4
+
 enum class ESP3DFsState : uint8_t {
   idle,
   busy,
@@ -62,11 +66,18 @@ class ESP3DFlash final {
   void close(FILE *fd);
   ESP3DFsState getState();
   ESP3DFsState setState(ESP3DFsState state);
+  // changes each time content may have changed
+  uint32_t getChangeId() { return _change_id; }
 
  private:
   bool _mounted;
   bool _started;
+  uint32_t _change_id;
   ESP3DFsState _state;
+  FILE *_written_files[ESP3D_FLASH_MAX_WRITTEN_FILES];
+  pthread_mutex_t _written_mutex;
+  void _trackWrittenFile(FILE *fd);
+  bool _untrackWrittenFile(FILE *fd);
 };
 
 extern ESP3DFlash flashFs;
\ No newline at end of file
@@ -61,6 +61,23 @@ ESP3DGlobalFileSystem::ESP3DGlobalFileSystem() {
   _rootDir.dd_vfs_idx = (uint16_t)-1;
   _rootDir.dd_rsv = GLOBAL_ROOT_DIR_ID;
   rewinddir(&_rootDir);
+  _dir_cache_use_count = 0;
+  _dir_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+}
+
+// Path with leading '/' and without trailing '/', used as cache key
+static std::string normalized_path(const char *path) {
+  std::string result;
+  if (!path || path[0] != '/') {
+    result = "/";
+  }
+  if (path) {
+    result += path;
+  }
+  while (result.length() > 1 && result[result.length() - 1] == '/') {
+    result.erase(result.length() - 1);
+  }
+  return result;
 }
 
 const char *ESP3DGlobalFileSystem::mount_point(ESP3DFileSystemType fstype) {
@@ -291,9 +308,15 @@ int ESP3DGlobalFileSystem::stat(const char *filepath, struct stat *entry_stat) {
 #if ESP3D_SD_CARD_FEATURE
     case ESP3DFileSystemType::sd:
       esp3d_log("Is SD %s", filepath);
+      if (_statFromCache(filepath, entry_stat)) {
+        return 0;
+      }
       return sd.stat(&filepath[strlen(ESP3D_SD_FS_HEADER) - 1], entry_stat);
 #endif  // ESP3D_SD_CARD_FEATURE
     case ESP3DFileSystemType::flash:
+      if (_statFromCache(filepath, entry_stat)) {
+        return 0;
+      }
       return flashFs.stat(&filepath[strlen(ESP3D_FLASH_FS_HEADER) - 1],
                           entry_stat);
     default:
@@ -481,3 +504,136 @@ void ESP3DGlobalFileSystem::close(FILE *fd, const char *filename) {
       break;
   }
 }
+
+bool ESP3DGlobalFileSystem::_getChangeId(ESP3DFileSystemType fstype,
+                                         uint32_t *changeId) {
+  switch (fstype) {
+#if ESP3D_SD_CARD_FEATURE
+    case ESP3DFileSystemType::sd:
+      *changeId = sd.getChangeId();
+      return true;
+#endif  // ESP3D_SD_CARD_FEATURE
+    case ESP3DFileSystemType::flash:
+      *changeId = flashFs.getChangeId();
+      return true;
+    default:
+      break;
+  }
+  // root is virtual, no need to cache it
+  return false;
+}
+
+bool ESP3DGlobalFileSystem::_statFromCache(const char *filepath,
+                                           struct stat *entry_stat) {
+  std::string path = normalized_path(filepath);
+  size_t pos = path.find_last_of('/');
+  if (pos == std::string::npos || pos == path.length() - 1) {
+    return false;
+  }
+  std::string parent = pos == 0 ? "/" : path.substr(0, pos);
+  const char *name = &path.c_str()[pos + 1];
+  uint32_t changeId;
+  if (!_getChangeId(getFSType(parent.c_str()), &changeId)) {
+    return false;
+  }
+  bool found = false;
+  if (pthread_mutex_lock(&_dir_cache_mutex) == 0) {
+    for (uint8_t i = 0; i < ESP3D_DIR_CACHE_SIZE && !found; i++) {
+      ESP3DDirCacheSlot &slot = _dir_cache[i];
+      if (slot.lastUse == 0 || slot.changeId != changeId ||
+          slot.path != parent) {
+        continue;
+      }
+      for (const ESP3DDirEntry &entry : slot.entries) {
+        if (entry.name == name) {
+          memset(entry_stat, 0, sizeof(struct stat));
+          entry_stat->st_mode = entry.isDir ? S_IFDIR : S_IFREG;
+          entry_stat->st_size = entry.size;
+          entry_stat->st_mtime = entry.mtime;
+          entry_stat->st_atime = entry.mtime;
+          entry_stat->st_ctime = entry.ctime;
+          found = true;
+          break;
+        }
+      }
+    }
+    pthread_mutex_unlock(&_dir_cache_mutex);
+  }
+  return found;
+}
+
+bool ESP3DGlobalFileSystem::listDir(const char *dirpath,
+                                    std::vector<ESP3DDirEntry> &entries) {
+  entries.clear();
+  std::string path = normalized_path(dirpath);
+  ESP3DFileSystemType fstype = getFSType(path.c_str());
+  uint32_t changeId = 0;
+  bool cacheable = _getChangeId(fstype, &changeId);
+  if (cacheable && pthread_mutex_lock(&_dir_cache_mutex) == 0) {
+    for (uint8_t i = 0; i < ESP3D_DIR_CACHE_SIZE; i++) {
+      ESP3DDirCacheSlot &slot = _dir_cache[i];
+      if (slot.lastUse != 0 && slot.changeId == changeId &&
+          slot.path == path) {
+        slot.lastUse = ++_dir_cache_use_count;
+        entries = slot.entries;
+        pthread_mutex_unlock(&_dir_cache_mutex);
+        esp3d_log("List %s from cache", path.c_str());
+        return true;
+      }
+    }
+    pthread_mutex_unlock(&_dir_cache_mutex);
+  }
+  DIR *dir = opendir(path.c_str());
+  if (!dir) {
+    esp3d_log_e("Cannot open %s", path.c_str());
+    return false;
+  }
+  struct dirent *entry;
+  struct stat entry_stat;
+  std::string entryPath;
+  // one pass to get all information of all entries
+  while ((entry = readdir(dir)) != NULL) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+      continue;
+    }
+    ESP3DDirEntry dirEntry;
+    dirEntry.name = entry->d_name;
+    dirEntry.isDir = entry->d_type == DT_DIR;
+    entryPath = path;
+    if (path != "/") {
+      entryPath += "/";
+    }
+    entryPath += entry->d_name;
+    if (stat(entryPath.c_str(), &entry_stat) == -1) {
+      esp3d_log_e("Failed to stat %s", entryPath.c_str());
+      continue;
+    }
+    dirEntry.size = dirEntry.isDir ? 0 : entry_stat.st_size;
+    dirEntry.mtime = entry_stat.st_mtime;
+    dirEntry.ctime = entry_stat.st_ctime;
+    entries.push_back(dirEntry);
+  }
+  closedir(dir);
+  if (!cacheable || entries.size() > ESP3D_DIR_CACHE_MAX_ENTRIES) {
+    return true;
+  }
+  // replace the least recently used slot
+  uint32_t currentChangeId = 0;
+  _getChangeId(fstype, &currentChangeId);
+  if (currentChangeId == changeId &&
+      pthread_mutex_lock(&_dir_cache_mutex) == 0) {
+    uint8_t index = 0;
+    for (uint8_t i = 1; i < ESP3D_DIR_CACHE_SIZE; i++) {
+      if (_dir_cache[i].lastUse < _dir_cache[index].lastUse) {
+        index = i;
+      }
+    }
+    ESP3DDirCacheSlot &slot = _dir_cache[index];
+    slot.path = path;
+    slot.changeId = changeId;
+    slot.lastUse = ++_dir_cache_use_count;
+    slot.entries = entries;
+    pthread_mutex_unlock(&_dir_cache_mutex);
+  }
+  return true;
+}
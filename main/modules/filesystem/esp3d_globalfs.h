@@ -20,12 +20,29 @@
 
 #pragma once
 #include <dirent.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <sys/stat.h>
 
+#include <string>
+#include <vector>
+
 #include "esp3d_fs_types.h"
 #include "esp_vfs.h"
 
+// Number of directories kept in cache
+#define ESP3D_DIR_CACHE_SIZE 4
+// Directories with more entries are not cached
+#define ESP3D_DIR_CACHE_MAX_ENTRIES 128
+
+struct ESP3DDirEntry {
+  std::string name;
+  bool isDir;
+  size_t size;
+  time_t mtime;
+  time_t ctime;
+};
+
 class ESP3DGlobalFileSystem final {
  public:
   ESP3DGlobalFileSystem();
@@ -51,9 +68,25 @@ class ESP3DGlobalFileSystem final {
   struct dirent *readdir(DIR *dirp);
   void rewinddir(DIR *dirp);
   FILE *open(const char *filename, const char *mode);
+  // files must be closed here, not with fclose(): closing a file open for
+  // writing updates change id and used space of its file system
   void close(FILE *fd, const char *filename);
+  // List directory entries with size and dates, served from cache when the
+  // file system did not change since last listing, FS must be accessed
+  bool listDir(const char *dirpath, std::vector<ESP3DDirEntry> &entries);
 
  private:
+  struct ESP3DDirCacheSlot {
+    std::string path;
+    uint32_t changeId;
+    uint32_t lastUse;
+    std::vector<ESP3DDirEntry> entries;
+  };
+  ESP3DDirCacheSlot _dir_cache[ESP3D_DIR_CACHE_SIZE];
+  uint32_t _dir_cache_use_count;
+  pthread_mutex_t _dir_cache_mutex;
+  bool _getChangeId(ESP3DFileSystemType fstype, uint32_t *changeId);
+  bool _statFromCache(const char *filepath, struct stat *entry_stat);
   struct dirent
       _rootEntry;  // there no multiple access to root so 1 should be enough
   DIR _rootDir;    // there no multiple access to root so 1 should be enough
@@ -21,16 +21,56 @@
 #include "esp3d_sd.h"
 
 #include <stdio.h>
+#include <string.h>
 
+#include "driver/gpio.h"
+#include "esp3d_hal.h"
 #include "esp3d_log.h"
 #include "esp3d_string.h"
+#include "ff.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "sd_def.h"
+#include "sdmmc_cmd.h"
+
+#if ESP3D_TFT_BENCHMARK
+#include "esp_timer.h"
+#endif  // ESP3D_TFT_BENCHMARK
+
+#if defined(ESP3D_SD_DETECT_PIN) && ESP3D_SD_DETECT_PIN >= 0
+#define ESP3D_SD_HAS_DETECT_PIN 1
+#ifndef ESP3D_SD_DETECT_VALUE
+#define ESP3D_SD_DETECT_VALUE 0
+#endif  // ESP3D_SD_DETECT_VALUE
+#endif  // ESP3D_SD_DETECT_PIN
+
+// Without card detect pin, delay between two mount attempts when no card
+#define ESP3D_SD_MOUNT_RETRY_DELAY 1000
+
+// Background full check of free space, lowest priority
+#define ESP3D_SD_SPACE_TASK_SIZE 3072
+#define ESP3D_SD_SPACE_TASK_PRIORITY 0
+#define ESP3D_SD_SPACE_TASK_CORE tskNO_AFFINITY
+
+// card handle of the mounted card, defined by SPI / SDIO implementation
+extern sdmmc_card_t* card;
 
 ESP3DSd sd;
 
 ESP3DSd::ESP3DSd() {
   _mounted = false;
   _started = false;
+  _remount_needed = false;
+  _mount_id = 0;
+  _change_id = 0;
+  _last_mount_try = 0;
+  _total_bytes = 0;
+  _used_bytes = 0;
+  _cluster_size = 0;
+  _stats_mount_id = 0;
+  _stats_task_running = false;
+  _stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+  memset(_written_files, 0, sizeof(_written_files));
   _spi_speed_divider = 0;
   _state = ESP3DSdState::unknown;
 }
@@ -42,8 +82,17 @@ ESP3DFileSystemType ESP3DSd::getFSType(const char* path) {
 
 bool ESP3DSd::accessFS(ESP3DFileSystemType FS) {
   (void)FS;
+#if ESP3D_TFT_BENCHMARK
+  int64_t start = esp_timer_get_time();
+  uint32_t mount_id = _mount_id;
+#endif  // ESP3D_TFT_BENCHMARK
   // if card is busy do not let another task access SD and so prevent a release
-  if (getState() != ESP3DSdState::idle) {
+  ESP3DSdState state = getState();
+#if ESP3D_TFT_BENCHMARK
+  esp3d_report("SD access check: %lld us%s", esp_timer_get_time() - start,
+               mount_id != _mount_id ? " (mounted)" : "");
+#endif  // ESP3D_TFT_BENCHMARK
+  if (state != ESP3DSdState::idle) {
     esp3d_log("SDCard not idle");
     return false;
   }
@@ -58,12 +107,273 @@ void ESP3DSd::releaseFS(ESP3DFileSystemType FS) {
   setState(ESP3DSdState::idle);
 }
 
+void ESP3DSd::_initCardDetect() {
+#if ESP3D_SD_HAS_DETECT_PIN
+  gpio_config_t cd_config = {
+      .pin_bit_mask = (1ULL << ESP3D_SD_DETECT_PIN),
+      .mode = GPIO_MODE_INPUT,
+      .pull_up_en = GPIO_PULLUP_ENABLE,
+      .pull_down_en = GPIO_PULLDOWN_DISABLE,
+      .intr_type = GPIO_INTR_DISABLE,
+  };
+  if (gpio_config(&cd_config) != ESP_OK) {
+    esp3d_log_e("Failed to configure card detect pin");
+  }
+#endif  // ESP3D_SD_HAS_DETECT_PIN
+}
+
+// Card detect pin if any, otherwise assume a card may be there
+bool ESP3DSd::_isCardInserted() {
+#if ESP3D_SD_HAS_DETECT_PIN
+  return gpio_get_level((gpio_num_t)ESP3D_SD_DETECT_PIN) ==
+         ESP3D_SD_DETECT_VALUE;
+#else
+  return true;
+#endif  // ESP3D_SD_HAS_DETECT_PIN
+}
+
+// Mounted card still answers: a removed or swapped card fails the status
+// request, which is much cheaper than a full mount
+bool ESP3DSd::_isCardPresent() {
+  if (!_isCardInserted()) {
+    return false;
+  }
+  return card != nullptr && sdmmc_get_status(card) == ESP_OK;
+}
+
 ESP3DSdState ESP3DSd::getState() {
   if (_state == ESP3DSdState::busy) {
     return _state;
   }
-  mount();
+  // Keep card mounted as long as it is present, only mount again on change
+  if (_mounted && !_remount_needed) {
+    if (_isCardPresent()) {
+      _state = ESP3DSdState::idle;
+    } else if (!_lockUnmount()) {
+      // unmount once space check is done
+      _state = ESP3DSdState::not_present;
+    } else {
+      esp3d_log_w("SDCard removed");
+      unmount();
+      pthread_mutex_unlock(&_stats_mutex);
+    }
+    return _state;
+  }
+  if (!_isCardInserted()) {
+    if (_mounted && _lockUnmount()) {
+      unmount();
+      pthread_mutex_unlock(&_stats_mutex);
+    }
+    // if space check is running, unmount is done on next call
+    _state = ESP3DSdState::not_present;
+    return _state;
+  }
+#if !ESP3D_SD_HAS_DETECT_PIN
+  // no way to know if card is inserted, so do not try too often
+  if (!_mounted && !_remount_needed && _last_mount_try != 0 &&
+      (esp3d_hal::millis() - _last_mount_try) < ESP3D_SD_MOUNT_RETRY_DELAY) {
+    return _state;
+  }
+#endif  // !ESP3D_SD_HAS_DETECT_PIN
+  // mount unmounts current card first, so wait for space check too
+  if (!_lockUnmount()) {
+    _state = ESP3DSdState::not_present;
+    return _state;
+  }
+  _last_mount_try = esp3d_hal::millis();
+  _remount_needed = false;
+  if (mount()) {
+    _mount_id++;
+    _change_id++;
+    memset(_written_files, 0, sizeof(_written_files));
+  }
+  pthread_mutex_unlock(&_stats_mutex);
   return _state;
 };
 
+// Space task scans FATFS without lock, so it must not be unmounted meanwhile:
+// true if no scan is running, then stats mutex is kept locked so no scan can
+// start until caller unlocks it once unmount or mount is done
+bool ESP3DSd::_lockUnmount() {
+  if (pthread_mutex_lock(&_stats_mutex) != 0) {
+    return false;
+  }
+  if (_stats_task_running) {
+    pthread_mutex_unlock(&_stats_mutex);
+    return false;
+  }
+  return true;
+}
+
+// Full scan of the FAT, can take seconds on big cards
+bool ESP3DSd::_readSpaceInfo() {
+  FATFS *fs;
+  DWORD fre_clust;
+  uint32_t mount_id = _mount_id;
+#if ESP3D_TFT_BENCHMARK
+  int64_t start = esp_timer_get_time();
+#endif  // ESP3D_TFT_BENCHMARK
+  // we only have one SD card with one partition so should be ok to use "0:"
+  if (f_getfree("0:", &fre_clust, &fs) != FR_OK) {
+    esp3d_log_e("Failed to get total and free space");
+    return false;
+  }
+#if ESP3D_TFT_BENCHMARK
+  esp3d_report("SD free space scan: %lld us", esp_timer_get_time() - start);
+#endif  // ESP3D_TFT_BENCHMARK
+  uint64_t cluster_size = (uint64_t)fs->csize * fs->ssize;
+  uint64_t total_bytes = (uint64_t)(fs->n_fatent - 2) * cluster_size;
+  uint64_t free_bytes = (uint64_t)fre_clust * cluster_size;
+  if (pthread_mutex_lock(&_stats_mutex) == 0) {
+    // card may have changed during scan
+    if (mount_id == _mount_id) {
+      _cluster_size = cluster_size;
+      _total_bytes = total_bytes;
+      _used_bytes = total_bytes - free_bytes;
+      _stats_mount_id = mount_id;
+    }
+    pthread_mutex_unlock(&_stats_mutex);
+  }
+  return true;
+}
+
+void ESP3DSd::_spaceInfoTask(void *arg) {
+  ESP3DSd *sdcard = (ESP3DSd *)arg;
+  if (sdcard->_mounted) {
+    sdcard->_readSpaceInfo();
+  }
+  sdcard->_stats_task_running = false;
+  vTaskDelete(NULL);
+}
+
+bool ESP3DSd::getSpaceInfo(uint64_t *totalBytes, uint64_t *usedBytes,
+                           uint64_t *freeBytes, bool refreshStats) {
+  uint64_t total_bytes = 0;
+  uint64_t used_bytes = 0;
+  esp3d_log("Try to get total and free space");
+  if (_mounted) {
+    bool start_task = false;
+    // first request after mount must wait for the scan to know total size
+    if (_stats_mount_id != _mount_id) {
+      _readSpaceInfo();
+    } else if (refreshStats && pthread_mutex_lock(&_stats_mutex) == 0) {
+      if (!_stats_task_running && _mounted) {
+        _stats_task_running = true;
+        start_task = true;
+      }
+      pthread_mutex_unlock(&_stats_mutex);
+    }
+    if (start_task) {
+      TaskHandle_t xHandle = NULL;
+      BaseType_t res = xTaskCreatePinnedToCore(
+          _spaceInfoTask, "sdSpaceTask", ESP3D_SD_SPACE_TASK_SIZE, this,
+          ESP3D_SD_SPACE_TASK_PRIORITY, &xHandle, ESP3D_SD_SPACE_TASK_CORE);
+      if (res != pdPASS || !xHandle) {
+        esp3d_log_e("Space task creation failed");
+        _stats_task_running = false;
+      }
+    }
+    if (pthread_mutex_lock(&_stats_mutex) == 0) {
+      if (_stats_mount_id == _mount_id) {
+        total_bytes = _total_bytes;
+        used_bytes = _used_bytes;
+      }
+      pthread_mutex_unlock(&_stats_mutex);
+    }
+  } else {
+    esp3d_log_e("Failed to get total and free space because not mounted");
+  }
+  // answer sizes according request
+  if (totalBytes) {
+    *totalBytes = total_bytes;
+  }
+  if (usedBytes) {
+    *usedBytes = used_bytes;
+  }
+  if (freeBytes) {
+    *freeBytes = total_bytes - used_bytes;
+  }
+  // if total is 0 it is a failure
+  return total_bytes != 0;
+}
+
+// Space used on card by a file of this size
+uint64_t ESP3DSd::_allocatedSize(size_t size) {
+  if (_cluster_size == 0) {
+    return size;
+  }
+  return ((size + _cluster_size - 1) / _cluster_size) * _cluster_size;
+}
+
+void ESP3DSd::_updateUsedSpace(int64_t delta) {
+  if (delta == 0 || pthread_mutex_lock(&_stats_mutex) != 0) {
+    return;
+  }
+  if (_stats_mount_id == _mount_id) {
+    if (delta < 0 && (uint64_t)(-delta) > _used_bytes) {
+      _used_bytes = 0;
+    } else {
+      _used_bytes += delta;
+    }
+    if (_used_bytes > _total_bytes) {
+      _used_bytes = _total_bytes;
+    }
+  }
+  pthread_mutex_unlock(&_stats_mutex);
+}
+
+void ESP3DSd::_trackWrittenFile(FILE *fd, const char *mode,
+                                size_t previous_size) {
+  size_t size = previous_size;
+  // file is truncated
+  if (strchr(mode, 'w')) {
+    _updateUsedSpace(-(int64_t)_allocatedSize(previous_size));
+    size = 0;
+  }
+  if (pthread_mutex_lock(&_stats_mutex) != 0) {
+    return;
+  }
+  bool tracked = false;
+  for (uint8_t i = 0; i < ESP3D_SD_MAX_WRITTEN_FILES; i++) {
+    if (_written_files[i].fd == nullptr) {
+      _written_files[i].fd = fd;
+      _written_files[i].size = size;
+      tracked = true;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&_stats_mutex);
+  if (!tracked) {
+    esp3d_log_w("Too many files open for writing, space not tracked");
+  }
+}
+
+// false if file was not open for writing
+bool ESP3DSd::_untrackWrittenFile(FILE *fd) {
+  if (pthread_mutex_lock(&_stats_mutex) != 0) {
+    return false;
+  }
+  bool tracked = false;
+  size_t previous_size = 0;
+  for (uint8_t i = 0; i < ESP3D_SD_MAX_WRITTEN_FILES; i++) {
+    if (_written_files[i].fd == fd) {
+      previous_size = _written_files[i].size;
+      _written_files[i].fd = nullptr;
+      tracked = true;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&_stats_mutex);
+  if (!tracked) {
+    return false;
+  }
+  struct stat entry_stat;
+  fflush(fd);
+  if (fstat(fileno(fd), &entry_stat) == 0) {
+    _updateUsedSpace((int64_t)_allocatedSize(entry_stat.st_size) -
+                     (int64_t)_allocatedSize(previous_size));
+  }
+  return true;
+}
+
 #endif  // ESP3D_SD_CARD_FEATURE
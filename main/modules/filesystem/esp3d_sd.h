@@ -20,12 +20,17 @@
 
 #pragma once
 #include <dirent.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <sys/stat.h>
 
 #include "esp3d_fs_types.h"
 #include "esp_vfs.h"
 
+// Files open for writing whose size is tracked for space accounting and
+// change id, as many as files SDIO mount can open
+#define ESP3D_SD_MAX_WRITTEN_FILES 5
+
 enum class ESP3DSdState : uint8_t {
   idle,
   not_present,
@@ -43,9 +48,17 @@ class ESP3DSd final {
   uint8_t getSPISpeedDivider() { return _spi_speed_divider; }
   void setSPISpeedDivider(uint8_t speeddivider) {
     _spi_speed_divider = speeddivider;
+    // new speed is applied at next access
+    _remount_needed = true;
   }
+  // changes each time a card is mounted, so cached FS data can be invalidated
+  uint32_t getMountId() { return _mount_id; }
+  // changes each time content may have changed, including card change
+  uint32_t getChangeId() { return _change_id; }
   const char *getFileSystemName();
   uint maxPathLength();
+  // Space is updated on each change, refreshStats schedules a full check
+  // in background so it never blocks the caller
   bool getSpaceInfo(uint64_t *totalBytes = NULL, uint64_t *usedBytes = NULL,
                     uint64_t *freeBytes = NULL, bool refreshStats = false);
 
@@ -74,8 +87,33 @@ class ESP3DSd final {
  private:
   bool _mounted;
   bool _started;
+  bool _remount_needed;
+  uint32_t _mount_id;
+  uint32_t _change_id;
+  int64_t _last_mount_try;
   ESP3DSdState _state;
   uint8_t _spi_speed_divider;
+  uint64_t _total_bytes;
+  uint64_t _used_bytes;
+  uint32_t _cluster_size;
+  uint32_t _stats_mount_id;
+  volatile bool _stats_task_running;
+  pthread_mutex_t _stats_mutex;
+  struct ESP3DWrittenFile {
+    FILE *fd;
+    size_t size;
+  };
+  ESP3DWrittenFile _written_files[ESP3D_SD_MAX_WRITTEN_FILES];
+  bool _readSpaceInfo();
+  bool _lockUnmount();
+  static void _spaceInfoTask(void *arg);
+  uint64_t _allocatedSize(size_t size);
+  void _updateUsedSpace(int64_t delta);
+  void _trackWrittenFile(FILE *fd, const char *mode, size_t previous_size);
+  bool _untrackWrittenFile(FILE *fd);
+  void _initCardDetect();
+  bool _isCardInserted();
+  bool _isCardPresent();
 };
 
 extern ESP3DSd sd;
\ No newline at end of file
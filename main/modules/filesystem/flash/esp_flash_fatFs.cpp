@@ -87,6 +87,7 @@ bool ESP3DFlash::format() {
   if (_mounted) {
     unmount();
   }
+  _change_id++;
   bool isFormated = false;
   esp_err_t err =
       esp_vfs_fat_spiflash_format_rw_wl(PARTITION_LABEL, mount_point());
@@ -197,6 +198,7 @@ bool ESP3DFlash::remove(const char *path) {
     }
     file_path += path;
   }
+  _change_id++;
   return !unlink(file_path.c_str());
 }
 
@@ -208,6 +210,7 @@ bool ESP3DFlash::mkdir(const char *path) {
     }
     dir_path += path;
   }
+  _change_id++;
   return !::mkdir(dir_path.c_str(), 0777);
 }
 
@@ -219,6 +222,7 @@ bool ESP3DFlash::rmdir(const char *path) {
     }
     dir_path += path;
   }
+  _change_id++;
   return !::rmdir(dir_path.c_str());
 }
 bool ESP3DFlash::rename(const char *oldpath, const char *newpath) {
@@ -240,6 +244,7 @@ bool ESP3DFlash::rename(const char *oldpath, const char *newpath) {
   if (::stat(new_path.c_str(), &st) == 0) {
     ::unlink(new_path.c_str());
   }
+  _change_id++;
   return !::rename(old_path.c_str(), new_path.c_str());
 }
 
@@ -251,7 +256,15 @@ FILE *ESP3DFlash::open(const char *filename, const char *mode) {
     }
     file_path += filename;
   }
-  return fopen(file_path.c_str(), mode);
+  if (!strpbrk(mode, "wa+")) {
+    return fopen(file_path.c_str(), mode);
+  }
+  _change_id++;
+  FILE *fd = fopen(file_path.c_str(), mode);
+  if (fd) {
+    _trackWrittenFile(fd);
+  }
+  return fd;
 }
 
 struct dirent *ESP3DFlash::readdir(DIR *dir) { return ::readdir(dir); }
@@ -259,7 +272,12 @@ struct dirent *ESP3DFlash::readdir(DIR *dir) { return ::readdir(dir); }
 void ESP3DFlash::rewinddir(DIR *dir) { ::rewinddir(dir); }
 
 void ESP3DFlash::close(FILE *fd) {
+  bool written = _untrackWrittenFile(fd);
   fclose(fd);
+  // size or date may have changed
+  if (written) {
+    _change_id++;
+  }
   fd = nullptr;
 }
 
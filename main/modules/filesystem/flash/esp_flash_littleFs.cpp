@@ -90,6 +90,7 @@ bool ESP3DFlash::format() {
   if (_mounted) {
     unmount();
   }
+  _change_id++;
   bool isFormated = false;
   if (ESP_OK == esp_littlefs_format(PARTITION_LABEL)) {
     isFormated = true;
@@ -193,6 +194,7 @@ bool ESP3DFlash::remove(const char *path) {
     }
     file_path += path;
   }
+  _change_id++;
   return !unlink(file_path.c_str());
 }
 
@@ -204,6 +206,7 @@ bool ESP3DFlash::mkdir(const char *path) {
     }
     dir_path += path;
   }
+  _change_id++;
   return !::mkdir(dir_path.c_str(), 0777);
 }
 
@@ -215,6 +218,7 @@ bool ESP3DFlash::rmdir(const char *path) {
     }
     dir_path += path;
   }
+  _change_id++;
   return !::rmdir(dir_path.c_str());
 }
 bool ESP3DFlash::rename(const char *oldpath, const char *newpath) {
@@ -236,6 +240,7 @@ bool ESP3DFlash::rename(const char *oldpath, const char *newpath) {
   if (::stat(new_path.c_str(), &st) == 0) {
     ::unlink(new_path.c_str());
   }
+  _change_id++;
   return !::rename(old_path.c_str(), new_path.c_str());
 }
 
@@ -247,7 +252,15 @@ FILE *ESP3DFlash::open(const char *filename, const char *mode) {
     }
     file_path += filename;
   }
-  return fopen(file_path.c_str(), mode);
+  if (!strpbrk(mode, "wa+")) {
+    return fopen(file_path.c_str(), mode);
+  }
+  _change_id++;
+  FILE *fd = fopen(file_path.c_str(), mode);
+  if (fd) {
+    _trackWrittenFile(fd);
+  }
+  return fd;
 }
 
 struct dirent *ESP3DFlash::readdir(DIR *dir) { return ::readdir(dir); }
@@ -255,7 +268,12 @@ struct dirent *ESP3DFlash::readdir(DIR *dir) { return ::readdir(dir); }
 void ESP3DFlash::rewinddir(DIR *dir) { ::rewinddir(dir); }
 
 void ESP3DFlash::close(FILE *fd) {
+  bool written = _untrackWrittenFile(fd);
   fclose(fd);
+  // size or date may have changed
+  if (written) {
+    _change_id++;
+  }
   fd = nullptr;
 }
 
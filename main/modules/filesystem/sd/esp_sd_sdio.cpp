@@ -104,56 +104,13 @@ bool ESP3DSd::mount() {
 const char *ESP3DSd::getFileSystemName() { return "SDFat native"; }
 
 bool ESP3DSd::begin() {
+  _initCardDetect();
   _started = true;
   return true;
 }
 
 uint ESP3DSd::maxPathLength() { return CONFIG_FATFS_MAX_LFN; }
 
-bool ESP3DSd::getSpaceInfo(uint64_t *totalBytes, uint64_t *usedBytes,
-                           uint64_t *freeBytes, bool refreshStats) {
-  static uint64_t _totalBytes = 0;
-  static uint64_t _usedBytes = 0;
-  static uint64_t _freeBytes = 0;
-  esp3d_log("Try to get total and free space");
-  // if not mounted reset values
-  if (!_mounted) {
-    esp3d_log_e("Failed to get total and free space because not mounted");
-    _totalBytes = 0;
-    _usedBytes = 0;
-    _freeBytes = 0;
-  }
-  // no need to try if not  mounted
-  if ((_totalBytes == 0 || refreshStats) && _mounted) {
-    FATFS *fs;
-    DWORD fre_clust;
-    // we only have one SD card with one partiti0n so should be ok to use "0:"
-    if (f_getfree("0:", &fre_clust, &fs) == FR_OK) {
-      _totalBytes = (fs->n_fatent - 2) * fs->csize;
-      _freeBytes = fre_clust * fs->csize;
-      _totalBytes = _totalBytes * (fs->ssize);
-      _freeBytes = _freeBytes * (fs->ssize);
-      _usedBytes = _totalBytes - _freeBytes;
-    } else {
-      esp3d_log_e("Failed to get total and free space");
-      _totalBytes = 0;
-      _usedBytes = 0;
-      _freeBytes = 0;
-    }
-  }
-  // answer sizes according request
-  if (totalBytes) {
-    *totalBytes = _totalBytes;
-  }
-  if (usedBytes) {
-    *usedBytes = _usedBytes;
-  }
-  if (freeBytes) {
-    *freeBytes = _freeBytes;
-  }
-  // if total is 0 it is a failure
-  return _totalBytes != 0;
-}
 DIR *ESP3DSd::opendir(const char *dirpath) {
   std::string dir_path = mount_point();
   if (strlen(dirpath) != 0) {
@@ -198,7 +155,16 @@ bool ESP3DSd::remove(const char *path) {
     }
     file_path += path;
   }
-  return !::unlink(file_path.c_str());
+  _change_id++;
+  struct stat entry_stat;
+  bool has_size = ::stat(file_path.c_str(), &entry_stat) == 0;
+  if (::unlink(file_path.c_str()) != 0) {
+    return false;
+  }
+  if (has_size) {
+    _updateUsedSpace(-(int64_t)_allocatedSize(entry_stat.st_size));
+  }
+  return true;
 }
 
 bool ESP3DSd::mkdir(const char *path) {
@@ -209,7 +175,13 @@ bool ESP3DSd::mkdir(const char *path) {
     }
     dir_path += path;
   }
-  return !::mkdir(dir_path.c_str(), 0777);
+  _change_id++;
+  if (::mkdir(dir_path.c_str(), 0777) != 0) {
+    return false;
+  }
+  // a directory uses at least one cluster
+  _updateUsedSpace(_allocatedSize(1));
+  return true;
 }
 
 bool ESP3DSd::rmdir(const char *path) {
@@ -220,7 +192,12 @@ bool ESP3DSd::rmdir(const char *path) {
     }
     dir_path += path;
   }
-  return !::rmdir(dir_path.c_str());
+  _change_id++;
+  if (::rmdir(dir_path.c_str()) != 0) {
+    return false;
+  }
+  _updateUsedSpace(-(int64_t)_allocatedSize(1));
+  return true;
 }
 bool ESP3DSd::rename(const char *oldpath, const char *newpath) {
   std::string old_path = mount_point();
@@ -238,9 +215,11 @@ bool ESP3DSd::rename(const char *oldpath, const char *newpath) {
     new_path += newpath;
   }
   struct stat st;
-  if (::stat(new_path.c_str(), &st) == 0) {
-    ::unlink(new_path.c_str());
+  if (::stat(new_path.c_str(), &st) == 0 &&
+      ::unlink(new_path.c_str()) == 0) {
+    _updateUsedSpace(-(int64_t)_allocatedSize(st.st_size));
   }
+  _change_id++;
   return !::rename(old_path.c_str(), new_path.c_str());
 }
 
@@ -252,13 +231,33 @@ FILE *ESP3DSd::open(const char *filename, const char *mode) {
     }
     file_path += filename;
   }
-  return fopen(file_path.c_str(), mode);
+  if (!strpbrk(mode, "wa+")) {
+    return fopen(file_path.c_str(), mode);
+  }
+  _change_id++;
+  struct stat entry_stat;
+  size_t previous_size = 0;
+  if (::stat(file_path.c_str(), &entry_stat) == 0) {
+    previous_size = entry_stat.st_size;
+  }
+  FILE *fd = fopen(file_path.c_str(), mode);
+  if (fd) {
+    _trackWrittenFile(fd, mode, previous_size);
+  }
+  return fd;
 }
 
 struct dirent *ESP3DSd::readdir(DIR *dir) { return ::readdir(dir); }
 
 void ESP3DSd::rewinddir(DIR *dir) { ::rewinddir(dir); }
 
-void ESP3DSd::close(FILE *fd) { fclose(fd); }
+void ESP3DSd::close(FILE *fd) {
+  bool written = _untrackWrittenFile(fd);
+  fclose(fd);
+  // size or date may have changed
+  if (written) {
+    _change_id++;
+  }
+}
 
 #endif  // ESP3D_SD_IS_SDIO
\ No newline at end of file
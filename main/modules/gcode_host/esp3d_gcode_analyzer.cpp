@@ -0,0 +1,304 @@
+/*
+  esp3d_gcode_analyzer
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "esp3d_gcode_analyzer.h"
+
+#include <math.h>
+#include <string.h>
+
+// Z difference to be a new layer, in mm
+#define LAYER_Z_MIN_DELTA 0.001f
+
+// Parse [-+]digits[.digits], no exponent in G-code, p is moved after number
+static bool parse_number(const char *&p, const char *end, float *value) {
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    p++;
+  }
+  bool found = false;
+  float result = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    result = result * 10 + (*p - '0');
+    found = true;
+    p++;
+  }
+  if (p < end && *p == '.') {
+    p++;
+    float scale = 0.1f;
+    while (p < end && *p >= '0' && *p <= '9') {
+      result += (*p - '0') * scale;
+      scale *= 0.1f;
+      found = true;
+      p++;
+    }
+  }
+  *value = negative ? -result : result;
+  return found;
+}
+
+ESP3DGcodeAnalyzer::ESP3DGcodeAnalyzer() { reset(); }
+
+void ESP3DGcodeAnalyzer::reset() {
+  _lines = 0;
+  _layer = 0;
+  _layer_z = 0;
+  _comment_layers = false;
+  _relative = false;
+  _relative_e = false;
+  _retracted = false;
+  _x = 0;
+  _y = 0;
+  _z = 0;
+  _e = 0;
+  _feedrate = 0;
+  _extruded = 0;
+  _move_time = 0;
+  _m73_remaining = -1;
+  _slicer_time = 0;
+  _slicer_elapsed = 0;
+  _events = 0;
+}
+
+uint8_t ESP3DGcodeAnalyzer::analyze(const char *line, size_t length) {
+  _events = 0;
+  if (length < 2) {
+    return 0;
+  }
+  _lines++;
+  if (line[0] == ';') {
+    _comment(line, length);
+    return _events;
+  }
+  const char *end = (const char *)memchr(line, ';', length);
+  if (!end) {
+    end = line + length;
+  }
+  char letter = line[0] & ~0x20;  // upper case
+  if (letter != 'G' && letter != 'M') {
+    return 0;
+  }
+  const char *p = line + 1;
+  float value;
+  if (!parse_number(p, end, &value)) {
+    return 0;
+  }
+  int code = (int)value;
+  if (letter == 'G') {
+    switch (code) {
+      case 0:
+      case 1:
+        _move(p, end);
+        break;
+      case 10:  // firmware retraction
+        _retracted = true;
+        break;
+      case 11:
+        _retracted = false;
+        break;
+      case 28:  // position is only approximative after homing
+        _x = 0;
+        _y = 0;
+        _z = 0;
+        break;
+      case 90:
+        _relative = false;
+        _relative_e = false;
+        break;
+      case 91:
+        _relative = true;
+        _relative_e = true;
+        break;
+      case 92:
+        _setPosition(p, end);
+        break;
+      default:
+        break;
+    }
+    return _events;
+  }
+  switch (code) {
+    case 73:
+      // M73 P<percent> R<remaining minutes>
+      while (p < end) {
+        char param = *p++ & ~0x20;
+        if (param == 'R' && parse_number(p, end, &value)) {
+          _m73_remaining = (int32_t)(value * 60);
+          _events |= ESP3D_GCODE_ANALYZER_PROGRESS;
+        } else if (param == 'P') {
+          _events |= ESP3D_GCODE_ANALYZER_PROGRESS;
+        }
+      }
+      break;
+    case 82:
+      _relative_e = false;
+      break;
+    case 83:
+      _relative_e = true;
+      break;
+    default:
+      break;
+  }
+  return _events;
+}
+
+void ESP3DGcodeAnalyzer::_move(const char *p, const char *end) {
+  float x = _x;
+  float y = _y;
+  float z = _z;
+  float e = 0;
+  bool has_xy = false;
+  bool has_e = false;
+  float value;
+  while (p < end) {
+    char param = *p++ & ~0x20;
+    if (param < 'E' || param > 'Z' || !parse_number(p, end, &value)) {
+      continue;
+    }
+    switch (param) {
+      case 'X':
+        x = _relative ? x + value : value;
+        has_xy = true;
+        break;
+      case 'Y':
+        y = _relative ? y + value : value;
+        has_xy = true;
+        break;
+      case 'Z':
+        z = _relative ? z + value : value;
+        break;
+      case 'E':
+        e = _relative_e ? value : value - _e;
+        has_e = true;
+        break;
+      case 'F':
+        if (value > 0) {
+          _feedrate = value;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  float dx = x - _x;
+  float dy = y - _y;
+  float dz = z - _z;
+  float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+  if (distance == 0) {
+    distance = fabsf(e);
+  }
+  // feedrate is in mm/min
+  if (_feedrate > 0) {
+    _move_time += distance * 60 / _feedrate;
+  }
+  _x = x;
+  _y = y;
+  _z = z;
+  _e += e;
+  if (e > 0) {
+    _extruded += e;
+    _retracted = false;
+    if (has_xy && !_comment_layers && _z > _layer_z + LAYER_Z_MIN_DELTA) {
+      // z hop goes back down before extruding, so it is not a layer
+      _layer++;
+      _layer_z = _z;
+      _events |= ESP3D_GCODE_ANALYZER_LAYER;
+    }
+  } else if (e < 0) {
+    _retracted = true;
+  } else if (has_xy && !has_e && _retracted) {
+    _events |= ESP3D_GCODE_ANALYZER_TRAVEL;
+  }
+}
+
+void ESP3DGcodeAnalyzer::_setPosition(const char *p, const char *end) {
+  float value;
+  while (p < end) {
+    char param = *p++ & ~0x20;
+    if (param < 'E' || param > 'Z' || !parse_number(p, end, &value)) {
+      continue;
+    }
+    switch (param) {
+      case 'X':
+        _x = value;
+        break;
+      case 'Y':
+        _y = value;
+        break;
+      case 'Z':
+        _z = value;
+        break;
+      case 'E':
+        _e = value;
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+// Cura: ;LAYER:<n from 0>, ;TIME:<s>, ;TIME_ELAPSED:<s>
+// PrusaSlicer / OrcaSlicer: ;LAYER_CHANGE
+void ESP3DGcodeAnalyzer::_comment(const char *line, size_t length) {
+  const char *end = line + length;
+  const char *p;
+  float value;
+  if (length > 7 && strncmp(line, ";LAYER", 6) == 0) {
+    if (line[6] == ':') {
+      p = line + 7;
+      if (parse_number(p, end, &value)) {
+        _layer = (uint32_t)value + 1;
+        _comment_layers = true;
+        _events |= ESP3D_GCODE_ANALYZER_LAYER;
+      }
+    } else if (strncmp(line + 6, "_CHANGE", 7) == 0) {
+      _layer++;
+      _comment_layers = true;
+      _events |= ESP3D_GCODE_ANALYZER_LAYER;
+    }
+  } else if (length > 6 && strncmp(line, ";TIME", 5) == 0) {
+    if (line[5] == ':') {
+      p = line + 6;
+      if (parse_number(p, end, &value)) {
+        _slicer_time = value;
+      }
+    } else if (length > 14 && strncmp(line + 5, "_ELAPSED:", 9) == 0) {
+      p = line + 14;
+      if (parse_number(p, end, &value)) {
+        _slicer_elapsed = value;
+      }
+    }
+  }
+}
+
+int32_t ESP3DGcodeAnalyzer::getRemainingTime(uint64_t processed,
+                                             uint64_t total) {
+  if (_m73_remaining >= 0) {
+    return _m73_remaining;
+  }
+  if (_slicer_time > 0) {
+    float elapsed = _slicer_elapsed > 0 ? _slicer_elapsed : _move_time;
+    return elapsed < _slicer_time ? (int32_t)(_slicer_time - elapsed) : 0;
+  }
+  if (processed > 0 && processed <= total && _move_time > 0) {
+    return (int32_t)(_move_time * (total - processed) / processed);
+  }
+  return -1;
+}
@@ -0,0 +1,85 @@
+/*
+  esp3d_gcode_analyzer
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// events of analyzed line
+// line is first one of a new layer
+#define ESP3D_GCODE_ANALYZER_LAYER 0x01
+// line is a travel move with retracted filament, safe to pause before it
+#define ESP3D_GCODE_ANALYZER_TRAVEL 0x02
+// line is M73 progress from slicer
+#define ESP3D_GCODE_ANALYZER_PROGRESS 0x04
+
+// Follow G-code lines before they are sent: layers, positions, extrusion
+// and estimated time of moves from feedrates (no acceleration).
+// Only G0-G1, G10-G11, G28, G90-G92, M73, M82-M83 and layer / time comments
+// of Cura and PrusaSlicer are parsed, other lines cost a few compares.
+class ESP3DGcodeAnalyzer final {
+ public:
+  ESP3DGcodeAnalyzer();
+  void reset();
+  // line is trimmed, comments may be already stripped (tokenized file), then
+  // layers come from Z of first extrusion above previous layer
+  uint8_t analyze(const char *line, size_t length);
+  uint32_t getLayer() { return _layer; }
+  float getZ() { return _z; }
+  // filament pushed in mm
+  float getExtruded() { return _extruded; }
+  // estimated time of analyzed moves in s
+  float getMoveTime() { return _move_time; }
+  uint32_t getLinesCount() { return _lines; }
+  // remaining time in s from M73 or slicer estimate, else from moves
+  // estimated time of processed part, -1 if unknown
+  int32_t getRemainingTime(uint64_t processed, uint64_t total);
+
+ private:
+  void _move(const char *p, const char *end);
+  void _setPosition(const char *p, const char *end);
+  void _comment(const char *line, size_t length);
+  uint32_t _lines;
+  uint32_t _layer;
+  float _layer_z;
+  bool _comment_layers;
+  bool _relative;
+  bool _relative_e;
+  bool _retracted;
+  float _x;
+  float _y;
+  float _z;
+  float _e;
+  float _feedrate;
+  float _extruded;
+  float _move_time;
+  int32_t _m73_remaining;
+  float _slicer_time;
+  float _slicer_elapsed;
+  uint8_t _events;
+};
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
@@ -27,8 +27,10 @@
 #endif  // #if ESP3D_USB_SERIAL_FEATURE
 
 #include "esp3d_commands.h"
+#include "esp3d_events.h"
 #include "esp3d_hal.h"
 #include "esp3d_log.h"
+#include "esp3d_scheduling.h"
 #include "esp3d_settings.h"
 #include "esp3d_values.h"
 #include "filesystem/esp3d_flash.h"
@@ -39,15 +41,21 @@
 
 #if ESP3D_SD_CARD_FEATURE
 #include "filesystem/esp3d_sd.h"
+#include "sd_def.h"
 #endif  // ESP3D_SD_CARD_FEATURE
 
 #include "esp32/rom/crc.h"
 #include "esp3d_gcode_parser_service.h"
+#include "esp3d_gcode_tokenizer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "tasks_def.h"
 #include "translations/esp3d_translation_service.h"
 
+#if ESP3D_TFT_BENCHMARK
+#include "esp_timer.h"
+#endif  // ESP3D_TFT_BENCHMARK
+
 // Macro/command behaviour:
 // to be executed regardless of streaming state (ie paused)
 // to be executed in same order as received
@@ -60,6 +68,12 @@ ESP3DGCodeHostService gcodeHostService;
 #define ESP3D_COMMAND_TIMEOUT 10000  // milliseconds timeout
 #define ESP3D_MAX_RETRY 5
 #define ESP3D_REFRESH_INTERVAL 1000  // milliseconds
+// Rx queue and notifications wake up the task, timeout is for ack timeout
+#define ESP3D_IDLE_TIMEOUT 100  // milliseconds
+// Loops done without waiting before a tick is given to lower priority tasks
+// (ui, idle task and its watchdog), streams without ack or long runs of
+// comments never wait otherwise
+#define ESP3D_MAX_BUSY_LOOPS 32
 
 #define isFileStreamType(type)                      \
   ((type == ESP3DGcodeHostStreamType::fs_stream) || \
@@ -82,10 +96,18 @@ static void esp3d_gcode_host_task(void* pvParameter) {
   (void)pvParameter;
   gcodeHostService.updateScripts();
   esp3d_hal::wait(100);
+  uint8_t busy_loops = 0;
   while (1) {
-    /* Delay */
-    gcodeHostService.handle(); 
-    esp3d_hal::wait(10);
+    gcodeHostService.handle();
+    /* Wait for event only if stream cannot progress on its own */
+    if (!gcodeHostService.hasPendingWork()) {
+      busy_loops = 0;
+      esp3dEvents.wait(ESP3DEventConsumer::gcode_host, ESP3D_IDLE_TIMEOUT);
+    } else if (++busy_loops >= ESP3D_MAX_BUSY_LOOPS) {
+      busy_loops = 0;
+      // taskYIELD() only lets tasks of same priority run
+      vTaskDelay(1);
+    }
   }
   vTaskDelete(NULL);
 }
@@ -147,7 +169,7 @@ bool ESP3DGCodeHostService::addStream(
   // because it is msg we should consider it as a command so we can execute it
   // first
   // so let's trim it to remove any space or \n
-  std::string cmd = esp3d_string::str_trim(command);
+  std::string cmd(esp3d_string::trimmed(command));
   if (cmd.length() == 0) {
     esp3d_log_e("Empty command");
     return false;
@@ -155,15 +177,138 @@ bool ESP3DGCodeHostService::addStream(
   return _add_stream(cmd.c_str(), authentication_level, true);
 }
 
+// Create a new multiple commands stream from a buffer of commands separated by
+// '\n', like a batch posted by http client
+// On success the buffer is owned by the stream and freed when stream ends
+bool ESP3DGCodeHostService::addCommandsStream(
+    char* commands, size_t length,
+    ESP3DAuthenticationLevel authentication_level, uint64_t* stream_id) {
+  if (commands == nullptr || length == 0) {
+    esp3d_log_e("Empty commands");
+    return false;
+  }
+  if (_scripts.size() >= ESP3D_MAX_STREAM_SIZE) {
+    esp3d_log_e("Stream list is full");
+    std::string text = esp3dTranslationService.translate(ESP3DLabel::error);
+    text += ": S";
+    text += std::to_string((uint8_t)ESP3DGcodeHostError::list_full);
+    esp3dTftValues.set_string_value(ESP3DValuesIndex::status_bar_label,
+                                    text.c_str());
+    return false;
+  }
+  ESP3DGcodeStream* new_stream =
+      (ESP3DGcodeStream*)malloc(sizeof(ESP3DGcodeStream));
+  if (new_stream == nullptr) {
+    esp3d_log_e("Failed to allocate memory for new stream");
+    return false;
+  }
+  new_stream->type = ESP3DGcodeHostStreamType::multiple_commands;
+  new_stream->id = _getNewStreamId();
+  new_stream->auth_type = authentication_level;
+  new_stream->cursorPos = 0;
+  new_stream->processedSize = 0;
+  new_stream->totalSize = length;
+  new_stream->active = false;
+  new_stream->tokenized = false;
+  new_stream->startLine = 0;
+  new_stream->state = ESP3DGcodeStreamState::start;
+  new_stream->dataStream = commands;
+  if (stream_id) {
+    *stream_id = new_stream->id;
+  }
+  esp3d_log("New commands stream %lld of %d bytes", new_stream->id, length);
+  if (!_pushBackGCodeStream(new_stream, false)) {
+    esp3d_log_e("Failed to add stream");
+    free(new_stream);
+    return false;
+  }
+  return true;
+}
+
+// Stream id is creation time in millis, but must stay unique to be polled
+uint64_t ESP3DGCodeHostService::_getNewStreamId() {
+  uint64_t id = esp3d_hal::millis();
+  if (pthread_mutex_lock(&_scripts_list_mutex) == 0) {
+    if (id <= _last_stream_id) {
+      id = _last_stream_id + 1;
+    }
+    _last_stream_id = id;
+    pthread_mutex_unlock(&_scripts_list_mutex);
+  } else {
+    esp3d_log_e("Failed to lock script list mutex");
+  }
+  return id;
+}
+
+void ESP3DGCodeHostService::_addEndedStreamStatus(
+    const ESP3DGcodeStreamStatus& status) {
+  if (pthread_mutex_lock(&_scripts_list_mutex) == 0) {
+    _ended_streams[_ended_streams_index] = status;
+    _ended_streams_index =
+        (_ended_streams_index + 1) % ESP3D_STREAM_HISTORY_SIZE;
+    pthread_mutex_unlock(&_scripts_list_mutex);
+  } else {
+    esp3d_log_e("Failed to lock script list mutex");
+  }
+}
+
+// Look for stream in queues first, then in ended streams
+// return false if stream id is unknown or too old
+bool ESP3DGCodeHostService::getStreamStatus(uint64_t id,
+                                            ESP3DGcodeStreamStatus* status) {
+  bool res = false;
+  if (status == nullptr || id == 0) {
+    return false;
+  }
+  if (pthread_mutex_lock(&_scripts_list_mutex) == 0) {
+    for (auto it = _scripts.begin(); it != _scripts.end() && !res; ++it) {
+      if ((*it)->id == id) {
+        status->id = id;
+        status->state = (*it)->state;
+        status->processedSize = (*it)->processedSize;
+        status->totalSize = (*it)->totalSize;
+        status->error = ESP3DGcodeHostError::no_error;
+        res = true;
+      }
+    }
+    for (uint8_t i = 0; i < ESP3D_STREAM_HISTORY_SIZE && !res; i++) {
+      if (_ended_streams[i].id == id) {
+        *status = _ended_streams[i];
+        res = true;
+      }
+    }
+    pthread_mutex_unlock(&_scripts_list_mutex);
+  } else {
+    esp3d_log_e("Failed to lock script list mutex");
+  }
+  if (!res) {
+    if (pthread_mutex_lock(&_streams_list_mutex) == 0) {
+      for (auto it = _streams.begin(); it != _streams.end() && !res; ++it) {
+        if ((*it)->id == id) {
+          status->id = id;
+          status->state = (*it)->state;
+          status->processedSize = (*it)->processedSize;
+          status->totalSize = (*it)->totalSize;
+          status->error = ESP3DGcodeHostError::no_error;
+          res = true;
+        }
+      }
+      pthread_mutex_unlock(&_streams_list_mutex);
+    } else {
+      esp3d_log_e("Failed to lock stream list mutex");
+    }
+  }
+  return res;
+}
+
 bool ESP3DGCodeHostService::hasStreamListCommand(const char* command) {
-  std::string cmd = esp3d_string::str_trim(command);
+  std::string_view cmd = esp3d_string::trimmed(command);
   bool res = false;
   if (_streams_list_mutex) {
     if (pthread_mutex_lock(&_streams_list_mutex) == 0) {
       for (auto it = _scripts.begin(); it != _scripts.end(); ++it) {
         if (((*it)->type == ESP3DGcodeHostStreamType::single_command)) {
-          std::string cmd_it = esp3d_string::str_trim((*it)->dataStream);
-          if (cmd_it == cmd) {
+          if (esp3d_string::trimmed((*it)->dataStream) == cmd) {
             res = true;
             break;
           }
@@ -182,7 +327,7 @@ bool ESP3DGCodeHostService::hasStreamListCommand(const char* command) {
 // Add stream from ESP700 command
 bool ESP3DGCodeHostService::addStream(const char* filename,
                                       ESP3DAuthenticationLevel auth_type,
-                                      bool executeAsMacro) {
+                                      bool executeAsMacro, uint32_t startLine) {
   esp3d_log("Add stream: %s", filename);
   ESP3DGcodeHostStreamType type = _getStreamType(filename);
   //  ESP700 only accepts file names, not commands
@@ -192,12 +337,13 @@ bool ESP3DGCodeHostService::addStream(const char* filename,
                 ESP3DGcodeHostStreamTypeStr[static_cast<uint8_t>(type)]);
     return false;
   }
-  return _add_stream(filename, auth_type, executeAsMacro);
+  return _add_stream(filename, auth_type, executeAsMacro, startLine);
 }
 
 bool ESP3DGCodeHostService::_add_stream(const char* data,
                                         ESP3DAuthenticationLevel auth_type,
-                                        bool executeFirst) {
+                                        bool executeFirst, uint32_t startLine,
+                                        uint64_t* stream_id) {
   esp3d_log("Processing stream request: %s, with authentication level=%d", data,
             static_cast<uint8_t>(auth_type));
   // Macro should be executed first like any other command
@@ -238,12 +384,14 @@ bool ESP3DGCodeHostService::_add_stream(const char* data,
   esp3d_log("New stream type: %d", static_cast<uint8_t>(type));
 
   new_stream->type = type;
-  new_stream->id = esp3d_hal::millis();
+  new_stream->id = _getNewStreamId();
   new_stream->auth_type = auth_type;
   new_stream->cursorPos = 0;
   new_stream->processedSize = 0;
   new_stream->totalSize = 0;
   new_stream->active = false;
+  new_stream->tokenized = false;
+  new_stream->startLine = startLine;
   new_stream->state = ESP3DGcodeStreamState::start;
   new_stream->dataStream = (char*)malloc(strlen(data) + 1);
   if (new_stream->dataStream == nullptr) {
@@ -253,6 +401,9 @@ bool ESP3DGCodeHostService::_add_stream(const char* data,
   }
   strcpy(new_stream->dataStream, data);
   esp3d_log("New stream data: %s", new_stream->dataStream);
+  if (stream_id) {
+    *stream_id = new_stream->id;
+  }
   // Sanity check for multiple commands
   if (type == ESP3DGcodeHostStreamType::multiple_commands) {
     for (int i = 0; i < strlen(new_stream->dataStream); i++) {
@@ -326,11 +477,15 @@ bool ESP3DGCodeHostService::_pushBackGCodeStream(ESP3DGcodeStream* stream,
       esp3d_log_e("Script list mutex not initialized");
     }
   }
+  if (res) {
+    esp3dEvents.notify(ESP3DEventConsumer::gcode_host);
+  }
   return res;
 }
 
 bool ESP3DGCodeHostService::_popFrontGCodeStream(bool is_stream) {
   bool res = false;
+  ESP3DGcodeStreamStatus ended_status;
   if (is_stream) {
     esp3d_log("Pop stream file");
     if (_streams_list_mutex) {
@@ -338,6 +493,9 @@ bool ESP3DGCodeHostService::_popFrontGCodeStream(bool is_stream) {
         if (_streams.size() != 0) {
           ESP3DGcodeStream* stream = _streams.front();
           _streams.pop_front();
+          ended_status.id = stream->id;
+          ended_status.processedSize = stream->processedSize;
+          ended_status.totalSize = stream->totalSize;
           free(stream->dataStream);
           free(stream);
           res = true;
@@ -358,6 +516,9 @@ bool ESP3DGCodeHostService::_popFrontGCodeStream(bool is_stream) {
         if (_scripts.size() != 0) {
           ESP3DGcodeStream* stream = _scripts.front();
           _scripts.pop_front();
+          ended_status.id = stream->id;
+          ended_status.processedSize = stream->processedSize;
+          ended_status.totalSize = stream->totalSize;
           free(stream->dataStream);
           free(stream);
           res = true;
@@ -372,24 +533,32 @@ bool ESP3DGCodeHostService::_popFrontGCodeStream(bool is_stream) {
       esp3d_log_e("Script list mutex not initialized");
     }
   }
+  if (res) {
+    ended_status.state = ESP3DGcodeStreamState::end;
+    ended_status.error = _error;
+    _addEndedStreamStatus(ended_status);
+  }
   return res;
 }
 
 bool ESP3DGCodeHostService::abort() {
   xTaskNotifyGive(_xHandle);
   xTaskNotifyGiveIndexed(_xHandle, _xAbortNotifyIndex);
+  esp3dEvents.notify(ESP3DEventConsumer::gcode_host);
   return true;
 }
 
 bool ESP3DGCodeHostService::pause() {
   xTaskNotifyGive(_xHandle);
   xTaskNotifyGiveIndexed(_xHandle, _xPauseNotifyIndex);
+  esp3dEvents.notify(ESP3DEventConsumer::gcode_host);
   return true;
 }
 
 bool ESP3DGCodeHostService::resume() {
   xTaskNotifyGive(_xHandle);
   xTaskNotifyGiveIndexed(_xHandle, _xResumeNotifyIndex);
+  esp3dEvents.notify(ESP3DEventConsumer::gcode_host);
   return true;
 }
 
@@ -401,10 +570,56 @@ bool ESP3DGCodeHostService::resume() {
 bool ESP3DGCodeHostService::_openFile(ESP3DGcodeStream* stream) {
   esp3d_log("File name is %s", stream->dataStream);
   _file_buffer_length = 0;
-  if (globalFs.accessFS(stream->dataStream)) {
+  if (_adoptPreparedFile(stream)) {
+    esp3d_log("Using prepared file");
+    _error = ESP3DGcodeHostError::no_error;
+    return true;
+  }
+  if (_accessFS(stream->dataStream)) {
     if (globalFs.exists(stream->dataStream)) {
       esp3d_log("File exists");
-      _file_handle = globalFs.open(stream->dataStream, "r");
+      // use tokens file if any and up to date
+      ESP3DGcodeTokensHeader tokens_header;
+      stream->tokenized =
+          ESP3DGcodeTokenizer::isValid(stream->dataStream, &tokens_header);
+      if (stream->tokenized) {
+        esp3d_log("Using tokens file");
+        _file_handle = globalFs.open(
+            ESP3DGcodeTokenizer::getTokensFilename(stream->dataStream).c_str(),
+            "r");
+      } else if (stream->startLine > 0) {
+        esp3d_log_e("Start line needs tokens file");
+        _error = ESP3DGcodeHostError::file_not_found;
+        _releaseFS(stream->dataStream);
+        return false;
+      } else {
+        _file_handle = globalFs.open(stream->dataStream, "r");
+      }
+      if (_file_handle != nullptr && stream->tokenized) {
+        // O(1) restart at any line with the offsets table
+        if (stream->cursorPos == 0 && stream->startLine > 0) {
+          uint32_t offset = 0;
+          if (!ESP3DGcodeTokenizer::getLineOffset(
+                  _file_handle, tokens_header, stream->startLine, &offset)) {
+            esp3d_log_e("Failed to get line %ld offset", stream->startLine);
+            _error = ESP3DGcodeHostError::cursor_out_of_range;
+            _closeFile(stream);
+            return false;
+          }
+          stream->cursorPos = offset;
+        }
+        stream->totalSize = tokens_header.data_size;
+        if (fseek(_file_handle,
+                  (long)(sizeof(ESP3DGcodeTokensHeader) + stream->cursorPos),
+                  SEEK_SET) != 0) {
+          esp3d_log_e("Failed to seek in tokens file");
+          _error = ESP3DGcodeHostError::cursor_out_of_range;
+          _closeFile(stream);
+          return false;
+        }
+        _error = ESP3DGcodeHostError::no_error;
+        return true;
+      }
       if (_file_handle != nullptr) {
         if (_current_stream_ptr->cursorPos != 0) {
           if (fseek(_file_handle, (long)stream->cursorPos,
@@ -414,7 +629,7 @@ bool ESP3DGCodeHostService::_openFile(ESP3DGcodeStream* stream) {
             esp3d_log_e("Failed to seek to correct position in file: %s",
                         stream->dataStream);
             _error = ESP3DGcodeHostError::cursor_out_of_range;
-            globalFs.releaseFS(stream->dataStream);
+            _releaseFS(stream->dataStream);
             return false;
           }
         }
@@ -425,7 +640,7 @@ bool ESP3DGCodeHostService::_openFile(ESP3DGcodeStream* stream) {
           if (globalFs.stat(stream->dataStream, &file_stat) == -1) {
             esp3d_log_e("Failed to get file size");
             _error = ESP3DGcodeHostError::file_system;
-            globalFs.releaseFS(stream->dataStream);
+            _releaseFS(stream->dataStream);
             return false;
           }
           if (file_stat.st_size > 0) {
@@ -433,7 +648,7 @@ bool ESP3DGCodeHostService::_openFile(ESP3DGcodeStream* stream) {
           } else {
             esp3d_log_e("File size is 0");
             _error = ESP3DGcodeHostError::empty_file;
-            globalFs.releaseFS(stream->dataStream);
+            _releaseFS(stream->dataStream);
             return false;
           }
         }
@@ -442,12 +657,12 @@ bool ESP3DGCodeHostService::_openFile(ESP3DGcodeStream* stream) {
       } else {
         esp3d_log_e("Failed to open file");
         _error = ESP3DGcodeHostError::access_denied;
-        globalFs.releaseFS(stream->dataStream);
+        _releaseFS(stream->dataStream);
       }
     } else {
       esp3d_log_e("File does not exist");
       _error = ESP3DGcodeHostError::file_not_found;
-      globalFs.releaseFS(stream->dataStream);
+      _releaseFS(stream->dataStream);
     }
 
   } else {
@@ -469,10 +684,139 @@ bool ESP3DGCodeHostService::_closeFile(ESP3DGcodeStream* stream) {
   globalFs.close((_file_handle), stream->dataStream);
   _file_handle = nullptr;
   _file_buffer_length = 0;
-  globalFs.releaseFS(stream->dataStream);
+  _releaseFS(stream->dataStream);
+  return true;
+}
+
+bool ESP3DGCodeHostService::_accessFS(const char* path) {
+  uint8_t fs = static_cast<uint8_t>(globalFs.getFSType(path));
+  if (fs >= static_cast<uint8_t>(ESP3DFileSystemType::unknown)) {
+    return false;
+  }
+  if (_fs_access_count[fs] == 0 && !globalFs.accessFS(path)) {
+    return false;
+  }
+  _fs_access_count[fs]++;
+  return true;
+}
+
+void ESP3DGCodeHostService::_releaseFS(const char* path) {
+  uint8_t fs = static_cast<uint8_t>(globalFs.getFSType(path));
+  if (fs >= static_cast<uint8_t>(ESP3DFileSystemType::unknown) ||
+      _fs_access_count[fs] == 0) {
+    return;
+  }
+  _fs_access_count[fs]--;
+  if (_fs_access_count[fs] == 0) {
+    globalFs.releaseFS(path);
+  }
+}
+
+// SPI SD is mounted with 2 files only: current job file and a web upload or
+// a script would not get one if next job file was kept open
+bool ESP3DGCodeHostService::_canPrepareFile(const char* filename) {
+#if ESP3D_SD_CARD_FEATURE && ESP3D_SD_IS_SPI
+  if (_getStreamType(filename) == ESP3DGcodeHostStreamType::sd_stream) {
+    return false;
+  }
+#endif  // ESP3D_SD_CARD_FEATURE && ESP3D_SD_IS_SPI
+  return true;
+}
+
+/// @brief Open file of next job and read its first buffer while current job
+/// ends, so starting it only costs a copy.
+/// @param filename Name of the file to prepare.
+/// @return True if file is valid and ready to be streamed.
+bool ESP3DGCodeHostService::_prepareFile(const char* filename) {
+  _releasePreparedFile();
+  if (!_accessFS(filename)) {
+    esp3d_log_w("Can't access FS to prepare %s", filename);
+    return false;
+  }
+  struct stat file_stat;
+  ESP3DGcodeTokensHeader tokens_header;
+  _prepared_length = 0;
+  if (globalFs.stat(filename, &file_stat) == 0 && file_stat.st_size > 0) {
+    _prepared_tokenized =
+        ESP3DGcodeTokenizer::isValid(filename, &tokens_header);
+    if (_prepared_tokenized) {
+      _prepared_size = tokens_header.data_size;
+      _prepared_handle = globalFs.open(
+          ESP3DGcodeTokenizer::getTokensFilename(filename).c_str(), "r");
+      if (_prepared_handle &&
+          fseek(_prepared_handle, (long)sizeof(ESP3DGcodeTokensHeader),
+                SEEK_SET) != 0) {
+        globalFs.close(_prepared_handle, filename);
+        _prepared_handle = nullptr;
+      }
+    } else {
+      _prepared_size = file_stat.st_size;
+      _prepared_handle = globalFs.open(filename, "r");
+      if (_prepared_handle) {
+        _prepared_length = fread(_prepared_buffer, sizeof(char),
+                                 STREAM_CHUNK_SIZE - 1, _prepared_handle);
+        if (_prepared_length == 0) {
+          globalFs.close(_prepared_handle, filename);
+          _prepared_handle = nullptr;
+        }
+      }
+    }
+  }
+  if (_prepared_handle == nullptr) {
+    esp3d_log_w("Failed to prepare %s", filename);
+    _releaseFS(filename);
+    return false;
+  }
+  esp3d_log("File %s prepared, %lld bytes", filename, _prepared_size);
+  _prepared_name = filename;
   return true;
 }
 
+// Take prepared file if stream starts at its beginning, else it is kept for
+// its own stream: it is only released when main stream ends without next job
+bool ESP3DGCodeHostService::_adoptPreparedFile(ESP3DGcodeStream* stream) {
+  if (_prepared_handle == nullptr || _prepared_name != stream->dataStream ||
+      stream->cursorPos != 0 || stream->startLine != 0) {
+    return false;
+  }
+  _file_handle = _prepared_handle;
+  stream->tokenized = _prepared_tokenized;
+  stream->totalSize = _prepared_size;
+  memcpy(_file_buffer, _prepared_buffer, _prepared_length);
+  _file_buffer[_prepared_length] = 0;
+  _file_buffer_length = _prepared_length;
+  _file_buffer_cursor = 0;
+  // FS access goes with the file
+  _prepared_handle = nullptr;
+  _prepared_name.clear();
+  return true;
+}
+
+// Keep main stream file open while scripts are processed before its first
+// line, like the line number reset of stream start
+void ESP3DGCodeHostService::_parkFile(ESP3DGcodeStream* stream) {
+  esp3d_log("Keep file %s open", stream->dataStream);
+  _prepared_name = stream->dataStream;
+  _prepared_handle = _file_handle;
+  _prepared_size = stream->totalSize;
+  _prepared_tokenized = stream->tokenized;
+  _prepared_length = _file_buffer_length;
+  memcpy(_prepared_buffer, _file_buffer, _file_buffer_length);
+  _file_handle = nullptr;
+  _file_buffer_length = 0;
+}
+
+void ESP3DGCodeHostService::_releasePreparedFile() {
+  if (_prepared_handle == nullptr) {
+    return;
+  }
+  esp3d_log("Release prepared file %s", _prepared_name.c_str());
+  globalFs.close(_prepared_handle, _prepared_name.c_str());
+  _prepared_handle = nullptr;
+  _releaseFS(_prepared_name.c_str());
+  _prepared_name.clear();
+}
+
 // ##################### Stream Handling Functions ########################
 
 bool ESP3DGCodeHostService::_startStream(ESP3DGcodeStream* stream) {
@@ -500,6 +844,24 @@ bool ESP3DGCodeHostService::_startStream(ESP3DGcodeStream* stream) {
       esp3d_log("Add command: %s", cmd.c_str());
       _add_stream(cmd.c_str(), stream->auth_type, true);
       _command_number = 0;
+      _resend_command_counter = 0;
+      _resend_ok_pending = false;
+      _link.reset();
+      _analyzer.reset();
+      _analyzed_pos = 0;
+#if ESP3D_TFT_BENCHMARK
+      _analyzer_time = 0;
+      if (_outputClient == ESP3DClientType::serial) {
+        serialClient.resetTxStats();
+      }
+#if ESP3D_USB_SERIAL_FEATURE
+      if (_outputClient == ESP3DClientType::usb_serial) {
+        usbSerialClient.resetTxStats();
+      }
+#endif  // ESP3D_USB_SERIAL_FEATURE
+#endif  // ESP3D_TFT_BENCHMARK
+      esp3dTftValues.set_string_value(ESP3DValuesIndex::job_layer, "0");
+      esp3dTftValues.set_string_value(ESP3DValuesIndex::job_remaining, "0");
       esp3dTftValues.set_string_value(ESP3DValuesIndex::job_status,
                                       "processing");
       esp3dTftValues.set_string_value(ESP3DValuesIndex::file_name,
@@ -562,8 +924,6 @@ bool ESP3DGCodeHostService::_endStream(ESP3DGcodeStream* stream) {
 /// @return True if command is read, False if no command read (end of
 /// stream).
 bool ESP3DGCodeHostService::_readNextCommand(ESP3DGcodeStream* stream) {
-  // No need to put this in class scope
-  static size_t buffer_cursor = 0;
   bool need_search_command = true;
   _error = ESP3DGcodeHostError::no_error;
   esp3d_log("Reading next command");
@@ -578,7 +938,8 @@ bool ESP3DGCodeHostService::_readNextCommand(ESP3DGcodeStream* stream) {
     // read from buffer = dataStream
     // reset content
     _current_command_str = "";
-    for (int i = stream->cursorPos; i < strlen(stream->dataStream); i++) {
+    // totalSize is the commands length, no need to strlen each char
+    for (uint64_t i = stream->cursorPos; i < stream->totalSize; i++) {
       stream->cursorPos++;
       if (stream->dataStream[i] == '\n') {
         need_search_command = false;
@@ -588,6 +949,30 @@ bool ESP3DGCodeHostService::_readNextCommand(ESP3DGcodeStream* stream) {
       _current_command_str += stream->dataStream[i];
     }
     esp3d_log("Command read: %s", _current_command_str.c_str());
+  } else if (isFileStream(stream) && stream->tokenized) {
+    // records are already trimmed and stripped, just read them
+    uint8_t record[2];
+    if (_file_handle == nullptr) {
+      esp3d_log_e("No file handle");
+      _error = ESP3DGcodeHostError::file_system;
+      return false;
+    }
+    if (stream->cursorPos >= stream->totalSize) {
+      esp3d_log("End of tokens reached");
+      _current_command_str = "";
+      return false;
+    }
+    if (fread(record, 1, sizeof(record), _file_handle) != sizeof(record) ||
+        record[1] == 0 ||
+        fread(_file_buffer, 1, record[1], _file_handle) != record[1]) {
+      esp3d_log_e("Failed to read tokens file");
+      _error = ESP3DGcodeHostError::file_system;
+      return false;
+    }
+    stream->cursorPos += sizeof(record) + record[1];
+    _current_command_str.assign(_file_buffer, record[1]);
+    _current_command_is_esp = (record[0] & ESP3D_GCODE_TOKEN_ESP_COMMAND) != 0;
+    return true;
   } else if (isFileStream(stream)) {
     _current_command_str = "";
     esp3d_log("File commands cursor pos is %lld and current command is %s",
@@ -601,16 +986,16 @@ bool ESP3DGCodeHostService::_readNextCommand(ESP3DGcodeStream* stream) {
     // read from file
     while (need_search_command) {
       esp3d_log("Buffer pos: %d, in buffer of %d,  for %lld/%lld",
-                buffer_cursor, _file_buffer_length, stream->cursorPos,
+                _file_buffer_cursor, _file_buffer_length, stream->cursorPos,
                 stream->totalSize);
-      if (buffer_cursor >= _file_buffer_length) {
+      if (_file_buffer_cursor >= _file_buffer_length) {
         // we need refill buffer from file
         _file_buffer_length = 0;
       }
       // read from file
       if (_file_buffer_length == 0) {
         esp3d_log("Buffer is empty, read from file");
-        buffer_cursor = 0;
+        _file_buffer_cursor = 0;
         _file_buffer_length = fread(_file_buffer, sizeof(char),
                                     STREAM_CHUNK_SIZE - 1, _file_handle);
         _file_buffer[_file_buffer_length] = 0;
@@ -641,15 +1026,15 @@ bool ESP3DGCodeHostService::_readNextCommand(ESP3DGcodeStream* stream) {
       if (need_search_command) {
         esp3d_log("Parsing buffer to add to command %s",
                   _current_command_str.c_str());
-        for (buffer_cursor = buffer_cursor; buffer_cursor < _file_buffer_length;
-             buffer_cursor++) {
+        for (; _file_buffer_cursor < _file_buffer_length;
+             _file_buffer_cursor++) {
           // What ever we read it increase the cursor pos
           (stream->cursorPos)++;
           // esp3d_log("Parsing buffer at index:%d, cursor is now %lld",
-          //             buffer_cursor, stream->cursorPos);
+          //             _file_buffer_cursor, stream->cursorPos);
           //   do not add the `\n` on purpose for triming the command
-          if (_file_buffer[buffer_cursor] == '\n' ||
-              _file_buffer[buffer_cursor] == '\r') {
+          if (_file_buffer[_file_buffer_cursor] == '\n' ||
+              _file_buffer[_file_buffer_cursor] == '\r') {
             esp3d_log("End of line %s found", _current_command_str.c_str());
             // is it en empty line ?
             //  if yes we need to continue to read
@@ -658,7 +1043,7 @@ bool ESP3DGCodeHostService::_readNextCommand(ESP3DGcodeStream* stream) {
                         stream->cursorPos, stream->totalSize);
               continue;
             } else {
-              buffer_cursor++;
+              _file_buffer_cursor++;
               esp3d_log("Command found, is now: *%s* of %d bytes",
                         _current_command_str.c_str(),
                         _current_command_str.length());
@@ -667,13 +1052,13 @@ bool ESP3DGCodeHostService::_readNextCommand(ESP3DGcodeStream* stream) {
             }
           }
           // fill the command string
-          _current_command_str += _file_buffer[buffer_cursor];
+          _current_command_str += _file_buffer[_file_buffer_cursor];
           // esp3d_log("Command is now: %s", _current_command_str.c_str());
           if (_current_command_str.length() > MAX_COMMAND_LENGTH) {
             esp3d_log_e("Command too long > 255, %s",
                         _current_command_str.c_str());
             // is that necessary ? as we are not going to send it
-            buffer_cursor++;
+            _file_buffer_cursor++;
             _error = ESP3DGcodeHostError::command_too_long;
             return false;
           }
@@ -719,13 +1104,13 @@ bool ESP3DGCodeHostService::_readNextCommand(ESP3DGcodeStream* stream) {
   }
   esp3d_log("Cursor pos is now %lld / %lld, %lld, buffer cursor is %d/%d",
             stream->cursorPos, stream->totalSize,
-            100 * stream->cursorPos / stream->totalSize, buffer_cursor,
+            100 * stream->cursorPos / stream->totalSize, _file_buffer_cursor,
             _file_buffer_length);
-  _current_command_str = esp3d_string::str_trim(_current_command_str.c_str());
+  esp3d_string::trimInPlace(_current_command_str);
   esp3d_log("Trimmed command read: %s", _current_command_str.c_str());
   if (_current_command_str.length() == 0) {
     esp3d_log("No command read %lld/%lld, on buffer %d/%d", stream->cursorPos,
-              stream->totalSize, buffer_cursor, _file_buffer_length);
+              stream->totalSize, _file_buffer_cursor, _file_buffer_length);
 
     return false;
   }
@@ -770,14 +1155,20 @@ bool ESP3DGCodeHostService::_CheckSumCommand(char* result_buffer,
   if (strlen(command) == 0) {
     return false;
   }
-  std::string cmd = "N" + std::to_string(commandnb) + " " + command;
-  uint8_t chksm = _Checksum(cmd.c_str(), cmd.length());
-  cmd += "*" + std::to_string(chksm) + "\n";
-  if (cmd.length() > max_result_size) {
+  // format in place, no intermediate string
+  int len = snprintf(result_buffer, max_result_size, "N%lu %s",
+                     (unsigned long)commandnb, command);
+  if (len < 0 || (size_t)len >= max_result_size) {
+    esp3d_log_e("Command too long");
+    return false;
+  }
+  uint8_t chksm = _Checksum(result_buffer, len);
+  int chksm_len = snprintf(result_buffer + len, max_result_size - len,
+                           "*%u\n", chksm);
+  if (chksm_len < 0 || (size_t)(len + chksm_len) >= max_result_size) {
     esp3d_log_e("Command too long");
     return false;
   }
-  strcpy(result_buffer, cmd.c_str());
   return true;
 }
 
@@ -785,16 +1176,29 @@ bool ESP3DGCodeHostService::_parseResponse(ESP3DMessage* rx) {
   esp3d_log("Parse response %s", (char*)(rx->data));
   ESP3DDataType response_type = esp3dGcodeParser.getType((char*)(rx->data));
   esp3d_log("Response type %d", static_cast<uint8_t>(response_type));
+  uint32_t latency;
   switch (response_type) {
     case ESP3DDataType::ack:  // ack
       _startTimeout = esp3d_hal::millis();
       esp3d_log("Reset timeout");
-      esp3d_log("Got ack %s", esp3d_string::str_trim((char*)rx->data));
-      esp3d_log("for %s", esp3d_string::str_trim(_current_command_str.c_str()));
+      esp3d_log("Got ack %s for %s", (char*)rx->data,
+                _current_command_str.c_str());
       if (_awaitingAck) {
         esp3d_log("When having awaiting ack");
         // we got an ack for the current command
+        if (_resend_ok_pending) {
+          _resend_ok_pending = false;
+          esp3d_log("Ack of rejected line, keep waiting");
+          break;
+        }
         _awaitingAck = false;
+        _acked_lines++;
+        _resend_command_counter = 0;
+        _last_ack_time = esp3d_hal::millis();
+        // smoothed on last 8 commands
+        latency = _last_ack_time - _command_sent_time;
+        _ack_latency = (_ack_latency * 7 + latency) / 8;
+        _link.lineAcked(latency);
         // save one cycle for single command
         if (_current_stream_ptr->type ==
             ESP3DGcodeHostStreamType::single_command) {
@@ -816,9 +1220,11 @@ bool ESP3DGCodeHostService::_parseResponse(ESP3DMessage* rx) {
     case ESP3DDataType::error:  // error
       esp3d_log_e("Got Error: %s", ((char*)(rx->data)));
       if (_awaitingAck) {
-        _awaitingAck = false;
-        // TODO: handle error ?
-        // e.g: Marlin raise error first then ask for resend
+        // Marlin raises error first then asks for resend and sends ok, so
+        // keep waiting for them
+        _link.error(
+            strstr(esp3dGcodeParser.getLastError(), "checksum") != nullptr ||
+            strstr(esp3dGcodeParser.getLastError(), "Checksum") != nullptr);
       } else {
         std::string text = esp3dTranslationService.translate(ESP3DLabel::error);
         text += ": P";
@@ -836,6 +1242,8 @@ bool ESP3DGCodeHostService::_parseResponse(ESP3DMessage* rx) {
       if (_awaitingAck) {
         _resend_command_number = esp3dGcodeParser.getLineResend();
         _resend_command_counter++;
+        _resend_ok_pending = true;
+        _link.resend();
         esp3d_log("Got resend %lld", _resend_command_number);
         _setStreamState(ESP3DGcodeStreamState::resend_gcode_command);
       } else {
@@ -907,6 +1315,24 @@ ESP3DGcodeStream* ESP3DGCodeHostService::getCurrentMainStream() {
 
 ESP3DGcodeHostError ESP3DGCodeHostService::getErrorNum() { return _error; }
 
+// True if the state machine can progress without waiting for any event
+// (new message, ack, pause/resume/abort request)
+bool ESP3DGCodeHostService::hasPendingWork() {
+  if (getRxMsgsCount() > 0) {
+    return true;
+  }
+  if (_current_stream_ptr == nullptr) {
+    return !(_scripts.empty() && _streams.empty());
+  }
+  // a script is waiting to take over the current stream
+  if (!_scripts.empty() && _get_front_script() != _current_stream_ptr) {
+    return true;
+  }
+  ESP3DGcodeStreamState state = _getStreamState();
+  return state != ESP3DGcodeStreamState::wait_for_ack &&
+         state != ESP3DGcodeStreamState::paused;
+}
+
 ESP3DGCodeHostService::ESP3DGCodeHostService() {
   _started = false;
   _xHandle = NULL;
@@ -943,6 +1369,7 @@ bool ESP3DGCodeHostService::begin() {
     return false;
   }
   setTxMutex(&_tx_mutex);
+  setEventConsumer(ESP3DEventConsumer::gcode_host);
 
   if (pthread_mutex_init(&_streams_list_mutex, NULL) != 0) {
     esp3d_log_e("Mutex creation for streams list failed");
@@ -953,6 +1380,11 @@ bool ESP3DGCodeHostService::begin() {
     esp3d_log_e("Mutex creation for scripts list failed");
     return false;
   }
+  if (!esp3dJobQueue.begin()) {
+    esp3d_log_e("Job queue start failed");
+  }
+  // command is built char by char, so keep room for the longest one
+  _current_command_str.reserve(MAX_COMMAND_LENGTH + 1);
 
   // Task is never stopped so no need to kill the task from outside
 
@@ -962,11 +1394,17 @@ bool ESP3DGCodeHostService::begin() {
   esp3d_log("Output client is: %d", static_cast<uint8_t>(_outputClient));
   BaseType_t res = xTaskCreatePinnedToCore(
       esp3d_gcode_host_task, "esp3d_gcode_host_task",
-      ESP3D_GCODE_HOST_TASK_SIZE, NULL, ESP3D_GCODE_HOST_TASK_PRIORITY,
-      &_xHandle, ESP3D_GCODE_HOST_TASK_CORE);
+      ESP3D_GCODE_HOST_TASK_SIZE, NULL,
+      esp3dScheduling.getPriority(ESP3DTaskRole::gcode_host,
+                                  ESP3D_GCODE_HOST_TASK_PRIORITY),
+      &_xHandle,
+      esp3dScheduling.getCore(ESP3DTaskRole::gcode_host,
+                              ESP3D_GCODE_HOST_TASK_CORE));
 
   if (res == pdPASS && _xHandle) {
     esp3d_log("Created GCode Host Task");
+    esp3dScheduling.registerTask(ESP3DTaskRole::gcode_host, _xHandle,
+                                 ESP3D_GCODE_HOST_TASK_PRIORITY);
     esp3d_hal::wait(100);
     esp3d_log("GCode Host service started");
     _started = true;
@@ -980,14 +1418,12 @@ bool ESP3DGCodeHostService::begin() {
 }
 
 bool ESP3DGCodeHostService::_stripCommand() {
-  std::string cmd = "";
-  for (uint i = 0; i < _current_command_str.length(); i++) {
-    if (_current_command_str[i] == ';') {
-      break;
-    }
-    cmd += _current_command_str[i];
+  // strip comment and trim in place, no copy
+  size_t pos = _current_command_str.find(';');
+  if (pos != std::string::npos) {
+    _current_command_str.resize(pos);
   }
-  _current_command_str = esp3d_string::str_trim(cmd.c_str());
+  esp3d_string::trimInPlace(_current_command_str);
   if (_current_command_str.length() == 0) {
     return false;
   }
@@ -995,6 +1431,48 @@ bool ESP3DGCodeHostService::_stripCommand() {
   return true;
 }
 
+// Look-ahead analysis of main stream, line is analyzed before it is sent
+// and before comments are stripped, return true to pause before this line
+bool ESP3DGCodeHostService::_analyzeCommand(uint64_t line_start) {
+  // line read again after a pause is already analyzed
+  if (line_start < _analyzed_pos) {
+    return false;
+  }
+  _analyzed_pos = _current_stream_ptr->cursorPos;
+#if ESP3D_TFT_BENCHMARK
+  int64_t start_time = esp_timer_get_time();
+#endif  // ESP3D_TFT_BENCHMARK
+  uint8_t events = _analyzer.analyze(_current_command_str.c_str(),
+                                     _current_command_str.length());
+#if ESP3D_TFT_BENCHMARK
+  _analyzer_time += esp_timer_get_time() - start_time;
+#endif  // ESP3D_TFT_BENCHMARK
+  if (events & ESP3D_GCODE_ANALYZER_LAYER) {
+    uint32_t layer = _analyzer.getLayer();
+    esp3dTftValues.set_string_value(ESP3DValuesIndex::job_layer,
+                                    std::to_string(layer).c_str());
+    if (_pause_layer != 0 && layer >= _pause_layer) {
+      esp3d_log("Pause at layer %ld", layer);
+      _pause_layer = 0;
+      return true;
+    }
+  }
+  if ((events & ESP3D_GCODE_ANALYZER_TRAVEL) && _pause_travel) {
+    esp3d_log("Pause at travel move");
+    _pause_travel = false;
+    return true;
+  }
+  return false;
+}
+
+int32_t ESP3DGCodeHostService::getRemainingTime() {
+  ESP3DGcodeStream* stream = getCurrentMainStream();
+  if (!stream) {
+    return -1;
+  }
+  return _analyzer.getRemainingTime(stream->processedSize, stream->totalSize);
+}
+
 // to avoid undefined reference if list is empty
 ESP3DGcodeStream* ESP3DGCodeHostService::_get_front_script() {
   if (_scripts.empty()) return nullptr;
@@ -1095,7 +1573,10 @@ void ESP3DGCodeHostService::_handle_stream_selection() {
           "there are other streams in front of it");
       _current_main_stream_ptr->active = false;
       // close the file if needed
-      if (_file_handle) {
+      if (_file_handle && _current_main_stream_ptr->cursorPos == 0 &&
+          _prepared_handle == nullptr) {
+        _parkFile(_current_main_stream_ptr);
+      } else if (_file_handle) {
         esp3d_log("File handle is not null, close it");
         _closeFile(_current_main_stream_ptr);
       }
@@ -1261,6 +1742,12 @@ void ESP3DGCodeHostService::_handle_stream_states() {
   static uint64_t last_ellapsedtime = 0;
   double new_progress;
   std::string new_progress_str;
+  int32_t remaining_time;
+  uint64_t line_start;
+  uint32_t line_spacing;
+#if ESP3D_TFT_BENCHMARK
+  uint64_t duration;
+#endif  // ESP3D_TFT_BENCHMARK
   ESP3DRequest requestId = {.id = 0};
 
   if (_current_stream_ptr == nullptr) {
@@ -1333,6 +1820,18 @@ void ESP3DGCodeHostService::_handle_stream_states() {
               ESP3DGcodeHostStreamType::fs_stream) ||
              (_current_stream_ptr->type ==
               ESP3DGcodeHostStreamType::sd_stream))) {
+          if (_job_active && !_job_prefetched &&
+              _current_stream_ptr->totalSize -
+                      _current_stream_ptr->processedSize <
+                  ESP3D_JOB_PREFETCH_DISTANCE) {
+            _job_prefetched = true;
+            ESP3DJob next_job;
+            if (esp3dJobQueue.isRunning() &&
+                esp3dJobQueue.get(0, &next_job) &&
+                _canPrepareFile(next_job.filename.c_str())) {
+              _prepareFile(next_job.filename.c_str());
+            }
+          }
           if (esp3d_hal::millis() - last_ellapsedtime >
               ESP3D_REFRESH_INTERVAL) {
             last_ellapsedtime = esp3d_hal::millis();
@@ -1340,6 +1839,15 @@ void ESP3DGCodeHostService::_handle_stream_states() {
                 ESP3DValuesIndex::job_duration,
                 std::to_string(esp3d_hal::millis() - _current_stream_ptr->id)
                     .c_str());
+            // in ms like duration
+            remaining_time = _analyzer.getRemainingTime(
+                _current_stream_ptr->processedSize,
+                _current_stream_ptr->totalSize);
+            if (remaining_time >= 0) {
+              esp3dTftValues.set_string_value(
+                  ESP3DValuesIndex::job_remaining,
+                  std::to_string(remaining_time * 1000LL).c_str());
+            }
           }
 
           new_progress = (1.0 * _current_stream_ptr->processedSize) /
@@ -1366,8 +1874,27 @@ void ESP3DGCodeHostService::_handle_stream_states() {
         break;
       }
 
+      line_start = _current_stream_ptr->cursorPos;
       if (_readNextCommand(_current_stream_ptr)) {
         esp3d_log("Read next command: *%s*", _current_command_str.c_str());
+        if ((_current_stream_ptr->type == ESP3DGcodeHostStreamType::fs_stream ||
+             _current_stream_ptr->type ==
+                 ESP3DGcodeHostStreamType::sd_stream) &&
+            _analyzeCommand(line_start)) {
+          // line will be read again when resumed
+          _current_stream_ptr->cursorPos = line_start;
+          esp3dTftValues.set_string_value(ESP3DValuesIndex::job_status,
+                                          "paused");
+          _setStreamState(ESP3DGcodeStreamState::pause);
+          break;
+        }
+        if (_current_stream_ptr->tokenized) {
+          // already flagged and stripped when tokenized
+          _setStreamState(_current_command_is_esp
+                              ? ESP3DGcodeStreamState::send_esp_command
+                              : ESP3DGcodeStreamState::send_gcode_command);
+          break;
+        }
         if (esp3dCommands.is_esp_command((uint8_t*)_current_command_str.c_str(),
                                          _current_command_str.length())) {
           esp3d_log("Command is an esp command");
@@ -1450,6 +1977,17 @@ void ESP3DGCodeHostService::_handle_stream_states() {
            _current_stream_ptr->type == ESP3DGcodeHostStreamType::fs_stream)) {
         _command_number++;
         esp3d_log("Command number: %lld, need checksum", _command_number);
+        if (_outputClient == ESP3DClientType::serial) {
+          _link.setRxOverflows(serialClient.getRxOverflows());
+        }
+        // backoff when link errors climb, host task is the only one to wait
+        line_spacing = _link.getSpacing();
+        if (line_spacing > 0 &&
+            esp3d_hal::millis() - _last_ack_time < line_spacing) {
+          esp3d_hal::wait(line_spacing -
+                          (esp3d_hal::millis() - _last_ack_time));
+        }
+        _link.lineSent();
         if (!_CheckSumCommand(buffer_str, MAX_COMMAND_LENGTH,
                               _current_command_str.c_str(), _command_number)) {
           esp3d_log_e("Failed to format command");
@@ -1489,6 +2027,7 @@ void ESP3DGCodeHostService::_handle_stream_states() {
           esp3d_log("change state to Waiting for ack");
           _setStreamState(ESP3DGcodeStreamState::wait_for_ack);
           _startTimeout = esp3d_hal::millis();
+          _command_sent_time = _startTimeout;
         } else {
           esp3d_log("change state to read cursor");
           _current_command_str = "";
@@ -1544,6 +2083,7 @@ void ESP3DGCodeHostService::_handle_stream_states() {
       if (_startTimeout != 0 &&
           esp3d_hal::millis() - _startTimeout > ESP3D_COMMAND_TIMEOUT) {
         esp3d_log_e("Timeout waiting for ack");
+        _link.timeout();
         _error = ESP3DGcodeHostError::time_out;
         _setStreamState(ESP3DGcodeStreamState::error);
         if (!_connection_lost) {
@@ -1616,7 +2156,35 @@ void ESP3DGCodeHostService::_handle_stream_states() {
       // sanity check, reset main stream pointer if it is the current stream
       if (_current_stream_ptr == _current_main_stream_ptr) {
         _current_main_stream_ptr = nullptr;
+        _pause_layer = 0;
+        _pause_travel = false;
+#if ESP3D_TFT_BENCHMARK
+        esp3d_report(
+            "G-code analysis: %ld lines in %lld us, %.2f us/line, %ld layers, "
+            "%.1f mm extruded, %.0f s estimated",
+            _analyzer.getLinesCount(), _analyzer_time,
+            _analyzer.getLinesCount()
+                ? (double)_analyzer_time / _analyzer.getLinesCount()
+                : 0.0,
+            _analyzer.getLayer(), _analyzer.getExtruded(),
+            _analyzer.getMoveTime());
+        // same file on serial and usb output compares both links
+        duration = esp3d_hal::millis() - _current_stream_ptr->id;
+        esp3d_report("Stream: %ld lines in %lld ms, %.1f lines/s, ack %ld ms",
+                     _link.getStats().lines, duration,
+                     _link.getStats().lines * 1000.0 / (duration + 1),
+                     _link.getStats().ack_latency);
+        if (_outputClient == ESP3DClientType::serial) {
+          serialClient.reportTxStats();
+        }
+#if ESP3D_USB_SERIAL_FEATURE
+        if (_outputClient == ESP3DClientType::usb_serial) {
+          usbSerialClient.reportTxStats();
+        }
+#endif  // ESP3D_USB_SERIAL_FEATURE
+#endif  // ESP3D_TFT_BENCHMARK
         esp3dTftValues.set_string_value(ESP3DValuesIndex::job_status, "idle");
+        esp3dTftValues.set_string_value(ESP3DValuesIndex::job_remaining, "0");
         if (_current_stream_ptr->cursorPos >= _current_stream_ptr->totalSize) {
           esp3d_log("Stream is finished send 100");
           esp3dTftValues.set_string_value(ESP3DValuesIndex::job_progress,
@@ -1630,6 +2198,16 @@ void ESP3DGCodeHostService::_handle_stream_states() {
             ESP3DValuesIndex::job_duration,
             std::to_string(esp3d_hal::millis() - _current_stream_ptr->id)
                 .c_str());
+        if (_job_active && _current_stream_ptr->id == _job_stream_id) {
+          _endJob(_error == ESP3DGcodeHostError::no_error &&
+                  _current_stream_ptr->totalSize > 0 &&
+                  _current_stream_ptr->cursorPos >=
+                      _current_stream_ptr->totalSize);
+        }
+        // file opened ahead is only kept for next job
+        if (!_job_active) {
+          _releasePreparedFile();
+        }
       }
       if (!_endStream(_current_stream_ptr)) {
         esp3d_log_e("Failed to end stream");
@@ -1731,6 +2309,90 @@ void ESP3DGCodeHostService::_handle_stream_states() {
   };
 }
 
+// ##################### Job Queue Functions ########################
+
+// Start next job when queue is running and printer is free, next jobs are
+// started as soon as previous one ends
+void ESP3DGCodeHostService::_handle_job_queue() {
+  if (_job_active || !esp3dJobQueue.isRunning()) {
+    return;
+  }
+  bool streams_empty = false;
+  if (pthread_mutex_lock(&_streams_list_mutex) == 0) {
+    streams_empty = _streams.empty();
+    pthread_mutex_unlock(&_streams_list_mutex);
+  }
+  if (!streams_empty) {
+    return;
+  }
+  _startNextJob();
+}
+
+/// @brief Add start script and file of first job of queue to the streams.
+/// @return True if job is started, queue is stopped if there is no job or it
+/// cannot be started.
+bool ESP3DGCodeHostService::_startNextJob() {
+  ESP3DJob job;
+  if (!esp3dJobQueue.get(0, &job)) {
+    esp3d_log("Job queue is done");
+    esp3dJobQueue.stop();
+    _releasePreparedFile();
+    return false;
+  }
+  esp3d_log("Start job %s", job.filename.c_str());
+  // queue may have changed since next file was prepared, a file which is not
+  // the one of this job would stay open until the end of the job
+  if (_prepared_name != job.filename) {
+    _releasePreparedFile();
+  }
+  bool res = true;
+  if (!isFileStreamType(_getStreamType(job.filename.c_str()))) {
+    esp3d_log_e("Invalid job file %s", job.filename.c_str());
+    res = false;
+  } else if (job.start_script.length() > 0 &&
+             !_add_stream(job.start_script.c_str(), job.auth_type, true)) {
+    esp3d_log_e("Failed to add job start script");
+    res = false;
+  } else if (!_add_stream(job.filename.c_str(), job.auth_type, false, 0,
+                          &_job_stream_id)) {
+    esp3d_log_e("Failed to add job %s", job.filename.c_str());
+    res = false;
+  }
+  if (!res) {
+    esp3dJobQueue.stop();
+    _releasePreparedFile();
+    return false;
+  }
+  // job is removed once it is in streams, so it is not printed twice after
+  // a restart
+  esp3dJobQueue.popFront(&_current_job);
+  _job_active = true;
+  _job_prefetched = false;
+  return true;
+}
+
+/// @brief Run end script of job and start next one if job is completed, else
+/// stop the queue so next jobs are not printed on a failed one.
+/// @param completed True if whole file has been sent.
+void ESP3DGCodeHostService::_endJob(bool completed) {
+  _job_active = false;
+  if (!completed) {
+    esp3d_log_w("Job %s failed, stop job queue",
+                _current_job.filename.c_str());
+    esp3dJobQueue.stop();
+    return;
+  }
+  esp3d_log("Job %s done", _current_job.filename.c_str());
+  if (_current_job.end_script.length() > 0 &&
+      !_add_stream(_current_job.end_script.c_str(), _current_job.auth_type,
+                   true)) {
+    esp3d_log_e("Failed to add job end script");
+  }
+  if (esp3dJobQueue.isRunning()) {
+    _startNextJob();
+  }
+}
+
 void ESP3DGCodeHostService::handle() {
   if (!_started) {
     return;
@@ -1738,6 +2400,9 @@ void ESP3DGCodeHostService::handle() {
   // Check for notifications, set the current stream state
   _handle_notifications();
 
+  // Feed next job of queue if nothing is printed
+  _handle_job_queue();
+
   // Handle the stream
   _handle_stream_selection();
 
@@ -1793,6 +2458,8 @@ void ESP3DGCodeHostService::end() {
     _xHandle = NULL;
   }
 
+  _releasePreparedFile();
+  _job_active = false;
   if (_file_handle) {
     _closeFile(_current_main_stream_ptr);
     _file_handle = nullptr;
@@ -26,11 +26,19 @@
 
 #include "authentication/esp3d_authentication_types.h"
 #include "esp3d_client.h"
+#include "esp3d_gcode_analyzer.h"
 #include "esp3d_gcode_host_types.h"
+#include "esp3d_job_queue.h"
+#include "esp3d_link_quality.h"
 #include "esp3d_log.h"
 #include "esp3d_string.h"
+#include "filesystem/esp3d_fs_types.h"
 #include "tasks_def.h"
 #define ESP3D_MAX_STREAM_SIZE 50
+// number of ended streams status kept for polling
+#define ESP3D_STREAM_HISTORY_SIZE 10
+// remaining bytes of job file when next job file is prepared
+#define ESP3D_JOB_PREFETCH_DISTANCE 65536
 
 #ifdef __cplusplus
 extern "C" {
@@ -54,9 +62,20 @@ struct ESP3DGcodeStream {
       ESP3DAuthenticationLevel::guest;  // the authentication level of the user
                                         // requesting the stream
   bool active = false;      // is the stream currently being processed
+  bool tokenized = false;   // is the stream read from the tokens file
+  uint32_t startLine = 0;   // line to start from, needs tokens file
   char *dataStream = NULL;  // the name of the file to stream
 };
 
+// stream status as reported to clients polling a stream id
+struct ESP3DGcodeStreamStatus {
+  uint64_t id = 0;
+  ESP3DGcodeStreamState state = ESP3DGcodeStreamState::undefined;
+  uint64_t processedSize = 0;
+  uint64_t totalSize = 0;
+  ESP3DGcodeHostError error = ESP3DGcodeHostError::no_error;
+};
+
 class ESP3DGCodeHostService : public ESP3DClient {
  public:
   ESP3DGCodeHostService();
@@ -67,6 +86,7 @@ class ESP3DGCodeHostService : public ESP3DClient {
   void process(ESP3DMessage *msg);
   void flush();
   bool started() { return _started; }
+  bool hasPendingWork();
 
   void updateScripts();
   bool abort();
@@ -78,13 +98,35 @@ class ESP3DGCodeHostService : public ESP3DClient {
   ESP3DGcodeHostError getErrorNum();
   ESP3DGcodeStream *getCurrentMainStream();
   bool addStream(const char *filename, ESP3DAuthenticationLevel auth_type,
-                 bool executeAsMacro);
+                 bool executeAsMacro, uint32_t startLine = 0);
   bool addStream(const char *command, size_t length,
                  ESP3DAuthenticationLevel authentication_level);
+  bool addCommandsStream(char *commands, size_t length,
+                         ESP3DAuthenticationLevel authentication_level,
+                         uint64_t *stream_id);
+  bool getStreamStatus(uint64_t id, ESP3DGcodeStreamStatus *status);
 
   size_t getScriptsListSize() { return _scripts.size(); }
   size_t getStreamsListSize() { return _scripts.size(); }
   bool hasStreamListCommand(const char *command);
+  // streaming throughput, ack latency is smoothed and in ms
+  uint32_t getAckedLines() { return _acked_lines; }
+  uint32_t getAckLatency() { return _ack_latency; }
+  // pause main stream before first line of layer, 0 to cancel
+  void pauseAtLayer(uint32_t layer) { _pause_layer = layer; }
+  // pause main stream before next travel move with retracted filament
+  void pauseAtTravel(bool enable = true) { _pause_travel = enable; }
+  uint32_t getPauseLayer() { return _pause_layer; }
+  bool isPauseAtTravel() { return _pause_travel; }
+  // from look-ahead analysis of main stream
+  uint32_t getLayer() { return _analyzer.getLayer(); }
+  int32_t getRemainingTime();
+  // errors of link with printer since main stream start, and current backoff
+  const ESP3DLinkQualityStats &getLinkStats() { return _link.getStats(); }
+  uint8_t getBackoffLevel() { return _link.getLevel(); }
+  uint32_t getLineSpacing() { return _link.getSpacing(); }
+  // a job of queue is printed
+  bool isJobActive() { return _job_active; }
 
  private:
   ESP3DGcodeHostStreamType _getStreamType(const char *data);
@@ -97,28 +139,62 @@ class ESP3DGCodeHostService : public ESP3DClient {
   bool _endStream(ESP3DGcodeStream *stream);
   bool _openFile(ESP3DGcodeStream *stream);
   bool _closeFile(ESP3DGcodeStream *stream);
+  bool _accessFS(const char *path);
+  void _releaseFS(const char *path);
+  bool _canPrepareFile(const char *filename);
+  bool _prepareFile(const char *filename);
+  bool _adoptPreparedFile(ESP3DGcodeStream *stream);
+  void _parkFile(ESP3DGcodeStream *stream);
+  void _releasePreparedFile();
+  void _handle_job_queue();
+  bool _startNextJob();
+  void _endJob(bool completed);
   bool _pushBackGCodeStream(ESP3DGcodeStream *stream, bool is_stream = false);
   bool _popFrontGCodeStream(bool is_stream = false);
+  uint64_t _getNewStreamId();
+  void _addEndedStreamStatus(const ESP3DGcodeStreamStatus &status);
 
   void _handle_notifications();
   void _handle_msgs();
   void _handle_stream_selection();
   void _handle_stream_states();
   bool _add_stream(const char *data, ESP3DAuthenticationLevel auth_type,
-                   bool executeFirst = false);
+                   bool executeFirst = false, uint32_t startLine = 0,
+                   uint64_t *stream_id = nullptr);
 
   bool _readNextCommand(ESP3DGcodeStream *stream);
   uint8_t _Checksum(const char *command, uint32_t commandSize);
   bool _CheckSumCommand(char *result_buffer, size_t max_result_size,
                         const char *command, uint32_t commandnb);
   bool _stripCommand();
+  bool _analyzeCommand(uint64_t line_start);
 
   bool _processRx(ESP3DMessage *rx);
   bool _parseResponse(ESP3DMessage *rx);
 
   std::string _current_command_str;
+  bool _current_command_is_esp = false;
   size_t _file_buffer_length = 0;
+  size_t _file_buffer_cursor = 0;
   char _file_buffer[STREAM_CHUNK_SIZE];
+  // SD access is exclusive, so access of a file system is taken once for
+  // all files opened by host and released with the last one
+  uint8_t _fs_access_count[static_cast<uint8_t>(ESP3DFileSystemType::unknown)] =
+      {0};
+
+  // job of queue being printed and if next one has been prepared
+  ESP3DJob _current_job;
+  uint64_t _job_stream_id = 0;
+  bool _job_active = false;
+  bool _job_prefetched = false;
+  // file opened ahead with its first buffer: next job file, or main stream
+  // file put on hold by scripts before its first line
+  std::string _prepared_name;
+  FILE *_prepared_handle = nullptr;
+  uint64_t _prepared_size = 0;
+  bool _prepared_tokenized = false;
+  size_t _prepared_length = 0;
+  char _prepared_buffer[STREAM_CHUNK_SIZE];
 
   TaskHandle_t _xHandle = NULL;
   bool _started = false;
@@ -129,12 +205,34 @@ class ESP3DGCodeHostService : public ESP3DClient {
   ESP3DClientType _outputClient = ESP3DClientType::no_client;
   bool _awaitingAck = false;
   uint64_t _startTimeout = 0;
+  uint64_t _command_sent_time = 0;
+  uint32_t _acked_lines = 0;
+  uint32_t _ack_latency = 0;
+  uint64_t _last_ack_time = 0;
+  ESP3DLinkQuality _link;
+  // printer sends ok for the rejected line after a resend request
+  bool _resend_ok_pending = false;
+
+  // look-ahead analysis of main stream, lines are analyzed once even if
+  // read again after a pause
+  ESP3DGcodeAnalyzer _analyzer;
+  uint64_t _analyzed_pos = 0;
+  // set by other tasks, only read by host task
+  volatile uint32_t _pause_layer = 0;
+  volatile bool _pause_travel = false;
+#if ESP3D_TFT_BENCHMARK
+  int64_t _analyzer_time = 0;
+#endif  // ESP3D_TFT_BENCHMARK
 
   ESP3DGcodeStreamState _requested_state = ESP3DGcodeStreamState::undefined;
   std::list<ESP3DGcodeStream *> _scripts;
   std::list<ESP3DGcodeStream *> _streams;
   ESP3DGcodeStream *_current_stream_ptr = nullptr;
   ESP3DGcodeStream *_current_main_stream_ptr = nullptr;
+  uint64_t _last_stream_id = 0;
+  // ring buffer of last ended streams, protected by _scripts_list_mutex
+  ESP3DGcodeStreamStatus _ended_streams[ESP3D_STREAM_HISTORY_SIZE];
+  uint8_t _ended_streams_index = 0;
 
   std::string _stop_script;
   std::string _pause_script;
@@ -152,7 +250,7 @@ class ESP3DGCodeHostService : public ESP3DClient {
           // as only one print stream is possible
   uint64_t _resend_command_number = 0;  // Requested command to resend.
   uint8_t _resend_command_counter =
-      0;  // Number of times the resend command has been requested
+      0;  // Number of times in a row the resend command has been requested
   pthread_mutex_t _tx_mutex;
   pthread_mutex_t _rx_mutex;
   pthread_mutex_t _streams_list_mutex;
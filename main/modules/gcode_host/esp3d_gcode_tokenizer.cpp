@@ -0,0 +1,388 @@
+/*
+  esp3d_gcode_tokenizer
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "esp3d_gcode_tokenizer.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "esp3d_commands.h"
+#include "esp3d_hal.h"
+#include "esp3d_log.h"
+#include "filesystem/esp3d_globalfs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "tasks_def.h"
+
+#if ESP3D_TFT_BENCHMARK
+#include "esp_timer.h"
+#endif  // ESP3D_TFT_BENCHMARK
+
+#define MAX_COMMAND_LENGTH 255
+#define TOKENS_INDEX_EXTENSION ".tmp"
+// tokenization runs in its own task, at low priority like SD space scan
+#define ESP3D_TOKENIZER_TASK_SIZE 6144
+#define ESP3D_TOKENIZER_TASK_PRIORITY 0
+#define ESP3D_TOKENIZER_TASK_CORE tskNO_AFFINITY
+
+// state of background build, running flag and file name are only changed
+// with mutex locked, as ESP703 can come from several tasks at once
+static pthread_mutex_t build_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool build_running = false;
+static volatile uint8_t build_progress = 0;
+static std::string build_filename;
+
+std::string ESP3DGcodeTokenizer::getTokensFilename(const char *filename) {
+  std::string tokens_filename = filename;
+  tokens_filename += ESP3D_GCODE_TOKENS_EXTENSION;
+  return tokens_filename;
+}
+
+// Write one line as record, same processing as the host does for each line:
+// esp command are kept as is, gcode comments are stripped
+static bool write_record(FILE *fd, char *line, size_t length,
+                         uint32_t *data_size, uint32_t *lines_count) {
+  // trim
+  while (length > 0 && (line[length - 1] == ' ' || line[length - 1] == '\t')) {
+    length--;
+  }
+  while (length > 0 && (line[0] == ' ' || line[0] == '\t')) {
+    line++;
+    length--;
+  }
+  if (length == 0) {
+    return true;
+  }
+  uint8_t flags = 0;
+  if (esp3dCommands.is_esp_command((uint8_t *)line, length)) {
+    flags |= ESP3D_GCODE_TOKEN_ESP_COMMAND;
+  } else {
+    char *comment = (char *)memchr(line, ';', length);
+    if (comment) {
+      length = comment - line;
+      while (length > 0 &&
+             (line[length - 1] == ' ' || line[length - 1] == '\t')) {
+        length--;
+      }
+      if (length == 0) {
+        return true;
+      }
+    }
+  }
+  uint8_t record[2] = {flags, (uint8_t)length};
+  if (fwrite(&record, 1, sizeof(record), fd) != sizeof(record) ||
+      fwrite(line, 1, length, fd) != length) {
+    esp3d_log_e("Failed to write record");
+    return false;
+  }
+  *data_size += sizeof(record) + length;
+  (*lines_count)++;
+  return true;
+}
+
+// Offset of each record, read back from tokens file
+static bool write_index(FILE *fd, FILE *index_fd, uint32_t data_size) {
+  char buffer[STREAM_CHUNK_SIZE];
+  size_t read_size = 0;
+  uint32_t position = 0;
+  uint32_t skip = 0;
+  uint8_t record_bytes = 0;
+  if (fseek(fd, sizeof(ESP3DGcodeTokensHeader), SEEK_SET) != 0) {
+    return false;
+  }
+  while ((read_size = fread(buffer, 1, sizeof(buffer), fd)) > 0) {
+    size_t i = 0;
+    while (i < read_size) {
+      if (skip > 0) {
+        size_t count = skip < read_size - i ? skip : read_size - i;
+        i += count;
+        skip -= count;
+        position += count;
+        continue;
+      }
+      // flags byte starts a record
+      if (record_bytes == 0 &&
+          fwrite(&position, 1, sizeof(uint32_t), index_fd) !=
+              sizeof(uint32_t)) {
+        return false;
+      }
+      record_bytes++;
+      position++;
+      if (record_bytes == 2) {
+        skip = (uint8_t)buffer[i];
+        record_bytes = 0;
+      }
+      i++;
+    }
+  }
+  return position == data_size && skip == 0 && record_bytes == 0;
+}
+
+static bool append_file(FILE *fd, FILE *source_fd) {
+  char buffer[STREAM_CHUNK_SIZE];
+  size_t read_size = 0;
+  while ((read_size = fread(buffer, 1, sizeof(buffer), source_fd)) > 0) {
+    if (fwrite(buffer, 1, read_size, fd) != read_size) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// SPI SD is mounted with 2 files max, so no more than 2 files are open:
+// records are written from source, then their offsets are read back from
+// tokens file to index file, then index is appended to tokens. So index is
+// never kept in memory
+bool ESP3DGcodeTokenizer::build(const char *filename, uint8_t *progress) {
+  struct stat source_stat;
+  if (globalFs.stat(filename, &source_stat) == -1 ||
+      !S_ISREG(source_stat.st_mode)) {
+    esp3d_log_e("Cannot stat %s", filename);
+    return false;
+  }
+  std::string tokens_filename = getTokensFilename(filename);
+  std::string index_filename = tokens_filename + TOKENS_INDEX_EXTENSION;
+  FILE *source_fd = globalFs.open(filename, "r");
+  if (!source_fd) {
+    esp3d_log_e("Cannot open %s", filename);
+    return false;
+  }
+  FILE *fd = globalFs.open(tokens_filename.c_str(), "w");
+  if (!fd) {
+    esp3d_log_e("Cannot create %s", tokens_filename.c_str());
+    globalFs.close(source_fd, filename);
+    return false;
+  }
+  // header is invalid until the end
+  ESP3DGcodeTokensHeader header;
+  memset(&header, 0, sizeof(header));
+  bool res = fwrite(&header, 1, sizeof(header), fd) == sizeof(header);
+  char buffer[STREAM_CHUNK_SIZE];
+  char line[MAX_COMMAND_LENGTH + 1];
+  size_t line_length = 0;
+  size_t read_size = 0;
+  uint64_t source_pos = 0;
+  uint32_t data_size = 0;
+  uint32_t lines_count = 0;
+#if ESP3D_TFT_BENCHMARK
+  int64_t start_time = esp_timer_get_time();
+#endif  // ESP3D_TFT_BENCHMARK
+  while (res &&
+         (read_size = fread(buffer, 1, sizeof(buffer), source_fd)) > 0) {
+    for (size_t i = 0; i < read_size && res; i++) {
+      if (buffer[i] == '\n' || buffer[i] == '\r') {
+        res = write_record(fd, line, line_length, &data_size, &lines_count);
+        line_length = 0;
+      } else if (line_length < MAX_COMMAND_LENGTH) {
+        line[line_length++] = buffer[i];
+      } else {
+        esp3d_log_e("Line %ld is too long", lines_count + 1);
+        res = false;
+      }
+    }
+    source_pos += read_size;
+    // index and append are less than 10% of the work
+    if (progress && source_stat.st_size > 0) {
+      *progress = (uint8_t)(90 * source_pos / source_stat.st_size);
+    }
+    esp3d_hal::wait(0);
+  }
+  if (res && line_length > 0) {
+    res = write_record(fd, line, line_length, &data_size, &lines_count);
+  }
+  globalFs.close(source_fd, filename);
+  globalFs.close(fd, tokens_filename.c_str());
+  fd = nullptr;
+  // offsets of records
+  FILE *index_fd = nullptr;
+  if (res) {
+    fd = globalFs.open(tokens_filename.c_str(), "r");
+    index_fd = globalFs.open(index_filename.c_str(), "w");
+    res = fd && index_fd && write_index(fd, index_fd, data_size);
+    if (fd) {
+      globalFs.close(fd, tokens_filename.c_str());
+      fd = nullptr;
+    }
+    if (index_fd) {
+      globalFs.close(index_fd, index_filename.c_str());
+      index_fd = nullptr;
+    }
+  }
+  // append index, then header can be validated
+  if (res) {
+    fd = globalFs.open(tokens_filename.c_str(), "r+");
+    index_fd = globalFs.open(index_filename.c_str(), "r");
+    res = fd && index_fd && fseek(fd, 0, SEEK_END) == 0 &&
+          append_file(fd, index_fd);
+  }
+  if (res) {
+    memcpy(header.magic, ESP3D_GCODE_TOKENS_MAGIC, 4);
+    header.version = ESP3D_GCODE_TOKENS_VERSION;
+    header.source_size = source_stat.st_size;
+    header.source_mtime = source_stat.st_mtime;
+    header.lines_count = lines_count;
+    header.data_size = data_size;
+    res = fseek(fd, 0, SEEK_SET) == 0 &&
+          fwrite(&header, 1, sizeof(header), fd) == sizeof(header);
+  }
+  if (index_fd) {
+    globalFs.close(index_fd, index_filename.c_str());
+  }
+  if (fd) {
+    globalFs.close(fd, tokens_filename.c_str());
+  }
+  globalFs.remove(index_filename.c_str());
+  if (!res) {
+    esp3d_log_e("Failed to tokenize %s", filename);
+    globalFs.remove(tokens_filename.c_str());
+    return false;
+  }
+  if (progress) {
+    *progress = 100;
+  }
+#if ESP3D_TFT_BENCHMARK
+  esp3d_report("Tokenized %s: %ld lines, %ld bytes in %lld ms", filename,
+               lines_count, data_size,
+               (esp_timer_get_time() - start_time) / 1000);
+#endif  // ESP3D_TFT_BENCHMARK
+  esp3d_log("Tokenized %s: %ld lines, %ld bytes", filename, lines_count,
+            data_size);
+  return true;
+}
+
+static void build_task(void *arg) {
+  (void)arg;
+  bool res = ESP3DGcodeTokenizer::build(build_filename.c_str(),
+                                        (uint8_t *)&build_progress);
+  globalFs.releaseFS(build_filename.c_str());
+  std::string text = res ? "Tokenized: " : "Tokenization failed: ";
+  text += build_filename;
+  ESP3DRequest requestId = {.id = 0};
+  // system origin so printer does not get it
+  esp3dCommands.dispatch(text.c_str(), ESP3DClientType::all_clients, requestId,
+                         ESP3DMessageType::unique, ESP3DClientType::system,
+                         ESP3DAuthenticationLevel::admin);
+  pthread_mutex_lock(&build_mutex);
+  build_running = false;
+  pthread_mutex_unlock(&build_mutex);
+  vTaskDelete(NULL);
+}
+
+bool ESP3DGcodeTokenizer::startBuild(const char *filename) {
+  pthread_mutex_lock(&build_mutex);
+  bool running = build_running;
+  if (!running) {
+    build_running = true;
+    build_filename = filename;
+    build_progress = 0;
+  }
+  pthread_mutex_unlock(&build_mutex);
+  if (running) {
+    esp3d_log_e("A file is already tokenized");
+    return false;
+  }
+  TaskHandle_t xHandle = NULL;
+  BaseType_t res = xTaskCreatePinnedToCore(
+      build_task, "tokenizerTask", ESP3D_TOKENIZER_TASK_SIZE, NULL,
+      ESP3D_TOKENIZER_TASK_PRIORITY, &xHandle, ESP3D_TOKENIZER_TASK_CORE);
+  if (res != pdPASS || !xHandle) {
+    esp3d_log_e("Tokenizer task creation failed");
+    pthread_mutex_lock(&build_mutex);
+    build_running = false;
+    pthread_mutex_unlock(&build_mutex);
+    return false;
+  }
+  return true;
+}
+
+bool ESP3DGcodeTokenizer::isBuilding() {
+  pthread_mutex_lock(&build_mutex);
+  bool running = build_running;
+  pthread_mutex_unlock(&build_mutex);
+  return running;
+}
+
+bool ESP3DGcodeTokenizer::getBuildStatus(std::string *filename,
+                                         uint8_t *progress) {
+  pthread_mutex_lock(&build_mutex);
+  bool running = build_running;
+  if (running) {
+    *filename = build_filename;
+    *progress = build_progress;
+  }
+  pthread_mutex_unlock(&build_mutex);
+  return running;
+}
+
+// Sidecar is valid only if G-code file did not change since it was built
+bool ESP3DGcodeTokenizer::isValid(const char *filename,
+                                  ESP3DGcodeTokensHeader *header) {
+  struct stat source_stat;
+  struct stat tokens_stat;
+  std::string tokens_filename = getTokensFilename(filename);
+  if (globalFs.stat(tokens_filename.c_str(), &tokens_stat) == -1 ||
+      globalFs.stat(filename, &source_stat) == -1) {
+    return false;
+  }
+  ESP3DGcodeTokensHeader tokens_header;
+  FILE *fd = globalFs.open(tokens_filename.c_str(), "r");
+  if (!fd) {
+    return false;
+  }
+  bool res = fread(&tokens_header, 1, sizeof(tokens_header), fd) ==
+             sizeof(tokens_header);
+  globalFs.close(fd, tokens_filename.c_str());
+  res = res &&
+        memcmp(tokens_header.magic, ESP3D_GCODE_TOKENS_MAGIC, 4) == 0 &&
+        tokens_header.version == ESP3D_GCODE_TOKENS_VERSION &&
+        tokens_header.source_size == (uint32_t)source_stat.st_size &&
+        tokens_header.source_mtime == (uint32_t)source_stat.st_mtime &&
+        tokens_stat.st_size ==
+            (off_t)(sizeof(tokens_header) + tokens_header.data_size +
+                    tokens_header.lines_count * sizeof(uint32_t));
+  if (!res) {
+    esp3d_log_w("Tokens file of %s is outdated", filename);
+    return false;
+  }
+  if (header) {
+    *header = tokens_header;
+  }
+  return true;
+}
+
+// Position of line record (line starts at 1), file position is restored
+bool ESP3DGcodeTokenizer::getLineOffset(FILE *fd,
+                                        const ESP3DGcodeTokensHeader &header,
+                                        uint32_t line, uint32_t *offset) {
+  if (line == 0 || line > header.lines_count) {
+    esp3d_log_e("Line %ld is out of range", line);
+    return false;
+  }
+  long position = ftell(fd);
+  long index_position = sizeof(header) + header.data_size +
+                        (line - 1) * sizeof(uint32_t);
+  bool res = fseek(fd, index_position, SEEK_SET) == 0 &&
+             fread(offset, 1, sizeof(uint32_t), fd) == sizeof(uint32_t);
+  if (fseek(fd, position, SEEK_SET) != 0) {
+    res = false;
+  }
+  return res && *offset < header.data_size;
+}
@@ -0,0 +1,74 @@
+/*
+  esp3d_gcode_tokenizer
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Sidecar file of a tokenized G-code file: <file name>.gct
+// Layout (little endian):
+// - header
+// - line records: uint8_t flags, uint8_t length, char command[length]
+//   command is trimmed, comments are stripped, no end of line
+// - offsets table: uint32_t offsets[lines_count], position of each record
+//   from the start of the records
+#define ESP3D_GCODE_TOKENS_EXTENSION ".gct"
+#define ESP3D_GCODE_TOKENS_MAGIC "EGCT"
+#define ESP3D_GCODE_TOKENS_VERSION 1
+// record flags
+#define ESP3D_GCODE_TOKEN_ESP_COMMAND 0x01
+
+struct ESP3DGcodeTokensHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t reserved;
+  uint32_t source_size;   // size of the G-code file when tokenized
+  uint32_t source_mtime;  // last modification time of the G-code file
+  uint32_t lines_count;   // number of records
+  uint32_t data_size;     // size of the records
+};
+
+class ESP3DGcodeTokenizer final {
+ public:
+  static std::string getTokensFilename(const char *filename);
+  // File system must be accessed by caller for these functions
+  static bool build(const char *filename, uint8_t *progress = nullptr);
+  static bool isValid(const char *filename,
+                      ESP3DGcodeTokensHeader *header = nullptr);
+  static bool getLineOffset(FILE *fd, const ESP3DGcodeTokensHeader &header,
+                            uint32_t line, uint32_t *offset);
+  // Build in a task so caller is not blocked, one file at a time. File
+  // system must be accessed by caller, it is released by the task when done
+  // and result is sent to all clients
+  static bool startBuild(const char *filename);
+  static bool isBuilding();
+  // false if no build is running, progress is in percent
+  static bool getBuildStatus(std::string *filename, uint8_t *progress);
+};
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
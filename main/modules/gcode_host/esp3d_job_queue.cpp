@@ -0,0 +1,250 @@
+/*
+  esp3d_job_queue
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "esp3d_job_queue.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <iterator>
+
+#include "esp3d_log.h"
+#include "filesystem/esp3d_flash.h"
+
+// a job line is: auth level<TAB>file<TAB>start script<TAB>end script
+#define JOB_FIELD_SEPARATOR '\t'
+// sanity check of queue file
+#define JOB_QUEUE_FILE_MAX_SIZE 8192
+
+ESP3DJobQueue esp3dJobQueue;
+
+ESP3DJobQueue::ESP3DJobQueue() {
+  _running = false;
+  _started = false;
+}
+
+ESP3DJobQueue::~ESP3DJobQueue() { end(); }
+
+bool ESP3DJobQueue::begin() {
+  end();
+  if (pthread_mutex_init(&_mutex, NULL) != 0) {
+    esp3d_log_e("Mutex creation for job queue failed");
+    return false;
+  }
+  _started = true;
+  if (!_load()) {
+    esp3d_log_w("No job queue loaded");
+  }
+  return true;
+}
+
+void ESP3DJobQueue::end() {
+  if (!_started) {
+    return;
+  }
+  _started = false;
+  _running = false;
+  _jobs.clear();
+  pthread_mutex_destroy(&_mutex);
+}
+
+bool ESP3DJobQueue::isValidField(const std::string &field) {
+  return field.find(JOB_FIELD_SEPARATOR) == std::string::npos &&
+         field.find('\n') == std::string::npos &&
+         field.find('\r') == std::string::npos;
+}
+
+bool ESP3DJobQueue::add(const ESP3DJob &job) {
+  if (!_started || job.filename.length() == 0 ||
+      !isValidField(job.filename) || !isValidField(job.start_script) ||
+      !isValidField(job.end_script)) {
+    esp3d_log_e("Invalid job");
+    return false;
+  }
+  bool res = false;
+  if (pthread_mutex_lock(&_mutex) == 0) {
+    if (_jobs.size() < ESP3D_JOB_QUEUE_MAX_SIZE) {
+      _jobs.push_back(job);
+      res = _save();
+    } else {
+      esp3d_log_e("Job queue is full");
+    }
+    pthread_mutex_unlock(&_mutex);
+  }
+  return res;
+}
+
+bool ESP3DJobQueue::remove(size_t index) {
+  bool res = false;
+  if (_started && pthread_mutex_lock(&_mutex) == 0) {
+    if (index < _jobs.size()) {
+      std::list<ESP3DJob>::iterator it = _jobs.begin();
+      std::advance(it, index);
+      _jobs.erase(it);
+      res = _save();
+    }
+    pthread_mutex_unlock(&_mutex);
+  }
+  return res;
+}
+
+bool ESP3DJobQueue::clear() {
+  bool res = false;
+  if (_started && pthread_mutex_lock(&_mutex) == 0) {
+    _jobs.clear();
+    res = _save();
+    pthread_mutex_unlock(&_mutex);
+  }
+  return res;
+}
+
+size_t ESP3DJobQueue::size() {
+  size_t res = 0;
+  if (_started && pthread_mutex_lock(&_mutex) == 0) {
+    res = _jobs.size();
+    pthread_mutex_unlock(&_mutex);
+  }
+  return res;
+}
+
+bool ESP3DJobQueue::get(size_t index, ESP3DJob *job) {
+  bool res = false;
+  if (_started && pthread_mutex_lock(&_mutex) == 0) {
+    if (index < _jobs.size()) {
+      std::list<ESP3DJob>::iterator it = _jobs.begin();
+      std::advance(it, index);
+      *job = *it;
+      res = true;
+    }
+    pthread_mutex_unlock(&_mutex);
+  }
+  return res;
+}
+
+bool ESP3DJobQueue::popFront(ESP3DJob *job) {
+  bool res = false;
+  if (_started && pthread_mutex_lock(&_mutex) == 0) {
+    if (!_jobs.empty()) {
+      *job = _jobs.front();
+      _jobs.pop_front();
+      // job is taken even if saving failed, it is only printed once
+      if (!_save()) {
+        esp3d_log_e("Failed to save job queue");
+      }
+      res = true;
+    }
+    pthread_mutex_unlock(&_mutex);
+  }
+  return res;
+}
+
+// Called with mutex locked
+bool ESP3DJobQueue::_save() {
+  if (!flashFs.accessFS()) {
+    esp3d_log_e("Cannot access flash to save job queue");
+    return false;
+  }
+  bool res = false;
+  if (_jobs.empty()) {
+    res = !flashFs.exists(ESP3D_JOB_QUEUE_FILE) ||
+          flashFs.remove(ESP3D_JOB_QUEUE_FILE);
+  } else {
+    FILE *fd = flashFs.open(ESP3D_JOB_QUEUE_FILE, "w");
+    if (fd) {
+      res = true;
+      for (const ESP3DJob &job : _jobs) {
+        if (fprintf(fd, "%d%c%s%c%s%c%s\n", static_cast<int>(job.auth_type),
+                    JOB_FIELD_SEPARATOR, job.filename.c_str(),
+                    JOB_FIELD_SEPARATOR, job.start_script.c_str(),
+                    JOB_FIELD_SEPARATOR, job.end_script.c_str()) < 0) {
+          res = false;
+          break;
+        }
+      }
+      flashFs.close(fd);
+    }
+  }
+  flashFs.releaseFS();
+  if (!res) {
+    esp3d_log_e("Failed to save job queue");
+  }
+  return res;
+}
+
+bool ESP3DJobQueue::_load() {
+  if (!flashFs.accessFS()) {
+    esp3d_log_e("Cannot access flash to load job queue");
+    return false;
+  }
+  struct stat entry_stat;
+  std::string content;
+  FILE *fd = nullptr;
+  if (flashFs.stat(ESP3D_JOB_QUEUE_FILE, &entry_stat) == 0 &&
+      entry_stat.st_size > 0 &&
+      entry_stat.st_size <= JOB_QUEUE_FILE_MAX_SIZE) {
+    fd = flashFs.open(ESP3D_JOB_QUEUE_FILE, "r");
+  }
+  if (fd) {
+    content.resize(entry_stat.st_size);
+    content.resize(fread(&content[0], 1, entry_stat.st_size, fd));
+    flashFs.close(fd);
+  }
+  flashFs.releaseFS();
+  if (content.length() == 0) {
+    return false;
+  }
+  size_t start = 0;
+  while (start < content.length() &&
+         _jobs.size() < ESP3D_JOB_QUEUE_MAX_SIZE) {
+    size_t end = content.find('\n', start);
+    if (end == std::string::npos) {
+      end = content.length();
+    }
+    std::string line = content.substr(start, end - start);
+    start = end + 1;
+    std::string fields[4];
+    size_t pos = 0;
+    uint8_t count = 0;
+    for (; count < 4; count++) {
+      size_t next = line.find(JOB_FIELD_SEPARATOR, pos);
+      fields[count] = line.substr(pos, next - pos);
+      if (next == std::string::npos) {
+        count++;
+        break;
+      }
+      pos = next + 1;
+    }
+    int level = atoi(fields[0].c_str());
+    if (count != 4 || fields[1].length() == 0 || level < 0 ||
+        level > static_cast<int>(ESP3DAuthenticationLevel::admin)) {
+      esp3d_log_w("Invalid job line skipped: %s", line.c_str());
+      continue;
+    }
+    ESP3DJob job;
+    job.auth_type = static_cast<ESP3DAuthenticationLevel>(level);
+    job.filename = fields[1];
+    job.start_script = fields[2];
+    job.end_script = fields[3];
+    _jobs.push_back(job);
+  }
+  esp3d_log("Job queue loaded: %d jobs", _jobs.size());
+  return true;
+}
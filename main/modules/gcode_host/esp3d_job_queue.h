@@ -0,0 +1,84 @@
+/*
+  esp3d_job_queue
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <list>
+#include <string>
+
+#include "authentication/esp3d_authentication_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Queue is saved on flash file system, one job per line
+#define ESP3D_JOB_QUEUE_FILE "/jobqueue.txt"
+#define ESP3D_JOB_QUEUE_MAX_SIZE 20
+
+// Scripts use same format as ESP702 scripts: commands separated by ';' or
+// a file name, they are run before and after the file
+struct ESP3DJob {
+  std::string filename;
+  std::string start_script;
+  std::string end_script;
+  ESP3DAuthenticationLevel auth_type = ESP3DAuthenticationLevel::guest;
+};
+
+// Files to print one after the other, shared between commands and gcode host
+// task. Queue content survives a restart but running state does not, so a
+// reboot never starts a print on its own.
+class ESP3DJobQueue final {
+ public:
+  ESP3DJobQueue();
+  ~ESP3DJobQueue();
+  bool begin();
+  void end();
+  bool add(const ESP3DJob &job);
+  bool remove(size_t index);
+  bool clear();
+  size_t size();
+  // copy of job at index, queue is not changed
+  bool get(size_t index, ESP3DJob *job);
+  // take first job out of queue
+  bool popFront(ESP3DJob *job);
+  void start() { _running = true; }
+  void stop() { _running = false; }
+  bool isRunning() { return _running; }
+  // field of a job cannot contain separators of queue file
+  static bool isValidField(const std::string &field);
+
+ private:
+  bool _load();
+  bool _save();
+  std::list<ESP3DJob> _jobs;
+  volatile bool _running;
+  bool _started;
+  pthread_mutex_t _mutex;
+};
+
+extern ESP3DJobQueue esp3dJobQueue;
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
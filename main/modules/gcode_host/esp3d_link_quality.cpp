@@ -0,0 +1,104 @@
+/*
+  esp3d_link_quality
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "esp3d_link_quality.h"
+
+#include "esp3d_log.h"
+
+// Delay between lines in ms for each backoff level
+static const uint8_t line_spacing[ESP3D_LINK_QUALITY_MAX_LEVEL + 1] = {
+    0, 1, 2, 5, 10, 20};
+
+ESP3DLinkQuality::ESP3DLinkQuality() {
+  _rx_overflows_total = 0;
+  _level = 0;
+  reset();
+}
+
+void ESP3DLinkQuality::reset() {
+  _stats = ESP3DLinkQualityStats();
+  _rx_overflows_base = _rx_overflows_total;
+  _window_lines = 0;
+  _window_errors = 0;
+}
+
+void ESP3DLinkQuality::lineSent() {
+  _window_lines++;
+  if (_window_lines < ESP3D_LINK_QUALITY_WINDOW) {
+    return;
+  }
+  // a whole window without error, link can go faster
+  if (_window_errors == 0 && _level > 0) {
+    _level--;
+    esp3d_log("Link is clean, backoff level %d", _level);
+  }
+  _window_lines = 0;
+  _window_errors = 0;
+}
+
+void ESP3DLinkQuality::lineAcked(uint32_t latency) {
+  _stats.lines++;
+  // smoothed on last 8 commands
+  _stats.ack_latency = (_stats.ack_latency * 7 + latency) / 8;
+}
+
+void ESP3DLinkQuality::resend() {
+  _stats.resends++;
+  _addError();
+}
+
+void ESP3DLinkQuality::error(bool checksum) {
+  _stats.errors++;
+  if (checksum) {
+    _stats.checksum_errors++;
+  }
+  // a resend request follows a line error, it is counted there
+}
+
+void ESP3DLinkQuality::timeout() {
+  _stats.timeouts++;
+  _addError();
+}
+
+void ESP3DLinkQuality::setRxOverflows(uint32_t total) {
+  if (total == _rx_overflows_total) {
+    return;
+  }
+  _rx_overflows_total = total;
+  _stats.rx_overflows = total - _rx_overflows_base;
+  _addError();
+}
+
+uint32_t ESP3DLinkQuality::getSpacing() { return line_spacing[_level]; }
+
+// Step up as soon as window has too many errors, no need to wait for its end
+// during a storm
+void ESP3DLinkQuality::_addError() {
+  _window_errors++;
+  if (_window_errors < ESP3D_LINK_QUALITY_MAX_ERRORS) {
+    return;
+  }
+  if (_level < ESP3D_LINK_QUALITY_MAX_LEVEL) {
+    _level++;
+    esp3d_log_w("Link errors are climbing, backoff level %d", _level);
+  }
+  _window_lines = 0;
+  _window_errors = 0;
+}
@@ -0,0 +1,79 @@
+/*
+  esp3d_link_quality
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number of sent lines a backoff decision is taken on
+#define ESP3D_LINK_QUALITY_WINDOW 100
+// Errors in a window to step up backoff, a clean window steps it down
+#define ESP3D_LINK_QUALITY_MAX_ERRORS 3
+// Highest backoff level, see line spacing table
+#define ESP3D_LINK_QUALITY_MAX_LEVEL 5
+
+// Counters of a session, since connection or main stream start
+struct ESP3DLinkQualityStats {
+  uint32_t lines = 0;         // acked lines
+  uint32_t resends = 0;       // resend requests from printer
+  uint32_t errors = 0;        // line errors from printer, checksum included
+  uint32_t checksum_errors = 0;
+  uint32_t timeouts = 0;      // ack never came
+  uint32_t rx_overflows = 0;  // received data lost by output client
+  uint32_t ack_latency = 0;   // smoothed, ms
+};
+
+// Follow errors of the link with printer and slow down sending when they
+// climb: each backoff level adds a delay between lines, so printer has time
+// to empty its buffer and line noise has less chance to hit a line
+class ESP3DLinkQuality final {
+ public:
+  ESP3DLinkQuality();
+  // backoff level is kept as it is a property of the link, not the session
+  void reset();
+  void lineSent();
+  void lineAcked(uint32_t latency);
+  void resend();
+  void error(bool checksum);
+  void timeout();
+  // total count of output client, only the increase since reset is counted
+  void setRxOverflows(uint32_t total);
+  // delay to wait between lines in ms
+  uint32_t getSpacing();
+  uint8_t getLevel() { return _level; }
+  const ESP3DLinkQualityStats &getStats() { return _stats; }
+
+ private:
+  void _addError();
+  ESP3DLinkQualityStats _stats;
+  uint32_t _rx_overflows_base;
+  uint32_t _rx_overflows_total;
+  uint32_t _window_lines;
+  uint32_t _window_errors;
+  uint8_t _level;
+};
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
@@ -23,8 +23,10 @@
 #include <string>
 
 #include "esp3d_commands.h"
-#include "esp3d_log.h"
+#include "esp3d_events.h"
 #include "esp3d_hal.h"
+#include "esp3d_log.h"
+#include "esp3d_scheduling.h"
 #include "esp_freertos_hooks.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
@@ -39,6 +41,8 @@
 #define STACKDEPTH STREAM_STACK_DEPTH
 #define TASKPRIORITY STREAM_TASK_PRIORITY
 #define TASKCORE STREAM_TASK_CORE
+// Queues notify the task, timeout is only a safety net
+#define STREAM_IDLE_TIMEOUT 100  // milliseconds
 
 /**********************
  *  STATIC PROTOTYPES
@@ -61,13 +65,14 @@ static void streamTask(void *pvParameter) {
   }
   esp3d_hal::wait(100);
   while (1) {
-    /* Delay */
-
     if (pdTRUE == xSemaphoreTake(xStreamSemaphore, portMAX_DELAY)) {
       esp3dTftstream.handle();
       xSemaphoreGive(xStreamSemaphore);
     }
-    esp3d_hal::wait(10);
+    /* Wait for event only if nothing left in queues */
+    if (!esp3dTftstream.hasPendingData()) {
+      esp3dEvents.wait(ESP3DEventConsumer::stream, STREAM_IDLE_TIMEOUT);
+    }
   }
 
   /* A task should NEVER return */
@@ -90,11 +95,13 @@ ESP3DTargetFirmware ESP3DTftStream::getTargetFirmware(bool fromSettings) {
 bool ESP3DTftStream::begin() {
   // Task creation
   TaskHandle_t xHandle = NULL;
-  BaseType_t res =
-      xTaskCreatePinnedToCore(streamTask, "tftStream", STACKDEPTH, NULL,
-                              TASKPRIORITY, &xHandle, TASKCORE);
+  BaseType_t res = xTaskCreatePinnedToCore(
+      streamTask, "tftStream", STACKDEPTH, NULL,
+      esp3dScheduling.getPriority(ESP3DTaskRole::stream, TASKPRIORITY),
+      &xHandle, esp3dScheduling.getCore(ESP3DTaskRole::stream, TASKCORE));
   if (res == pdPASS && xHandle) {
     esp3d_log("Created Stream Task");
+    esp3dScheduling.registerTask(ESP3DTaskRole::stream, xHandle, TASKPRIORITY);
     // to let buffer time to empty
 #if ESP3D_TFT_LOG
     esp3d_hal::wait(100);
@@ -135,6 +142,19 @@ void ESP3DTftStream::handle() {
 #endif  // ESP3D_USB_SERIAL_FEATURE
 }
 
+bool ESP3DTftStream::hasPendingData() {
+  if (serialClient.getRxMsgsCount() > 0 || serialClient.getTxMsgsCount() > 0) {
+    return true;
+  }
+#if ESP3D_USB_SERIAL_FEATURE
+  if (usbSerialClient.getRxMsgsCount() > 0 ||
+      usbSerialClient.getTxMsgsCount() > 0) {
+    return true;
+  }
+#endif  // ESP3D_USB_SERIAL_FEATURE
+  return false;
+}
+
 bool ESP3DTftStream::end() {
   // TODO: need code review
   // this part is never called
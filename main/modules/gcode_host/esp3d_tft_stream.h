@@ -33,6 +33,7 @@ class ESP3DTftStream final {
   ~ESP3DTftStream();
   bool begin();
   void handle();
+  bool hasPendingData();
   bool end();
   ESP3DTargetFirmware getTargetFirmware(bool fromSettings = false);
 
@@ -0,0 +1,263 @@
+/*
+  esp3d_history
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "esp3d_history.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp3d_hal.h"
+#include "esp3d_log.h"
+#include "esp_heap_caps.h"
+
+#define HISTORY_CHANNELS static_cast<uint8_t>(ESP3DHistoryChannel::count)
+#define HISTORY_RESOLUTIONS static_cast<uint8_t>(ESP3DHistoryResolution::count)
+#define SHORT_TERM static_cast<uint8_t>(ESP3DHistoryResolution::short_term)
+#define LONG_TERM static_cast<uint8_t>(ESP3DHistoryResolution::long_term)
+
+ESP3DHistory esp3dHistory;
+
+const char *historyChannelNames[] = {"extruder0", "extruder1", "bed", "z"};
+
+const ESP3DHistorySample emptySample = {ESP3D_HISTORY_NO_VALUE,
+                                        ESP3D_HISTORY_NO_VALUE};
+
+ESP3DHistory::ESP3DHistory() {
+  _mutex = PTHREAD_MUTEX_INITIALIZER;
+  _buffer = nullptr;
+  clear();
+}
+
+ESP3DHistory::~ESP3DHistory() {
+  if (_buffer) {
+    free(_buffer);
+    _buffer = nullptr;
+  }
+}
+
+void ESP3DHistory::clear() {
+  pthread_mutex_lock(&_mutex);
+  _current_second = 0;
+  for (uint8_t r = 0; r < HISTORY_RESOLUTIONS; r++) {
+    _sequence[r] = 0;
+    for (uint8_t c = 0; c < HISTORY_CHANNELS; c++) {
+      _pending[r][c] = emptySample;
+    }
+  }
+  for (uint8_t c = 0; c < HISTORY_CHANNELS; c++) {
+    _last_value[c] = ESP3D_HISTORY_NO_VALUE;
+    _last_update[c] = 0;
+  }
+  pthread_mutex_unlock(&_mutex);
+}
+
+uint32_t ESP3DHistory::getPeriod(ESP3DHistoryResolution resolution) {
+  return resolution == ESP3DHistoryResolution::long_term
+             ? ESP3D_HISTORY_LONG_PERIOD
+             : ESP3D_HISTORY_SHORT_PERIOD;
+}
+
+uint32_t ESP3DHistory::getSize(ESP3DHistoryResolution resolution) {
+  return resolution == ESP3DHistoryResolution::long_term
+             ? ESP3D_HISTORY_LONG_SIZE
+             : ESP3D_HISTORY_SHORT_SIZE;
+}
+
+const char *ESP3DHistory::getChannelName(ESP3DHistoryChannel channel) {
+  if (channel >= ESP3DHistoryChannel::count) {
+    return "";
+  }
+  return historyChannelNames[static_cast<uint8_t>(channel)];
+}
+
+bool ESP3DHistory::getChannel(const char *name, ESP3DHistoryChannel &channel) {
+  for (uint8_t c = 0; c < HISTORY_CHANNELS; c++) {
+    if (strcmp(name, historyChannelNames[c]) == 0) {
+      channel = static_cast<ESP3DHistoryChannel>(c);
+      return true;
+    }
+  }
+  return false;
+}
+
+// One block for all channels and resolutions, so memory used is known and
+// allocated only if some values are received
+bool ESP3DHistory::_allocate() {
+  if (_buffer) {
+    return true;
+  }
+  size_t size = HISTORY_CHANNELS *
+                (ESP3D_HISTORY_SHORT_SIZE + ESP3D_HISTORY_LONG_SIZE) *
+                sizeof(ESP3DHistorySample);
+  _buffer = (ESP3DHistorySample *)heap_caps_malloc_prefer(
+      size, 2, MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT);
+  if (!_buffer) {
+    esp3d_log_e("Cannot allocate %d bytes for history", size);
+    return false;
+  }
+  esp3d_log("History uses %d bytes", size);
+  return true;
+}
+
+ESP3DHistorySample *ESP3DHistory::_samples(uint8_t resolution,
+                                           uint8_t channel) {
+  if (resolution == SHORT_TERM) {
+    return _buffer + channel * ESP3D_HISTORY_SHORT_SIZE;
+  }
+  return _buffer + HISTORY_CHANNELS * ESP3D_HISTORY_SHORT_SIZE +
+         channel * ESP3D_HISTORY_LONG_SIZE;
+}
+
+void ESP3DHistory::_record(uint8_t resolution, uint8_t channel,
+                           const ESP3DHistorySample &sample) {
+  uint32_t size = getSize(static_cast<ESP3DHistoryResolution>(resolution));
+  _samples(resolution, channel)[_sequence[resolution] % size] = sample;
+}
+
+// Close all the seconds elapsed since last call, long term samples are the
+// min/max decimation of the short term ones
+void ESP3DHistory::_advance(uint32_t now) {
+  if (_current_second == 0 || now < _current_second) {
+    _current_second = now;
+    return;
+  }
+  // no need to fill more than the whole history
+  uint32_t max_gap = ESP3D_HISTORY_LONG_SIZE * ESP3D_HISTORY_LONG_PERIOD;
+  if (now - _current_second > max_gap) {
+    _current_second = now - max_gap;
+  }
+  while (_current_second < now) {
+    for (uint8_t c = 0; c < HISTORY_CHANNELS; c++) {
+      ESP3DHistorySample sample = _pending[SHORT_TERM][c];
+      if (sample.min == ESP3D_HISTORY_NO_VALUE &&
+          _last_value[c] != ESP3D_HISTORY_NO_VALUE &&
+          _current_second - _last_update[c] <= ESP3D_HISTORY_HOLD_TIME) {
+        sample.min = _last_value[c];
+        sample.max = _last_value[c];
+      }
+      _record(SHORT_TERM, c, sample);
+      _pending[SHORT_TERM][c] = emptySample;
+      if (sample.min != ESP3D_HISTORY_NO_VALUE) {
+        ESP3DHistorySample &decimated = _pending[LONG_TERM][c];
+        if (decimated.min == ESP3D_HISTORY_NO_VALUE ||
+            sample.min < decimated.min) {
+          decimated.min = sample.min;
+        }
+        if (decimated.max == ESP3D_HISTORY_NO_VALUE ||
+            sample.max > decimated.max) {
+          decimated.max = sample.max;
+        }
+      }
+    }
+    _sequence[SHORT_TERM]++;
+    if (_sequence[SHORT_TERM] % ESP3D_HISTORY_LONG_PERIOD == 0) {
+      for (uint8_t c = 0; c < HISTORY_CHANNELS; c++) {
+        _record(LONG_TERM, c, _pending[LONG_TERM][c]);
+        _pending[LONG_TERM][c] = emptySample;
+      }
+      _sequence[LONG_TERM]++;
+    }
+    _current_second++;
+  }
+}
+
+void ESP3DHistory::push(ESP3DHistoryChannel channel, const char *value) {
+  if (channel >= ESP3DHistoryChannel::count || value == nullptr) {
+    return;
+  }
+  // "#" and "?" are used for unavailable values
+  char *end = nullptr;
+  float fvalue = strtof(value, &end);
+  if (end == value) {
+    return;
+  }
+  long scaled = lroundf(fvalue * ESP3D_HISTORY_SCALE);
+  if (scaled > INT16_MAX) {
+    scaled = INT16_MAX;
+  } else if (scaled <= ESP3D_HISTORY_NO_VALUE) {
+    scaled = ESP3D_HISTORY_NO_VALUE + 1;
+  }
+  int16_t sample_value = (int16_t)scaled;
+  uint8_t c = static_cast<uint8_t>(channel);
+  pthread_mutex_lock(&_mutex);
+  if (_allocate()) {
+    uint32_t now = esp3d_hal::millis() / 1000;
+    _advance(now);
+    ESP3DHistorySample &sample = _pending[SHORT_TERM][c];
+    if (sample.min == ESP3D_HISTORY_NO_VALUE || sample_value < sample.min) {
+      sample.min = sample_value;
+    }
+    if (sample.max == ESP3D_HISTORY_NO_VALUE || sample_value > sample.max) {
+      sample.max = sample_value;
+    }
+    _last_value[c] = sample_value;
+    _last_update[c] = now;
+  }
+  pthread_mutex_unlock(&_mutex);
+}
+
+uint32_t ESP3DHistory::getSequence(ESP3DHistoryResolution resolution) {
+  if (resolution >= ESP3DHistoryResolution::count) {
+    return 0;
+  }
+  pthread_mutex_lock(&_mutex);
+  if (_buffer) {
+    _advance(esp3d_hal::millis() / 1000);
+  }
+  uint32_t sequence = _sequence[static_cast<uint8_t>(resolution)];
+  pthread_mutex_unlock(&_mutex);
+  return sequence;
+}
+
+uint32_t ESP3DHistory::getSamples(ESP3DHistoryChannel channel,
+                                  ESP3DHistoryResolution resolution,
+                                  uint32_t &from, ESP3DHistorySample *samples,
+                                  uint32_t max_count) {
+  if (channel >= ESP3DHistoryChannel::count ||
+      resolution >= ESP3DHistoryResolution::count || samples == nullptr) {
+    return 0;
+  }
+  uint32_t count = 0;
+  uint8_t r = static_cast<uint8_t>(resolution);
+  uint32_t size = getSize(resolution);
+  pthread_mutex_lock(&_mutex);
+  if (_buffer) {
+    // time goes on even if printer does not send anything
+    _advance(esp3d_hal::millis() / 1000);
+    uint32_t last = _sequence[r];
+    uint32_t oldest = last > size ? last - size : 0;
+    if (from < oldest || from > last) {
+      from = oldest;
+    }
+    count = last - from;
+    if (count > max_count) {
+      count = max_count;
+    }
+    const ESP3DHistorySample *buffer =
+        _samples(r, static_cast<uint8_t>(channel));
+    for (uint32_t i = 0; i < count; i++) {
+      samples[i] = buffer[(from + i) % size];
+    }
+    from += count;
+  }
+  pthread_mutex_unlock(&_mutex);
+  return count;
+}
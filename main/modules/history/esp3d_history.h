@@ -0,0 +1,104 @@
+/*
+  esp3d_history
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Short resolution: 1 sample per second for 10 minutes
+#define ESP3D_HISTORY_SHORT_PERIOD 1
+#define ESP3D_HISTORY_SHORT_SIZE 600
+// Long resolution: 1 sample per 10 seconds for 6 hours
+#define ESP3D_HISTORY_LONG_PERIOD 10
+#define ESP3D_HISTORY_LONG_SIZE 2160
+// Last value is repeated when no new value comes for up to this delay
+#define ESP3D_HISTORY_HOLD_TIME 5
+// Marker of a missing sample
+#define ESP3D_HISTORY_NO_VALUE INT16_MIN
+// Samples are stored in tenth of unit
+#define ESP3D_HISTORY_SCALE 10
+
+enum class ESP3DHistoryChannel : uint8_t {
+  ext_0_temperature = 0,
+  ext_1_temperature,
+  bed_temperature,
+  position_z,
+  count,
+};
+
+enum class ESP3DHistoryResolution : uint8_t {
+  short_term = 0,
+  long_term,
+  count,
+};
+
+// min and max of the values received during the sample period
+struct ESP3DHistorySample {
+  int16_t min;
+  int16_t max;
+};
+
+class ESP3DHistory final {
+ public:
+  ESP3DHistory();
+  ~ESP3DHistory();
+  // add a value received from printer, buffers are allocated on first value
+  void push(ESP3DHistoryChannel channel, const char *value);
+  // copy samples from sequence number `from`, oldest first, return number of
+  // copied samples and update `from` to the sequence of next sample
+  uint32_t getSamples(ESP3DHistoryChannel channel,
+                      ESP3DHistoryResolution resolution, uint32_t &from,
+                      ESP3DHistorySample *samples, uint32_t max_count);
+  // sequence number of next sample to be recorded
+  uint32_t getSequence(ESP3DHistoryResolution resolution);
+  uint32_t getPeriod(ESP3DHistoryResolution resolution);
+  uint32_t getSize(ESP3DHistoryResolution resolution);
+  const char *getChannelName(ESP3DHistoryChannel channel);
+  bool getChannel(const char *name, ESP3DHistoryChannel &channel);
+  void clear();
+
+ private:
+  bool _allocate();
+  void _advance(uint32_t now);
+  void _record(uint8_t resolution, uint8_t channel,
+               const ESP3DHistorySample &sample);
+  ESP3DHistorySample *_samples(uint8_t resolution, uint8_t channel);
+  pthread_mutex_t _mutex;
+  ESP3DHistorySample *_buffer;
+  uint32_t _sequence[static_cast<uint8_t>(ESP3DHistoryResolution::count)];
+  uint32_t _current_second;
+  // samples being accumulated for each resolution and channel
+  ESP3DHistorySample
+      _pending[static_cast<uint8_t>(ESP3DHistoryResolution::count)]
+              [static_cast<uint8_t>(ESP3DHistoryChannel::count)];
+  int16_t _last_value[static_cast<uint8_t>(ESP3DHistoryChannel::count)];
+  uint32_t _last_update[static_cast<uint8_t>(ESP3DHistoryChannel::count)];
+};
+
+extern ESP3DHistory esp3dHistory;
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
@@ -0,0 +1,339 @@
+/*
+  esp3d_deflate
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "esp3d_deflate.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp3d_log.h"
+#include "esp_rom_crc.h"
+
+// RFC 1951
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+#define END_OF_BLOCK 256
+#define WINDOW_MASK (ESP3D_DEFLATE_WINDOW_SIZE - 1)
+#define BUFFER_SIZE (2 * ESP3D_DEFLATE_WINDOW_SIZE)
+
+static const uint16_t length_base[] = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t length_extra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                       1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                       4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t distance_base[] = {
+    1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t distance_extra[] = {0, 0, 0,  0,  1,  1,  2,  2,
+                                         3, 3, 4,  4,  5,  5,  6,  6,
+                                         7, 7, 8,  8,  9,  9,  10, 10,
+                                         11, 11, 12, 12, 13, 13};
+// ID1 ID2 CM FLG MTIME(4) XFL OS(unknown)
+static const uint8_t gzip_header[] = {0x1f, 0x8b, 0x08, 0x00, 0x00,
+                                      0x00, 0x00, 0x00, 0x00, 0xff};
+
+static inline uint hash(const uint8_t *p) {
+  // each byte must reach the 10 bits of the hash
+  return ((p[0] << 6) ^ (p[1] << 3) ^ p[2]) & (ESP3D_DEFLATE_HASH_SIZE - 1);
+}
+
+ESP3DDeflate::ESP3DDeflate() {
+  _head = nullptr;
+  _prev = nullptr;
+  _buffer = nullptr;
+  _out = nullptr;
+  _output = nullptr;
+  _arg = nullptr;
+  _error = false;
+  _input_size = 0;
+  _output_size = 0;
+}
+
+ESP3DDeflate::~ESP3DDeflate() { _free(); }
+
+void ESP3DDeflate::_free() {
+  if (_head) {
+    free(_head);
+  }
+  _head = nullptr;
+  _prev = nullptr;
+  _buffer = nullptr;
+  _out = nullptr;
+}
+
+bool ESP3DDeflate::begin(ESP3DDeflateFormat format, ESP3DDeflateOutput output,
+                         void *arg) {
+  _free();
+  // one allocation for all, 16 bits arrays first for alignment
+  _head = (uint16_t *)malloc(ESP3D_DEFLATE_HASH_SIZE * sizeof(uint16_t) +
+                             ESP3D_DEFLATE_WINDOW_SIZE * sizeof(uint16_t) +
+                             BUFFER_SIZE + ESP3D_DEFLATE_OUTPUT_SIZE);
+  if (!_head) {
+    esp3d_log_e("Memory allocation failed");
+    return false;
+  }
+  _prev = _head + ESP3D_DEFLATE_HASH_SIZE;
+  _buffer = (uint8_t *)(_prev + ESP3D_DEFLATE_WINDOW_SIZE);
+  _out = _buffer + BUFFER_SIZE;
+  memset(_head, 0, ESP3D_DEFLATE_HASH_SIZE * sizeof(uint16_t));
+  memset(_prev, 0, ESP3D_DEFLATE_WINDOW_SIZE * sizeof(uint16_t));
+  _format = format;
+  _output = output;
+  _arg = arg;
+  _out_pos = 0;
+  _start = 0;
+  _end = 0;
+  _bits = 0;
+  _bit_count = 0;
+  _crc = 0;
+  _input_size = 0;
+  _output_size = 0;
+  _error = false;
+  if (_format == ESP3DDeflateFormat::gzip) {
+    memcpy(_out, gzip_header, sizeof(gzip_header));
+    _out_pos = sizeof(gzip_header);
+  }
+  // not final, fixed Huffman codes
+  _putBits(0, 1);
+  _putBits(1, 2);
+  return true;
+}
+
+bool ESP3DDeflate::write(const char *str) {
+  return write((const uint8_t *)str, str ? strlen(str) : 0);
+}
+
+bool ESP3DDeflate::write(const uint8_t *data, size_t len) {
+  if (!_buffer || _error) {
+    return false;
+  }
+  while (len > 0) {
+    if (_end == BUFFER_SIZE) {
+      // keep last window only, less than MAX_MATCH bytes are not compressed
+      // yet so they are in it
+      memmove(_buffer, _buffer + ESP3D_DEFLATE_WINDOW_SIZE,
+              _end - ESP3D_DEFLATE_WINDOW_SIZE);
+      _start -= ESP3D_DEFLATE_WINDOW_SIZE;
+      _end -= ESP3D_DEFLATE_WINDOW_SIZE;
+      for (uint i = 0; i < ESP3D_DEFLATE_HASH_SIZE; i++) {
+        _head[i] = _head[i] > ESP3D_DEFLATE_WINDOW_SIZE
+                       ? _head[i] - ESP3D_DEFLATE_WINDOW_SIZE
+                       : 0;
+      }
+      for (uint i = 0; i < ESP3D_DEFLATE_WINDOW_SIZE; i++) {
+        _prev[i] = _prev[i] > ESP3D_DEFLATE_WINDOW_SIZE
+                       ? _prev[i] - ESP3D_DEFLATE_WINDOW_SIZE
+                       : 0;
+      }
+    }
+    size_t size = BUFFER_SIZE - _end;
+    if (size > len) {
+      size = len;
+    }
+    memcpy(_buffer + _end, data, size);
+    if (_format == ESP3DDeflateFormat::gzip) {
+      _crc = esp_rom_crc32_le(_crc, data, size);
+    }
+    _end += size;
+    _input_size += size;
+    data += size;
+    len -= size;
+    _compress(false);
+  }
+  return !_error;
+}
+
+bool ESP3DDeflate::flush() {
+  if (!_buffer || _error) {
+    return false;
+  }
+  _compress(true);
+  _putLiteral(END_OF_BLOCK);
+  // empty stored block to be byte aligned, then new fixed codes block
+  _putBits(0, 3);
+  _alignBits();
+  _putBits(0x0000, 16);
+  _putBits(0xffff, 16);
+  _putBits(0, 1);
+  _putBits(1, 2);
+  return _sendOutput();
+}
+
+bool ESP3DDeflate::end() {
+  if (!_buffer) {
+    return false;
+  }
+  if (!_error) {
+    _compress(true);
+    _putLiteral(END_OF_BLOCK);
+    // final empty block
+    _putBits(1, 1);
+    _putBits(1, 2);
+    _putLiteral(END_OF_BLOCK);
+    _alignBits();
+    if (_format == ESP3DDeflateFormat::gzip) {
+      _putBits(_crc & 0xffff, 16);
+      _putBits(_crc >> 16, 16);
+      _putBits(_input_size & 0xffff, 16);
+      _putBits((_input_size >> 16) & 0xffff, 16);
+    }
+    _sendOutput();
+  }
+  _free();
+  return !_error;
+}
+
+// Greedy parsing, less than MAX_MATCH bytes are kept for next write unless
+// final
+void ESP3DDeflate::_compress(bool final) {
+  while (_start < _end && (final || _end - _start >= MAX_MATCH)) {
+    uint distance = 0;
+    uint length = _findMatch(&distance);
+    if (length >= MIN_MATCH) {
+      _putMatch(length, distance);
+      for (uint i = 0; i < length; i++) {
+        _insert(_start + i);
+      }
+      _start += length;
+    } else {
+      _putLiteral(_buffer[_start]);
+      _insert(_start);
+      _start++;
+    }
+  }
+}
+
+void ESP3DDeflate::_insert(uint pos) {
+  if (pos + MIN_MATCH > _end) {
+    return;
+  }
+  uint h = hash(&_buffer[pos]);
+  _prev[pos & WINDOW_MASK] = _head[h];
+  _head[h] = pos + 1;
+}
+
+uint ESP3DDeflate::_findMatch(uint *distance) {
+  if (_end - _start < MIN_MATCH) {
+    return 0;
+  }
+  uint max = _end - _start;
+  if (max > MAX_MATCH) {
+    max = MAX_MATCH;
+  }
+  const uint8_t *current = &_buffer[_start];
+  uint best = 0;
+  uint candidate = _head[hash(current)];
+  for (uint8_t chain = 0; candidate && chain < ESP3D_DEFLATE_MAX_CHAIN;
+       chain++) {
+    uint pos = candidate - 1;
+    // older positions of chain may have been replaced by newer ones
+    if (pos >= _start || _start - pos >= ESP3D_DEFLATE_WINDOW_SIZE) {
+      break;
+    }
+    const uint8_t *previous = &_buffer[pos];
+    if (previous[best] == current[best]) {
+      uint length = 0;
+      while (length < max && previous[length] == current[length]) {
+        length++;
+      }
+      if (length > best) {
+        best = length;
+        *distance = _start - pos;
+        if (length == max) {
+          break;
+        }
+      }
+    }
+    candidate = _prev[pos & WINDOW_MASK];
+  }
+  return best >= MIN_MATCH ? best : 0;
+}
+
+// Bits are packed from least significant bit
+void ESP3DDeflate::_putBits(uint32_t value, uint8_t count) {
+  _bits |= value << _bit_count;
+  _bit_count += count;
+  while (_bit_count >= 8) {
+    if (_out_pos == ESP3D_DEFLATE_OUTPUT_SIZE) {
+      _sendOutput();
+    }
+    _out[_out_pos++] = _bits & 0xff;
+    _bits >>= 8;
+    _bit_count -= 8;
+  }
+}
+
+// Huffman codes are packed from most significant bit
+void ESP3DDeflate::_putCode(uint16_t code, uint8_t length) {
+  uint16_t reversed = 0;
+  for (uint8_t i = 0; i < length; i++) {
+    reversed = (reversed << 1) | (code & 1);
+    code >>= 1;
+  }
+  _putBits(reversed, length);
+}
+
+// Fixed Huffman codes of literals and lengths
+void ESP3DDeflate::_putLiteral(uint16_t value) {
+  if (value < 144) {
+    _putCode(0x30 + value, 8);
+  } else if (value < 256) {
+    _putCode(0x190 + value - 144, 9);
+  } else if (value < 280) {
+    _putCode(value - 256, 7);
+  } else {
+    _putCode(0xc0 + value - 280, 8);
+  }
+}
+
+void ESP3DDeflate::_putMatch(uint length, uint distance) {
+  uint8_t code = sizeof(length_base) / sizeof(length_base[0]) - 1;
+  while (length_base[code] > length) {
+    code--;
+  }
+  _putLiteral(257 + code);
+  _putBits(length - length_base[code], length_extra[code]);
+  code = sizeof(distance_base) / sizeof(distance_base[0]) - 1;
+  while (distance_base[code] > distance) {
+    code--;
+  }
+  _putCode(code, 5);
+  _putBits(distance - distance_base[code], distance_extra[code]);
+}
+
+void ESP3DDeflate::_alignBits() {
+  if (_bit_count > 0) {
+    _putBits(0, 8 - _bit_count);
+  }
+}
+
+bool ESP3DDeflate::_sendOutput() {
+  if (_out_pos > 0 && !_error) {
+    if (!_output(_arg, _out, _out_pos)) {
+      esp3d_log_e("Compressed data sending failed");
+      _error = true;
+    }
+    _output_size += _out_pos;
+  }
+  _out_pos = 0;
+  return !_error;
+}
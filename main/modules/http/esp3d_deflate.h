@@ -0,0 +1,102 @@
+/*
+  esp3d_deflate
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Max distance of a match, must be a power of 2, memory used is about
+// 5 times this size
+#define ESP3D_DEFLATE_WINDOW_SIZE 2048
+// Must be a power of 2
+#define ESP3D_DEFLATE_HASH_SIZE 1024
+// Max number of previous positions checked for a match
+#define ESP3D_DEFLATE_MAX_CHAIN 8
+// Compressed data are sent to output by this size, each one is an http chunk
+// when response is compressed
+#define ESP3D_DEFLATE_OUTPUT_SIZE 1024
+
+enum class ESP3DDeflateFormat : uint8_t {
+  raw = 0,  // deflate data only
+  gzip,     // gzip header and trailer
+};
+
+// return false to abort compression
+typedef bool (*ESP3DDeflateOutput)(void *arg, const uint8_t *data,
+                                   size_t len);
+
+// Streaming deflate with fixed Huffman codes and a small window: ratio is
+// lower than zlib but memory is only a few KB, which is enough for JSON and
+// text that repeat same keys and tags a lot
+class ESP3DDeflate final {
+ public:
+  ESP3DDeflate();
+  ~ESP3DDeflate();
+  bool begin(ESP3DDeflateFormat format, ESP3DDeflateOutput output,
+             void *arg);
+  bool write(const uint8_t *data, size_t len);
+  bool write(const char *str);
+  // all data written so far can be decoded by client once sent
+  bool flush();
+  bool end();
+  // free memory without sending pending data
+  void abort() { _free(); }
+  bool started() { return _buffer != nullptr; }
+  size_t getInputSize() { return _input_size; }
+  size_t getOutputSize() { return _output_size; }
+
+ private:
+  void _compress(bool final);
+  void _insert(uint pos);
+  uint _findMatch(uint *distance);
+  void _putBits(uint32_t value, uint8_t count);
+  void _putCode(uint16_t code, uint8_t length);
+  void _putLiteral(uint16_t value);
+  void _putMatch(uint length, uint distance);
+  void _alignBits();
+  bool _sendOutput();
+  void _free();
+  ESP3DDeflateFormat _format;
+  ESP3DDeflateOutput _output;
+  void *_arg;
+  // window and lookahead, then hash heads and chains, then output buffer
+  uint8_t *_buffer;
+  uint16_t *_head;
+  uint16_t *_prev;
+  uint8_t *_out;
+  uint _out_pos;
+  uint _start;
+  uint _end;
+  uint32_t _bits;
+  uint8_t _bit_count;
+  uint32_t _crc;
+  size_t _input_size;
+  size_t _output_size;
+  bool _error;
+};
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
@@ -0,0 +1,301 @@
+/*
+  esp3d_http_chunk_writer
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "esp3d_http_chunk_writer.h"
+
+#include <string.h>
+
+#include "esp3d_log.h"
+#include "http/esp3d_http_service.h"
+
+#if ESP3D_TFT_BENCHMARK
+#include "esp_timer.h"
+#endif  // ESP3D_TFT_BENCHMARK
+
+#define SECONDS_PER_DAY 86400
+// offset of HH:MM:SS in "Sun, 06 Nov 1994 08:49:37 GMT"
+#define HTTP_DATE_TIME_OFFSET 17
+
+ESP3DChunkWriter::ESP3DChunkWriter(httpd_req_t *req) {
+  _req = req;
+  _buffer = esp3dHttpService._getFileBuffer(&_buffer_size);
+  _pos = 0;
+  _size = 0;
+  _chunks = 0;
+  _error = false;
+  _ended = false;
+  _accept_gzip = ESP3D_CHUNK_WRITER_GZIP_THRESHOLD > 0 &&
+                 esp3dHttpService.acceptGzip(req);
+  _gzip = ESP3D_CHUNK_WRITER_GZIP_THRESHOLD > 0
+              ? ESP3DChunkGzipState::undecided
+              : ESP3DChunkGzipState::off;
+  _sent_size = 0;
+#if ESP3D_TFT_BENCHMARK
+  _gzip_time = 0;
+#endif  // ESP3D_TFT_BENCHMARK
+  _http_day = -1;
+  _http_time = -1;
+  _http_date[0] = 0;
+  _local_time = -1;
+  _local_date[0] = 0;
+}
+
+ESP3DChunkWriter::~ESP3DChunkWriter() {
+  esp3dHttpService._releaseFileBuffer(_buffer);
+}
+
+bool ESP3DChunkWriter::_send(const char *data, size_t len) {
+  if (esp3dHttpService._sendChunk(_req, data, len) != ESP_OK) {
+    esp3d_log_e("Chunk sending failed!");
+    _error = true;
+    return false;
+  }
+  _chunks++;
+  _sent_size += len;
+  return true;
+}
+
+bool ESP3DChunkWriter::_deflate_output(void *arg, const uint8_t *data,
+                                       size_t len) {
+  return ((ESP3DChunkWriter *)arg)->_send((const char *)data, len);
+}
+
+// Header must be set before first chunk, if compressor cannot start or
+// header cannot be set, response is sent as is
+void ESP3DChunkWriter::_startGzip() {
+  _gzip = ESP3DChunkGzipState::off;
+  if (!_deflate.begin(ESP3DDeflateFormat::gzip, _deflate_output, this)) {
+    return;
+  }
+  if (httpd_resp_set_hdr(_req, "Content-Encoding", "gzip") != ESP_OK) {
+    esp3d_log_w("Cannot set gzip header");
+    _deflate.abort();
+    return;
+  }
+  _gzip = ESP3DChunkGzipState::on;
+}
+
+// Must be done before first output, as headers are sent with first chunk
+void ESP3DChunkWriter::_decideGzip() {
+  if (_gzip != ESP3DChunkGzipState::undecided) {
+    return;
+  }
+  _gzip = ESP3DChunkGzipState::off;
+  if (_size >= ESP3D_CHUNK_WRITER_GZIP_THRESHOLD) {
+    // same url can be answered compressed or not
+    if (httpd_resp_set_hdr(_req, "Vary", "Accept-Encoding") != ESP_OK) {
+      esp3d_log_w("Cannot set vary header");
+    }
+    if (_accept_gzip) {
+      _startGzip();
+    }
+  }
+}
+
+bool ESP3DChunkWriter::_output(const char *data, size_t len) {
+  if (_gzip != ESP3DChunkGzipState::on) {
+    return _send(data, len);
+  }
+#if ESP3D_TFT_BENCHMARK
+  int64_t start = esp_timer_get_time();
+#endif  // ESP3D_TFT_BENCHMARK
+  bool res = _deflate.write((const uint8_t *)data, len);
+#if ESP3D_TFT_BENCHMARK
+  _gzip_time += esp_timer_get_time() - start;
+#endif  // ESP3D_TFT_BENCHMARK
+  if (!res) {
+    _error = true;
+  }
+  return res;
+}
+
+bool ESP3DChunkWriter::flush() {
+  if (_error) {
+    return false;
+  }
+  if (_pos == 0) {
+    return true;
+  }
+  _decideGzip();
+  size_t len = _pos;
+  _pos = 0;
+  return _output(_buffer, len);
+}
+
+bool ESP3DChunkWriter::end() {
+  if (_ended) {
+    return !_error;
+  }
+  _ended = true;
+  flush();
+  if (_gzip == ESP3DChunkGzipState::on) {
+#if ESP3D_TFT_BENCHMARK
+    int64_t start = esp_timer_get_time();
+#endif  // ESP3D_TFT_BENCHMARK
+    // compressor is freed even after an error
+    if (!_deflate.end()) {
+      _error = true;
+    }
+#if ESP3D_TFT_BENCHMARK
+    _gzip_time += esp_timer_get_time() - start;
+    esp3d_report("gzip %d bytes to %d (%.1f%%) in %.2f ms", _size, _sent_size,
+                 _size ? 100.0 * _sent_size / _size : 0.0,
+                 _gzip_time / 1000.0);
+#endif  // ESP3D_TFT_BENCHMARK
+  }
+  // final chunk is sent even after an error to close the response
+  if (esp3dHttpService._sendChunk(_req, NULL, 0) != ESP_OK) {
+    _error = true;
+  }
+  return !_error;
+}
+
+bool ESP3DChunkWriter::write(const char *str) {
+  if (!str) {
+    return !_error;
+  }
+  return write(str, strlen(str));
+}
+
+bool ESP3DChunkWriter::write(const char *data, size_t len) {
+  if (_error) {
+    return false;
+  }
+  _size += len;
+  if (_pos + len > _buffer_size) {
+    if (!flush()) {
+      return false;
+    }
+    // too big for buffer, send as is, first output if buffer was empty
+    if (len > _buffer_size) {
+      _decideGzip();
+      return _output(data, len);
+    }
+  }
+  memcpy(_buffer + _pos, data, len);
+  _pos += len;
+  return true;
+}
+
+bool ESP3DChunkWriter::writeXml(const char *str) {
+  if (!str) {
+    return !_error;
+  }
+  const char *start = str;
+  for (const char *p = str; *p; p++) {
+    const char *entity = nullptr;
+    switch (*p) {
+      case '&':
+        entity = "&amp;";
+        break;
+      case '<':
+        entity = "&lt;";
+        break;
+      case '>':
+        entity = "&gt;";
+        break;
+      case '"':
+        entity = "&quot;";
+        break;
+      case '\'':
+        entity = "&apos;";
+        break;
+      default:
+        continue;
+    }
+    // write unescaped part at once
+    if (!write(start, p - start) || !write(entity)) {
+      return false;
+    }
+    start = p + 1;
+  }
+  return write(start);
+}
+
+bool ESP3DChunkWriter::writeJson(const char *str) {
+  if (!str) {
+    return !_error;
+  }
+  const char *start = str;
+  for (const char *p = str; *p; p++) {
+    char escaped[7];
+    if (*p == '"' || *p == '\\') {
+      escaped[0] = '\\';
+      escaped[1] = *p;
+      escaped[2] = 0;
+    } else if ((uint8_t)*p < 0x20) {
+      snprintf(escaped, sizeof(escaped), "\\u%04x", (uint8_t)*p);
+    } else {
+      continue;
+    }
+    if (!write(start, p - start) || !write(escaped)) {
+      return false;
+    }
+    start = p + 1;
+  }
+  return write(start);
+}
+
+bool ESP3DChunkWriter::writeNumber(uint64_t value) {
+  char digits[21];
+  uint8_t pos = sizeof(digits);
+  do {
+    digits[--pos] = '0' + (value % 10);
+    value /= 10;
+  } while (value > 0);
+  return write(&digits[pos], sizeof(digits) - pos);
+}
+
+// Entries of same directory often share same date or at least same day, so
+// only time of day is updated when day is unchanged
+bool ESP3DChunkWriter::writeDate(time_t time, ESP3DChunkDateFormat format) {
+  struct tm tmstruct;
+  if (format == ESP3DChunkDateFormat::http) {
+    if (time != _http_time) {
+      time_t day = time / SECONDS_PER_DAY;
+      if (time >= 0 && day == _http_day) {
+        uint32_t seconds = time % SECONDS_PER_DAY;
+        char *p = &_http_date[HTTP_DATE_TIME_OFFSET];
+        p[0] = '0' + (seconds / 36000);
+        p[1] = '0' + ((seconds / 3600) % 10);
+        p[3] = '0' + ((seconds % 3600) / 600);
+        p[4] = '0' + ((seconds % 3600) / 60) % 10;
+        p[6] = '0' + ((seconds % 60) / 10);
+        p[7] = '0' + (seconds % 10);
+      } else {
+        gmtime_r(&time, &tmstruct);
+        strftime(_http_date, sizeof(_http_date), "%a, %d %b %Y %H:%M:%S GMT",
+                 &tmstruct);
+        _http_day = time >= 0 ? day : -1;
+      }
+      _http_time = time;
+    }
+    return write(_http_date);
+  }
+  // local time depends on time zone and daylight saving, so only same date
+  // is reused
+  if (time != _local_time) {
+    localtime_r(&time, &tmstruct);
+    strftime(_local_date, sizeof(_local_date), "%Y-%m-%d %H:%M:%S",
+             &tmstruct);
+    _local_time = time;
+  }
+  return write(_local_date);
+}
@@ -0,0 +1,109 @@
+/*
+  esp3d_http_chunk_writer
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+#include <esp_http_server.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "http/esp3d_deflate.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Size of "Sun, 06 Nov 1994 08:49:37 GMT" + 0
+#define ESP3D_CHUNK_WRITER_HTTP_DATE_SIZE 30
+// Size of "1994-11-06 08:49:37" + 0
+#define ESP3D_CHUNK_WRITER_LOCAL_DATE_SIZE 20
+// Responses of at least this size are gzipped if client accepts it, 0 to
+// never compress
+#define ESP3D_CHUNK_WRITER_GZIP_THRESHOLD 1024
+
+enum class ESP3DChunkDateFormat : uint8_t {
+  http = 0,  // RFC 1123 in GMT, used by webdav
+  local,     // local time YYYY-MM-DD HH:MM:SS, used by files listing
+};
+
+// Buffer the body of a response and send it by big chunks instead of one
+// chunk per entry, buffer is taken from http service file buffers pool
+// Compression is decided when buffer is sent for the first time: body written
+// so far must be at least ESP3D_CHUNK_WRITER_GZIP_THRESHOLD, so a response
+// of 1024 bytes or more is compressed even if it fits in buffer, and a
+// smaller one never is. Vary header is then set for caches, whatever the
+// client accepts
+class ESP3DChunkWriter final {
+ public:
+  ESP3DChunkWriter(httpd_req_t *req);
+  ~ESP3DChunkWriter();
+  // all write functions return false once a send failed
+  bool write(const char *str);
+  bool write(const char *data, size_t len);
+  // escape & < > " ' for XML text and attributes
+  bool writeXml(const char *str);
+  // escape " \ and control characters for JSON string
+  bool writeJson(const char *str);
+  bool writeNumber(uint64_t value);
+  // same date is only formated once
+  bool writeDate(time_t time, ESP3DChunkDateFormat format);
+  bool flush();
+  // flush and send final empty chunk
+  bool end();
+  bool hasError() { return _error; }
+  size_t getSize() { return _size; }
+  uint32_t getChunksCount() { return _chunks; }
+  bool isCompressed() { return _gzip == ESP3DChunkGzipState::on; }
+  // size sent to client, compressed or not
+  size_t getSentSize() { return _sent_size; }
+
+ private:
+  enum class ESP3DChunkGzipState : uint8_t { undecided, on, off };
+  static bool _deflate_output(void *arg, const uint8_t *data, size_t len);
+  bool _send(const char *data, size_t len);
+  bool _output(const char *data, size_t len);
+  void _startGzip();
+  void _decideGzip();
+  httpd_req_t *_req;
+  char *_buffer;
+  size_t _buffer_size;
+  size_t _pos;
+  size_t _size;
+  uint32_t _chunks;
+  bool _error;
+  bool _ended;
+  ESP3DChunkGzipState _gzip;
+  bool _accept_gzip;
+  ESP3DDeflate _deflate;
+  size_t _sent_size;
+#if ESP3D_TFT_BENCHMARK
+  int64_t _gzip_time;
+#endif  // ESP3D_TFT_BENCHMARK
+  // last formated dates
+  time_t _http_day;
+  time_t _http_time;
+  char _http_date[ESP3D_CHUNK_WRITER_HTTP_DATE_SIZE];
+  time_t _local_time;
+  char _local_date[ESP3D_CHUNK_WRITER_LOCAL_DATE_SIZE];
+};
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
@@ -30,6 +30,7 @@
 #include "esp_tls_crypto.h"
 #include "esp_wifi.h"
 #include "filesystem/esp3d_globalfs.h"
+#include "http/esp3d_http_chunk_writer.h"
 #include "network/esp3d_network.h"
 #include "sdkconfig.h"
 #include "websocket/esp3d_webui_service.h"
@@ -42,8 +43,10 @@
 #define SSDP_HANLDER_CNT 0
 #endif  // ESP3D_SSDP_FEATURE
 #define ROOT_GET_HANDLER_CNT 1
-#define COMMAND_HANDLER_CNT 1
+#define COMMAND_HANDLER_CNT 2
+#define BOOTSTRAP_HANDLER_CNT 1
 #define CONFIG_HANDLER_CNT 1
+#define HISTORY_HANDLER_CNT 1
 #define FILES_HANDLER_CNT 1
 #define LOGIN_HANDLER_CNT 1
 #define FILES_UPLOAD_HANDLER_CNT 1
@@ -55,7 +58,7 @@
 #define SDFILES_UPLOAD_HANDLER_CNT 0
 #endif  // ESP3D_SD_CARD_FEATURE
 #if ESP3D_UPDATE_FEATURE
-#define UPDATEFW_UPLOAD_HANDLER_CNT 1
+#define UPDATEFW_UPLOAD_HANDLER_CNT 2
 #else
 #define UPDATEFW_UPLOAD_HANDLER_CNT 0
 #endif  // ESP3D_UPDATE_FEATURE
@@ -113,8 +116,11 @@ PostUploadContext ESP3DHttpService::_post_updatefw_upload_ctx = {
                       size_t))(ESP3DHttpService::upload_to_updatefw_handler),
     .nextHandler =
         (esp_err_t(*)(httpd_req_t *))(ESP3DHttpService::updatefw_handler),
-    .packetReadSize = 1024,   // TODO:This may need to be defined in tasks_def.h
-    .packetWriteSize = 1024,  // TODO:This may need to be defined in tasks_def.h
+    // data are gathered in big blocks by the ota writer
+    .packetReadSize =
+        4 * 1024,  // TODO:This may need to be defined in tasks_def.h
+    .packetWriteSize =
+        4 * 1024,  // TODO:This may need to be defined in tasks_def.h
     .status = ESP3DUploadStatus::not_started,
     .args = {}};
 #endif  // ESP3D_UPDATE_FEATURE
@@ -179,6 +185,15 @@ const char *ESP3DHttpService::getArg(httpd_req_t *req, const char *argname) {
 ESP3DHttpService::ESP3DHttpService() {
   _started = false;
   _server = nullptr;
+  _capture_req = nullptr;
+  _capture = nullptr;
+  _writer_req = nullptr;
+  _writer = nullptr;
+  _file_buffers_mutex = PTHREAD_MUTEX_INITIALIZER;
+  for (uint8_t i = 0; i < FILE_BUFFER_POOL_SIZE; i++) {
+    _file_buffers[i] = nullptr;
+    _file_buffers_used[i] = false;
+  }
 #if ESP3D_WEBDAV_SERVICES_FEATURE
   _webdav_active = false;
 #endif  // ESP3D_WEBDAV_SERVICES_FEATURE
@@ -243,11 +258,13 @@ bool ESP3DHttpService::begin() {
   // handlers
   config.max_uri_handlers =
       FAV_ICON_HANLDER_CNT + SSDP_HANLDER_CNT + ROOT_GET_HANDLER_CNT +
-      COMMAND_HANDLER_CNT + CONFIG_HANDLER_CNT + FILES_HANDLER_CNT +
-      LOGIN_HANDLER_CNT + FILES_UPLOAD_HANDLER_CNT + SDFILES_HANDLER_CNT +
-      SDFILES_UPLOAD_HANDLER_CNT + UPDATEFW_UPLOAD_HANDLER_CNT +
-      WEBSOCKET_WEBUI_HANDLER_CNT + WEBSOCKET_DATA_HANDLER_CNT +
-      WEBDAV_HANDLER_CNT + FILE_NOT_FOUND_HANDLER_CNT + CAMERA_HANDLER_CNT;
+      COMMAND_HANDLER_CNT + BOOTSTRAP_HANDLER_CNT + CONFIG_HANDLER_CNT +
+      HISTORY_HANDLER_CNT +
+      FILES_HANDLER_CNT + LOGIN_HANDLER_CNT + FILES_UPLOAD_HANDLER_CNT +
+      SDFILES_HANDLER_CNT + SDFILES_UPLOAD_HANDLER_CNT +
+      UPDATEFW_UPLOAD_HANDLER_CNT + WEBSOCKET_WEBUI_HANDLER_CNT +
+      WEBSOCKET_DATA_HANDLER_CNT + WEBDAV_HANDLER_CNT +
+      FILE_NOT_FOUND_HANDLER_CNT + CAMERA_HANDLER_CNT;
   // backlog_conn
   config.backlog_conn = 8;
   config.close_fn = close_fn;
@@ -318,6 +335,36 @@ bool ESP3DHttpService::begin() {
       esp3d_log_e("command handler registration failed");
     }
 
+    // Commands batch /command
+    const httpd_uri_t command_batch_handler_config = {
+        .uri = "/command",
+        .method = HTTP_POST,
+        .handler = (esp_err_t(*)(httpd_req_t *))(
+            esp3dHttpService.command_batch_handler),
+        .user_ctx = nullptr,
+        .is_websocket = false,
+        .handle_ws_control_frames = false,
+        .supported_subprotocol = nullptr};
+    if (ESP_OK !=
+        httpd_register_uri_handler(_server, &command_batch_handler_config)) {
+      esp3d_log_e("command batch handler registration failed");
+    }
+
+    // Bootstrap /bootstrap
+    const httpd_uri_t bootstrap_handler_config = {
+        .uri = "/bootstrap",
+        .method = HTTP_GET,
+        .handler =
+            (esp_err_t(*)(httpd_req_t *))(esp3dHttpService.bootstrap_handler),
+        .user_ctx = nullptr,
+        .is_websocket = false,
+        .handle_ws_control_frames = false,
+        .supported_subprotocol = nullptr};
+    if (ESP_OK !=
+        httpd_register_uri_handler(_server, &bootstrap_handler_config)) {
+      esp3d_log_e("bootstrap handler registration failed");
+    }
+
     // config /config
     const httpd_uri_t config_handler_config = {
         .uri = "/config",
@@ -332,6 +379,21 @@ bool ESP3DHttpService::begin() {
       esp3d_log_e("config handler registration failed");
     }
 
+    // history /history
+    const httpd_uri_t history_handler_config = {
+        .uri = "/history",
+        .method = HTTP_GET,
+        .handler =
+            (esp_err_t(*)(httpd_req_t *))(esp3dHttpService.history_get_handler),
+        .user_ctx = nullptr,
+        .is_websocket = false,
+        .handle_ws_control_frames = false,
+        .supported_subprotocol = nullptr};
+    if (ESP_OK !=
+        httpd_register_uri_handler(_server, &history_handler_config)) {
+      esp3d_log_e("history handler registration failed");
+    }
+
     // flash files /files
     const httpd_uri_t files_handler_config = {
         .uri = "/files",
@@ -430,6 +492,20 @@ bool ESP3DHttpService::begin() {
         httpd_register_uri_handler(_server, &updatefw_upload_handler_config)) {
       esp3d_log_e("updatefw upload handler registration failed");
     }
+    // updatefw resume status (GET)
+    const httpd_uri_t updatefw_status_handler_config = {
+        .uri = "/updatefw",
+        .method = HTTP_GET,
+        .handler = (esp_err_t(*)(httpd_req_t *))(
+            esp3dHttpService.updatefw_status_handler),
+        .user_ctx = nullptr,
+        .is_websocket = false,
+        .handle_ws_control_frames = false,
+        .supported_subprotocol = nullptr};
+    if (ESP_OK !=
+        httpd_register_uri_handler(_server, &updatefw_status_handler_config)) {
+      esp3d_log_e("updatefw status handler registration failed");
+    }
 #endif  // ESP3D_UPDATE_FEATURE
 
     // webui web socket /ws
@@ -706,9 +782,11 @@ void ESP3DHttpService::end() {
 #endif  // ESP3D_WS_SERVICE_FEATURE
     httpd_unregister_uri(_server, "/favicon.ico");
     httpd_unregister_uri(_server, "/command");
+    httpd_unregister_uri(_server, "/bootstrap");
     httpd_unregister_uri(_server, "/");
     httpd_unregister_uri(_server, "/files");
     httpd_unregister_uri(_server, "/config");
+    httpd_unregister_uri(_server, "/history");
     httpd_unregister_uri(_server, "/ws");
 #if ESP3D_UPDATE_FEATURE
     httpd_unregister_uri(_server, "/updatefw");
@@ -725,6 +803,8 @@ void ESP3DHttpService::end() {
   }
   _server = nullptr;
   _started = false;
+  _freeFileBuffers();
+  _clearBootstrap();
   _post_files_upload_ctx.status = ESP3DUploadStatus::not_started;
 #if ESP3D_SD_CARD_FEATURE
   _post_sdfiles_upload_ctx.status = ESP3DUploadStatus::not_started;
@@ -918,16 +998,12 @@ ESP3DAuthenticationLevel ESP3DHttpService::getAuthenticationLevel(
     if (sessionID.length() != 0) {
       // Update Session ID
       esp3d_log("Found Session ID: %s", sessionID.c_str());
-      ESP3DAuthenticationRecord *rec =
-          esp3dAuthenthicationService.getRecord(sessionID.c_str());
-      if (rec) {
-        // we have a record for this session ID so update it
-        // update timeout
-        // update level
-        esp3d_log("Record created for level %d",
+      if (esp3dAuthenthicationService.setLevel(sessionID.c_str(),
+                                               authentication_level)) {
+        // we have a record for this session ID so level and timeout are
+        // updated
+        esp3d_log("Record updated for level %d",
                   static_cast<uint8_t>(authentication_level));
-        rec->level = authentication_level;
-        rec->last_time = esp3d_hal::millis();
       } else {
         // We have no record for this session ID so create one
         if (esp3dAuthenthicationService.createRecord(
@@ -985,22 +1061,22 @@ ESP3DAuthenticationLevel ESP3DHttpService::getAuthenticationLevel(
       // we have a session ID
       // check if time out is set
       esp3d_log("Got Session ID: %s", sessionID.c_str());
-      ESP3DAuthenticationRecord *rec =
-          esp3dAuthenthicationService.getRecord(sessionID.c_str());
-      if (rec) {
+      ESP3DAuthenticationRecord rec;
+      if (esp3dAuthenthicationService.getRecord(sessionID.c_str(), &rec)) {
         if (esp3dAuthenthicationService.getSessionTimeout() !=
             0) {  // no session limit
-          if (esp3d_hal::millis() - rec->last_time <
-              esp3dAuthenthicationService.getSessionTimeout()) {
+          // session may have been removed since it was read
+          if (esp3d_hal::millis() - rec.last_time <
+                  esp3dAuthenthicationService.getSessionTimeout() &&
+              esp3dAuthenthicationService.touch(sessionID.c_str())) {
             esp3d_log("Update Session timeout");
-            rec->last_time = esp3d_hal::millis();
             esp3d_log("Authentication level now %d",
-                      static_cast<uint8_t>(rec->level));
-            authentication_level = rec->level;
+                      static_cast<uint8_t>(rec.level));
+            authentication_level = rec.level;
 
           } else {  // session  reached limit
             esp3d_log_w("Session is now outdated %lld vs %lld",
-                        esp3d_hal::millis() - rec->last_time,
+                        esp3d_hal::millis() - rec.last_time,
                         esp3dAuthenthicationService.getSessionTimeout());
             authentication_level = ESP3DAuthenticationLevel::guest;
             // Update cookie to 0
@@ -1017,7 +1093,7 @@ ESP3DAuthenticationLevel ESP3DHttpService::getAuthenticationLevel(
           }
         } else {
           // in case setting change
-          rec->last_time = esp3d_hal::millis();
+          esp3dAuthenthicationService.touch(sessionID.c_str());
           esp3d_log("Session has no timeout");
         }
       } else {
@@ -1104,7 +1180,8 @@ esp_err_t ESP3DHttpService::streamFile(const char *path, httpd_req_t *req) {
         if (fstype == ESP3DFileSystemType::unknown) {
           filename = globalFs.mount_point(ESP3DFileSystemType::flash);
         }
-        filename += esp3d_string::urlDecode((const char *)buf);
+        esp3d_string::urlDecodeInPlace(buf);
+        filename += buf;
         filenameGz = filename + ".gz";
       }
       free(buf);
@@ -1128,29 +1205,26 @@ esp_err_t ESP3DHttpService::streamFile(const char *path, httpd_req_t *req) {
         res = ESP_ERR_NOT_FOUND;
       }
       if (res == ESP_OK) {
-        FILE *fd =
-            globalFs.open(isGzip ? filenameGz.c_str() : filename.c_str(), "r");
+        struct stat entry_stat;
+        FILE *fd = nullptr;
+        if (globalFs.stat(isGzip ? filenameGz.c_str() : filename.c_str(),
+                          &entry_stat) != -1) {
+          fd = globalFs.open(isGzip ? filenameGz.c_str() : filename.c_str(),
+                             "r");
+        }
         if (fd) {
           // stream file
           std::string mimeType = esp3d_string::getContentType(filename.c_str());
-
+          char last_modified[ESP3D_TIME_STRING_SIZE];
+          esp3d_string::getTimeStringTo(entry_stat.st_mtime, true,
+                                        last_modified, sizeof(last_modified));
           httpd_resp_set_type(req, mimeType.c_str());
           if (isGzip) {
             httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
           }
-          size_t chunksize;
-          do {
-            chunksize = fread(_chunk, 1, CHUNK_BUFFER_SIZE, fd);
-            if (chunksize > 0) {
-              if (httpd_resp_send_chunk(req, _chunk, chunksize) != ESP_OK) {
-                esp3d_log_e("File sending failed!");
-                chunksize = 0;
-                res = ESP_FAIL;
-              }
-            }
-          } while (chunksize != 0);
-          fclose(fd);
-          httpd_resp_send_chunk(req, NULL, 0);
+          httpd_resp_set_hdr(req, "Last-Modified", last_modified);
+          res = sendFileContent(req, fd, entry_stat.st_size, last_modified);
+          globalFs.close(fd, isGzip ? filenameGz.c_str() : filename.c_str());
         } else {
           res = ESP_ERR_NOT_FOUND;
           esp3d_log_e("Cannot access File %s",
@@ -1167,6 +1241,196 @@ esp_err_t ESP3DHttpService::streamFile(const char *path, httpd_req_t *req) {
   return res;
 }
 
+// Buffers are shared by all requests, if none is available the small static
+// chunk is used instead
+char *ESP3DHttpService::_getFileBuffer(size_t *size) {
+  char *buffer = nullptr;
+  if (pthread_mutex_lock(&_file_buffers_mutex) == 0) {
+    for (uint8_t i = 0; i < FILE_BUFFER_POOL_SIZE && !buffer; i++) {
+      if (!_file_buffers_used[i]) {
+        if (!_file_buffers[i]) {
+          _file_buffers[i] = (char *)malloc(FILE_BUFFER_SIZE);
+        }
+        if (_file_buffers[i]) {
+          _file_buffers_used[i] = true;
+          buffer = _file_buffers[i];
+        }
+      }
+    }
+    pthread_mutex_unlock(&_file_buffers_mutex);
+  }
+  if (buffer) {
+    *size = FILE_BUFFER_SIZE;
+  } else {
+    esp3d_log_w("No file buffer available, use chunk");
+    buffer = _chunk;
+    *size = CHUNK_BUFFER_SIZE;
+  }
+  return buffer;
+}
+
+void ESP3DHttpService::_releaseFileBuffer(char *buffer) {
+  if (buffer == _chunk) {
+    return;
+  }
+  if (pthread_mutex_lock(&_file_buffers_mutex) == 0) {
+    for (uint8_t i = 0; i < FILE_BUFFER_POOL_SIZE; i++) {
+      if (_file_buffers[i] == buffer) {
+        _file_buffers_used[i] = false;
+        break;
+      }
+    }
+    pthread_mutex_unlock(&_file_buffers_mutex);
+  }
+}
+
+void ESP3DHttpService::_freeFileBuffers() {
+  if (pthread_mutex_lock(&_file_buffers_mutex) == 0) {
+    for (uint8_t i = 0; i < FILE_BUFFER_POOL_SIZE; i++) {
+      if (_file_buffers[i] && !_file_buffers_used[i]) {
+        free(_file_buffers[i]);
+        _file_buffers[i] = nullptr;
+      }
+    }
+    pthread_mutex_unlock(&_file_buffers_mutex);
+  }
+}
+
+// Parse Range header, only single range `bytes=start-end`, `bytes=start-` and
+// `bytes=-suffix` are supported, multiple ranges are ignored and full content
+// is sent. If-Range only supports Last-Modified date.
+// Return true if a valid range is found
+bool ESP3DHttpService::_getRange(httpd_req_t *req, size_t file_size,
+                                 const char *last_modified, size_t *start,
+                                 size_t *end, bool *unsatisfiable) {
+  char header[64];
+  *unsatisfiable = false;
+  size_t header_len = httpd_req_get_hdr_value_len(req, "Range");
+  if (header_len == 0 || header_len >= sizeof(header)) {
+    return false;
+  }
+  if (httpd_req_get_hdr_value_str(req, "Range", header, sizeof(header)) !=
+      ESP_OK) {
+    return false;
+  }
+  esp3d_log("Range: %s", header);
+  if (strncmp(header, "bytes=", 6) != 0 || strchr(header, ',') != nullptr) {
+    esp3d_log_w("Range not supported: %s", header);
+    return false;
+  }
+  // range is ignored if file changed since client got it
+  size_t if_range_len = httpd_req_get_hdr_value_len(req, "If-Range");
+  if (if_range_len > 0) {
+    char if_range[64];
+    if (!last_modified || if_range_len >= sizeof(if_range) ||
+        httpd_req_get_hdr_value_str(req, "If-Range", if_range,
+                                    sizeof(if_range)) != ESP_OK ||
+        strcmp(if_range, last_modified) != 0) {
+      esp3d_log("If-Range does not match, send full content");
+      return false;
+    }
+  }
+  char *range = &header[6];
+  char *separator = strchr(range, '-');
+  if (!separator) {
+    return false;
+  }
+  *separator = 0x0;
+  char *range_end = separator + 1;
+  if (strlen(range) == 0) {
+    // suffix: last n bytes
+    size_t suffix = strtoul(range_end, nullptr, 10);
+    if (suffix == 0 || file_size == 0) {
+      *unsatisfiable = true;
+      return false;
+    }
+    *start = suffix > file_size ? 0 : file_size - suffix;
+    *end = file_size - 1;
+  } else {
+    *start = strtoul(range, nullptr, 10);
+    if (*start >= file_size) {
+      *unsatisfiable = true;
+      return false;
+    }
+    *end = strlen(range_end) > 0 ? strtoul(range_end, nullptr, 10)
+                                 : file_size - 1;
+    if (*end >= file_size) {
+      *end = file_size - 1;
+    }
+    if (*end < *start) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Send file content from current position, honoring Range header
+// Content which fit in one buffer is sent with Content-Length, bigger one is
+// sent by chunks
+// Content-Type and other headers must be set before calling this function
+esp_err_t ESP3DHttpService::sendFileContent(httpd_req_t *req, FILE *fd,
+                                            size_t file_size,
+                                            const char *last_modified) {
+  esp_err_t res = ESP_OK;
+  size_t start = 0;
+  size_t end = file_size > 0 ? file_size - 1 : 0;
+  bool unsatisfiable = false;
+  char content_range[64];
+  httpd_resp_set_hdr(req, "Accept-Ranges", "bytes");
+  if (_getRange(req, file_size, last_modified, &start, &end, &unsatisfiable)) {
+    snprintf(content_range, sizeof(content_range), "bytes %u-%u/%u",
+             (unsigned int)start, (unsigned int)end, (unsigned int)file_size);
+    httpd_resp_set_status(req, "206 Partial Content");
+    httpd_resp_set_hdr(req, "Content-Range", content_range);
+    if (fseek(fd, start, SEEK_SET) != 0) {
+      esp3d_log_e("Failed to seek to %d", start);
+      httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                          "Failed to seek");
+      return ESP_FAIL;
+    }
+  } else if (unsatisfiable) {
+    snprintf(content_range, sizeof(content_range), "bytes */%u",
+             (unsigned int)file_size);
+    httpd_resp_set_status(req, "416 Range Not Satisfiable");
+    httpd_resp_set_hdr(req, "Content-Range", content_range);
+    return httpd_resp_send(req, NULL, 0);
+  }
+  size_t remaining = file_size > 0 ? end - start + 1 : 0;
+  size_t buffer_size = 0;
+  char *buffer = _getFileBuffer(&buffer_size);
+  if (remaining <= buffer_size) {
+    // fast path: send all at once with Content-Length
+    size_t read_size = remaining > 0 ? fread(buffer, 1, remaining, fd) : 0;
+    if (read_size != remaining) {
+      esp3d_log_e("File reading failed!");
+      httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                          "Failed to read file");
+      res = ESP_FAIL;
+    } else if (httpd_resp_send(req, buffer, read_size) != ESP_OK) {
+      esp3d_log_e("File sending failed!");
+      res = ESP_FAIL;
+    }
+  } else {
+    while (remaining > 0 && res == ESP_OK) {
+      size_t chunksize = fread(
+          buffer, 1, remaining < buffer_size ? remaining : buffer_size, fd);
+      if (chunksize == 0) {
+        esp3d_log_e("File sending failed: size do not match!");
+        res = ESP_FAIL;
+        break;
+      }
+      if (httpd_resp_send_chunk(req, buffer, chunksize) != ESP_OK) {
+        esp3d_log_e("File sending failed!");
+        res = ESP_FAIL;
+      }
+      remaining -= chunksize;
+    }
+    httpd_resp_send_chunk(req, NULL, 0);
+  }
+  _releaseFileBuffer(buffer);
+  return res;
+}
+
 #if ESP3D_TFT_LOG >= ESP3D_TFT_LOG_LEVEL_DEBUG
 // The header is esp_httpd_priv.h but it is not exposed
 // so lets just define struct here
@@ -1237,14 +1501,14 @@ uint ESP3DHttpService::showAllHeaders(httpd_req_t *req) {
 void ESP3DHttpService::process(ESP3DMessage *msg) {
   if (msg->request_id.http_request) {
     // esp3d_log("Msg type : %d", msg->type);
-    if (httpd_resp_send_chunk(msg->request_id.http_request,
-                              (const char *)msg->data, msg->size) != ESP_OK) {
-      httpd_resp_send_chunk(msg->request_id.http_request, NULL, 0);
+    if (sendChunk(msg->request_id.http_request, (const char *)msg->data,
+                  msg->size) != ESP_OK) {
+      sendChunk(msg->request_id.http_request, NULL, 0);
       esp3d_log_e("Error sending data, closing chunk");
     } else {
       if (msg->type == ESP3DMessageType::tail ||
           msg->type == ESP3DMessageType::unique) {
-        httpd_resp_send_chunk(msg->request_id.http_request, NULL, 0);
+        sendChunk(msg->request_id.http_request, NULL, 0);
         esp3d_log("End of messages for this req, closing chunk");
       }
     }
@@ -1252,12 +1516,70 @@ void ESP3DHttpService::process(ESP3DMessage *msg) {
   ESP3DClient::deleteMsg(msg);
 }
 
+esp_err_t ESP3DHttpService::sendChunk(httpd_req_t *req, const char *data,
+                                      size_t len) {
+  if (_writer_req && req == _writer_req) {
+    bool res = data ? _writer->write(data, len) : _writer->end();
+    return res ? ESP_OK : ESP_FAIL;
+  }
+  return _sendChunk(req, data, len);
+}
+
+esp_err_t ESP3DHttpService::_sendChunk(httpd_req_t *req, const char *data,
+                                       size_t len) {
+  if (_capture_req && req == _capture_req) {
+    if (data) {
+      _capture->append(data, len);
+    }
+    return ESP_OK;
+  }
+  return httpd_resp_send_chunk(req, data, len);
+}
+
+// Only used by http task, so no other request can be sent meanwhile
+void ESP3DHttpService::startCapture(httpd_req_t *req, std::string *output) {
+  _capture = output;
+  _capture_req = req;
+}
+
+void ESP3DHttpService::stopCapture() {
+  _capture_req = nullptr;
+  _capture = nullptr;
+}
+
+void ESP3DHttpService::startWriter(httpd_req_t *req,
+                                   ESP3DChunkWriter *writer) {
+  _writer = writer;
+  _writer_req = req;
+}
+
+void ESP3DHttpService::stopWriter() {
+  _writer_req = nullptr;
+  _writer = nullptr;
+}
+
+bool ESP3DHttpService::acceptGzip(httpd_req_t *req) {
+  bool res = false;
+  size_t header_size = httpd_req_get_hdr_value_len(req, "Accept-Encoding");
+  if (header_size > 0) {
+    char *header_value = (char *)malloc(header_size + 1);
+    if (header_value) {
+      if (httpd_req_get_hdr_value_str(req, "Accept-Encoding", header_value,
+                                      header_size + 1) == ESP_OK) {
+        res = strstr(header_value, "gzip") != nullptr;
+      }
+      free(header_value);
+    }
+  }
+  return res;
+}
+
 esp_err_t ESP3DHttpService::sendStringChunk(httpd_req_t *req, const char *str,
                                             bool autoClose) {
-  if (!str || httpd_resp_send_chunk(req, str, strlen(str)) != ESP_OK) {
+  if (!str || sendChunk(req, str, strlen(str)) != ESP_OK) {
     esp3d_log_e("String sending failed!");
     if (autoClose) {
-      httpd_resp_send_chunk(req, NULL, 0);
+      sendChunk(req, NULL, 0);
     }
     return ESP_FAIL;
   }
@@ -1267,10 +1589,10 @@ esp_err_t ESP3DHttpService::sendStringChunk(httpd_req_t *req, const char *str,
 esp_err_t ESP3DHttpService::sendBinaryChunk(httpd_req_t *req,
                                             const uint8_t *data, size_t len,
                                             bool autoClose) {
-  if (!data || httpd_resp_send_chunk(req, (const char *)data, len) != ESP_OK) {
+  if (!data || sendChunk(req, (const char *)data, len) != ESP_OK) {
     esp3d_log_e("String sending failed!");
     if (autoClose) {
-      httpd_resp_send_chunk(req, NULL, 0);
+      sendChunk(req, NULL, 0);
     }
     return ESP_FAIL;
   }
@@ -20,6 +20,7 @@
 
 #pragma once
 #include <esp_http_server.h>
+#include <pthread.h>
 #include <stdio.h>
 
 #include <list>
@@ -34,6 +35,9 @@
 #include "tasks_def.h"
 
 #define CHUNK_BUFFER_SIZE STREAM_CHUNK_SIZE
+// buffers used to send files, allocated on first use
+#define FILE_BUFFER_SIZE (8 * 1024)
+#define FILE_BUFFER_POOL_SIZE 2
 
 #ifdef __cplusplus
 extern "C" {
@@ -94,6 +98,8 @@ struct PostUploadContext {
   std::list<std::pair<std::string, std::string>> args;
 };
 
+class ESP3DChunkWriter;
+
 class ESP3DHttpService final {
  public:
   ESP3DHttpService();
@@ -114,7 +120,10 @@ class ESP3DHttpService final {
   static ESP3DAuthenticationLevel getAuthenticationLevel(httpd_req_t *req);
   static esp_err_t root_get_handler(httpd_req_t *req);
   static esp_err_t command_handler(httpd_req_t *req);
+  static esp_err_t command_batch_handler(httpd_req_t *req);
+  static esp_err_t bootstrap_handler(httpd_req_t *req);
   static esp_err_t config_handler(httpd_req_t *req);
+  static esp_err_t history_get_handler(httpd_req_t *req);
 #if ESP3D_SSDP_FEATURE
   static esp_err_t description_xml_handler(httpd_req_t *req);
 #endif  // #if ESP3D_SSDP_FEATURE
@@ -123,6 +132,8 @@ class ESP3DHttpService final {
                                           httpd_err_code_t err);
   static esp_err_t login_handler(httpd_req_t *req);
   static esp_err_t files_handler(httpd_req_t *req);
+  esp_err_t sendFilesList(httpd_req_t *req, const std::string &path,
+                          std::string status);
 #if ESP3D_CAMERA_FEATURE
   static esp_err_t snap_handler(httpd_req_t *req);
 #endif  // ESP3D_CAMERA_FEATURE
@@ -164,6 +175,7 @@ class ESP3DHttpService final {
 #endif  // ESP3D_TFT_LOG >= ESP3D_TFT_LOG_LEVEL_DEBUG
 #if ESP3D_UPDATE_FEATURE
   static esp_err_t updatefw_handler(httpd_req_t *req);
+  static esp_err_t updatefw_status_handler(httpd_req_t *req);
   static esp_err_t upload_to_updatefw_handler(
       const uint8_t *data, size_t datasize, ESP3DUploadState file_upload_state,
       const char *filename, size_t filesize);
@@ -173,6 +185,19 @@ class ESP3DHttpService final {
   static void close_fn(httpd_handle_t hd, int socketFd);
   void onClose(int socketFd);
   esp_err_t streamFile(const char *path, httpd_req_t *req);
+  esp_err_t sendFileContent(httpd_req_t *req, FILE *fd, size_t file_size,
+                            const char *last_modified = nullptr);
+  // send a chunk of response, or add it to captured output or to response
+  // writer, nullptr data ends response
+  esp_err_t sendChunk(httpd_req_t *req, const char *data, size_t len);
+  // answers sent to this request are added to output instead of being sent
+  void startCapture(httpd_req_t *req, std::string *output);
+  void stopCapture();
+  // answers sent to this request go through writer, to be batched and
+  // compressed
+  void startWriter(httpd_req_t *req, ESP3DChunkWriter *writer);
+  void stopWriter();
+  bool acceptGzip(httpd_req_t *req);
   esp_err_t sendStringChunk(httpd_req_t *req, const char *str,
                             bool autoClose = true);
   esp_err_t sendBinaryChunk(httpd_req_t *req, const uint8_t *data, size_t len,
@@ -186,6 +211,8 @@ class ESP3DHttpService final {
   bool webdavActive(bool fromSettings = false);
 
  private:
+  // uses file buffers pool
+  friend class ESP3DChunkWriter;
 #if ESP3D_WEBDAV_SERVICES_FEATURE
   bool _webdav_active;
 #endif  // ESP3D_WEBDAV_SERVICES_FEATURE
@@ -200,12 +227,26 @@ class ESP3DHttpService final {
   static PostUploadContext _post_sdfiles_upload_ctx;
 #endif  // ESP3D_SD_CARD_FEATURE
   static int _clearPayload(httpd_req_t *req);
+  bool _getRange(httpd_req_t *req, size_t file_size, const char *last_modified,
+                 size_t *start, size_t *end, bool *unsatisfiable);
+  char *_getFileBuffer(size_t *size);
+  void _releaseFileBuffer(char *buffer);
+  void _freeFileBuffers();
+  char *_file_buffers[FILE_BUFFER_POOL_SIZE];
+  bool _file_buffers_used[FILE_BUFFER_POOL_SIZE];
+  pthread_mutex_t _file_buffers_mutex;
 #if ESP3D_UPDATE_FEATURE
   static PostUploadContext _post_updatefw_upload_ctx;
 #endif  // ESP3D_UPDATE_FEATURE
 
   static PostUploadContext _post_login_ctx;
   std::list<std::pair<esp3dSocketType, int>> _sockets_list;
+  esp_err_t _sendChunk(httpd_req_t *req, const char *data, size_t len);
+  httpd_req_t *_capture_req;
+  std::string *_capture;
+  httpd_req_t *_writer_req;
+  ESP3DChunkWriter *_writer;
+  void _clearBootstrap();
 };
 
 extern ESP3DHttpService esp3dHttpService;
@@ -0,0 +1,267 @@
+/*
+  esp3d_http_service
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+
+#include "authentication/esp3d_authentication.h"
+#include "esp3d_commands.h"
+#include "esp3d_log.h"
+#include "esp3d_settings.h"
+#include "esp3d_string.h"
+#include "esp_timer.h"
+#include "filesystem/esp3d_flash.h"
+#include "http/esp3d_deflate.h"
+#include "http/esp3d_http_service.h"
+
+// ESP420 is live status so bundle is rebuilt after this delay even if nothing
+// else changed (ms)
+#define ESP3D_BOOTSTRAP_MAX_AGE 10000
+// Max size of a file added to bundle
+#define ESP3D_BOOTSTRAP_MAX_FILE_SIZE (32 * 1024)
+
+// Compressed bundle of last request and what it was built from
+struct ESP3DBootstrapCache {
+  std::string data;
+  std::string esp800;
+  std::string lang;
+  ESP3DAuthenticationLevel level;
+  uint32_t settings_id;
+  uint32_t files_id;
+  int64_t time;
+};
+
+static ESP3DBootstrapCache *bootstrap_cache = nullptr;
+
+static bool append_output(void *arg, const uint8_t *data, size_t len) {
+  ((std::string *)arg)->append((const char *)data, len);
+  return true;
+}
+
+// Add content of a flash file, or null if it is not there
+static void add_file(std::string &output, const char *path) {
+  struct stat entry_stat;
+  FILE *fd = nullptr;
+  if (flashFs.stat(path, &entry_stat) == 0 && !S_ISDIR(entry_stat.st_mode) &&
+      entry_stat.st_size > 0 &&
+      entry_stat.st_size <= ESP3D_BOOTSTRAP_MAX_FILE_SIZE) {
+    fd = flashFs.open(path, "r");
+  }
+  if (!fd) {
+    output += "null";
+    return;
+  }
+  size_t start = output.size();
+  output.resize(start + entry_stat.st_size);
+  size_t read = fread(&output[start], 1, entry_stat.st_size, fd);
+  flashFs.close(fd);
+  if (read != (size_t)entry_stat.st_size) {
+    esp3d_log_e("Error reading %s", path);
+    output.resize(start);
+    output += "null";
+  }
+}
+
+// Answer of an [ESPxxx] command as it would be sent to /command
+static void add_command(httpd_req_t *req, std::string &output,
+                        const char *cmd, ESP3DAuthenticationLevel level) {
+  size_t start = output.size();
+  ESP3DMessage *newMsgPtr =
+      ESP3DClient::newMsg(ESP3DClientType::webui, ESP3DClientType::command,
+                          (const uint8_t *)cmd, strlen(cmd), level);
+  if (newMsgPtr) {
+    newMsgPtr->request_id.http_request = req;
+    esp3dHttpService.startCapture(req, &output);
+    esp3dCommands.process(newMsgPtr);
+    esp3dHttpService.stopCapture();
+  }
+  if (output.size() == start) {
+    output += "null";
+  }
+}
+
+// Whole bundle as JSON, each part is what webui would get by its own request
+static void build_bootstrap(httpd_req_t *req, std::string &output,
+                            const std::string &esp800,
+                            const std::string &lang,
+                            ESP3DAuthenticationLevel level) {
+  output = "{\"ESP800\":";
+  output += esp800;
+  output += ",\"ESP400\":";
+  add_command(req, output, "[ESP400]json=yes", level);
+  output += ",\"ESP420\":";
+  add_command(req, output, "[ESP420]json=yes", level);
+  output += ",\"preferences\":";
+  if (flashFs.accessFS()) {
+    add_file(output, "/preferences.json");
+    output += ",\"files\":";
+    size_t start = output.size();
+    esp3dHttpService.startCapture(req, &output);
+    if (esp3dHttpService.sendFilesList(req, "/", "ok") != ESP_OK) {
+      output.resize(start);
+      output += "null";
+    }
+    esp3dHttpService.stopCapture();
+    if (lang.length() > 0) {
+      output += ",\"lang\":";
+      add_file(output, lang.c_str());
+    }
+    flashFs.releaseFS();
+  } else {
+    output += "null,\"files\":null";
+  }
+  output += "}";
+}
+
+void ESP3DHttpService::_clearBootstrap() {
+  if (bootstrap_cache) {
+    delete bootstrap_cache;
+    bootstrap_cache = nullptr;
+  }
+}
+
+// Everything webui asks at connection in one answer: ESP800, ESP400, ESP420,
+// preferences, flash files list and optional language file (?lang=<file>)
+// ?time=, ?tz= and ?version= are passed to ESP800 like webui does
+// Compressed answer is kept and sent again until settings or flash files
+// change, SD card is not listed as it may be busy printing
+esp_err_t ESP3DHttpService::bootstrap_handler(httpd_req_t *req) {
+  ESP3DAuthenticationLevel authentication_level = getAuthenticationLevel(req);
+  // Send httpd header
+  httpd_resp_set_http_hdr(req);
+#if ESP3D_AUTHENTICATION_FEATURE
+  if (authentication_level == ESP3DAuthenticationLevel::guest) {
+    // send 401
+    return not_authenticated_handler(req);
+  }
+#endif  // #if ESP3D_AUTHENTICATION_FEATURE
+  esp3d_log("Uri: %s", req->uri);
+  std::string lang;
+  std::string esp800_cmd = "[ESP800]json=yes";
+  char param[255 + 1] = {0};
+  size_t buf_len = httpd_req_get_url_query_len(req) + 1;
+  if (buf_len > 1) {
+    char *buf = (char *)malloc(buf_len);
+    if (buf && httpd_req_get_url_query_str(req, buf, buf_len) == ESP_OK) {
+      if (httpd_query_key_value(buf, "lang", param, 255) == ESP_OK) {
+        esp3d_string::urlDecodeInPlace(param);
+        lang = param;
+        esp3d_log("lang is: %s", lang.c_str());
+      }
+      for (const char *key : {"time", "tz", "version"}) {
+        if (httpd_query_key_value(buf, key, param, 255) == ESP_OK) {
+          esp3d_string::urlDecodeInPlace(param);
+          // a space would end the parameter value in command
+          if (strchr(param, ' ')) {
+            esp3d_log_w("Invalid %s: %s", key, param);
+            continue;
+          }
+          esp800_cmd += " ";
+          esp800_cmd += key;
+          esp800_cmd += "=";
+          esp800_cmd += param;
+        }
+      }
+    }
+    free(buf);
+  }
+  if (lang.length() > 0) {
+    if (lang.find("..") != std::string::npos) {
+      esp3d_log_e("Invalid lang file: %s", lang.c_str());
+      httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid request");
+      return ESP_FAIL;
+    }
+    if (lang[0] != '/') {
+      lang = "/" + lang;
+    }
+  }
+  bool gzip = esp3dHttpService.acceptGzip(req);
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+  httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+  // ESP800 always runs as it sets time, its answer is part of cache key
+  std::string esp800;
+  add_command(req, esp800, esp800_cmd.c_str(), authentication_level);
+  if (!gzip) {
+    // not worth caching for a client that does not support compression
+    std::string output;
+    build_bootstrap(req, output, esp800, lang, authentication_level);
+    return httpd_resp_send(req, output.c_str(), output.size());
+  }
+  int64_t now = esp_timer_get_time() / 1000;
+  ESP3DBootstrapCache *cache = bootstrap_cache;
+  if (cache &&
+      (cache->settings_id != esp3dTftsettings.getChangeId() ||
+       cache->esp800 != esp800 ||
+       cache->files_id != flashFs.getChangeId() || cache->lang != lang ||
+       cache->level != authentication_level ||
+       now - cache->time > ESP3D_BOOTSTRAP_MAX_AGE)) {
+    esp3d_log("Bootstrap bundle is outdated");
+    esp3dHttpService._clearBootstrap();
+    cache = nullptr;
+  }
+  if (!cache) {
+#if ESP3D_TFT_BENCHMARK
+    int64_t start_build = esp_timer_get_time();
+#endif  // ESP3D_TFT_BENCHMARK
+    std::string output;
+    uint32_t settings_id = esp3dTftsettings.getChangeId();
+    uint32_t files_id = flashFs.getChangeId();
+    build_bootstrap(req, output, esp800, lang, authentication_level);
+    // ids are read again after build: bundle is only kept if nothing changed
+    // meanwhile, reading files does not change flash id
+    bool keep = settings_id == esp3dTftsettings.getChangeId() &&
+                files_id == flashFs.getChangeId();
+    cache = new (std::nothrow) ESP3DBootstrapCache;
+    ESP3DDeflate deflate;
+    if (!cache ||
+        !deflate.begin(ESP3DDeflateFormat::gzip, append_output,
+                       &cache->data) ||
+        !deflate.write((const uint8_t *)output.c_str(), output.size()) ||
+        !deflate.end()) {
+      esp3d_log_e("Bootstrap bundle compression failed");
+      if (cache) {
+        delete cache;
+      }
+      // still answer, without compression
+      return httpd_resp_send(req, output.c_str(), output.size());
+    }
+    if (!keep) {
+      esp3d_log("Bootstrap bundle changed during build, not kept");
+      httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+      esp_err_t res =
+          httpd_resp_send(req, cache->data.c_str(), cache->data.size());
+      delete cache;
+      return res;
+    }
+    cache->esp800 = esp800;
+    cache->lang = lang;
+    cache->level = authentication_level;
+    cache->settings_id = settings_id;
+    cache->files_id = files_id;
+    cache->time = now;
+    bootstrap_cache = cache;
+#if ESP3D_TFT_BENCHMARK
+    esp3d_report("Bootstrap bundle: %d bytes, %d gzipped, built in %lld us",
+                 output.size(), cache->data.size(),
+                 esp_timer_get_time() - start_build);
+#endif  // ESP3D_TFT_BENCHMARK
+  }
+  httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+  return httpd_resp_send(req, cache->data.c_str(), cache->data.size());
+}
@@ -24,9 +24,51 @@
 #include "esp3d_settings.h"
 #include "esp3d_string.h"
 #include "esp_wifi.h"
+#include "gcode_host/esp3d_gcode_host_service.h"
+#include "http/esp3d_http_chunk_writer.h"
 #include "http/esp3d_http_service.h"
 #include "network/esp3d_network.h"
 
+// max size of commands batch posted at once
+#define ESP3D_MAX_BATCH_COMMANDS_SIZE (16 * 1024)
+#define ESP3D_MAX_BATCH_COMMAND_LENGTH 255
+
+// Send status of a stream as json
+static esp_err_t send_stream_status(httpd_req_t *req, uint64_t id) {
+  ESP3DGcodeStreamStatus status;
+  if (!gcodeHostService.getStreamStatus(id, &status)) {
+    httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown stream");
+    return ESP_FAIL;
+  }
+  std::string state;
+  switch (status.state) {
+    case ESP3DGcodeStreamState::start:
+      state = status.processedSize == 0 ? "queued" : "processing";
+      break;
+    case ESP3DGcodeStreamState::paused:
+      state = "paused";
+      break;
+    case ESP3DGcodeStreamState::end:
+      state = status.error == ESP3DGcodeHostError::no_error ? "done" : "error";
+      break;
+    case ESP3DGcodeStreamState::error:
+      state = "error";
+      break;
+    default:
+      state = "processing";
+      break;
+  }
+  std::string response = "{\"id\":\"" + std::to_string(status.id) +
+                         "\",\"status\":\"" + state + "\",\"processed\":" +
+                         std::to_string(status.processedSize) +
+                         ",\"total\":" + std::to_string(status.totalSize) +
+                         ",\"error\":" +
+                         std::to_string(static_cast<uint8_t>(status.error)) +
+                         "}";
+  httpd_resp_set_type(req, "application/json");
+  return httpd_resp_sendstr(req, response.c_str());
+}
+
 esp_err_t ESP3DHttpService::command_handler(httpd_req_t *req) {
   // TODO: check authentication level
   ESP3DAuthenticationLevel authentication_level = getAuthenticationLevel(req);
@@ -47,8 +89,12 @@ esp_err_t ESP3DHttpService::command_handler(httpd_req_t *req) {
     buf = (char *)malloc(buf_len);
     if (httpd_req_get_url_query_str(req, buf, buf_len) == ESP_OK) {
       esp3d_log("query string: %s", buf);
-      if (httpd_query_key_value(buf, "cmd", cmd, 255) == ESP_OK) {
-        strcpy(cmd, esp3d_string::urlDecode(cmd));
+      if (httpd_query_key_value(buf, "stream", cmd, 255) == ESP_OK) {
+        // polling of a commands batch
+        free(buf);
+        return send_stream_status(req, strtoull(cmd, nullptr, 10));
+      } else if (httpd_query_key_value(buf, "cmd", cmd, 255) == ESP_OK) {
+        esp3d_string::urlDecodeInPlace(cmd);
         esp3d_log("command is: %s", cmd);
       } else if (httpd_query_key_value(buf, "PING", cmd, 255) == ESP_OK) {
         if (strcmp(cmd, "PING") == 0) {
@@ -75,7 +121,13 @@ esp_err_t ESP3DHttpService::command_handler(httpd_req_t *req) {
           (const uint8_t *)cmd, strlen(cmd), authentication_level);
       if (newMsgPtr) {
         newMsgPtr->request_id.http_request = req;
+        // answer is complete when process returns, it is batched in big
+        // chunks and compressed if it is big, like ESP400 or ESP420
+        ESP3DChunkWriter writer(req);
+        esp3dHttpService.startWriter(req, &writer);
         esp3dCommands.process(newMsgPtr);
+        esp3dHttpService.stopWriter();
+        writer.end();
         return ESP_OK;
       } else {
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
@@ -103,3 +155,108 @@ esp_err_t ESP3DHttpService::command_handler(httpd_req_t *req) {
   }
   return ESP_FAIL;
 }
+
+// Commands batch: body is a list of commands separated by '\n'
+// Body is received by chunks and copied to the stream buffer without empty
+// lines and '\r', then it is processed as one multiple commands stream by
+// gcode host, the returned stream id can be polled with /command?stream=<id>
+// Whole body is kept (ESP3D_MAX_BATCH_COMMANDS_SIZE max) on purpose: a batch
+// with a too long line or a lost connection is rejected before any command
+// reaches the printer, and one stream gives one id to poll
+esp_err_t ESP3DHttpService::command_batch_handler(httpd_req_t *req) {
+  ESP3DAuthenticationLevel authentication_level = getAuthenticationLevel(req);
+  // Send httpd header
+  httpd_resp_set_http_hdr(req);
+#if ESP3D_AUTHENTICATION_FEATURE
+  if (authentication_level == ESP3DAuthenticationLevel::guest) {
+    _clearPayload(req);
+    // send 401
+    return not_authenticated_handler(req);
+  }
+#endif  // #if ESP3D_AUTHENTICATION_FEATURE
+  esp3d_log("Uri: %s, %d bytes", req->uri, req->content_len);
+  if (req->content_len == 0) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid request");
+    return ESP_FAIL;
+  }
+  if (req->content_len > ESP3D_MAX_BATCH_COMMANDS_SIZE) {
+    esp3d_log_e("Commands batch too large: %d", req->content_len);
+    _clearPayload(req);
+    httpd_resp_set_status(req, "413 Payload Too Large");
+    httpd_resp_sendstr(req, "Commands batch too large");
+    return ESP_FAIL;
+  }
+  char *commands = (char *)malloc(req->content_len + 1);
+  if (commands == nullptr) {
+    esp3d_log_e("Memory allocation failed");
+    _clearPayload(req);
+    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                        "Memory allocation failed");
+    return ESP_FAIL;
+  }
+  size_t commands_size = 0;
+  size_t line_size = 0;
+  size_t remaining = req->content_len;
+  const char *error_msg = nullptr;
+  while (remaining > 0 && !error_msg) {
+    int received = httpd_req_recv(
+        req, _chunk,
+        remaining < CHUNK_BUFFER_SIZE ? remaining : CHUNK_BUFFER_SIZE);
+    if (received == HTTPD_SOCK_ERR_TIMEOUT) {
+      esp3d_log_e("Time out");
+      continue;
+    }
+    if (received <= 0) {
+      esp3d_log_e("Error connection");
+      error_msg = "Connection lost";
+      break;
+    }
+    remaining -= received;
+    for (int i = 0; i < received; i++) {
+      char c = _chunk[i];
+      if (c == '\r') {
+        continue;
+      }
+      if (c == '\n') {
+        // skip empty lines
+        if (line_size > 0) {
+          commands[commands_size++] = '\n';
+          line_size = 0;
+        }
+        continue;
+      }
+      if (line_size >= ESP3D_MAX_BATCH_COMMAND_LENGTH) {
+        esp3d_log_e("Command too long");
+        error_msg = "Command too long";
+        break;
+      }
+      commands[commands_size++] = c;
+      line_size++;
+    }
+  }
+  if (!error_msg && commands_size == 0) {
+    error_msg = "No command";
+  }
+  if (error_msg) {
+    free(commands);
+    if (remaining > 0) {
+      _clearPayload(req);
+    }
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, error_msg);
+    return ESP_FAIL;
+  }
+  commands[commands_size] = 0x0;
+  uint64_t stream_id = 0;
+  // on success buffer is now owned by gcode host
+  if (!gcodeHostService.addCommandsStream(commands, commands_size,
+                                          authentication_level, &stream_id)) {
+    free(commands);
+    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                        "Cannot queue commands");
+    return ESP_FAIL;
+  }
+  std::string response =
+      "{\"status\":\"ok\",\"id\":\"" + std::to_string(stream_id) + "\"}";
+  httpd_resp_set_type(req, "application/json");
+  return httpd_resp_sendstr(req, response.c_str());
+}
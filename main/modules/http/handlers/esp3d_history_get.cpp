@@ -0,0 +1,155 @@
+/*
+  esp3d_http_service
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "authentication/esp3d_authentication.h"
+#include "esp3d_log.h"
+#include "esp3d_string.h"
+#include "history/esp3d_history.h"
+#include "http/esp3d_http_service.h"
+
+// Samples read from history at once
+#define HISTORY_BLOCK_SIZE 32
+
+// Header of binary export, followed by samples as little endian int16 min/max
+struct __attribute__((packed)) ESP3DHistoryBinaryHeader {
+  char magic[4];  // "E3DH"
+  uint8_t version;
+  uint8_t channel;
+  uint16_t scale;
+  uint32_t period;
+  uint32_t from;
+  uint32_t count;
+};
+
+// /history?channel=bed&resolution=long&format=json&from=0
+// from is the sequence of first sample wanted, so client can only ask for new
+// samples using the "next" value of previous answer
+esp_err_t ESP3DHttpService::history_get_handler(httpd_req_t *req) {
+  esp3d_log("Uri: %s", req->uri);
+  // Send httpd header
+  httpd_resp_set_http_hdr(req);
+#if ESP3D_AUTHENTICATION_FEATURE
+  ESP3DAuthenticationLevel authentication_level = getAuthenticationLevel(req);
+  if (authentication_level == ESP3DAuthenticationLevel::guest) {
+    // send 401
+    return not_authenticated_handler(req);
+  }
+#endif  // #if ESP3D_AUTHENTICATION_FEATURE
+  ESP3DHistoryChannel channel = ESP3DHistoryChannel::ext_0_temperature;
+  ESP3DHistoryResolution resolution = ESP3DHistoryResolution::short_term;
+  bool binary = false;
+  uint32_t from = 0;
+  size_t buf_len = httpd_req_get_url_query_len(req);
+  if (buf_len > 0) {
+    buf_len++;  // for 0x0
+    char *buf = (char *)malloc(buf_len);
+    if (buf && httpd_req_get_url_query_str(req, buf, buf_len) == ESP_OK) {
+      char value[32] = {0};
+      if (httpd_query_key_value(buf, "channel", value, sizeof(value)) ==
+              ESP_OK &&
+          !esp3dHistory.getChannel(value, channel)) {
+        free(buf);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid channel");
+        return ESP_FAIL;
+      }
+      if (httpd_query_key_value(buf, "resolution", value, sizeof(value)) ==
+              ESP_OK &&
+          strcmp(value, "long") == 0) {
+        resolution = ESP3DHistoryResolution::long_term;
+      }
+      if (httpd_query_key_value(buf, "format", value, sizeof(value)) ==
+              ESP_OK &&
+          strcmp(value, "bin") == 0) {
+        binary = true;
+      }
+      if (httpd_query_key_value(buf, "from", value, sizeof(value)) == ESP_OK) {
+        from = strtoul(value, nullptr, 10);
+      }
+    }
+    free(buf);
+  }
+  ESP3DHistorySample samples[HISTORY_BLOCK_SIZE];
+  // limit answer to samples available now
+  uint32_t last = esp3dHistory.getSequence(resolution);
+  uint32_t size = esp3dHistory.getSize(resolution);
+  if (from > last || last - from > size) {
+    from = last > size ? last - size : 0;
+  }
+  uint32_t count = last - from;
+  if (binary) {
+    ESP3DHistoryBinaryHeader header = {
+        {'E', '3', 'D', 'H'},
+        1,
+        static_cast<uint8_t>(channel),
+        ESP3D_HISTORY_SCALE,
+        esp3dHistory.getPeriod(resolution),
+        from,
+        count};
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_send_chunk(req, (const char *)&header, sizeof(header));
+  } else {
+    httpd_resp_set_type(req, "application/json");
+    std::string head = "{\"channel\":\"";
+    head += esp3dHistory.getChannelName(channel);
+    head += "\",\"period\":";
+    head += std::to_string(esp3dHistory.getPeriod(resolution));
+    head += ",\"scale\":";
+    head += std::to_string(ESP3D_HISTORY_SCALE);
+    head += ",\"from\":";
+    head += std::to_string(from);
+    head += ",\"next\":";
+    head += std::to_string(last);
+    head += ",\"samples\":[";
+    httpd_resp_send_chunk(req, head.c_str(), head.length());
+  }
+  // ",[min,max]" or ",null", each sample is 16 chars max
+  char text[HISTORY_BLOCK_SIZE * 16 + 1];
+  bool first = true;
+  while (count > 0) {
+    uint32_t nb = esp3dHistory.getSamples(
+        channel, resolution, from, samples,
+        count > HISTORY_BLOCK_SIZE ? HISTORY_BLOCK_SIZE : count);
+    if (nb == 0) {
+      break;
+    }
+    count -= nb;
+    if (binary) {
+      httpd_resp_send_chunk(req, (const char *)samples,
+                            nb * sizeof(ESP3DHistorySample));
+      continue;
+    }
+    size_t pos = 0;
+    for (uint32_t i = 0; i < nb; i++) {
+      if (samples[i].min == ESP3D_HISTORY_NO_VALUE) {
+        pos += snprintf(text + pos, sizeof(text) - pos, "%snull",
+                        first ? "" : ",");
+      } else {
+        pos += snprintf(text + pos, sizeof(text) - pos, "%s[%d,%d]",
+                        first ? "" : ",", samples[i].min, samples[i].max);
+      }
+      first = false;
+    }
+    httpd_resp_send_chunk(req, text, pos);
+  }
+  if (!binary) {
+    httpd_resp_send_chunk(req, "]}", 2);
+  }
+  httpd_resp_send_chunk(req, NULL, 0);
+  return ESP_OK;
+}
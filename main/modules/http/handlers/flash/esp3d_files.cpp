@@ -22,6 +22,7 @@
 #include "esp3d_log.h"
 #include "esp3d_string.h"
 #include "filesystem/esp3d_flash.h"
+#include "http/esp3d_http_chunk_writer.h"
 #include "http/esp3d_http_service.h"
 
 #if ESP3D_TIMESTAMP_FEATURE
@@ -60,7 +61,8 @@ esp_err_t ESP3DHttpService::files_handler(httpd_req_t *req) {
     if (httpd_req_get_url_query_str(req, buf, buf_len) == ESP_OK) {
       esp3d_log("query string: %s", buf);
       if (httpd_query_key_value(buf, "path", param, 255) == ESP_OK) {
-        path = esp3d_string::urlDecode(param);
+        esp3d_string::urlDecodeInPlace(param);
+        path = param;
         esp3d_log("path is: %s", path.c_str());
       }
       if (httpd_query_key_value(buf, "action", param, 255) == ESP_OK) {
@@ -68,7 +70,8 @@ esp_err_t ESP3DHttpService::files_handler(httpd_req_t *req) {
         esp3d_log("action is: %s", action.c_str());
       }
       if (httpd_query_key_value(buf, "filename", param, 255) == ESP_OK) {
-        filename = esp3d_string::urlDecode(param);
+        esp3d_string::urlDecodeInPlace(param);
+        filename = param;
         esp3d_log("filename is: %s", filename.c_str());
       }
     }
@@ -109,99 +112,114 @@ esp_err_t ESP3DHttpService::files_handler(httpd_req_t *req) {
         }
       }
     }
-    size_t totalSpace = 0;
-    size_t usedSpace = 0;
-    flashFs.getSpaceInfo(&totalSpace, &usedSpace, nullptr, true);
-    uint8_t occupation = 0;
-    if (totalSpace == 0) {
-      status = "Error getting space info";
-    } else {
-      occupation = round(100.0 * usedSpace / totalSpace);
-      if (occupation == 0 && usedSpace != 0) {
-        occupation = 1;
-      }
+    // entries are batched in big chunks, and compressed if list is big
+    ESP3DChunkWriter writer(req);
+    esp3dHttpService.startWriter(req, &writer);
+    esp_err_t res = esp3dHttpService.sendFilesList(req, path, status);
+    esp3dHttpService.stopWriter();
+    if (!writer.end()) {
+      res = ESP_FAIL;
     }
+    flashFs.releaseFS();
+    return res;
+  } else {
+    httpd_resp_sendstr(req, "{\"status\":\"error accessing filesystem\"}");
+    return ESP_FAIL;
+  }
+}
 
-    // head of json
-    if (esp3dHttpService.sendStringChunk(req, "{\"files\":[") != ESP_OK) {
-      flashFs.releaseFS();
-      return ESP_FAIL;
+// JSON list of a flash directory, filesystem must be accessed by caller
+esp_err_t ESP3DHttpService::sendFilesList(httpd_req_t *req,
+                                          const std::string &path,
+                                          std::string status) {
+  std::string tmpstr;
+  std::string currentPath;
+  size_t totalSpace = 0;
+  size_t usedSpace = 0;
+  flashFs.getSpaceInfo(&totalSpace, &usedSpace, nullptr, true);
+  uint8_t occupation = 0;
+  if (totalSpace == 0) {
+    status = "Error getting space info";
+  } else {
+    occupation = round(100.0 * usedSpace / totalSpace);
+    if (occupation == 0 && usedSpace != 0) {
+      occupation = 1;
     }
-    DIR *dir = flashFs.opendir(path.c_str());
+  }
 
-    if (dir) {
-      struct dirent *entry;
-      struct stat entry_stat;
-      uint nentries = 0;
-      while ((entry = flashFs.readdir(dir)) != NULL) {
-        currentPath = path;
-        tmpstr = "";
-        if (nentries > 0) {
-          tmpstr += ",";
-        }
-        nentries++;
-        if (path[path.length() - 1] != '/') {
-          currentPath += "/";
-        }
-        currentPath += entry->d_name;
-        if (entry->d_type == DT_DIR) {
-          tmpstr += "{\"name\":\"";
-          tmpstr += entry->d_name;
-          tmpstr += "\",\"size\":\"-1\"}";
+  // head of json
+  if (esp3dHttpService.sendStringChunk(req, "{\"files\":[") != ESP_OK) {
+    return ESP_FAIL;
+  }
+  DIR *dir = flashFs.opendir(path.c_str());
 
-        } else {
-          if (flashFs.stat(currentPath.c_str(), &entry_stat) == -1) {
-            esp3d_log_e("Failed to stat %s : %s",
-                        entry->d_type == DT_DIR ? "DIR" : "FILE",
-                        currentPath.c_str());
-            continue;
-          }
+  if (dir) {
+    struct dirent *entry;
+    struct stat entry_stat;
+    uint nentries = 0;
+    while ((entry = flashFs.readdir(dir)) != NULL) {
+      currentPath = path;
+      tmpstr = "";
+      if (nentries > 0) {
+        tmpstr += ",";
+      }
+      nentries++;
+      if (path[path.length() - 1] != '/') {
+        currentPath += "/";
+      }
+      currentPath += entry->d_name;
+      if (entry->d_type == DT_DIR) {
+        tmpstr += "{\"name\":\"";
+        tmpstr += entry->d_name;
+        tmpstr += "\",\"size\":\"-1\"}";
+
+      } else {
+        if (flashFs.stat(currentPath.c_str(), &entry_stat) == -1) {
+          esp3d_log_e("Failed to stat %s : %s",
+                      entry->d_type == DT_DIR ? "DIR" : "FILE",
+                      currentPath.c_str());
+          continue;
+        }
 #if ESP3D_TIMESTAMP_FEATURE
-          char buff[20];
-          strftime(buff, sizeof(buff), "%Y-%m-%d %H:%M:%S",
-                   localtime(&(entry_stat.st_mtim.tv_sec)));
+        char buff[20];
+        strftime(buff, sizeof(buff), "%Y-%m-%d %H:%M:%S",
+                 localtime(&(entry_stat.st_mtim.tv_sec)));
 #endif  // ESP3D_TIMESTAMP_FEATURE
-          tmpstr += "{\"name\":\"";
-          tmpstr += entry->d_name;
-          tmpstr += "\",\"size\":\"";
-          tmpstr += esp3d_string::formatBytes(entry_stat.st_size);
+        tmpstr += "{\"name\":\"";
+        tmpstr += entry->d_name;
+        tmpstr += "\",\"size\":\"";
+        tmpstr += esp3d_string::formatBytes(entry_stat.st_size);
 #if ESP3D_TIMESTAMP_FEATURE
-          tmpstr += "\",\"time\":\"";
-          tmpstr += buff;
+        tmpstr += "\",\"time\":\"";
+        tmpstr += buff;
 #endif  // ESP3D_TIMESTAMP_FEATURE
-          tmpstr += "\"}";
-        }
-        if (esp3dHttpService.sendStringChunk(req, tmpstr.c_str()) != ESP_OK) {
-          flashFs.releaseFS();
-          return ESP_FAIL;
-        }
+        tmpstr += "\"}";
+      }
+      if (esp3dHttpService.sendStringChunk(req, tmpstr.c_str()) != ESP_OK) {
+        flashFs.closedir(dir);
+        return ESP_FAIL;
       }
-    } else {
-      status = "error cannot access ";
-      status += path;
-    }
-
-    tmpstr = "],\"path\":\"";
-    tmpstr += path;
-    tmpstr += "\",\"occupation\":\"";
-    tmpstr += std::to_string(occupation);
-    tmpstr += "\",\"status\":\"";
-    tmpstr += status;
-    tmpstr += "\",\"total\":\"";
-    tmpstr += esp3d_string::formatBytes(totalSpace);
-    tmpstr += "\",\"used\":\"";
-    tmpstr += esp3d_string::formatBytes(usedSpace);
-    tmpstr += "\"}";
-    if (esp3dHttpService.sendStringChunk(req, tmpstr.c_str()) != ESP_OK) {
-      flashFs.releaseFS();
-      return ESP_FAIL;
     }
-    // end of json
-    httpd_resp_send_chunk(req, NULL, 0);
-    flashFs.releaseFS();
-    return ESP_OK;
+    flashFs.closedir(dir);
   } else {
-    httpd_resp_sendstr(req, "{\"status\":\"error accessing filesystem\"}");
+    status = "error cannot access ";
+    status += path;
+  }
+
+  tmpstr = "],\"path\":\"";
+  tmpstr += path;
+  tmpstr += "\",\"occupation\":\"";
+  tmpstr += std::to_string(occupation);
+  tmpstr += "\",\"status\":\"";
+  tmpstr += status;
+  tmpstr += "\",\"total\":\"";
+  tmpstr += esp3d_string::formatBytes(totalSpace);
+  tmpstr += "\",\"used\":\"";
+  tmpstr += esp3d_string::formatBytes(usedSpace);
+  tmpstr += "\"}";
+  if (esp3dHttpService.sendStringChunk(req, tmpstr.c_str()) != ESP_OK) {
     return ESP_FAIL;
   }
+  // end of json
+  return esp3dHttpService.sendChunk(req, NULL, 0);
 }
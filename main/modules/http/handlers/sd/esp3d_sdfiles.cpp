@@ -21,12 +21,14 @@
 
 #include "esp3d_log.h"
 #include "esp3d_string.h"
+#include "filesystem/esp3d_globalfs.h"
 #include "filesystem/esp3d_sd.h"
+#include "http/esp3d_http_chunk_writer.h"
 #include "http/esp3d_http_service.h"
 
-#if ESP3D_TIMESTAMP_FEATURE
-#include <time.h>
-#endif  // ESP3D_TIMESTAMP_FEATURE
+#if ESP3D_TFT_BENCHMARK
+#include "esp_timer.h"
+#endif  // ESP3D_TFT_BENCHMARK
 #include "authentication/esp3d_authentication.h"
 
 esp_err_t ESP3DHttpService::sdfiles_handler(httpd_req_t *req) {
@@ -43,7 +45,6 @@ esp_err_t ESP3DHttpService::sdfiles_handler(httpd_req_t *req) {
   char *buf;
   size_t buf_len;
   char param[255 + 1] = {0};
-  std::string tmpstr;
   std::string path = "/";
   std::string action;
   std::string filename;
@@ -60,7 +61,8 @@ esp_err_t ESP3DHttpService::sdfiles_handler(httpd_req_t *req) {
     if (httpd_req_get_url_query_str(req, buf, buf_len) == ESP_OK) {
       esp3d_log("query string: %s", buf);
       if (httpd_query_key_value(buf, "path", param, 255) == ESP_OK) {
-        path = esp3d_string::urlDecode(param);
+        esp3d_string::urlDecodeInPlace(param);
+        path = param;
         esp3d_log("path is: %s", path.c_str());
       }
       if (httpd_query_key_value(buf, "action", param, 255) == ESP_OK) {
@@ -68,7 +70,8 @@ esp_err_t ESP3DHttpService::sdfiles_handler(httpd_req_t *req) {
         esp3d_log("action is: %s", action.c_str());
       }
       if (httpd_query_key_value(buf, "filename", param, 255) == ESP_OK) {
-        filename = esp3d_string::urlDecode(param);
+        esp3d_string::urlDecodeInPlace(param);
+        filename = param;
         esp3d_log("filename is: %s", filename.c_str());
       }
     }
@@ -122,84 +125,72 @@ esp_err_t ESP3DHttpService::sdfiles_handler(httpd_req_t *req) {
       }
     }
 
+#if ESP3D_TFT_BENCHMARK
+    uint64_t startBenchmark = esp_timer_get_time();
+    uint32_t nentries = 0;
+#endif  // ESP3D_TFT_BENCHMARK
+    ESP3DChunkWriter writer(req);
+    char size_str[ESP3D_FORMAT_BYTES_SIZE];
     // head of json
-    if (esp3dHttpService.sendStringChunk(req, "{\"files\":[") != ESP_OK) {
-      sd.releaseFS();
-      return ESP_FAIL;
+    writer.write("{\"files\":[");
+    std::vector<ESP3DDirEntry> entries;
+    std::string dirPath = sd.mount_point();
+    if (path[0] != '/') {
+      dirPath += "/";
     }
-    DIR *dir = sd.opendir(path.c_str());
-
-    if (dir) {
-      struct dirent *entry;
-      struct stat entry_stat;
-      uint nentries = 0;
-      while ((entry = sd.readdir(dir)) != NULL) {
-        currentPath = path;
-        tmpstr = "";
-        if (nentries > 0) {
-          tmpstr += ",";
-        }
-        nentries++;
-        if (path[path.length() - 1] != '/') {
-          currentPath += "/";
-        }
-        currentPath += entry->d_name;
-        if (entry->d_type == DT_DIR) {
-          tmpstr += "{\"name\":\"";
-          tmpstr += entry->d_name;
-          tmpstr += "\",\"size\":\"-1\"}";
-
+    dirPath += path;
+    if (globalFs.listDir(dirPath.c_str(), entries)) {
+      bool isFirst = true;
+      for (const ESP3DDirEntry &entry : entries) {
+        writer.write(isFirst ? "{\"name\":\"" : ",{\"name\":\"");
+        isFirst = false;
+        writer.writeJson(entry.name.c_str());
+        if (entry.isDir) {
+          writer.write("\",\"size\":\"-1\"}");
         } else {
-          if (sd.stat(currentPath.c_str(), &entry_stat) == -1) {
-            esp3d_log_e("Failed to stat %s : %s",
-                        entry->d_type == DT_DIR ? "DIR" : "FILE",
-                        currentPath.c_str());
-            continue;
-          }
+          writer.write("\",\"size\":\"");
+          writer.write(esp3d_string::formatBytesTo(entry.size, size_str,
+                                                   sizeof(size_str)));
 #if ESP3D_TIMESTAMP_FEATURE
-          char buff[20];
-          strftime(buff, sizeof(buff), "%Y-%m-%d %H:%M:%S",
-                   localtime(&(entry_stat.st_mtim.tv_sec)));
+          writer.write("\",\"time\":\"");
+          writer.writeDate(entry.mtime, ESP3DChunkDateFormat::local);
 #endif  // ESP3D_TIMESTAMP_FEATURE
-          tmpstr += "{\"name\":\"";
-          tmpstr += entry->d_name;
-          tmpstr += "\",\"size\":\"";
-          tmpstr += esp3d_string::formatBytes(entry_stat.st_size);
-#if ESP3D_TIMESTAMP_FEATURE
-          tmpstr += "\",\"time\":\"";
-          tmpstr += buff;
-#endif  // ESP3D_TIMESTAMP_FEATURE
-          tmpstr += "\"}";
+          writer.write("\"}");
         }
-        if (esp3dHttpService.sendStringChunk(req, tmpstr.c_str()) != ESP_OK) {
-          sd.releaseFS();
-          return ESP_FAIL;
+        if (writer.hasError()) {
+          break;
         }
+#if ESP3D_TFT_BENCHMARK
+        nentries++;
+#endif  // ESP3D_TFT_BENCHMARK
       }
     } else {
       status = "error cannot access ";
       status += path;
     }
 
-    tmpstr = "],\"path\":\"";
-    tmpstr += path;
-    tmpstr += "\",\"occupation\":\"";
-    tmpstr += std::to_string(occupation);
-    tmpstr += "\",\"status\":\"";
-    tmpstr += status;
-    tmpstr += "\",\"total\":\"";
-    tmpstr += esp3d_string::formatBytes(totalSpace);
-    tmpstr += "\",\"used\":\"";
-    tmpstr += esp3d_string::formatBytes(usedSpace);
-    tmpstr += "\"}";
-    if (esp3dHttpService.sendStringChunk(req, tmpstr.c_str()) != ESP_OK) {
-      sd.releaseFS();
-      return ESP_FAIL;
-    }
+    writer.write("],\"path\":\"");
+    writer.writeJson(path.c_str());
+    writer.write("\",\"occupation\":\"");
+    writer.writeNumber(occupation);
+    writer.write("\",\"status\":\"");
+    writer.writeJson(status.c_str());
+    writer.write("\",\"total\":\"");
+    writer.write(
+        esp3d_string::formatBytesTo(totalSpace, size_str, sizeof(size_str)));
+    writer.write("\",\"used\":\"");
+    writer.write(
+        esp3d_string::formatBytesTo(usedSpace, size_str, sizeof(size_str)));
+    writer.write("\"}");
     // end of json
-    httpd_resp_send_chunk(req, NULL, 0);
+    bool sent = writer.end();
+#if ESP3D_TFT_BENCHMARK
+    esp3d_report("sdfiles %ld entries, %d bytes in %ld chunks, %.2f ms",
+                 nentries, writer.getSize(), writer.getChunksCount(),
+                 (esp_timer_get_time() - startBenchmark) / 1000.0);
+#endif  // ESP3D_TFT_BENCHMARK
     sd.releaseFS();
-    return ESP_OK;
+    return sent ? ESP_OK : ESP_FAIL;
   } else {
     httpd_resp_sendstr(req, "{\"status\":\"error accessing filesystem\"}");
     return ESP_FAIL;
@@ -16,6 +16,9 @@
   License along with this library; if not, write to the Free Software
   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
+#include <stdlib.h>
+
+#include "authentication/esp3d_authentication.h"
 #include "esp3d_log.h"
 #include "esp3d_hal.h"
 #include "esp3d_string.h"
@@ -23,6 +26,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "http/esp3d_http_service.h"
+#include "update/esp3d_ota_writer.h"
 
 esp_err_t ESP3DHttpService::updatefw_handler(httpd_req_t *req) {
   // No need Authentication as already handled in multipart_parser
@@ -34,3 +38,69 @@ esp_err_t ESP3DHttpService::updatefw_handler(httpd_req_t *req) {
   esp_restart();
   return ESP_OK;
 }
+
+// GET /updatefw?name=<file>&size=<n>
+// {"status":"interrupted","name":"fw.bin","size":1234567,"offset":262144}
+// offset is where same file can be resumed, 0 if it cannot
+esp_err_t ESP3DHttpService::updatefw_status_handler(httpd_req_t *req) {
+  esp3d_log("Uri: %s", req->uri);
+  httpd_resp_set_http_hdr(req);
+#if ESP3D_AUTHENTICATION_FEATURE
+  ESP3DAuthenticationLevel authentication_level = getAuthenticationLevel(req);
+  if (authentication_level != ESP3DAuthenticationLevel::admin) {
+    // send 401
+    return not_authenticated_handler(req);
+  }
+#endif  // #if ESP3D_AUTHENTICATION_FEATURE
+  std::string name = esp3dOtaWriter.getName();
+  size_t size = esp3dOtaWriter.getTotalSize();
+  size_t buf_len = httpd_req_get_url_query_len(req);
+  if (buf_len > 0) {
+    buf_len++;  // for 0x0
+    char *buf = (char *)malloc(buf_len);
+    if (buf && httpd_req_get_url_query_str(req, buf, buf_len) == ESP_OK) {
+      char value[128] = {0};
+      if (httpd_query_key_value(buf, "name", value, sizeof(value)) ==
+          ESP_OK) {
+        esp3d_string::urlDecodeInPlace(value);
+        name = value;
+      }
+      if (httpd_query_key_value(buf, "size", value, sizeof(value)) ==
+          ESP_OK) {
+        size = strtoul(value, nullptr, 10);
+      }
+    }
+    free(buf);
+  }
+  const char *status = "idle";
+  switch (esp3dOtaWriter.getState()) {
+    case ESP3DOtaState::writing:
+      status = "writing";
+      break;
+    case ESP3DOtaState::interrupted:
+      status = "interrupted";
+      break;
+    case ESP3DOtaState::done:
+      status = "done";
+      break;
+    case ESP3DOtaState::error:
+      status = "error";
+      break;
+    default:
+      break;
+  }
+  std::string answer = "{\"status\":\"";
+  answer += status;
+  answer += "\",\"name\":\"";
+  esp3d_string::appendJson(answer, esp3dOtaWriter.getName());
+  answer += "\",\"size\":";
+  answer += std::to_string(esp3dOtaWriter.getTotalSize());
+  answer += ",\"verified\":";
+  answer += std::to_string(esp3dOtaWriter.getVerifiedSize());
+  answer += ",\"offset\":";
+  answer +=
+      std::to_string(esp3dOtaWriter.getResumeOffset(name.c_str(), size));
+  answer += "}";
+  httpd_resp_set_type(req, "application/json");
+  return httpd_resp_sendstr(req, answer.c_str());
+}
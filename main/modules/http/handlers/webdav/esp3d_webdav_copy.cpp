@@ -47,8 +47,8 @@ esp_err_t ESP3DHttpService::webdav_copy_handler(httpd_req_t* req) {
 #if ESP3D_TFT_LOG >= ESP3D_TFT_LOG_LEVEL_DEBUG
   esp3d_log("Headers count: %d\n", showAllHeaders(req));
 #endif  // ESP3D_TFT_LOG >= ESP3D_LOG_LEVEL_
-  std::string uri =
-      esp3d_string::urlDecode(&req->uri[strlen(ESP3D_WEBDAV_ROOT) + 1]);
+  std::string uri = &req->uri[strlen(ESP3D_WEBDAV_ROOT) + 1];
+  esp3d_string::urlDecodeStringInPlace(uri);
   esp3d_log("Uri: %s", uri.c_str());
   // get header Destination
   size_t header_size = httpd_req_get_hdr_value_len(req, "Destination");
@@ -43,11 +43,12 @@ esp_err_t ESP3DHttpService::webdav_get_handler(httpd_req_t *req) {
 #endif  // ESP3D_TFT_LOG >= ESP3D_LOG_LEVEL_
 
   size_t file_size = 0;
+  bool send_failed = false;
   std::string content_type = "";
   std::string last_modified = "";
   esp3d_log("Uri: %s", req->uri);
-  std::string uri =
-      esp3d_string::urlDecode(&req->uri[strlen(ESP3D_WEBDAV_ROOT) + 1]);
+  std::string uri = &req->uri[strlen(ESP3D_WEBDAV_ROOT) + 1];
+  esp3d_string::urlDecodeStringInPlace(uri);
   esp3d_log("Uri: %s", uri.c_str());
 
   int payload_size = _clearPayload(req);
@@ -70,7 +71,9 @@ esp_err_t ESP3DHttpService::webdav_get_handler(httpd_req_t *req) {
         esp3d_log_e("Failed to stat");
       } else {
         // get last modified time
-        last_modified = esp3d_string::getTimeString(entry_stat.st_mtime, true);
+        char date[ESP3D_TIME_STRING_SIZE];
+        last_modified = esp3d_string::getTimeStringTo(entry_stat.st_mtime,
+                                                      true, date, sizeof(date));
         // Add Last-Modified header
         httpd_resp_set_hdr(req, "Last-Modified", last_modified.c_str());
         // is file ?
@@ -80,39 +83,20 @@ esp_err_t ESP3DHttpService::webdav_get_handler(httpd_req_t *req) {
           content_type = esp3d_string::getContentType(uri.c_str());
           // Add Content-Type header
           httpd_resp_set_type(req, content_type.c_str());
-          // Add Content-Length header
-          httpd_resp_set_hdr(req, "Content-Length",
-                             std::to_string(file_size).c_str());
 
           // open file
           FILE *fd = globalFs.open(uri.c_str(), "r");
           if (fd) {
-            size_t chunksize;
-            size_t total_send = 0;
-            // send file
-            do {
-              // Read data block from the file
-              chunksize = fread(_chunk, 1, CHUNK_BUFFER_SIZE, fd);
-              total_send += chunksize;
-              if (chunksize > 0) {
-                // Send the HTTP data block
-                if (httpd_resp_send_chunk(req, _chunk, chunksize) != ESP_OK) {
-                  esp3d_log_e("File sending failed!");
-                  chunksize = 0;
-                  response_code = 500;
-                  response_msg = "Failed to send file";
-                }
-              }
-            } while (chunksize != 0);
-            // Close the file
-            fclose(fd);
-            httpd_resp_send_chunk(req, NULL, 0);
-            // Check if all the file has been sent
-            if (total_send != file_size) {
-              esp3d_log_e("File sending failed: size do not match!");
-              response_code = 500;
-              response_msg = "File sending failed: size do not match!";
+            // send file, Content-Length and Range are handled here
+            if (esp3dHttpService.sendFileContent(req, fd, file_size,
+                                                 last_modified.c_str()) !=
+                ESP_OK) {
+              esp3d_log_e("File sending failed!");
+              // response already started, cannot send error code
+              send_failed = true;
             }
+            // Close the file
+            globalFs.close(fd, uri.c_str());
           } else {
             esp3d_log_e("Failed to open file");
             response_code = 500;
@@ -134,6 +118,7 @@ esp_err_t ESP3DHttpService::webdav_get_handler(httpd_req_t *req) {
     }
   }
   // send response code to client
+  if (send_failed) return ESP_FAIL;
   if (response_code == 200) return ESP_OK;
   return http_send_response(req, response_code, response_msg.c_str());
 }
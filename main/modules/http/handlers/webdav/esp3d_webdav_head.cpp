@@ -44,8 +44,8 @@ esp_err_t ESP3DHttpService::webdav_head_handler(httpd_req_t *req) {
 #if ESP3D_TFT_LOG >= ESP3D_TFT_LOG_LEVEL_DEBUG
   esp3d_log("Headers count: %d\n", showAllHeaders(req));
 #endif  // ESP3D_TFT_LOG >= ESP3D_LOG_LEVEL_
-  std::string uri =
-      esp3d_string::urlDecode(&req->uri[strlen(ESP3D_WEBDAV_ROOT) + 1]);
+  std::string uri = &req->uri[strlen(ESP3D_WEBDAV_ROOT) + 1];
+  esp3d_string::urlDecodeStringInPlace(uri);
   esp3d_log("Uri: %s", uri.c_str());
 
   int payload_size = _clearPayload(req);
@@ -68,7 +68,9 @@ esp_err_t ESP3DHttpService::webdav_head_handler(httpd_req_t *req) {
         esp3d_log_e("Failed to stat");
       } else {
         // get last modified time
-        last_modified = esp3d_string::getTimeString(entry_stat.st_mtime, true);
+        char date[ESP3D_TIME_STRING_SIZE];
+        last_modified = esp3d_string::getTimeStringTo(entry_stat.st_mtime,
+                                                      true, date, sizeof(date));
         // Add Last-Modified header
         httpd_resp_set_hdr(req, "Last-Modified", last_modified.c_str());
         // is file ?
@@ -37,8 +37,8 @@ esp_err_t ESP3DHttpService::webdav_options_handler(httpd_req_t *req) {
     esp3d_log_e("Webdav not active");
     return http_send_response(req, response_code, response_msg.c_str());
   }
-  std::string uri =
-      esp3d_string::urlDecode(&req->uri[strlen(ESP3D_WEBDAV_ROOT) + 1]);
+  std::string uri = &req->uri[strlen(ESP3D_WEBDAV_ROOT) + 1];
+  esp3d_string::urlDecodeStringInPlace(uri);
   esp3d_log("Uri: %s", uri.c_str());
 #if ESP3D_TFT_LOG >= ESP3D_TFT_LOG_LEVEL_DEBUG
   esp3d_log("Headers count: %d\n", showAllHeaders(req));
@@ -22,8 +22,13 @@
 #include "esp3d_log.h"
 #include "esp3d_string.h"
 #include "filesystem/esp3d_globalfs.h"
+#include "http/esp3d_http_chunk_writer.h"
 #include "http/esp3d_http_service.h"
 
+#if ESP3D_TFT_BENCHMARK
+#include "esp_timer.h"
+#endif  // ESP3D_TFT_BENCHMARK
+
 #define PROPFIND_RESPONSE_BODY_HEADER_1            \
   "<?xml version=\"1.0\" encoding=\"utf-8\"?>\r\n" \
   "<D:multistatus xmlns:D=\"DAV:\""
@@ -31,6 +36,50 @@
 
 #define PROPFIND_RESPONSE_BODY_FOOTER "</D:multistatus>\r\n"
 
+// Fixed parts of each entry, written with their size
+static const char PROPFIND_ENTRY_HREF[] =
+    "<D:response xmlns:esp3d=\"DAV:\">\r\n<D:href>/" ESP3D_WEBDAV_ROOT;
+static const char PROPFIND_ENTRY_LASTMODIFIED[] =
+    "</D:href>\r\n<D:propstat>\r\n<D:status>HTTP/1.1 200 "
+    "OK</D:status>\r\n<D:prop>\r\n<esp3d:getlastmodified>";
+static const char PROPFIND_ENTRY_CREATIONDATE[] =
+    "</esp3d:getlastmodified>\r\n<esp3d:creationdate>";
+static const char PROPFIND_ENTRY_DIR[] =
+    "</esp3d:creationdate>\r\n<D:resourcetype><D:collection/>"
+    "</D:resourcetype>\r\n<esp3d:displayname>";
+static const char PROPFIND_ENTRY_FILE[] =
+    "</esp3d:creationdate>\r\n<D:resourcetype/>\r\n"
+    "<esp3d:getcontentlength>";
+static const char PROPFIND_ENTRY_FILE_DISPLAYNAME[] =
+    "</esp3d:getcontentlength>\r\n<esp3d:displayname>";
+static const char PROPFIND_ENTRY_END[] =
+    "</esp3d:displayname>\r\n</D:prop>\r\n</D:propstat>\r\n"
+    "</D:response>\r\n";
+
+#define WRITE_FRAGMENT(writer, fragment) \
+  writer.write(fragment, sizeof(fragment) - 1)
+
+// path is relative to webdav root and starts with /
+static bool write_propfind_entry(ESP3DChunkWriter& writer, const char* path,
+                                 time_t mtime, time_t ctime, bool isDir,
+                                 uint64_t size, const char* displayname) {
+  WRITE_FRAGMENT(writer, PROPFIND_ENTRY_HREF);
+  writer.writeXml(path);
+  WRITE_FRAGMENT(writer, PROPFIND_ENTRY_LASTMODIFIED);
+  writer.writeDate(mtime, ESP3DChunkDateFormat::http);
+  WRITE_FRAGMENT(writer, PROPFIND_ENTRY_CREATIONDATE);
+  writer.writeDate(ctime, ESP3DChunkDateFormat::http);
+  if (isDir) {
+    WRITE_FRAGMENT(writer, PROPFIND_ENTRY_DIR);
+  } else {
+    WRITE_FRAGMENT(writer, PROPFIND_ENTRY_FILE);
+    writer.writeNumber(size);
+    WRITE_FRAGMENT(writer, PROPFIND_ENTRY_FILE_DISPLAYNAME);
+  }
+  writer.writeXml(displayname);
+  return WRITE_FRAGMENT(writer, PROPFIND_ENTRY_END);
+}
+
 esp_err_t ESP3DHttpService::webdav_propfind_handler(httpd_req_t* req) {
   esp3d_log("Method: %s", "PROPFIND");
   esp3d_log("Uri: %s", req->uri);
@@ -45,15 +94,14 @@ esp_err_t ESP3DHttpService::webdav_propfind_handler(httpd_req_t* req) {
     return http_send_response(req, response_code, response_msg.c_str());
   }
 
-  std::string response_body = "";
   std::string depth = "0";
   std::string requested_depth = "0";
   esp3d_log("Uri: %s", req->uri);
 #if ESP3D_TFT_LOG >= ESP3D_TFT_LOG_LEVEL_DEBUG
   esp3d_log("Headers count: %d\n", showAllHeaders(req));
 #endif  // ESP3D_TFT_LOG >= ESP3D_LOG_LEVEL_DEBUG
-  std::string uri =
-      esp3d_string::urlDecode(&req->uri[strlen(ESP3D_WEBDAV_ROOT) + 1]);
+  std::string uri = &req->uri[strlen(ESP3D_WEBDAV_ROOT) + 1];
+  esp3d_string::urlDecodeStringInPlace(uri);
   esp3d_log("Uri: %s", uri.c_str());
   // clear the payload
   int payload_size = _clearPayload(req);
@@ -96,146 +144,60 @@ esp_err_t ESP3DHttpService::webdav_propfind_handler(httpd_req_t* req) {
       httpd_resp_set_type(req, "application/xml; charset=\"utf-8\"");
       // Add Webdav headers
       httpd_resp_set_webdav_hdr(req);
-
-      response_body = PROPFIND_RESPONSE_BODY_HEADER_1;
+#if ESP3D_TFT_BENCHMARK
+      uint64_t startBenchmark = esp_timer_get_time();
+      uint32_t nbEntries = 1;
+#endif  // ESP3D_TFT_BENCHMARK
+      ESP3DChunkWriter writer(req);
+      writer.write(PROPFIND_RESPONSE_BODY_HEADER_1);
       if (depth != requested_depth) {
-        response_body += " depth=\"" + depth + "\"";
+        writer.write(" depth=\"");
+        writer.write(depth.c_str());
+        writer.write("\"");
       }
-      response_body += PROPFIND_RESPONSE_BODY_HEADER_2;
-      httpd_resp_send_chunk(req, response_body.c_str(), response_body.length());
-      esp3d_log("%s", response_body.c_str());
+      writer.write(PROPFIND_RESPONSE_BODY_HEADER_2);
 
       // stat on request first
-      response_body = "<D:response xmlns:esp3d=\"DAV:\">\r\n";
-      response_body += "<D:href>";
-      response_body += "/";
-      response_body += ESP3D_WEBDAV_ROOT;
-      if (uri != "/") response_body += uri;
-      response_body += "</D:href>\r\n";
-      response_body +=
-          "<D:propstat>\r\n<D:status>HTTP/1.1 200 "
-          "OK</D:status>\r\n<D:prop>\r\n";
-      response_body += "<esp3d:getlastmodified>";
-      response_body += esp3d_string::getTimeString(entry_stat.st_mtime, true);
-      response_body += "</esp3d:getlastmodified>\r\n";
-      response_body += "<esp3d:creationdate>";
-      response_body += esp3d_string::getTimeString(entry_stat.st_ctime, true);
-      response_body += "</esp3d:creationdate>\r\n";
-      // is dir
-      if (S_ISDIR(entry_stat.st_mode)) {
-        response_body += "<D:resourcetype><D:collection/></D:resourcetype>\r\n";
-        // space entries are only for directory at first level
-        // NOTE: letft for future implementation because windows actually does
-        // not support it for some reason (tested on windows 11) so it is not
-        // really usefull
-        /*uint64_t totalSpace = 0;
-        uint64_t usedSpace = 0;
-        uint64_t freeSpace = 0;
-        globalFs.getSpaceInfo(&totalSpace, &usedSpace, &freeSpace, uri.c_str(),
-                              true);
-        response_body += "<quota-available-bytes>";
-        response_body += std::to_string(freeSpace);
-        response_body += "</quota-available-bytes>\r\n";
-        response_body += "<quota-used-bytes>";
-        response_body += std::to_string(usedSpace);
-        response_body += "</quota-used-bytes>\r\n";
-        response_body += "<fs-total-space>";
-        response_body += esp3d_string::formatBytes(totalSpace);
-        response_body += "</fs-total-space>\r\n";
-        response_body += "<fs-free-space>";
-        response_body += esp3d_string::formatBytes(freeSpace);
-        response_body += "</fs-free-space>\r\n";
-        */
-      } else {  // is file
-        response_body += "<D:resourcetype/>\r\n";
-        response_body += "<esp3d:getcontentlength>" +
-                         std::to_string(entry_stat.st_size) +
-                         "</esp3d:getcontentlength>\r\n";
-      }
-      // DisplayName
-      response_body += "<esp3d:displayname>";
-      if (uri == "/") {
-        response_body += "/";
-      } else {
-        response_body += uri.substr(1);
-      }
-      response_body += "</esp3d:displayname>\r\n";
-      // end tags xml
-      response_body += "</D:prop>\r\n</D:propstat>\r\n</D:response>\r\n";
-      httpd_resp_send_chunk(req, response_body.c_str(), response_body.length());
-      esp3d_log("%s", response_body.c_str());
+      // space entries are only for directory at first level
+      // NOTE: left for future implementation because windows actually does
+      // not support it for some reason (tested on windows 11) so it is not
+      // really usefull: quota-available-bytes, quota-used-bytes,
+      // fs-total-space, fs-free-space from globalFs.getSpaceInfo()
+      write_propfind_entry(writer, uri == "/" ? "" : uri.c_str(),
+                           entry_stat.st_mtime, entry_stat.st_ctime,
+                           S_ISDIR(entry_stat.st_mode), entry_stat.st_size,
+                           uri == "/" ? "/" : uri.c_str() + 1);
 
       // reponse for the first only if dir or file
-      if (depth == "1" && S_ISDIR(entry_stat.st_mode)) {
+      if (depth == "1" && S_ISDIR(entry_stat.st_mode) && !writer.hasError()) {
         if (uri[uri.length() - 1] != '/') {
           uri += "/";
         }
         // do direct childs only
-        // parse directory direct children
-        DIR* dir = globalFs.opendir(uri.c_str());
+        // parse directory direct children, in one pass or from cache
+        std::vector<ESP3DDirEntry> entries;
         std::string currentPath;
-        if (dir) {
-          struct dirent* entry;
-          struct stat entry_stat;
-          // parse directory
-          while ((entry = globalFs.readdir(dir)) != NULL) {
-            currentPath = uri + entry->d_name;
-
-            // stat the entry
-            if (globalFs.stat(currentPath.c_str(), &entry_stat) == -1) {
-              esp3d_log_e("Failed to stat %s : %s",
-                          entry->d_type == DT_DIR ? "DIR" : "FILE",
-                          entry->d_name);
-              continue;
-            }
-            // build chunk
-            // stat on request first
-            response_body = "<D:response xmlns:esp3d=\"DAV:\">\r\n";
-            response_body += "<D:href>";
-            response_body += "/";
-            response_body += ESP3D_WEBDAV_ROOT;
-            if (currentPath[0] != '/') response_body += "/";
-            response_body += currentPath;
-            response_body += "</D:href>\r\n";
-            response_body +=
-                "<D:propstat>\r\n<D:status>HTTP/1.1 200 "
-                "OK</D:status>\r\n<D:prop>\r\n";
-            response_body += "<esp3d:getlastmodified>";
-            response_body +=
-                esp3d_string::getTimeString(entry_stat.st_mtime, true);
-            response_body += "</esp3d:getlastmodified>\r\n";
-            response_body += "<esp3d:creationdate>";
-            response_body +=
-                esp3d_string::getTimeString(entry_stat.st_ctime, true);
-            response_body += "</esp3d:creationdate>\r\n";
-            if (entry->d_type == DT_DIR) {
-              // is dir
-              response_body +=
-                  "<D:resourcetype><D:collection/></D:resourcetype>\r\n";
-            } else {
-              // is file
-              response_body += "<D:resourcetype/>\r\n";
-              response_body += "<esp3d:getcontentlength>" +
-                               std::to_string(entry_stat.st_size) +
-                               "</esp3d:getcontentlength>\r\n";
+        if (globalFs.listDir(uri.c_str(), entries)) {
+          for (const ESP3DDirEntry& entry : entries) {
+            currentPath = uri + entry.name;
+            if (!write_propfind_entry(writer, currentPath.c_str(), entry.mtime,
+                                      entry.ctime, entry.isDir, entry.size,
+                                      entry.name.c_str())) {
+              break;
             }
-            // DisplayName
-            response_body += "<esp3d:displayname>";
-            response_body += entry->d_name;
-            response_body += "</esp3d:displayname>\r\n";
-            // end tags xml
-            response_body += "</D:prop>\r\n</D:propstat>\r\n</D:response>\r\n";
-            httpd_resp_send_chunk(req, response_body.c_str(),
-                                  response_body.length());
-            esp3d_log("\n%s", response_body.c_str());
+#if ESP3D_TFT_BENCHMARK
+            nbEntries++;
+#endif  // ESP3D_TFT_BENCHMARK
           }
-          globalFs.closedir(dir);
         }
       }
-      httpd_resp_send_chunk(req, PROPFIND_RESPONSE_BODY_FOOTER,
-                            strlen(PROPFIND_RESPONSE_BODY_FOOTER));
-      esp3d_log("%s", PROPFIND_RESPONSE_BODY_FOOTER);
-      httpd_resp_send_chunk(req, NULL, 0);
+      writer.write(PROPFIND_RESPONSE_BODY_FOOTER);
+      writer.end();
+#if ESP3D_TFT_BENCHMARK
+      esp3d_report("PROPFIND %ld entries, %d bytes in %ld chunks, %.2f ms",
+                   nbEntries, writer.getSize(), writer.getChunksCount(),
+                   (esp_timer_get_time() - startBenchmark) / 1000.0);
+#endif  // ESP3D_TFT_BENCHMARK
     }
 
     // release access
@@ -55,8 +55,8 @@ esp_err_t ESP3DHttpService::webdav_put_handler(httpd_req_t* req) {
 #if ESP3D_TFT_LOG >= ESP3D_TFT_LOG_LEVEL_DEBUG
   esp3d_log("Headers count: %d\n", showAllHeaders(req));
 #endif  // ESP3D_TFT_LOG >= ESP3D_LOG_LEVEL_DEBUG
-  std::string uri =
-      esp3d_string::urlDecode(&req->uri[strlen(ESP3D_WEBDAV_ROOT) + 1]);
+  std::string uri = &req->uri[strlen(ESP3D_WEBDAV_ROOT) + 1];
+  esp3d_string::urlDecodeStringInPlace(uri);
   esp3d_log("Uri: %s", uri.c_str());
   bool overwrite = true;
 
@@ -104,7 +104,9 @@ esp_err_t ESP3DHttpService::webdav_put_handler(httpd_req_t* req) {
       if (overwrite) {
         time_t now;
         time(&now);
-        last_modified = esp3d_string::getTimeString(now, true);
+        char date[ESP3D_TIME_STRING_SIZE];
+        last_modified =
+            esp3d_string::getTimeStringTo(now, true, date, sizeof(date));
 
         httpd_resp_set_hdr(req, "Last-Modified", last_modified.c_str());
         // check free space
@@ -168,7 +170,7 @@ esp_err_t ESP3DHttpService::webdav_put_handler(httpd_req_t* req) {
                 }
               }
               // Close the file
-              fclose(fd);
+              globalFs.close(fd, uri.c_str());
               // Check if all the file has been sent
               if (hasError && total_read != file_size) {
                 esp3d_log_e(
@@ -28,6 +28,7 @@
 #include "lwip/apps/netbiosns.h"
 #endif  // ESP3D_WIFI_FEATURE
 #include "esp3d_commands.h"
+#include "esp3d_events.h"
 #include "esp3d_hal.h"
 #include "esp3d_log.h"
 #include "esp3d_settings.h"
@@ -133,6 +134,7 @@ static void wifi_sta_event_handler(void* arg, esp_event_base_t event_base,
     esp3dTftValues.set_string_value(ESP3DValuesIndex::status_bar_label,
                                     "0.0.0.0");
     xEventGroupSetBits(esp3dNetwork.getEventGroup(), WIFI_STA_LOST_IP);
+    esp3dEvents.notify(ESP3DEventConsumer::network);
   }
 }
 
@@ -237,6 +239,7 @@ bool ESP3DNetwork::begin() {
 bool ESP3DNetwork::setModeAsync(ESP3DRadioMode mode) {
   _async_radio_mode = mode;
   esp3d_log("Enabling async mode to %d", (uint8_t)_async_radio_mode);
+  esp3dEvents.notify(ESP3DEventConsumer::network);
   return true;
 }
 
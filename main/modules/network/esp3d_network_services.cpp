@@ -29,6 +29,9 @@
 #include "esp3d_values.h"
 #include "esp_wifi.h"
 #include "http/esp3d_http_service.h"
+#if ESP3D_HTTP_FEATURE
+#include "websocket/esp3d_webui_service.h"
+#endif  // ESP3D_HTTP_FEATURE
 
 #if ESP3D_NOTIFICATIONS_FEATURE
 #include "notifications/esp3d_notifications_service.h"
@@ -109,6 +112,9 @@ void ESP3DNetworkServices::handle() {
 #if ESP3D_TIMESTAMP_FEATURE
     esp3dTimeService.handle();
 #endif  // ESP3D_TIMESTAMP_FEATURE
+#if ESP3D_HTTP_FEATURE
+    esp3dWsWebUiService.handle();
+#endif  // ESP3D_HTTP_FEATURE
   }
 }
 
@@ -20,8 +20,9 @@
 
 #include "esp3d_tft_network.h"
 
-#include "esp3d_log.h"
+#include "esp3d_events.h"
 #include "esp3d_hal.h"
+#include "esp3d_log.h"
 #include "esp_event.h"
 #include "esp_freertos_hooks.h"
 #include "esp_system.h"
@@ -35,6 +36,8 @@
 #define STACKDEPTH NETWORK_STACK_DEPTH
 #define TASKPRIORITY NETWORK_TASK_PRIORITY
 #define TASKCORE NETWORK_TASK_CORE
+// Services are time based so wake up regularly even without event
+#define NETWORK_IDLE_TIMEOUT 100  // milliseconds
 
 /**********************
  *  STATIC PROTOTYPES
@@ -61,8 +64,8 @@ static void networkTask(void *pvParameter) {
   esp3dNetwork.begin();
   esp3d_hal::wait(100);
   while (1) {
-    /* Delay */
-    esp3d_hal::wait(10);
+    /* Wait for event or timeout */
+    esp3dEvents.wait(ESP3DEventConsumer::network, NETWORK_IDLE_TIMEOUT);
 
     if (pdTRUE == xSemaphoreTake(xNetworkSemaphore, portMAX_DELAY)) {
       esp3dTftnetwork.handle();
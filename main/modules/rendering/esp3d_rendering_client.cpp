@@ -22,11 +22,14 @@
 #include <stdio.h>
 
 #include "esp3d_commands.h"
+#include "esp3d_events.h"
 #include "esp3d_gcode_parser_service.h"
 #include "esp3d_hal.h"
 #include "esp3d_log.h"
+#include "esp3d_scheduling.h"
 #include "esp3d_settings.h"
 #include "esp3d_string.h"
+#include "esp3d_values.h"
 #include "freertos/task.h"
 #include "gcode_host/esp3d_gcode_host_service.h"
 #include "tasks_def.h"
@@ -37,14 +40,19 @@ ESP3DRenderingClient renderingClient;
 
 #define ESP3D_POLLING_INTERVAL 3000  // milliseconds
 
+// Rx queue notifies the task, timeout is for polling commands
+#define RENDERING_IDLE_TIMEOUT 100  // milliseconds
+
 // this task only collecting rendering RX data and push thenmm to Rx Queue
 static void esp3d_rendering_rx_task(void *pvParameter) {
   (void)pvParameter;
 
   while (1) {
-    /* Delay */
-    esp3d_hal::wait(10);
     renderingClient.handle();
+    /* Wait for event only if nothing left in queue */
+    if (renderingClient.getRxMsgsCount() == 0) {
+      esp3dEvents.wait(ESP3DEventConsumer::rendering, RENDERING_IDLE_TIMEOUT);
+    }
   }
   /* A task should NEVER return */
   vTaskDelete(NULL);
@@ -91,17 +99,24 @@ bool ESP3DRenderingClient::begin() {
     return false;
   }
   setRxMutex(&_rx_mutex);
+  setEventConsumer(ESP3DEventConsumer::rendering);
 
   _xGuiSemaphore = xSemaphoreCreateMutex();
 
   _started = true;
   BaseType_t res = xTaskCreatePinnedToCore(
       esp3d_rendering_rx_task, "esp3d_rendering_rx_task",
-      ESP3D_RENDERING_RX_TASK_SIZE, NULL, ESP3D_RENDERING_TASK_PRIORITY,
-      &_xHandle, ESP3D_RENDERING_TASK_CORE);
+      ESP3D_RENDERING_RX_TASK_SIZE, NULL,
+      esp3dScheduling.getPriority(ESP3DTaskRole::rendering,
+                                  ESP3D_RENDERING_TASK_PRIORITY),
+      &_xHandle,
+      esp3dScheduling.getCore(ESP3DTaskRole::rendering,
+                              ESP3D_RENDERING_TASK_CORE));
 
   if (res == pdPASS && _xHandle) {
     esp3d_log("Created Rendering Task");
+    esp3dScheduling.registerTask(ESP3DTaskRole::rendering, _xHandle,
+                                 ESP3D_RENDERING_TASK_PRIORITY);
     esp3d_log("Rendering client started");
     flush();
     if (esp3dTftsettings.readByte(ESP3DSettingIndex::esp3d_polling_on) == 1) {
@@ -126,7 +141,13 @@ void ESP3DRenderingClient::handle() {
         ESP3DMessage *msg = popRx();
         if (msg) {
           esp3d_log("Rendering client received message: %s", (char *)msg->data);
+#if ESP3D_TFT_BENCHMARK
+          esp3dTftValues.setLatencyOrigin(msg->timestamp);
+#endif  // ESP3D_TFT_BENCHMARK
           esp3dGcodeParser.processCommand((char *)msg->data);
+#if ESP3D_TFT_BENCHMARK
+          esp3dTftValues.setLatencyOrigin(0);
+#endif  // ESP3D_TFT_BENCHMARK
           deleteMsg(msg);
         };
         xSemaphoreGive(_xGuiSemaphore);
@@ -20,23 +20,69 @@
 #include "esp3d_serial_client.h"
 
 #include <stdio.h>
+#include <string.h>
 
 #include "driver/gpio.h"
 #include "driver/uart.h"
 #include "esp3d_commands.h"
 #include "esp3d_hal.h"
 #include "esp3d_log.h"
+#include "esp3d_scheduling.h"
 #include "esp3d_settings.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "serial_def.h"
 
+#if ESP3D_TFT_BENCHMARK
+#include "esp_timer.h"
+#endif  // ESP3D_TFT_BENCHMARK
+
 ESP3DSerialClient serialClient;
 
 #define RX_FLUSH_TIME_OUT 1500  // milliseconds timeout
+// uart driver events, only overflows are used, data events are dropped when
+// queue is full
+#define ESP3D_SERIAL_EVENT_QUEUE_SIZE 20
+// milliseconds to wait for printer answer at one baud rate
+#define ESP3D_SERIAL_PROBE_TIMEOUT 500
+// any firmware answers a line to it, even if only an error
+#define ESP3D_SERIAL_PROBE_COMMAND "\nM115\n"
+
+// Wrong baud rate gives bytes out of printable range
+static bool is_text_answer(const uint8_t *data, size_t len) {
+  size_t printable = 0;
+  bool has_line = false;
+  for (size_t i = 0; i < len; i++) {
+    if (data[i] == '\n') {
+      has_line = true;
+    } else if (data[i] >= 0x20 && data[i] < 0x7f) {
+      printable++;
+    } else if (data[i] != '\r' && data[i] != '\t') {
+      return false;
+    }
+  }
+  // at least `ok`
+  return has_line && printable >= 2;
+}
 
 void ESP3DSerialClient::readSerial() {
   static uint64_t startTimeout = 0;  // milliseconds
+  if (_probe_requested) {
+    _runRequestedProbe();
+    return;
+  }
+  uart_event_t event;
+  while (xQueueReceive(_uart_queue, &event, 0) == pdTRUE) {
+    if (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL) {
+      esp3d_log_w("Serial rx overflow");
+      _rx_overflows++;
+      // data are missing so partial line cannot be trusted
+      uart_flush_input(ESP3D_SERIAL_PORT);
+      xQueueReset(_uart_queue);
+      _bufferPos = 0;
+      return;
+    }
+  }
   int len = uart_read_bytes(ESP3D_SERIAL_PORT, _data,
                             (ESP3D_SERIAL_RX_BUFFER_SIZE - 1),
                             10 / portTICK_PERIOD_MS);
@@ -52,10 +98,15 @@ void ESP3DSerialClient::readSerial() {
       // if end of char or buffer is full
       if (serialClient.isEndChar(_data[i]) ||
           _bufferPos == ESP3D_SERIAL_RX_BUFFER_SIZE) {
+        if (!serialClient.isEndChar(_data[i])) {
+          // line is cut
+          _rx_overflows++;
+        }
         // create message and push
         if (!serialClient.pushMsgToRxQueue(_buffer, _bufferPos)) {
           // send error
           esp3d_log_e("Push Message to rx queue failed");
+          _rx_overflows++;
         }
         _bufferPos = 0;
       }
@@ -75,6 +126,10 @@ void ESP3DSerialClient::readSerial() {
 // this task only collecting serial RX data and push thenmm to Rx Queue
 static void esp3d_serial_rx_task(void *pvParameter) {
   (void)pvParameter;
+#if ESP3D_SERIAL_BAUD_PROBE_FEATURE
+  // printer may not be at baud rate of settings
+  serialClient.requestProbe();
+#endif  // ESP3D_SERIAL_BAUD_PROBE_FEATURE
   while (1) {
     /* Delay */
     esp3d_hal::wait(1);
@@ -93,6 +148,14 @@ ESP3DSerialClient::ESP3DSerialClient() {
   _data = NULL;
   _buffer = NULL;
   _bufferPos = 0;
+  _uart_queue = NULL;
+  _baud_rate = 0;
+  _rx_overflows = 0;
+  _probing = false;
+  _probe_requested = false;
+#if ESP3D_TFT_BENCHMARK
+  resetTxStats();
+#endif  // ESP3D_TFT_BENCHMARK
 }
 ESP3DSerialClient::~ESP3DSerialClient() { end(); }
 
@@ -138,6 +201,7 @@ bool ESP3DSerialClient::begin() {
     return false;
   }
   setTxMutex(&_tx_mutex);
+  setEventConsumer(ESP3DEventConsumer::stream);
   // load baudrate
   uint32_t baudrate =
       esp3dTftsettings.readUint32(ESP3DSettingIndex::esp3d_baud_rate);
@@ -148,6 +212,7 @@ bool ESP3DSerialClient::begin() {
         ESP3DSettingIndex::esp3d_baud_rate);
   }
   esp3d_log("Use %ld Serial Baud Rate", baudrate);
+  _baud_rate = baudrate;
   uart_config_t uart_config = {
       .baud_rate = (int)baudrate,
       .data_bits = ESP3D_SERIAL_DATA_BITS,
@@ -164,7 +229,8 @@ bool ESP3DSerialClient::begin() {
 #endif
   ESP_ERROR_CHECK(uart_driver_install(
       ESP3D_SERIAL_PORT, ESP3D_SERIAL_RX_BUFFER_SIZE * 2,
-      ESP3D_SERIAL_TX_BUFFER_SIZE, 0, NULL, intr_alloc_flags));
+      ESP3D_SERIAL_TX_BUFFER_SIZE, ESP3D_SERIAL_EVENT_QUEUE_SIZE,
+      &_uart_queue, intr_alloc_flags));
   ESP_ERROR_CHECK(uart_param_config(ESP3D_SERIAL_PORT, &uart_config));
   ESP_ERROR_CHECK(uart_set_pin(ESP3D_SERIAL_PORT, ESP3D_SERIAL_TX_PIN,
                                ESP3D_SERIAL_RX_PIN, UART_PIN_NO_CHANGE,
@@ -174,10 +240,16 @@ bool ESP3DSerialClient::begin() {
   _started = true;
   BaseType_t res = xTaskCreatePinnedToCore(
       esp3d_serial_rx_task, "esp3d_serial_rx_task", ESP3D_SERIAL_RX_TASK_SIZE,
-      NULL, ESP3D_SERIAL_TASK_PRIORITY, &_xHandle, ESP3D_SERIAL_TASK_CORE);
+      NULL,
+      esp3dScheduling.getPriority(ESP3DTaskRole::serial,
+                                  ESP3D_SERIAL_TASK_PRIORITY),
+      &_xHandle,
+      esp3dScheduling.getCore(ESP3DTaskRole::serial, ESP3D_SERIAL_TASK_CORE));
 
   if (res == pdPASS && _xHandle) {
     esp3d_log("Created Serial Task");
+    esp3dScheduling.registerTask(ESP3DTaskRole::serial, _xHandle,
+                                 ESP3D_SERIAL_TASK_PRIORITY);
     esp3d_log("Serial client started");
     flush();
     return true;
@@ -224,19 +296,134 @@ void ESP3DSerialClient::handle() {
         esp3dCommands.process(msg);
       }
     }
-    if (getTxMsgsCount() > 0) {
+    if (getTxMsgsCount() > 0 && !_probing) {
       ESP3DMessage *msg = popTx();
       if (msg) {
+#if ESP3D_TFT_BENCHMARK
+        int64_t start = esp_timer_get_time();
+#endif  // ESP3D_TFT_BENCHMARK
         size_t len = uart_write_bytes(ESP3D_SERIAL_PORT, msg->data, msg->size);
         if (len != msg->size) {
           esp3d_log_e("Error writing message %s", msg->data);
         }
+#if ESP3D_TFT_BENCHMARK
+        _tx_time += esp_timer_get_time() - start;
+        _tx_bytes += len;
+        _tx_msgs++;
+#endif  // ESP3D_TFT_BENCHMARK
         deleteMsg(msg);
       }
     }
   }
 }
 
+bool ESP3DSerialClient::_probe(uint32_t baud_rate, uint8_t *answer) {
+  esp3d_log("Probing %ld baud", baud_rate);
+  uart_wait_tx_done(ESP3D_SERIAL_PORT, pdMS_TO_TICKS(500));
+  if (uart_set_baudrate(ESP3D_SERIAL_PORT, baud_rate) != ESP_OK) {
+    esp3d_log_e("Cannot set %ld baud", baud_rate);
+    return false;
+  }
+  uart_flush_input(ESP3D_SERIAL_PORT);
+  uart_write_bytes(ESP3D_SERIAL_PORT, ESP3D_SERIAL_PROBE_COMMAND,
+                   strlen(ESP3D_SERIAL_PROBE_COMMAND));
+  size_t len = 0;
+  uint64_t start = esp3d_hal::millis();
+  // first line is enough
+  while (len < ESP3D_SERIAL_RX_BUFFER_SIZE - 1 &&
+         (len < 3 || answer[len - 1] != '\n') &&
+         esp3d_hal::millis() - start < ESP3D_SERIAL_PROBE_TIMEOUT) {
+    int read = uart_read_bytes(ESP3D_SERIAL_PORT, answer + len,
+                               ESP3D_SERIAL_RX_BUFFER_SIZE - 1 - len,
+                               pdMS_TO_TICKS(20));
+    if (read > 0) {
+      len += read;
+    }
+  }
+  return is_text_answer(answer, len);
+}
+
+bool ESP3DSerialClient::requestProbe() {
+  if (!_started || _probing || _probe_requested) {
+    return false;
+  }
+  _probe_requested = true;
+  return true;
+}
+
+// Called from rx task only, answer has its own buffer so rx buffers are
+// left as they are, baud rates are tried from the fastest after the current
+// one, printer answer is dropped
+uint32_t ESP3DSerialClient::_probeBaudRate() {
+  uint8_t *answer = (uint8_t *)malloc(ESP3D_SERIAL_RX_BUFFER_SIZE);
+  if (!answer) {
+    esp3d_log_e("Failed to allocate memory for probe");
+    return 0;
+  }
+  _probing = true;
+  uint32_t found = _probe(_baud_rate, answer) ? _baud_rate : 0;
+  size_t count = sizeof(SupportedBaudList) / sizeof(SupportedBaudList[0]);
+  for (size_t i = count; i > 0 && found == 0; i--) {
+    if (SupportedBaudList[i - 1] != _baud_rate &&
+        _probe(SupportedBaudList[i - 1], answer)) {
+      found = SupportedBaudList[i - 1];
+    }
+  }
+  free(answer);
+  if (found != 0) {
+    esp3d_log("Printer answers at %ld baud", found);
+    _baud_rate = found;
+  } else {
+    esp3d_log_w("No answer from printer, keep %ld baud", _baud_rate);
+    uart_set_baudrate(ESP3D_SERIAL_PORT, _baud_rate);
+  }
+  // let end of answer come before dropping it
+  esp3d_hal::wait(100);
+  uart_flush_input(ESP3D_SERIAL_PORT);
+  xQueueReset(_uart_queue);
+  _bufferPos = 0;
+  _probing = false;
+  return found;
+}
+
+void ESP3DSerialClient::_runRequestedProbe() {
+  uint32_t baud_rate = _probeBaudRate();
+  _probe_requested = false;
+  std::string text;
+  if (baud_rate == 0) {
+    text = "No answer from printer";
+  } else if (baud_rate != esp3dTftsettings.readUint32(
+                              ESP3DSettingIndex::esp3d_baud_rate) &&
+             !esp3dTftsettings.writeUint32(ESP3DSettingIndex::esp3d_baud_rate,
+                                           baud_rate)) {
+    text = "Set value failed";
+  } else {
+    text = "Printer found at " + std::to_string(baud_rate) + " baud";
+  }
+  esp3d_log("Probe: %s", text.c_str());
+  ESP3DRequest requestId = {.id = 0};
+  // system origin so printer does not get it
+  esp3dCommands.dispatch(text.c_str(), ESP3DClientType::all_clients, requestId,
+                         ESP3DMessageType::unique, ESP3DClientType::system,
+                         ESP3DAuthenticationLevel::admin);
+}
+
+#if ESP3D_TFT_BENCHMARK
+void ESP3DSerialClient::resetTxStats() {
+  _tx_bytes = 0;
+  _tx_msgs = 0;
+  _tx_time = 0;
+}
+
+// Time is spent copying to uart driver buffer, wire time is in ack latency
+void ESP3DSerialClient::reportTxStats() {
+  esp3d_report("Serial tx: %ld messages, %ld bytes, %lld us, %.1f us per "
+               "message at %ld baud",
+               _tx_msgs, _tx_bytes, _tx_time,
+               _tx_msgs ? (double)_tx_time / _tx_msgs : 0.0, _baud_rate);
+}
+#endif  // ESP3D_TFT_BENCHMARK
+
 void ESP3DSerialClient::flush() {
   uint8_t loopCount = 10;
   while (loopCount && getTxMsgsCount() > 0) {
@@ -267,6 +454,7 @@ void ESP3DSerialClient::end() {
         uart_driver_delete(ESP3D_SERIAL_PORT) != ESP_OK) {
       esp3d_log_e("Error deleting serial driver");
     }
+    _uart_queue = NULL;
   }
   if (_xHandle) {
     vTaskDelete(_xHandle);
@@ -24,6 +24,8 @@
 
 #include "esp3d_client.h"
 #include "esp3d_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,15 +44,40 @@ class ESP3DSerialClient : public ESP3DClient {
   void flush();
   bool started() { return _started; }
   void readSerial();
+  // received data lost: uart overflows, too long lines, full rx queue
+  uint32_t getRxOverflows() { return _rx_overflows; }
+  uint32_t getBaudRate() { return _baud_rate; }
+  // probe is done by rx task so rx is paused and caller is not blocked,
+  // found baud rate is saved and result is sent to all clients
+  bool requestProbe();
+#if ESP3D_TFT_BENCHMARK
+  void resetTxStats();
+  void reportTxStats();
+#endif  // ESP3D_TFT_BENCHMARK
 
  private:
+  bool _probe(uint32_t baud_rate, uint8_t* answer);
+  // find baud rate printer answers at, current one first, 0 if none
+  uint32_t _probeBaudRate();
+  void _runRequestedProbe();
   TaskHandle_t _xHandle;
+  QueueHandle_t _uart_queue;
   bool _started;
   pthread_mutex_t _tx_mutex;
   pthread_mutex_t _rx_mutex;
   uint8_t* _data;
   uint8_t* _buffer;
   size_t _bufferPos;
+  uint32_t _baud_rate;
+  volatile uint32_t _rx_overflows;
+  // rx task and tx leave uart to probe
+  volatile bool _probing;
+  volatile bool _probe_requested;
+#if ESP3D_TFT_BENCHMARK
+  uint32_t _tx_bytes;
+  uint32_t _tx_msgs;
+  int64_t _tx_time;
+#endif  // ESP3D_TFT_BENCHMARK
 };
 
 extern ESP3DSerialClient serialClient;
@@ -72,7 +72,7 @@ void ESP3DSocketServer::closeMainSocket() {
 
 ESP3DSocketInfos *ESP3DSocketServer::getClientInfos(uint index) {
   if (_started) {
-    if (index <= ESP3D_MAX_SOCKET_CLIENTS) {
+    if (index < ESP3D_MAX_SOCKET_CLIENTS) {
       if (_clients[index].socket_id != FREE_SOCKET_HANDLE) {
         return &_clients[index];
       }
@@ -123,7 +123,7 @@ bool ESP3DSocketServer::startSocketServer() {
     return false;
   }
   esp3d_log("Socket bound, port %ld", _port);
-  err = listen(_listen_socket, 1);
+  err = listen(_listen_socket, ESP3D_MAX_SOCKET_CLIENTS);
   if (err != 0) {
     esp3d_log_e("Error occurred during listen: errno %d, %s", errno,
                 strerror(errno));
@@ -144,93 +144,247 @@ void ESP3DSocketServer::process(ESP3DMessage *msg) {
   }
 }
 
-void ESP3DSocketServer::readSockets() {
-  int len;
-  static uint64_t startTimeout[ESP3D_MAX_SOCKET_CLIENTS];
-  static bool initArrays = false;
+// Only one select for listening socket and all clients, so a slow client
+// never blocks others: it is only written when its socket can take data
+void ESP3DSocketServer::pollSockets() {
   if (!_started || !_data || !_buffer) {
     return;
   }
-  static size_t pos[ESP3D_MAX_SOCKET_CLIENTS];
-  if (!initArrays) {
-    initArrays = true;
+  fd_set read_set;
+  fd_set write_set;
+  FD_ZERO(&read_set);
+  FD_ZERO(&write_set);
+  int max_fd = _listen_socket;
+  FD_SET(_listen_socket, &read_set);
+  if (pthread_mutex_lock(&_clients_mutex) == 0) {
     for (uint s = 0; s < ESP3D_MAX_SOCKET_CLIENTS; s++) {
-      pos[s] = 0;
-      startTimeout[s] = 0;
-      if (!_buffer[s]) {
-        esp3d_log_e("Missing buffer for socket %d", s);
-        return;
+      int fd = _clients[s].socket_id;
+      if (fd != FREE_SOCKET_HANDLE) {
+        FD_SET(fd, &read_set);
+        if (_clients[s].tx_count > 0) {
+          FD_SET(fd, &write_set);
+        }
+        if (fd > max_fd) {
+          max_fd = fd;
+        }
       }
     }
+    pthread_mutex_unlock(&_clients_mutex);
+  }
+  struct timeval timeout;
+  timeout.tv_sec = 0;
+  timeout.tv_usec = ESP3D_SOCKET_SELECT_TIMEOUT * 1000;
+  int ready = select(max_fd + 1, &read_set, &write_set, NULL, &timeout);
+  if (ready < 0) {
+    esp3d_log_e("Error occurred during select: errno %d", errno);
+    esp3d_hal::wait(ESP3D_SOCKET_SELECT_TIMEOUT);
+    return;
   }
-
+  if (pthread_mutex_lock(&_clients_mutex) != 0) {
+    return;
+  }
+  if (ready > 0 && FD_ISSET(_listen_socket, &read_set)) {
+    getClient();
+  }
+  int64_t now = esp3d_hal::millis();
   for (uint s = 0; s < ESP3D_MAX_SOCKET_CLIENTS; s++) {
-    if (_clients[s].socket_id != FREE_SOCKET_HANDLE) {
-      len = recv(_clients[s].socket_id, _data, ESP3D_SOCKET_RX_BUFFER_SIZE, 0);
-      if (len < 0) {
-        if (errno == EINPROGRESS || errno == EAGAIN || errno == EWOULDBLOCK) {
-          continue;  // Not an error
-        }
-        if (errno == ENOTCONN) {
-          esp3d_log("Connection closed");
-          closeSocket(_clients[s].socket_id);
-          continue;
-        }
-        esp3d_log_e("Error occurred during receiving: errno %d on socket %d",
-                    errno, s);
-        closeSocket(_clients[s].socket_id);
-      } else {
-        _data[len] = 0;  // Null-terminate whatever is received and treat it
-                         // like a string
-        esp3d_log("Received %d bytes: %s", len, _data);
-        if (len) {
-          // parse data
-          startTimeout[s] = esp3d_hal::millis();
-          for (size_t i = 0; i < len; i++) {
-            if (pos[s] < ESP3D_SOCKET_RX_BUFFER_SIZE) {
-              _buffer[s][pos[s]] = _data[i];
-              (pos[s])++;
-              _buffer[s][pos[s]] = 0;
-            }
-            // if end of char or buffer is full
-            if (isEndChar(_data[i]) || pos[s] == ESP3D_SOCKET_RX_BUFFER_SIZE) {
-              // create message and push
-              if (!pushMsgToRxQueue(s, (const uint8_t *)_buffer[s], pos[s])) {
-                // send error
-                esp3d_log_e("Push Message to rx queue failed");
-              }
-              pos[s] = 0;
-            }
-          }
-        }
+    int fd = _clients[s].socket_id;
+    if (fd == FREE_SOCKET_HANDLE) {
+      continue;
+    }
+    // new client may be in slot but not in sets
+    if (ready > 0 && FD_ISSET(fd, &read_set)) {
+      readSocket(s);
+    }
+    if (_clients[s].socket_id == fd && ready > 0 &&
+        FD_ISSET(fd, &write_set)) {
+      sendQueue(s);
+    }
+    if (_clients[s].socket_id != fd) {
+      // closed meanwhile
+      continue;
+    }
+    // if no data during a while then send them
+    if (_clients[s].rx_pos > 0 &&
+        now - _clients[s].rx_time > RX_FLUSH_TIME_OUT) {
+      if (!pushMsgToRxQueue(s, (const uint8_t *)_buffer[s],
+                            _clients[s].rx_pos)) {
+        // send error
+        esp3d_log_e("Push Message  %s of size %d to rx queue failed",
+                    _buffer[s], _clients[s].rx_pos);
       }
+      _clients[s].rx_pos = 0;
     }
+    if (_clients[s].tx_stalled_since != 0 &&
+        now - _clients[s].tx_stalled_since > ESP3D_SOCKET_SLOW_CLIENT_TIMEOUT) {
+      esp3d_log_w("Client %d too slow, %ld messages dropped, closing", s,
+                  _clients[s].tx_dropped);
+      closeSocket(fd);
+    }
+  }
+  pthread_mutex_unlock(&_clients_mutex);
+}
+
+void ESP3DSocketServer::readSocket(uint index) {
+  ESP3DSocketInfos &client = _clients[index];
+  int len = recv(client.socket_id, _data, ESP3D_SOCKET_RX_BUFFER_SIZE, 0);
+  if (len < 0) {
+    if (errno == EINPROGRESS || errno == EAGAIN || errno == EWOULDBLOCK) {
+      return;  // Not an error
+    }
+    if (errno == ENOTCONN) {
+      esp3d_log("Connection closed");
+      closeSocket(client.socket_id);
+      return;
+    }
+    esp3d_log_e("Error occurred during receiving: errno %d on socket %d",
+                errno, index);
+    closeSocket(client.socket_id);
+    return;
   }
-  // if no data during a while then send them
-  for (uint s = 0; s < ESP3D_MAX_SOCKET_CLIENTS; s++)
-    if (esp3d_hal::millis() - startTimeout[s] > (RX_FLUSH_TIME_OUT) &&
-        pos[s] > 0) {
-      if (!pushMsgToRxQueue(s, (const uint8_t *)_buffer[s], pos[s])) {
+  if (len == 0) {
+    // socket was readable so connection is closed by peer
+    esp3d_log("Connection closed");
+    closeSocket(client.socket_id);
+    return;
+  }
+  _data[len] = 0;  // Null-terminate whatever is received and treat it
+                   // like a string
+  esp3d_log("Received %d bytes: %s", len, _data);
+  // parse data
+  char *buffer = _buffer[index];
+  client.rx_time = esp3d_hal::millis();
+  for (size_t i = 0; i < len; i++) {
+    if (client.rx_pos < ESP3D_SOCKET_RX_BUFFER_SIZE) {
+      buffer[client.rx_pos] = _data[i];
+      client.rx_pos++;
+      buffer[client.rx_pos] = 0;
+    }
+    // if end of char or buffer is full
+    if (isEndChar(_data[i]) || client.rx_pos == ESP3D_SOCKET_RX_BUFFER_SIZE) {
+      // create message and push
+      if (!pushMsgToRxQueue(index, (const uint8_t *)buffer, client.rx_pos)) {
         // send error
-        esp3d_log_e("Push Message  %s of size %d to rx queue failed",
-                    _buffer[s], pos[s]);
+        esp3d_log_e("Push Message to rx queue failed");
+      }
+      client.rx_pos = 0;
+      // authentication failure may have closed the client
+      if (client.socket_id == FREE_SOCKET_HANDLE) {
+        return;
+      }
+    }
+  }
+}
+
+// Send as much as socket can take without blocking, rest is sent when
+// select says socket is writable again
+void ESP3DSocketServer::sendQueue(uint index) {
+  ESP3DSocketInfos &client = _clients[index];
+  while (client.tx_count > 0) {
+    ESP3DSocketPayload *payload = client.tx_queue[client.tx_head];
+    int written =
+        send(client.socket_id, payload->msg->data + client.tx_offset,
+             payload->msg->size - client.tx_offset, 0);
+    if (written < 0) {
+      if (errno == EINPROGRESS || errno == EAGAIN || errno == EWOULDBLOCK) {
+        return;
       }
-      pos[s] = 0;
+      esp3d_log_e("Error occurred during sending: errno %d on socket %d",
+                  errno, index);
+      closeSocket(client.socket_id);
+      return;
+    }
+    client.tx_stalled_since = 0;
+    client.tx_offset += written;
+    if (client.tx_offset >= payload->msg->size) {
+      client.tx_queue[client.tx_head] = nullptr;
+      client.tx_head = (client.tx_head + 1) % ESP3D_SOCKET_TX_QUEUE_SIZE;
+      client.tx_count--;
+      client.tx_offset = 0;
+      releasePayload(payload);
     }
+  }
+}
+
+bool ESP3DSocketServer::queueMsg(uint index, ESP3DSocketPayload *payload) {
+  ESP3DSocketInfos &client = _clients[index];
+  if (client.tx_count == ESP3D_SOCKET_TX_QUEUE_SIZE) {
+    // drop newest so client still gets complete messages
+    if (client.tx_stalled_since == 0) {
+      esp3d_log_w("Client %d queue is full, dropping messages", index);
+      client.tx_stalled_since = esp3d_hal::millis();
+    }
+    client.tx_dropped++;
+    _dropped++;
+    return false;
+  }
+  client.tx_queue[(client.tx_head + client.tx_count) %
+                  ESP3D_SOCKET_TX_QUEUE_SIZE] = payload;
+  client.tx_count++;
+  payload->refs++;
+  return true;
+}
+
+bool ESP3DSocketServer::queueString(uint index, const char *str) {
+  ESP3DMessage *msg =
+      newMsg(ESP3DClientType::telnet, ESP3DClientType::telnet,
+             (const uint8_t *)str, strlen(str));
+  if (!msg) {
+    esp3d_log_e("Out of memory!");
+    return false;
+  }
+  ESP3DSocketPayload *payload =
+      (ESP3DSocketPayload *)malloc(sizeof(ESP3DSocketPayload));
+  if (!payload) {
+    esp3d_log_e("Out of memory!");
+    deleteMsg(msg);
+    return false;
+  }
+  payload->msg = msg;
+  payload->refs = 0;
+  bool res = queueMsg(index, payload);
+  if (!res) {
+    releasePayload(payload);
+  }
+  return res;
+}
+
+void ESP3DSocketServer::releasePayload(ESP3DSocketPayload *payload) {
+  if (payload->refs > 0) {
+    payload->refs--;
+  }
+  if (payload->refs == 0) {
+    deleteMsg(payload->msg);
+    free(payload);
+  }
 }
 
-// this task only collecting serial RX data and push thenmm to Rx Queue
+void ESP3DSocketServer::clearQueue(uint index) {
+  ESP3DSocketInfos &client = _clients[index];
+  while (client.tx_count > 0) {
+    releasePayload(client.tx_queue[client.tx_head]);
+    client.tx_queue[client.tx_head] = nullptr;
+    client.tx_head = (client.tx_head + 1) % ESP3D_SOCKET_TX_QUEUE_SIZE;
+    client.tx_count--;
+  }
+  client.tx_head = 0;
+  client.tx_offset = 0;
+  client.tx_stalled_since = 0;
+  client.tx_dropped = 0;
+  client.rx_pos = 0;
+  client.rx_time = 0;
+}
+
+// this task handles sockets RX and TX and push RX data to Rx Queue
 static void esp3d_socket_rx_task(void *pvParameter) {
   (void)pvParameter;
   bool res = esp3dSocketServer.startSocketServer();
 
   if (res) {
-    // uint64_t startTimeout = 0; // milliseconds
     while (esp3dSocketServer.isRunning()) {
-      esp3dSocketServer.getClient();
-      esp3dSocketServer.readSockets();
+      // select timeout gives the loop pace
+      esp3dSocketServer.pollSockets();
       esp3dSocketServer.handle();
-      esp3d_hal::wait(10);
     }
 
   } else {
@@ -241,22 +395,6 @@ static void esp3d_socket_rx_task(void *pvParameter) {
   vTaskDelete(NULL);
 }
 
-bool ESP3DSocketServer::sendToSocket(const int sock, const char *data,
-                                     const size_t len) {
-  int to_write = len;
-  // does it need to add time out ?
-  while (to_write > 0) {
-    int written = send(sock, data + (len - to_write), to_write, 0);
-    if (written < 0 && errno != EINPROGRESS && errno != EAGAIN &&
-        errno != EWOULDBLOCK) {
-      esp3d_log_e("Error occurred during sending %d", errno);
-      return false;
-    }
-    to_write -= written;
-  }
-  return true;
-}
-
 bool ESP3DSocketServer::getClient() {
   struct sockaddr_storage source_addr;
   socklen_t addr_len = sizeof(source_addr);
@@ -277,6 +415,7 @@ bool ESP3DSocketServer::getClient() {
          sizeof(_clients[freeIndex].session_id));
 #endif  // #if ESP3D_AUTHENTICATION_FEATURE
   // copy informations of the client
+  clearQueue(freeIndex);
   _clients[freeIndex].socket_id = sock;
   memcpy(&_clients[freeIndex].source_addr, &source_addr, sizeof(source_addr));
   // Marking the socket as non-blocking
@@ -295,7 +434,7 @@ bool ESP3DSocketServer::getClient() {
   esp3d_log("Socket accepted ip address: %s", addr_str);
 #endif
 #if !DISABLE_TELNET_WELCOME_MESSAGE
-  sendToSocket(sock, WELCOME_MSG, strlen(WELCOME_MSG));
+  queueString(freeIndex, WELCOME_MSG);
 #endif  // DISABLE_TELNET_WELCOME_MESSAGE
   return true;
 }
@@ -319,6 +458,7 @@ bool ESP3DSocketServer::closeSocket(int socketId) {
 #endif  // #if ESP3D_AUTHENTICATION_FEATURE
         shutdown(socketId, 0);
         close(socketId);
+        clearQueue(s);
         _clients[s].socket_id = FREE_SOCKET_HANDLE;
         memset(&_clients[s].source_addr, 0, sizeof(struct sockaddr_storage));
         return true;
@@ -337,6 +477,8 @@ ESP3DSocketServer::ESP3DSocketServer() {
   }
   _data = NULL;
   _buffer = NULL;
+  _dropped = 0;
+  _clients_mutex = PTHREAD_MUTEX_INITIALIZER;
 }
 ESP3DSocketServer::~ESP3DSocketServer() { end(); }
 
@@ -431,7 +573,7 @@ bool ESP3DSocketServer::pushMsgToRxQueue(uint index, const uint8_t *msg,
               static_cast<uint8_t>(authentication_level));
     if (authentication_level == ESP3DAuthenticationLevel::guest) {
       esp3d_log("Authentication Level = GUEST, for %s", (const char *)msg);
-      sendToSocket(client->socket_id, ERROR_MSG, strlen(ERROR_MSG));
+      queueString(index, ERROR_MSG);
       return false;
     }
     // 1 -  create  session id
@@ -443,16 +585,15 @@ bool ESP3DSocketServer::pushMsgToRxQueue(uint index, const uint8_t *msg,
             client->session_id, client->socket_id, authentication_level,
             ESP3DClientType::telnet)) {
       esp3d_log("Authentication error, rejected.");
-      sendToSocket(client->socket_id, ERROR_MSG, strlen(ERROR_MSG));
+      queueString(index, ERROR_MSG);
       return false;
     }
   } else {
     esp3d_log("SessionId is %s", client->session_id);
     // No need to check time out as session is deleted on close
-    ESP3DAuthenticationRecord *rec =
-        esp3dAuthenthicationService.getRecord(client->session_id);
-    if (rec != NULL) {
-      authentication_level = rec->level;
+    ESP3DAuthenticationRecord rec;
+    if (esp3dAuthenthicationService.getRecord(client->session_id, &rec)) {
+      authentication_level = rec.level;
     } else {
       esp3d_log_e("No client record for authentication level");
       return false;
@@ -497,19 +638,36 @@ void ESP3DSocketServer::handle() {
         esp3dCommands.process(msg);
       }
     }
-    if (getTxMsgsCount() > 0) {
+    // only queue messages, sockets are written when they are ready, so
+    // message is shared by clients instead of being copied
+    while (getTxMsgsCount() > 0) {
       ESP3DMessage *msg = popTx();
-      if (msg) {
+      if (!msg) {
+        break;
+      }
+      ESP3DSocketPayload *payload =
+          (ESP3DSocketPayload *)malloc(sizeof(ESP3DSocketPayload));
+      if (!payload) {
+        esp3d_log_e("Out of memory!");
+        deleteMsg(msg);
+        continue;
+      }
+      payload->msg = msg;
+      payload->refs = 0;
+      if (pthread_mutex_lock(&_clients_mutex) == 0) {
         for (uint s = 0; s < ESP3D_MAX_SOCKET_CLIENTS; s++) {
           if (_clients[s].socket_id != FREE_SOCKET_HANDLE) {
             if (msg->request_id.id == 0 ||
                 msg->request_id.id == _clients[s].socket_id) {
-              sendToSocket(_clients[s].socket_id, (const char *)msg->data,
-                           msg->size);
+              queueMsg(s, payload);
             }
           }
         }
-        deleteMsg(msg);
+        pthread_mutex_unlock(&_clients_mutex);
+      }
+      // no client took it
+      if (payload->refs == 0) {
+        releasePayload(payload);
       }
     }
   }
@@ -530,6 +688,15 @@ void ESP3DSocketServer::end() {
     _isRunning = false;
     esp3d_hal::wait(500);
     flush();
+    // last chance for pending messages
+    if (pthread_mutex_lock(&_clients_mutex) == 0) {
+      for (uint s = 0; s < ESP3D_MAX_SOCKET_CLIENTS; s++) {
+        if (_clients[s].socket_id != FREE_SOCKET_HANDLE) {
+          sendQueue(s);
+        }
+      }
+      pthread_mutex_unlock(&_clients_mutex);
+    }
     closeAllClients();
     _started = false;
     esp3d_log("Clearing queue Rx messages");
@@ -574,7 +741,10 @@ void ESP3DSocketServer::end() {
 
 void ESP3DSocketServer::closeAllClients() {
   esp3d_log("Socket server closing all clients");
-  for (uint s = 0; s < ESP3D_MAX_SOCKET_CLIENTS; s++) {
-    closeSocket(_clients[s].socket_id);
+  if (pthread_mutex_lock(&_clients_mutex) == 0) {
+    for (uint s = 0; s < ESP3D_MAX_SOCKET_CLIENTS; s++) {
+      closeSocket(_clients[s].socket_id);
+    }
+    pthread_mutex_unlock(&_clients_mutex);
   }
 }
@@ -32,7 +32,26 @@
 extern "C" {
 #endif
 
-#define ESP3D_MAX_SOCKET_CLIENTS 2
+// Each client uses one lwip socket, http server already uses 8 + 3 internal
+// so raise CONFIG_LWIP_MAX_SOCKETS before raising this value
+#ifndef ESP3D_MAX_SOCKET_CLIENTS
+#define ESP3D_MAX_SOCKET_CLIENTS 4
+#endif  // ESP3D_MAX_SOCKET_CLIENTS
+// Messages waiting to be sent to one client, newer messages are dropped for
+// this client when full
+#define ESP3D_SOCKET_TX_QUEUE_SIZE 32
+// Client which cannot send anything during this time (ms) while its queue is
+// full is closed, so it does not keep its messages forever
+#define ESP3D_SOCKET_SLOW_CLIENT_TIMEOUT 10000
+// Time (ms) select waits for sockets activity
+#define ESP3D_SOCKET_SELECT_TIMEOUT 10
+
+// Message shared by all clients it is queued to, deleted when last client
+// has sent it or dropped it
+struct ESP3DSocketPayload {
+  ESP3DMessage* msg;
+  uint8_t refs;
+};
 
 struct ESP3DSocketInfos {
   int socket_id;
@@ -40,6 +59,16 @@ struct ESP3DSocketInfos {
 #if ESP3D_AUTHENTICATION_FEATURE
   char session_id[25];
 #endif  // #if ESP3D_AUTHENTICATION_FEATURE
+  // output queue, ring buffer of shared payloads
+  ESP3DSocketPayload* tx_queue[ESP3D_SOCKET_TX_QUEUE_SIZE];
+  uint8_t tx_head;
+  uint8_t tx_count;
+  size_t tx_offset;          // bytes of head payload already sent
+  int64_t tx_stalled_since;  // 0 if queue is not full
+  uint32_t tx_dropped;
+  // input line being received
+  size_t rx_pos;
+  int64_t rx_time;
 };
 
 class ESP3DSocketServer : public ESP3DClient {
@@ -49,7 +78,8 @@ class ESP3DSocketServer : public ESP3DClient {
   bool begin();
   void handle();
   void process(ESP3DMessage* msg);
-  void readSockets();
+  // wait for sockets activity then accept, read and write what is ready
+  void pollSockets();
   void end();
   bool isEndChar(uint8_t ch);
   bool pushMsgToRxQueue(uint index, const uint8_t* msg, size_t size);
@@ -64,9 +94,16 @@ class ESP3DSocketServer : public ESP3DClient {
   void resetTaskHandle() { _xHandle = NULL; }
   ESP3DSocketInfos* getClientInfos(uint index);
   bool isRunning() { return _isRunning; }
+  // messages dropped because clients were too slow
+  uint32_t getDroppedCount() { return _dropped; }
 
  private:
-  bool sendToSocket(const int sock, const char* data, const size_t len);
+  void readSocket(uint index);
+  void sendQueue(uint index);
+  bool queueMsg(uint index, ESP3DSocketPayload* payload);
+  bool queueString(uint index, const char* str);
+  void releasePayload(ESP3DSocketPayload* payload);
+  void clearQueue(uint index);
   bool closeSocket(int socketId);
   int getFreeClientSlot();
   ESP3DSocketInfos _clients[ESP3D_MAX_SOCKET_CLIENTS];
@@ -75,8 +112,11 @@ class ESP3DSocketServer : public ESP3DClient {
   bool _started;
   uint32_t _port;
   bool _isRunning;
+  uint32_t _dropped;
   pthread_mutex_t _tx_mutex;
   pthread_mutex_t _rx_mutex;
+  // clients and their queues are used by socket task and by flush()
+  pthread_mutex_t _clients_mutex;
   TaskHandle_t _xHandle;
   char** _buffer;
   char* _data;
@@ -57,6 +57,10 @@ const char* TimeService::getTimeZone() { return _time_zone.c_str(); }
 bool TimeService::setTimeZone(const char* stime) {
   if (esp3dTftsettings.isValidStringSetting(
           stime, ESP3DSettingIndex::esp3d_timezone)) {
+    // webui sends it at each connection, a write would change settings id
+    if (_time_zone == stime) {
+      return true;
+    }
     _time_zone = stime;
     return esp3dTftsettings.writeString(ESP3DSettingIndex::esp3d_timezone,
                                         _time_zone.c_str());
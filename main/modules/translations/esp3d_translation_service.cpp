@@ -27,6 +27,7 @@
 #include "esp3d_hal.h"
 #include "esp3d_log.h"
 #include "esp3d_string.h"
+#include "esp_heap_caps.h"
 #include "filesystem/esp3d_flash.h"
 
 #define LANGUAGE_PACK_HEAD "ui_"
@@ -42,9 +43,23 @@
 
 ESP3DTranslationService esp3dTranslationService;
 
-ESP3DTranslationService::ESP3DTranslationService() { _started = false; }
+ESP3DTranslationService::ESP3DTranslationService() {
+  _started = false;
+  _pack = nullptr;
+  _pack_count = 0;
+  _pack_offsets = nullptr;
+  _pack_blob = nullptr;
+  _pack_blob_size = 0;
+  _text_pack_entries = nullptr;
+  for (uint16_t i = 0; i < ESP3D_TRANSLATIONS_COUNT; i++) {
+    _default_texts[i] = nullptr;
+  }
+}
 
-ESP3DTranslationService::~ESP3DTranslationService() { _started = false; }
+ESP3DTranslationService::~ESP3DTranslationService() {
+  _started = false;
+  _freePack();
+}
 
 const char *ESP3DTranslationService::getEntry(ESP3DLabel label) {
   if (!_started) {
@@ -59,7 +74,7 @@ const char *ESP3DTranslationService::getEntry(ESP3DLabel label) {
 bool ESP3DTranslationService::begin() {
   _started = false;
   esp3d_log("Starting Translation Service");
-  _translations.clear();
+  _freePack();
   init();
   std::string filename = DEFAULT_LANGUAGE_PACK;
   _languageCode = DEFAULT_LANGUAGE;
@@ -87,14 +102,11 @@ bool ESP3DTranslationService::begin() {
   if (flashFs.accessFS()) {
     if (flashFs.exists(filename.c_str())) {
       filename = ESP3D_FLASH_FS_HEADER + filename;
-      ESP3DConfigFile updateTranslations(
-          filename.c_str(), esp3dTranslationService.processingFileFunction);
       esp3d_log("Processing language pack: %s", filename.c_str());
-      if (updateTranslations.processFile()) {
+      if (_loadPack(filename.c_str())) {
+        _started = true;
         esp3d_log("Processing language pack, done: %s",
                   translate(ESP3DLabel::language));
-        flashFs.releaseFS();
-        _started = true;
       } else {
         esp3d_log_e("Processing language pack, failed");
       }
@@ -108,8 +120,7 @@ bool ESP3DTranslationService::begin() {
   }
   if (!_started) {
     esp3d_log_e("Translation Service not started");
-    _translations.clear();
-    init();
+    _freePack();
     _languageCode = DEFAULT_LANGUAGE;
     _started = true;
   }
@@ -117,6 +128,170 @@ bool ESP3DTranslationService::begin() {
   return _started;
 }
 
+void ESP3DTranslationService::_freePack() {
+  if (_pack) {
+    free(_pack);
+  }
+  _pack = nullptr;
+  _pack_count = 0;
+  _pack_offsets = nullptr;
+  _pack_blob = nullptr;
+  _pack_blob_size = 0;
+}
+
+// Check pack block and set the lookup pointers, the block is owned by the
+// service on success
+bool ESP3DTranslationService::_setPack(char *pack, size_t size) {
+  if (size < sizeof(ESP3DLanguagePackHeader)) {
+    esp3d_log_e("Language pack is too small");
+    return false;
+  }
+  const ESP3DLanguagePackHeader *header = (const ESP3DLanguagePackHeader *)pack;
+  if (memcmp(header->magic, ESP3D_LANGUAGE_PACK_MAGIC, 4) != 0 ||
+      header->version != ESP3D_LANGUAGE_PACK_VERSION) {
+    esp3d_log_e("Invalid language pack header");
+    return false;
+  }
+  size_t expected_size = sizeof(ESP3DLanguagePackHeader) +
+                         header->count * sizeof(uint32_t) + header->blob_size;
+  if (expected_size != size || header->blob_size == 0 ||
+      pack[size - 1] != 0x0) {
+    esp3d_log_e("Invalid language pack size");
+    return false;
+  }
+  const uint32_t *offsets =
+      (const uint32_t *)(pack + sizeof(ESP3DLanguagePackHeader));
+  for (uint16_t i = 0; i < header->count; i++) {
+    if (offsets[i] != ESP3D_LANGUAGE_PACK_NO_ENTRY &&
+        offsets[i] >= header->blob_size) {
+      esp3d_log_e("Invalid offset for label %d", i);
+      return false;
+    }
+  }
+  _freePack();
+  _pack = pack;
+  _pack_count = header->count;
+  _pack_offsets = offsets;
+  _pack_blob = (const char *)(offsets + header->count);
+  _pack_blob_size = header->blob_size;
+  esp3d_log("Language pack of %d entries, %d bytes", _pack_count, size);
+  return true;
+}
+
+// Compiled pack is copied once into a single block, in PSRAM if any,
+// text pack is parsed and converted to the same layout
+bool ESP3DTranslationService::_loadPack(const char *filename) {
+  struct stat file_stat;
+  if (flashFs.stat(filename, &file_stat) == -1 || file_stat.st_size <= 0) {
+    esp3d_log_e("Cannot stat %s", filename);
+    return false;
+  }
+  FILE *fd = flashFs.open(filename, "r");
+  if (!fd) {
+    esp3d_log_e("Cannot open %s", filename);
+    return false;
+  }
+  char magic[4] = {0};
+  bool is_compiled = fread(magic, 1, sizeof(magic), fd) == sizeof(magic) &&
+                     memcmp(magic, ESP3D_LANGUAGE_PACK_MAGIC, 4) == 0;
+  if (!is_compiled) {
+    flashFs.close(fd);
+    esp3d_log_w("%s is not compiled, consider converting it", filename);
+    return _loadTextPack(filename);
+  }
+  size_t size = file_stat.st_size;
+  char *pack = (char *)heap_caps_malloc_prefer(size, 2, MALLOC_CAP_SPIRAM,
+                                               MALLOC_CAP_DEFAULT);
+  if (!pack) {
+    esp3d_log_e("Cannot allocate %d bytes for language pack", size);
+    flashFs.close(fd);
+    return false;
+  }
+  memcpy(pack, magic, sizeof(magic));
+  size_t read_size = sizeof(magic);
+  read_size += fread(pack + read_size, 1, size - read_size, fd);
+  flashFs.close(fd);
+  if (read_size != size || !_setPack(pack, size)) {
+    esp3d_log_e("Invalid language pack %s", filename);
+    free(pack);
+    return false;
+  }
+  return true;
+}
+
+// Legacy ini language pack
+bool ESP3DTranslationService::_loadTextPack(const char *filename) {
+  std::map<ESP3DLabel, std::string> entries;
+  _text_pack_entries = &entries;
+  ESP3DConfigFile updateTranslations(
+      filename, esp3dTranslationService.processingFileFunction);
+  bool res = updateTranslations.processFile();
+  _text_pack_entries = nullptr;
+  if (!res || entries.empty()) {
+    return false;
+  }
+  uint16_t count = static_cast<uint16_t>(entries.rbegin()->first) + 1;
+  uint32_t blob_size = 0;
+  for (auto &entry : entries) {
+    blob_size += entry.second.length() + 1;
+  }
+  size_t size = sizeof(ESP3DLanguagePackHeader) + count * sizeof(uint32_t) +
+                blob_size;
+  char *pack = (char *)heap_caps_malloc_prefer(size, 2, MALLOC_CAP_SPIRAM,
+                                               MALLOC_CAP_DEFAULT);
+  if (!pack) {
+    esp3d_log_e("Cannot allocate %d bytes for language pack", size);
+    return false;
+  }
+  ESP3DLanguagePackHeader *header = (ESP3DLanguagePackHeader *)pack;
+  memcpy(header->magic, ESP3D_LANGUAGE_PACK_MAGIC, 4);
+  header->version = ESP3D_LANGUAGE_PACK_VERSION;
+  header->count = count;
+  header->blob_size = blob_size;
+  uint32_t *offsets = (uint32_t *)(pack + sizeof(ESP3DLanguagePackHeader));
+  char *blob = (char *)(offsets + count);
+  for (uint16_t i = 0; i < count; i++) {
+    offsets[i] = ESP3D_LANGUAGE_PACK_NO_ENTRY;
+  }
+  uint32_t offset = 0;
+  for (auto &entry : entries) {
+    offsets[static_cast<uint16_t>(entry.first)] = offset;
+    memcpy(blob + offset, entry.second.c_str(), entry.second.length() + 1);
+    offset += entry.second.length() + 1;
+  }
+  if (!_setPack(pack, size)) {
+    free(pack);
+    return false;
+  }
+  return true;
+}
+
+// Read only language name (label 0) without loading the whole pack
+bool ESP3DTranslationService::_readPackLanguage(const char *filename,
+                                                char *language, size_t size) {
+  bool res = false;
+  FILE *fd = flashFs.open(filename, "r");
+  if (!fd) {
+    return false;
+  }
+  ESP3DLanguagePackHeader header;
+  uint32_t offset = ESP3D_LANGUAGE_PACK_NO_ENTRY;
+  if (fread(&header, 1, sizeof(header), fd) == sizeof(header) &&
+      memcmp(header.magic, ESP3D_LANGUAGE_PACK_MAGIC, 4) == 0 &&
+      header.version == ESP3D_LANGUAGE_PACK_VERSION && header.count > 0 &&
+      fread(&offset, 1, sizeof(offset), fd) == sizeof(offset) &&
+      offset < header.blob_size) {
+    long position = sizeof(header) + header.count * sizeof(uint32_t) + offset;
+    if (fseek(fd, position, SEEK_SET) == 0) {
+      size_t read_size = fread(language, 1, size - 1, fd);
+      language[read_size] = 0x0;
+      res = strlen(language) > 0;
+    }
+  }
+  flashFs.close(fd);
+  return res;
+}
+
 std::vector<std::string> ESP3DTranslationService::getLanguagesLabels() {
   return _labels;
 }
@@ -153,11 +328,16 @@ uint16_t ESP3DTranslationService::getLanguagesList() {
                 strlen(LANGUAGE_PACK_TAIL));
             std::string filename = ESP3D_FLASH_FS_HEADER;
             filename += entry->d_name;
-            ESP3DConfigFile getLanguage(filename.c_str());
             char tmpstr[255] = {0};
-            if (getLanguage.processFile(LANGUAGE_SECION,
-                                        getEntry(ESP3DLabel::language), tmpstr,
-                                        sizeof(tmpstr))) {
+            bool found = _readPackLanguage(filename.c_str(), tmpstr,
+                                           sizeof(tmpstr));
+            if (!found) {
+              ESP3DConfigFile getLanguage(filename.c_str());
+              found = getLanguage.processFile(LANGUAGE_SECION,
+                                              getEntry(ESP3DLabel::language),
+                                              tmpstr, sizeof(tmpstr));
+            }
+            if (found) {
               if (strlen(tmpstr) > 0) {
                 esp3d_log("Found file: %s, code: %s, language:%s",
                           entry->d_name, languageCode.c_str(), tmpstr);
@@ -182,6 +362,19 @@ uint16_t ESP3DTranslationService::getLanguagesList() {
 
 void ESP3DTranslationService::handle() {}
 
+// O(1) lookup: language pack first, then default text
+const char *ESP3DTranslationService::_getText(ESP3DLabel label) {
+  uint16_t index = static_cast<uint16_t>(label);
+  if (index < _pack_count &&
+      _pack_offsets[index] != ESP3D_LANGUAGE_PACK_NO_ENTRY) {
+    return &_pack_blob[_pack_offsets[index]];
+  }
+  if (index < ESP3D_TRANSLATIONS_COUNT) {
+    return _default_texts[index];
+  }
+  return nullptr;
+}
+
 const char *ESP3DTranslationService::translate(ESP3DLabel label, ...) {
   static std::string responseString;
   responseString.clear();
@@ -189,10 +382,10 @@ const char *ESP3DTranslationService::translate(ESP3DLabel label, ...) {
     esp3d_log_e("Translation Service not started");
     return "???";
   }
-  auto it = _translations.find(label);
-  if (it != _translations.end()) {
+  const char *text = _getText(label);
+  if (text) {
     esp3d_log("Key index: %d is found in translation and text is %s",
-              static_cast<uint16_t>(label), it->second.c_str());
+              static_cast<uint16_t>(label), text);
     char localBuffer[64] = {0};
     char *buffer = localBuffer;
     va_list args;
@@ -200,10 +393,10 @@ const char *ESP3DTranslationService::translate(ESP3DLabel label, ...) {
     // Disable warning for va_start
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wvarargs"
-    va_start(args, (char *)(it->second.c_str()));
+    va_start(args, (char *)(text));
 #pragma GCC diagnostic pop
     va_copy(copy, args);
-    size_t len = vsnprintf(NULL, 0, it->second.c_str(), args);
+    size_t len = vsnprintf(NULL, 0, text, args);
     va_end(copy);
     if (len >= sizeof(localBuffer)) {
       buffer = (char *)malloc(sizeof(char) * (len + 1));
@@ -212,7 +405,7 @@ const char *ESP3DTranslationService::translate(ESP3DLabel label, ...) {
         return "???";
       }
     }
-    len = vsnprintf(buffer, len + 1, it->second.c_str(), args);
+    len = vsnprintf(buffer, len + 1, text, args);
     responseString = buffer;
     va_end(args);
     if (buffer != localBuffer) {
@@ -227,14 +420,17 @@ const char *ESP3DTranslationService::translate(ESP3DLabel label, ...) {
 
 void ESP3DTranslationService::end() { esp3d_log("Stop Translation Service"); }
 
+// Only used when loading a text language pack
 bool ESP3DTranslationService::updateTranslation(const char *text,
                                                 ESP3DLabel label) {
-  auto it = _translations.find(static_cast<ESP3DLabel>(label));
-  if (it != _translations.end()) {
+  if (!_text_pack_entries) {
+    esp3d_log_e("No language pack is loading");
+    return false;
+  }
+  if (static_cast<uint16_t>(label) < ESP3D_TRANSLATIONS_COUNT) {
     esp3d_log("Key index: %d is found in translation and updated to %s",
               static_cast<uint16_t>(label), text);
-    it->second = text;
-
+    (*_text_pack_entries)[label] = text;
     return true;
   } else {
     esp3d_log_e("Key index: %d is not found in translation",
@@ -32,6 +32,28 @@
 extern "C" {
 #endif
 
+#define ESP3D_TRANSLATIONS_COUNT static_cast<uint16_t>(ESP3DLabel::unknown_index)
+
+// Default translation entry, text is a literal kept in flash
+struct ESP3DTranslationEntry {
+  ESP3DLabel label;
+  const char *text;
+};
+
+// Compiled language pack header, generated by scripts/language_packs
+// followed by uint32_t offsets[count] (one per label, sorted by label index)
+// and by the blob of null terminated strings
+// all values are little endian
+#define ESP3D_LANGUAGE_PACK_MAGIC "ELPK"
+#define ESP3D_LANGUAGE_PACK_VERSION 1
+#define ESP3D_LANGUAGE_PACK_NO_ENTRY 0xFFFFFFFF
+struct ESP3DLanguagePackHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t count;
+  uint32_t blob_size;
+};
+
 class ESP3DTranslationService final {
  public:
   ESP3DTranslationService();
@@ -53,7 +75,21 @@ class ESP3DTranslationService final {
 
  private:
   bool _started;
-  std::map<ESP3DLabel, std::string> _translations;
+  const char *_getText(ESP3DLabel label);
+  bool _loadPack(const char *filename);
+  bool _loadTextPack(const char *filename);
+  bool _setPack(char *pack, size_t size);
+  void _freePack();
+  bool _readPackLanguage(const char *filename, char *language, size_t size);
+  const char *_default_texts[ESP3D_TRANSLATIONS_COUNT];
+  // language pack is a single block: header, offsets table and strings blob
+  char *_pack;
+  uint16_t _pack_count;
+  const uint32_t *_pack_offsets;
+  const char *_pack_blob;
+  uint32_t _pack_blob_size;
+  // only used while loading a text language pack
+  std::map<ESP3DLabel, std::string> *_text_pack_entries;
   std::string _languageCode;
   std::vector<std::string> _values;
   std::vector<std::string> _labels;
@@ -0,0 +1,392 @@
+/*
+  esp3d_ota_writer
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "esp3d_ota_writer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp3d_log.h"
+#include "esp3d_values.h"
+#include "esp_app_format.h"
+#include "esp_ota_ops.h"
+#if ESP3D_TFT_BENCHMARK
+#include "esp_timer.h"
+#endif  // ESP3D_TFT_BENCHMARK
+
+#define UNKNOWN_SIZE ((size_t)-1)
+
+ESP3DOtaWriter esp3dOtaWriter;
+
+ESP3DOtaWriter::ESP3DOtaWriter() {
+  _partition = nullptr;
+  for (uint8_t i = 0; i < ESP3D_OTA_BLOCKS_COUNT; i++) {
+    _blocks[i] = nullptr;
+  }
+  _full_blocks = nullptr;
+  _free_blocks = nullptr;
+  _task_handle = nullptr;
+  _task_done = nullptr;
+  _current = -1;
+  _pos = 0;
+  _received = 0;
+  _total = 0;
+  _verified = 0;
+  _erased = 0;
+  _error = false;
+  _error_msg = "";
+  _state = ESP3DOtaState::idle;
+  _hash[0] = 0;
+  _progress = 0;
+  mbedtls_sha256_init(&_sha);
+}
+
+ESP3DOtaWriter::~ESP3DOtaWriter() { abort(); }
+
+void ESP3DOtaWriter::_setError(const char *msg) {
+  esp3d_log_e("Update error: %s", msg);
+  _error_msg = msg;
+  _error = true;
+}
+
+// Nothing was written to flash yet, so a failed resume can be tried again
+bool ESP3DOtaWriter::_beginError(const char *msg, bool resume) {
+  _setError(msg);
+  _state = resume ? ESP3DOtaState::interrupted : ESP3DOtaState::error;
+  return false;
+}
+
+void ESP3DOtaWriter::_setProgress() {
+  if (_total == UNKNOWN_SIZE || _total == 0) {
+    return;
+  }
+  uint8_t progress = (100ULL * _verified) / _total;
+  if (progress != _progress) {
+    _progress = progress;
+    esp3dTftValues.set_string_value(ESP3DValuesIndex::update_progress,
+                                    std::to_string(progress).c_str());
+  }
+}
+
+size_t ESP3DOtaWriter::getResumeOffset(const char *name, size_t total_size) {
+  if (_state != ESP3DOtaState::interrupted || total_size != _total ||
+      _name != name) {
+    return 0;
+  }
+  return _verified;
+}
+
+void ESP3DOtaWriter::_clear() {
+  for (uint8_t i = 0; i < ESP3D_OTA_BLOCKS_COUNT; i++) {
+    free(_blocks[i]);
+    _blocks[i] = nullptr;
+  }
+  if (_full_blocks) {
+    vQueueDelete(_full_blocks);
+    _full_blocks = nullptr;
+  }
+  if (_free_blocks) {
+    vQueueDelete(_free_blocks);
+    _free_blocks = nullptr;
+  }
+  if (_task_done) {
+    vSemaphoreDelete(_task_done);
+    _task_done = nullptr;
+  }
+  _current = -1;
+  _pos = 0;
+  mbedtls_sha256_free(&_sha);
+}
+
+// Flash content is hashed again, so resumed update starts from data
+// really written
+bool ESP3DOtaWriter::_hashFlash(size_t size) {
+  for (size_t pos = 0; pos < size; pos += ESP3D_OTA_BLOCK_SIZE) {
+    size_t len = size - pos < ESP3D_OTA_BLOCK_SIZE ? size - pos
+                                                   : ESP3D_OTA_BLOCK_SIZE;
+    if (esp_partition_read(_partition, pos, _blocks[0], len) != ESP_OK) {
+      return false;
+    }
+    mbedtls_sha256_update(&_sha, _blocks[0], len);
+  }
+  return true;
+}
+
+bool ESP3DOtaWriter::begin(const char *name, size_t total_size,
+                           size_t offset) {
+  if (_state == ESP3DOtaState::writing) {
+    esp3d_log_e("Update already in progress");
+    return false;
+  }
+  if (offset != 0 && offset != getResumeOffset(name, total_size)) {
+    esp3d_log_e("Cannot resume %s at %d", name, offset);
+    _error_msg = "Cannot resume";
+    return false;
+  }
+  _error = false;
+  _error_msg = "";
+  _hash[0] = 0;
+  _partition = esp_ota_get_next_update_partition(NULL);
+  if (!_partition) {
+    return _beginError("Error accessing update partition", offset != 0);
+  }
+  if (total_size != UNKNOWN_SIZE && total_size > _partition->size) {
+    esp3d_log_e("Not enough space have %ld and need %d", _partition->size,
+                total_size);
+    return _beginError("Error not enough space", offset != 0);
+  }
+  for (uint8_t i = 0; i < ESP3D_OTA_BLOCKS_COUNT; i++) {
+    _blocks[i] = (uint8_t *)malloc(ESP3D_OTA_BLOCK_SIZE);
+    if (!_blocks[i]) {
+      _clear();
+      return _beginError("Memory allocation failed", offset != 0);
+    }
+  }
+  _full_blocks =
+      xQueueCreate(ESP3D_OTA_BLOCKS_COUNT + 1, sizeof(ESP3DOtaBlock));
+  _free_blocks = xQueueCreate(ESP3D_OTA_BLOCKS_COUNT, sizeof(int8_t));
+  _task_done = xSemaphoreCreateBinary();
+  if (!_full_blocks || !_free_blocks || !_task_done) {
+    _clear();
+    return _beginError("Memory allocation failed", offset != 0);
+  }
+  mbedtls_sha256_init(&_sha);
+  mbedtls_sha256_starts(&_sha, 0);
+  if (offset != 0 && !_hashFlash(offset)) {
+    _clear();
+    return _beginError("Cannot read update partition", offset != 0);
+  }
+  _verified = offset;
+  _erased = offset;
+  _received = offset;
+  _total = total_size;
+  _name = name;
+  // force first report
+  _progress = UINT8_MAX;
+  _setProgress();
+  for (int8_t i = 0; i < ESP3D_OTA_BLOCKS_COUNT; i++) {
+    xQueueSend(_free_blocks, &i, 0);
+  }
+  xQueueReceive(_free_blocks, &_current, 0);
+  _pos = 0;
+  BaseType_t res = xTaskCreatePinnedToCore(
+      _task, "otaWriter", ESP3D_OTA_TASK_SIZE, this, ESP3D_OTA_TASK_PRIORITY,
+      &_task_handle, ESP3D_OTA_TASK_CORE);
+  if (res != pdPASS || !_task_handle) {
+    _task_handle = nullptr;
+    _clear();
+    return _beginError("Update task creation failed", offset != 0);
+  }
+#if ESP3D_TFT_BENCHMARK
+  _start_time = esp_timer_get_time();
+#endif  // ESP3D_TFT_BENCHMARK
+  esp3d_log("Update %s started at %d", name, offset);
+  _state = ESP3DOtaState::writing;
+  return true;
+}
+
+void ESP3DOtaWriter::_task(void *arg) {
+  ESP3DOtaWriter *writer = (ESP3DOtaWriter *)arg;
+  ESP3DOtaBlock block;
+  while (xQueueReceive(writer->_full_blocks, &block, portMAX_DELAY) ==
+             pdTRUE &&
+         block.index >= 0) {
+    // after an error, blocks are only given back
+    if (!writer->_error) {
+      writer->_writeBlock(block.index, block.size);
+    }
+    xQueueSend(writer->_free_blocks, &block.index, portMAX_DELAY);
+  }
+  xSemaphoreGive(writer->_task_done);
+  vTaskDelete(NULL);
+}
+
+bool ESP3DOtaWriter::_writeBlock(uint8_t index, size_t size) {
+  const uint8_t *data = _blocks[index];
+  size_t offset = _verified;
+  if (offset == 0 && data[0] != ESP_IMAGE_HEADER_MAGIC) {
+    _setError("Invalid image");
+    return false;
+  }
+  // erase is done just before writing, by whole sectors
+  if (offset + size > _erased) {
+    size_t erase_size = offset + size - _erased;
+    erase_size = ((erase_size + _partition->erase_size - 1) /
+                  _partition->erase_size) *
+                 _partition->erase_size;
+    if (esp_partition_erase_range(_partition, _erased, erase_size) !=
+        ESP_OK) {
+      _setError("Error update erase failed");
+      return false;
+    }
+    _erased += erase_size;
+  }
+  if (esp_partition_write(_partition, offset, data, size) != ESP_OK) {
+    _setError("Error update write failed");
+    return false;
+  }
+  uint8_t check[ESP3D_OTA_CHECK_SIZE];
+  for (size_t pos = 0; pos < size; pos += ESP3D_OTA_CHECK_SIZE) {
+    size_t len = size - pos < ESP3D_OTA_CHECK_SIZE ? size - pos
+                                                   : ESP3D_OTA_CHECK_SIZE;
+    if (esp_partition_read(_partition, offset + pos, check, len) != ESP_OK ||
+        memcmp(check, data + pos, len) != 0) {
+      _setError("Error update verification failed");
+      return false;
+    }
+  }
+  mbedtls_sha256_update(&_sha, data, size);
+  _verified = offset + size;
+  _setProgress();
+  return true;
+}
+
+bool ESP3DOtaWriter::_queueBlock() {
+  ESP3DOtaBlock block = {_current, _pos};
+  _current = -1;
+  _pos = 0;
+  xQueueSend(_full_blocks, &block, portMAX_DELAY);
+  // writer task gives back a block once written
+  xQueueReceive(_free_blocks, &_current, portMAX_DELAY);
+  return !_error;
+}
+
+uint8_t *ESP3DOtaWriter::getBuffer(size_t *available) {
+  if (_state != ESP3DOtaState::writing || _error || _current < 0) {
+    *available = 0;
+    return nullptr;
+  }
+  *available = ESP3D_OTA_BLOCK_SIZE - _pos;
+  return _blocks[_current] + _pos;
+}
+
+bool ESP3DOtaWriter::commit(size_t size) {
+  if (_state != ESP3DOtaState::writing || _error) {
+    return false;
+  }
+  size_t max_size = _total != UNKNOWN_SIZE ? _total : _partition->size;
+  if (_pos + size > ESP3D_OTA_BLOCK_SIZE || _received + size > max_size) {
+    _setError("Error update is too big");
+    return false;
+  }
+  _pos += size;
+  _received += size;
+  if (_pos == ESP3D_OTA_BLOCK_SIZE) {
+    return _queueBlock();
+  }
+  return true;
+}
+
+bool ESP3DOtaWriter::write(const uint8_t *data, size_t size) {
+  while (size > 0) {
+    size_t available = 0;
+    uint8_t *buffer = getBuffer(&available);
+    if (!buffer) {
+      return false;
+    }
+    size_t len = size < available ? size : available;
+    memcpy(buffer, data, len);
+    if (!commit(len)) {
+      return false;
+    }
+    data += len;
+    size -= len;
+  }
+  return true;
+}
+
+void ESP3DOtaWriter::_stopTask() {
+  if (!_task_handle) {
+    return;
+  }
+  ESP3DOtaBlock block = {-1, 0};
+  xQueueSend(_full_blocks, &block, portMAX_DELAY);
+  xSemaphoreTake(_task_done, portMAX_DELAY);
+  _task_handle = nullptr;
+}
+
+bool ESP3DOtaWriter::end(const char *sha256) {
+  if (_state != ESP3DOtaState::writing) {
+    return false;
+  }
+  if (_pos > 0) {
+    ESP3DOtaBlock block = {_current, _pos};
+    _current = -1;
+    _pos = 0;
+    xQueueSend(_full_blocks, &block, portMAX_DELAY);
+  }
+  _stopTask();
+  if (!_error && _total != UNKNOWN_SIZE && _verified != _total) {
+    esp3d_log_e("Invalid size got %d expected %d", _verified, _total);
+    _setError("Error file size does not match");
+  }
+  if (!_error) {
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&_sha, digest);
+    for (uint8_t i = 0; i < sizeof(digest); i++) {
+      snprintf(&_hash[i * 2], 3, "%02x", digest[i]);
+    }
+    if (sha256 && sha256[0] != 0 && strcasecmp(sha256, _hash) != 0) {
+      esp3d_log_e("Hash is %s expected %s", _hash, sha256);
+      _setError("Error hash does not match");
+    }
+  }
+  if (!_error) {
+    // image is validated before being set as boot partition
+    esp_err_t err = esp_ota_set_boot_partition(_partition);
+    if (err != ESP_OK) {
+      esp3d_log_e("esp_ota_set_boot_partition failed (%s)!",
+                  esp_err_to_name(err));
+      _setError("Error update failed");
+    }
+  }
+  _clear();
+  if (_error) {
+    _state = ESP3DOtaState::error;
+    return false;
+  }
+  _state = ESP3DOtaState::done;
+  _total = _verified;
+  _setProgress();
+#if ESP3D_TFT_BENCHMARK
+  int64_t duration = (esp_timer_get_time() - _start_time) / 1000;
+  esp3d_report("Update %d bytes in %lld ms, %lld KB/s", _verified, duration,
+               duration > 0 ? (int64_t)_verified / duration : 0);
+#endif  // ESP3D_TFT_BENCHMARK
+  esp3d_log("Update done, sha256 %s", _hash);
+  return true;
+}
+
+void ESP3DOtaWriter::abort() {
+  if (_state != ESP3DOtaState::writing) {
+    return;
+  }
+  // partial block is dropped so resume offset stays on a block boundary,
+  // full blocks already queued are still written
+  _pos = 0;
+  _stopTask();
+  _clear();
+  if (!_error && _verified > 0 && _total != UNKNOWN_SIZE) {
+    esp3d_log("Update interrupted at %d / %d", _verified, _total);
+    _state = ESP3DOtaState::interrupted;
+  } else {
+    _state = ESP3DOtaState::error;
+  }
+}
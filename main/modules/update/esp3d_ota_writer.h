@@ -0,0 +1,132 @@
+/*
+  esp3d_ota_writer
+
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+
+#include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "mbedtls/sha256.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Size of a flash write, must be a multiple of flash sector size
+#define ESP3D_OTA_BLOCK_SIZE (16 * 1024)
+// One block is filled while the other one is written
+#define ESP3D_OTA_BLOCKS_COUNT 2
+// Flash writer task
+#define ESP3D_OTA_TASK_SIZE 4096
+#define ESP3D_OTA_TASK_PRIORITY 5
+#define ESP3D_OTA_TASK_CORE tskNO_AFFINITY
+// Written data are read back by this size to be checked
+#define ESP3D_OTA_CHECK_SIZE 512
+// Size of SHA-256 as hex string + 0
+#define ESP3D_OTA_HASH_SIZE 65
+
+enum class ESP3DOtaState : uint8_t {
+  idle = 0,
+  writing,
+  interrupted,  // can be resumed from verified offset
+  done,
+  error,
+};
+
+struct ESP3DOtaBlock {
+  int8_t index;  // -1 to stop writer task
+  size_t size;
+};
+
+// Write firmware in update partition by big blocks: a task writes a block,
+// reads it back and updates the SHA-256 while the next one is filled by
+// caller
+class ESP3DOtaWriter final {
+ public:
+  ESP3DOtaWriter();
+  ~ESP3DOtaWriter();
+  // total_size is (size_t)-1 if unknown, offset is 0 unless resuming
+  bool begin(const char *name, size_t total_size, size_t offset = 0);
+  bool write(const uint8_t *data, size_t size);
+  // fill current block directly to avoid a copy, then commit() what was
+  // filled
+  uint8_t *getBuffer(size_t *available);
+  bool commit(size_t size);
+  // write last block, check size and hash (hex, optional) and set boot
+  // partition
+  bool end(const char *sha256 = nullptr);
+  // verified data are kept so same file can be resumed
+  void abort();
+  ESP3DOtaState getState() { return _state; }
+  // offset to resume same file from, 0 if it cannot be resumed
+  size_t getResumeOffset(const char *name, size_t total_size);
+  size_t getVerifiedSize() { return _verified; }
+  size_t getTotalSize() { return _total; }
+  const char *getName() { return _name.c_str(); }
+  // valid once end() succeeded
+  const char *getHash() { return _hash; }
+  const char *getErrorMsg() { return _error_msg; }
+
+ private:
+  static void _task(void *arg);
+  bool _writeBlock(uint8_t index, size_t size);
+  bool _hashFlash(size_t size);
+  bool _queueBlock();
+  void _stopTask();
+  void _clear();
+  void _setError(const char *msg);
+  bool _beginError(const char *msg, bool resume);
+  void _setProgress();
+  const esp_partition_t *_partition;
+  uint8_t *_blocks[ESP3D_OTA_BLOCKS_COUNT];
+  QueueHandle_t _full_blocks;
+  QueueHandle_t _free_blocks;
+  TaskHandle_t _task_handle;
+  SemaphoreHandle_t _task_done;
+  int8_t _current;
+  size_t _pos;
+  size_t _received;
+  size_t _total;
+  // written, read back and hashed, only updated by writer task
+  volatile size_t _verified;
+  size_t _erased;
+  volatile bool _error;
+  const char *_error_msg;
+  ESP3DOtaState _state;
+  std::string _name;
+  mbedtls_sha256_context _sha;
+  char _hash[ESP3D_OTA_HASH_SIZE];
+  uint8_t _progress;
+#if ESP3D_TFT_BENCHMARK
+  int64_t _start_time;
+#endif  // ESP3D_TFT_BENCHMARK
+};
+
+extern ESP3DOtaWriter esp3dOtaWriter;
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
@@ -29,6 +29,7 @@
 #include "esp_system.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "update/esp3d_ota_writer.h"
 #if ESP3D_SD_CARD_FEATURE
 #include "filesystem/esp3d_sd.h"
 #include "sd_def.h"
@@ -49,7 +50,6 @@
 #define FW_FILE "/esp3dfw.bin"
 #define FW_FILE_OK "/esp3dfw.ok"
 // #define FS_FILE "/esp3dfs.bin"
-#define CHUNK_BUFFER_SIZE 1024
 
 ESP3DUpdateService esp3dUpdateService;
 
@@ -409,13 +409,8 @@ bool ESP3DUpdateService::updateConfig() {
 }
 #if ESP3D_SD_CARD_FEATURE
 bool ESP3DUpdateService::updateFW() {
-  bool isSuccess = true;
-  char chunk[CHUNK_BUFFER_SIZE];
-  esp_ota_handle_t update_handle = 0;
-  const esp_partition_t *update_partition = NULL;
   esp3d_log("Updating firmware");
   struct stat entry_stat;
-  size_t totalSize = 0;
   if (sd.stat(FW_FILE, &entry_stat) == -1) {
     esp3d_log_e("Failed to stat : %s", FW_FILE);
     return false;
@@ -425,70 +420,32 @@ bool ESP3DUpdateService::updateFW() {
     esp3d_log_e("Failed to open on sd : %s", FW_FILE);
     return false;
   }
-  update_partition = esp_ota_get_next_update_partition(NULL);
-  if (!update_partition) {
-    esp3d_log_e("Error accessing flash filesystem");
-    isSuccess = false;
-  }
-  if (isSuccess) {
-    esp_err_t err = esp_ota_begin(update_partition, OTA_WITH_SEQUENTIAL_WRITES,
-                                  &update_handle);
-    if (err != ESP_OK) {
-      esp3d_log_e("esp_ota_begin failed (%s)", esp_err_to_name(err));
-      isSuccess = false;
-    }
-  }
-  if (isSuccess) {
-    size_t chunksize;
-#if ESP3D_TFT_LOG
-    uint8_t progress = 0;
-#endif
-    do {
-      chunksize = fread(chunk, 1, CHUNK_BUFFER_SIZE, fwFd);
-      totalSize += chunksize;
-      if (esp_ota_write(update_handle, (const void *)chunk, chunksize) !=
-          ESP_OK) {
-        esp3d_log_e("Error cannot writing data on update partition");
-        isSuccess = false;
-      }
-#if ESP3D_TFT_LOG
-      if (progress != 100 * totalSize / entry_stat.st_size) {
-        progress = 100 * totalSize / entry_stat.st_size;
-        esp3d_log("Update %d %% %d / %ld", progress, totalSize,
-                  entry_stat.st_size);
-      }
-#endif
-    } while (chunksize != 0 && isSuccess);
-  }
-  sd.close(fwFd);
-  if (isSuccess) {
-    // check size
-    if (totalSize != entry_stat.st_size) {
-      esp3d_log_e("Failed to read firmware full data");
-      isSuccess = false;
-    }
+  if (!esp3dOtaWriter.begin(FW_FILE, entry_stat.st_size)) {
+    sd.close(fwFd);
+    return false;
   }
-  if (isSuccess) {
-    esp_err_t err = esp_ota_end(update_handle);
-    if (err != ESP_OK) {
-      esp3d_log_e("Error cannot end update(%s)", esp_err_to_name(err));
+  // file is read directly in the block not being written
+  bool isSuccess = true;
+  size_t chunksize;
+  do {
+    size_t available = 0;
+    uint8_t *buffer = esp3dOtaWriter.getBuffer(&available);
+    if (!buffer) {
       isSuccess = false;
+      break;
     }
-    update_handle = 0;
-  }
-  if (isSuccess) {
-    esp_err_t err = esp_ota_set_boot_partition(update_partition);
-    if (err != ESP_OK) {
-      esp3d_log_e("esp_ota_set_boot_partition failed (%s)!",
-                  esp_err_to_name(err));
+    chunksize = fread(buffer, 1, available, fwFd);
+    if (chunksize > 0 && !esp3dOtaWriter.commit(chunksize)) {
       isSuccess = false;
     }
+  } while (chunksize != 0 && isSuccess);
+  sd.close(fwFd);
+  if (!isSuccess) {
+    esp3dOtaWriter.abort();
+    return false;
   }
-  if (update_handle && !isSuccess) {
-    esp_ota_abort(update_handle);
-    update_handle = 0;
-  }
-  return isSuccess;
+  // size and image are checked before setting boot partition
+  return esp3dOtaWriter.end();
 }
 #endif  // ESP3D_SD_CARD_FEATURE
 void ESP3DUpdateService::handle() {}
@@ -20,6 +20,8 @@
 #if ESP3D_USB_SERIAL_FEATURE
 #include "esp3d_usb_serial_client.h"
 
+#include <string.h>
+
 #include "esp3d_commands.h"
 #include "esp3d_hal.h"
 #include "esp3d_log.h"
@@ -27,9 +29,11 @@
 #include "usb_serial_def.h"
 #include "websocket/esp3d_webui_service.h"
 
-ESP3DUsbSerialClient usbSerialClient;
+#if ESP3D_TFT_BENCHMARK
+#include "esp_timer.h"
+#endif  // ESP3D_TFT_BENCHMARK
 
-#define RX_FLUSH_TIME_OUT 1500  // milliseconds timeout
+ESP3DUsbSerialClient usbSerialClient;
 
 /**
  * @brief Data received callback
@@ -41,33 +45,53 @@ bool rx_callback(const uint8_t *data, size_t data_len, void *arg) {
   return true;
 }
 
+// Lines are pushed from transfer buffer, only a line split between two
+// transfers goes through _rx_buffer
 void ESP3DUsbSerialClient::handle_rx(const uint8_t *data, size_t data_len) {
-  static uint64_t startTimeout = 0;  // microseconds
-  // parse data
-  startTimeout = esp3d_hal::millis();
-  for (size_t i = 0; i < data_len; i++) {
-    if (_rx_pos < ESP3D_USB_SERIAL_RX_BUFFER_SIZE) {
-      _rx_buffer[_rx_pos] = data[i];
-      _rx_pos++;
+  const uint8_t *end = data + data_len;
+  while (data < end) {
+    const uint8_t *eol = data;
+    while (eol < end && !isEndChar(*eol)) {
+      eol++;
+    }
+    if (eol == end) {
+      // keep start of line for next transfer
+      size_t size = end - data;
+      if (_rx_pos + size > ESP3D_USB_SERIAL_RX_BUFFER_SIZE) {
+        size = ESP3D_USB_SERIAL_RX_BUFFER_SIZE - _rx_pos;
+      }
+      memcpy(_rx_buffer + _rx_pos, data, size);
+      _rx_pos += size;
+      data += size;
+      if (_rx_pos == ESP3D_USB_SERIAL_RX_BUFFER_SIZE) {
+        // line is too long, send what we have
+        if (!pushMsgToRxQueue(_rx_buffer, _rx_pos)) {
+          esp3d_log_e("Push Message to rx queue failed");
+        }
+        _rx_pos = 0;
+      }
+      continue;
     }
-    // if end of char or buffer is full
-    if (isEndChar(data[i]) || _rx_pos == ESP3D_USB_SERIAL_RX_BUFFER_SIZE) {
-      // create message and push
-      if (!pushMsgToRxQueue(_rx_buffer, _rx_pos)) {
-        // send error
+    // end char is part of message like for serial
+    eol++;
+    if (_rx_pos == 0) {
+      if (!pushMsgToRxQueue(data, eol - data)) {
         esp3d_log_e("Push Message to rx queue failed");
       }
-      _rx_pos = 0;
+      data = eol;
+      continue;
     }
-  }
-
-  // if no data during a while then send them
-  if (esp3d_hal::millis() - startTimeout > (RX_FLUSH_TIME_OUT) && _rx_pos > 0) {
-    if (!pushMsgToRxQueue(_rx_buffer, _rx_pos)) {
-      // send error
+    size_t size = eol - data;
+    if (_rx_pos + size > ESP3D_USB_SERIAL_RX_BUFFER_SIZE) {
+      // line is too long, end of it will be next message
+      size = ESP3D_USB_SERIAL_RX_BUFFER_SIZE - _rx_pos;
+    }
+    memcpy(_rx_buffer + _rx_pos, data, size);
+    if (!pushMsgToRxQueue(_rx_buffer, _rx_pos + size)) {
       esp3d_log_e("Push Message to rx queue failed");
     }
     _rx_pos = 0;
+    data += size;
   }
 }
 
@@ -133,6 +157,10 @@ void ESP3DUsbSerialClient::connectDevice() {
   esp3d_log("USB device found");
 
   if (_vcp_ptr->line_coding_set(&line_coding) == ESP_OK) {
+    // once for all, not after each transfer
+    if (_vcp_ptr->set_control_line_state(true, true) != ESP_OK) {
+      esp3d_log("Failed set line");
+    }
     esp3d_log("USB Connected");
     usbSerialClient.setConnected(true);
     esp3d_hal::wait(10);
@@ -187,10 +215,14 @@ ESP3DUsbSerialClient::ESP3DUsbSerialClient() {
   _connected = false;
   _device_disconnected_sem = NULL;
   _rx_buffer = NULL;
+  _tx_buffer = NULL;
   _rx_pos = 0;
   _xHandle = NULL;
   _vcp_ptr = NULL;
   _stopConnect = false;
+#if ESP3D_TFT_BENCHMARK
+  resetTxStats();
+#endif  // ESP3D_TFT_BENCHMARK
 }
 ESP3DUsbSerialClient::~ESP3DUsbSerialClient() { end(); }
 
@@ -218,6 +250,11 @@ bool ESP3DUsbSerialClient::begin() {
     esp3d_log_e("Failed to allocate memory for buffer");
     return false;
   }
+  _tx_buffer = (uint8_t *)malloc(ESP3D_USB_SERIAL_TX_BUFFER_SIZE);
+  if (!_tx_buffer) {
+    esp3d_log_e("Failed to allocate memory for buffer");
+    return false;
+  }
 
   _device_disconnected_sem = xSemaphoreCreateBinary();
   if (_device_disconnected_sem == NULL) {
@@ -235,6 +272,7 @@ bool ESP3DUsbSerialClient::begin() {
     return false;
   }
   setTxMutex(&_tx_mutex);
+  setEventConsumer(ESP3DEventConsumer::stream);
   // load baudrate
   _baudrate = esp3dTftsettings.readUint32(
       ESP3DSettingIndex::esp3d_usb_serial_baud_rate);
@@ -301,26 +339,83 @@ void ESP3DUsbSerialClient::handle() {
       }
     }
     if (getTxMsgsCount() > 0) {
+      // pack queued messages while they fit, one bulk transfer for all
+      size_t tx_size = 0;
       ESP3DMessage *msg = popTx();
-      if (msg) {
-        esp3d_log("Got message to send");
-        if (_connected) {
-          esp3d_log("Send message");
-          // TODO: check if msg->size < ESP3D_USB_SERIAL_TX_BUFFER_SIZE
-          if (_vcp_ptr && _vcp_ptr->tx_blocking(msg->data, msg->size) == ESP_OK) {
-            if (!(_vcp_ptr && _vcp_ptr->set_control_line_state(true, true) == ESP_OK)) {
-              esp3d_log("Failed set line");
-            }
+      while (msg) {
+        if (!_connected) {
+          // drop it like a disconnected cable would
+        } else if (msg->size > ESP3D_USB_SERIAL_TX_BUFFER_SIZE - tx_size) {
+          if (tx_size > 0) {
+            _sendTx(_tx_buffer, tx_size);
+            tx_size = 0;
+          }
+          if (msg->size > ESP3D_USB_SERIAL_TX_BUFFER_SIZE) {
+            _sendTx(msg->data, msg->size);
           } else {
-            esp3d_log_e("Failed to send message");
+            memcpy(_tx_buffer, msg->data, msg->size);
+            tx_size = msg->size;
           }
+        } else {
+          memcpy(_tx_buffer + tx_size, msg->data, msg->size);
+          tx_size += msg->size;
         }
+#if ESP3D_TFT_BENCHMARK
+        _tx_msgs++;
+#endif  // ESP3D_TFT_BENCHMARK
         deleteMsg(msg);
+        msg = getTxMsgsCount() > 0 ? popTx() : nullptr;
       }
+      if (tx_size > 0) {
+        _sendTx(_tx_buffer, tx_size);
+      }
+    }
+  }
+}
+
+// Data bigger than tx buffer of device are sent in several transfers
+bool ESP3DUsbSerialClient::_sendTx(const uint8_t *data, size_t size) {
+#if ESP3D_TFT_BENCHMARK
+  int64_t start = esp_timer_get_time();
+#endif  // ESP3D_TFT_BENCHMARK
+  while (size > 0) {
+    size_t len = size > ESP3D_USB_SERIAL_TX_BUFFER_SIZE
+                     ? ESP3D_USB_SERIAL_TX_BUFFER_SIZE
+                     : size;
+    if (!_vcp_ptr || _vcp_ptr->tx_blocking((uint8_t *)data, len) != ESP_OK) {
+      esp3d_log_e("Failed to send message");
+      return false;
     }
+#if ESP3D_TFT_BENCHMARK
+    _tx_bytes += len;
+    _tx_transfers++;
+#endif  // ESP3D_TFT_BENCHMARK
+    data += len;
+    size -= len;
   }
+#if ESP3D_TFT_BENCHMARK
+  _tx_time += esp_timer_get_time() - start;
+#endif  // ESP3D_TFT_BENCHMARK
+  return true;
+}
+
+#if ESP3D_TFT_BENCHMARK
+void ESP3DUsbSerialClient::resetTxStats() {
+  _tx_bytes = 0;
+  _tx_transfers = 0;
+  _tx_msgs = 0;
+  _tx_time = 0;
 }
 
+void ESP3DUsbSerialClient::reportTxStats() {
+  esp3d_report(
+      "USB tx: %ld messages, %ld bytes in %ld transfers, %lld us, %.1f us per "
+      "message",
+      _tx_msgs, _tx_bytes, _tx_transfers, _tx_time,
+      _tx_msgs ? (double)_tx_time / _tx_msgs : 0.0);
+}
+#endif  // ESP3D_TFT_BENCHMARK
+
 void ESP3DUsbSerialClient::flush() {}
 
 void ESP3DUsbSerialClient::end() {
@@ -349,6 +444,10 @@ void ESP3DUsbSerialClient::end() {
     _rx_buffer = NULL;
     _rx_pos = 0;
   }
+  if (_tx_buffer) {
+    free(_tx_buffer);
+    _tx_buffer = NULL;
+  }
   if (_xHandle) {
     vTaskDelete(_xHandle);
     _xHandle = NULL;
@@ -53,11 +53,24 @@ class ESP3DUsbSerialClient : public ESP3DClient {
   bool isConnected() { return _connected; }
   void setBaudRate(uint32_t baudRate) { _baudrate = baudRate; }
   uint32_t getBaudRate() { return _baudrate; }
+#if ESP3D_TFT_BENCHMARK
+  void resetTxStats();
+  void reportTxStats();
+#endif  // ESP3D_TFT_BENCHMARK
 
  private:
+  bool _sendTx(const uint8_t* data, size_t size);
   TaskHandle_t _xHandle;
   size_t _rx_pos;
   uint8_t* _rx_buffer;
+  // queued messages are packed in it to make full bulk transfers
+  uint8_t* _tx_buffer;
+#if ESP3D_TFT_BENCHMARK
+  uint32_t _tx_bytes;
+  uint32_t _tx_transfers;
+  uint32_t _tx_msgs;
+  int64_t _tx_time;
+#endif  // ESP3D_TFT_BENCHMARK
   uint32_t _baudrate;
   bool _stopConnect;
   bool _started;
@@ -20,10 +20,13 @@
 #include "esp3d_webui_service.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "authentication/esp3d_authentication.h"
 #include "esp3d_hal.h"
 #include "esp3d_log.h"
+#include "esp3d_machine_state.h"
 #include "esp3d_string.h"
 #include "http/esp3d_http_service.h"
 
@@ -74,10 +77,74 @@ esp_err_t ESP3DWebUiService::onOpen(httpd_req_t *req) {
 void ESP3DWebUiService::process(ESP3DMessage *msg) {
   // webui use bin for the stream
   esp3d_log("Processing message");
-  BroadcastBin(msg->data, msg->size);
+  // printer output is not sent to clients using machine state only
+  bool raw = msg->origin == ESP3DClientType::serial ||
+             msg->origin == ESP3DClientType::usb_serial;
+  for (uint i = 0; i < maxClients(); i++) {
+    ESP3DWebSocketInfos *client = getClientInfos(i);
+    if (client && (!raw || client->raw_stream)) {
+      pushMsgBin(client->socket_id, msg->data, msg->size);
+    }
+  }
   ESP3DClient::deleteMsg(msg);
 }
 
+// STATE:<period>[:NORAW]
+// period in ms, 0 to unsubscribe, NORAW to stop printer output
+void ESP3DWebUiService::_subscribeState(int socketId, const char *params) {
+  ESP3DWebSocketInfos *client = getClientInfosFromSocketId(socketId);
+  if (!client) {
+    esp3d_log_e("Unregistered client");
+    return;
+  }
+  uint32_t period = ESP3D_WEBUI_STATE_DEFAULT_PERIOD;
+  if (*params >= '0' && *params <= '9') {
+    period = atoi(params);
+  }
+  if (period != 0 && period < ESP3D_MACHINE_STATE_MIN_PERIOD) {
+    period = ESP3D_MACHINE_STATE_MIN_PERIOD;
+  }
+  client->state_period = period;
+  client->raw_stream = period == 0 || strstr(params, "NORAW") == nullptr;
+  // next push is a full snapshot
+  client->state_version = 0;
+  client->state_last_push = 0;
+  esp3d_log("Socket %d state period %ld raw %d", socketId, period,
+            client->raw_stream);
+}
+
+void ESP3DWebUiService::handle() {
+  if (!started()) {
+    return;
+  }
+  uint32_t version = esp3dMachineState.getVersion();
+  int64_t now = esp3d_hal::millis();
+  // same delta is generated once if clients have same version
+  std::string delta;
+  uint32_t delta_since = 0;
+  uint32_t delta_version = 0;
+  for (uint i = 0; i < maxClients(); i++) {
+    ESP3DWebSocketInfos *client = getClientInfos(i);
+    if (!client || client->state_period == 0 ||
+        (client->state_version == version && client->state_last_push != 0) ||
+        now - client->state_last_push < client->state_period) {
+      continue;
+    }
+    if (delta.empty() || delta_since != client->state_version) {
+      delta_since = client->state_version;
+      delta = "STATE:";
+      std::string json;
+      delta_version = esp3dMachineState.getDelta(delta_since, json);
+      delta += json;
+      delta += "\n";
+    }
+    if (pushMsgTxt(client->socket_id, delta.c_str()) == ESP_OK) {
+      client->state_version = delta_version;
+    }
+    client->state_last_push = now;
+  }
+}
+
 esp_err_t ESP3DWebUiService::pushNotification(const char *msg) {
   // webui use TXT for internal messages
   std::string tmp = "NOTIFICATION:";
@@ -114,18 +181,22 @@ esp_err_t ESP3DWebUiService::onMessage(httpd_req_t *req) {
       return ret;
     }
     if (ws_pkt.type == HTTPD_WS_TYPE_TEXT) {
-#if ESP3D_AUTHENTICATION_FEATURE
       int currentFd = httpd_req_to_sockfd(req);
       esp3d_log("Got packet with message: %s on socket %d", ws_pkt.payload,
                 currentFd);
+      if (esp3d_string::startsWith((const char *)buf, "STATE:")) {
+        _subscribeState(currentFd, (const char *)&buf[6]);
+      }
+#if ESP3D_AUTHENTICATION_FEATURE
       if (esp3d_string::startsWith((const char *)buf, "PING:")) {
         esp3d_log("Got PING on sessionID %s", (const char *)&buf[5]);
-        ESP3DAuthenticationRecord *rec =
-            esp3dAuthenthicationService.getRecord((const char *)&buf[5]);
+        ESP3DAuthenticationRecord rec;
+        bool found =
+            esp3dAuthenthicationService.getRecord((const char *)&buf[5], &rec);
         std::string tmpStr = "PING:";
         uint64_t session = esp3dAuthenthicationService.getSessionTimeout();
-        if (rec != NULL) {
-          int64_t last = rec->last_time;
+        if (found) {
+          int64_t last = rec.last_time;
 
           uint64_t now = esp3d_hal::millis();
           int64_t diff = now - last;
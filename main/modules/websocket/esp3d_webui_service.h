@@ -22,16 +22,24 @@
 
 #include "esp3d_ws_service.h"
 
+// Machine state push period (ms) when client does not set it
+#define ESP3D_WEBUI_STATE_DEFAULT_PERIOD 500
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 class ESP3DWebUiService : public ESP3DWsService {
  public:
+  // push machine state changes to subscribed clients
+  void handle();
   void process(ESP3DMessage *msg);
   esp_err_t pushNotification(const char *msg);
   esp_err_t onOpen(httpd_req_t *req);
   esp_err_t onMessage(httpd_req_t *req);
+
+ private:
+  void _subscribeState(int socketId, const char *params);
 };
 
 extern ESP3DWebUiService esp3dWsWebUiService;
@@ -119,6 +119,10 @@ bool ESP3DWsService::addClient(int socketid) {
   }
   _clients[freeIndex].socket_id = socketid;
   _clients[freeIndex].buf_position = 0;
+  _clients[freeIndex].state_period = 0;
+  _clients[freeIndex].state_version = 0;
+  _clients[freeIndex].state_last_push = 0;
+  _clients[freeIndex].raw_stream = true;
   esp3d_log("Added connection %d, on slot %d", socketid, freeIndex);
 
   struct sockaddr_in6 saddr;  // esp_http_server uses IPv6 addressing
@@ -335,10 +339,9 @@ bool ESP3DWsService::pushMsgToRxQueue(int socketId, const uint8_t *msg,
   } else {
     esp3d_log("SessionId is %s", client->session_id);
     // No need to check time out as session is deleted on close
-    ESP3DAuthenticationRecord *rec =
-        esp3dAuthenthicationService.getRecord(client->session_id);
-    if (rec != NULL) {
-      authentication_level = rec->level;
+    ESP3DAuthenticationRecord rec;
+    if (esp3dAuthenthicationService.getRecord(client->session_id, &rec)) {
+      authentication_level = rec.level;
     } else {
       esp3d_log_e("No client record for authentication level");
       return false;
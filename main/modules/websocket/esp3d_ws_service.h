@@ -44,6 +44,11 @@ struct ESP3DWebSocketInfos {
   struct sockaddr_storage source_addr;
   char *buffer;
   uint buf_position;
+  // machine state subscription, period is 0 if not subscribed
+  uint32_t state_period;
+  uint32_t state_version;
+  int64_t state_last_push;
+  bool raw_stream;
 #if ESP3D_AUTHENTICATION_FEATURE
   char session_id[25];
 #endif  // #if ESP3D_AUTHENTICATION_FEATURE
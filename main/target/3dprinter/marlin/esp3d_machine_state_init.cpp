@@ -0,0 +1,56 @@
+/*
+  esp3d_machine_state
+  Copyright (c) 2022 Luc Lebosse. All rights reserved.
+
+  This code is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This code is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "esp3d_machine_state.h"
+
+void ESP3DMachineState::init() {
+  // keys stay in flash, only pointers are stored
+  static const ESP3DMachineStateField fields[] = {
+      {ESP3DValuesIndex::ext_0_temperature, "T0",
+       ESP3DMachineStateType::number},
+      {ESP3DValuesIndex::ext_0_target_temperature, "T0t",
+       ESP3DMachineStateType::number},
+      {ESP3DValuesIndex::ext_1_temperature, "T1",
+       ESP3DMachineStateType::number},
+      {ESP3DValuesIndex::ext_1_target_temperature, "T1t",
+       ESP3DMachineStateType::number},
+      {ESP3DValuesIndex::bed_temperature, "B", ESP3DMachineStateType::number},
+      {ESP3DValuesIndex::bed_target_temperature, "Bt",
+       ESP3DMachineStateType::number},
+      {ESP3DValuesIndex::position_x, "X", ESP3DMachineStateType::number},
+      {ESP3DValuesIndex::position_y, "Y", ESP3DMachineStateType::number},
+      {ESP3DValuesIndex::position_z, "Z", ESP3DMachineStateType::number},
+      {ESP3DValuesIndex::ext_0_fan, "F0", ESP3DMachineStateType::number},
+      {ESP3DValuesIndex::ext_1_fan, "F1", ESP3DMachineStateType::number},
+      {ESP3DValuesIndex::speed, "S", ESP3DMachineStateType::number},
+      {ESP3DValuesIndex::job_status, "state", ESP3DMachineStateType::text},
+      {ESP3DValuesIndex::job_progress, "progress",
+       ESP3DMachineStateType::number},
+      {ESP3DValuesIndex::job_duration, "duration",
+       ESP3DMachineStateType::number},
+      {ESP3DValuesIndex::job_id, "job", ESP3DMachineStateType::text},
+      {ESP3DValuesIndex::update_progress, "update",
+       ESP3DMachineStateType::number},
+      {ESP3DValuesIndex::job_layer, "layer", ESP3DMachineStateType::number},
+      {ESP3DValuesIndex::job_remaining, "remaining",
+       ESP3DMachineStateType::number},
+  };
+  _fields = fields;
+  _fields_count = sizeof(fields) / sizeof(fields[0]);
+}
@@ -32,6 +32,7 @@
 
 #include "esp3d_client.h"
 #include "esp3d_log.h"
+#include "esp3d_scheduling.h"
 #include "esp_system.h"
 #include "serial_def.h"
 
@@ -197,6 +198,8 @@ const ESP3DSettingDescription ESP3DSettingsData[] = {
     {ESP3DSettingIndex::esp3d_timezone, ESP3DSettingType::string_t,
      SIZE_OF_TIMEZONE, "+00:00"},
 #endif  // ESP3D_TIMESTAMP_FEATURE
+    {ESP3DSettingIndex::esp3d_scheduling_profile, ESP3DSettingType::byte_t, 1,
+     "0"},
 };
 
 // Is Valid String Setting ?
@@ -415,6 +418,9 @@ bool ESP3DSettings::isValidByteSetting(uint8_t value,
       return true;  // 0 ->255 minutes
       break;
 #endif  // ESP3D_AUTHENTICATION_FEATURE
+    case ESP3DSettingIndex::esp3d_scheduling_profile:
+      return value < static_cast<uint8_t>(ESP3DSchedulingProfile::count);
+      break;
 #if ESP3D_USB_SERIAL_FEATURE
     case ESP3DSettingIndex::esp3d_output_client:
       return ((ESP3DClientType)value == ESP3DClientType::serial ||
@@ -699,7 +705,7 @@ bool ESP3DSettings::reset() {
   return result;
 }
 
-ESP3DSettings::ESP3DSettings() {}
+ESP3DSettings::ESP3DSettings() { _change_id = 0; }
 
 ESP3DSettings::~ESP3DSettings() {}
 
@@ -720,6 +726,7 @@ void ESP3DSettings::release_nvs(nvs_open_mode_t mode) {
   if (mode == NVS_READONLY) {
     return;
   }
+  _change_id++;
 #if ESP3D_PATCH_FS_ACCESS_RELEASE
   esp3d_log("revert patch");
   if (ESP_OK != bsp_releaseFs()) {
@@ -106,6 +106,7 @@ enum class ESP3DSettingIndex : uint16_t {
   esp3d_time_server3,
   esp3d_timezone,
   esp3d_webdav_on,
+  esp3d_scheduling_profile,
   unknown_index
 };
 
@@ -172,8 +173,11 @@ class ESP3DSettings final {
   uint8_t getDefaultByteSetting(ESP3DSettingIndex settingElement);
   const ESP3DSettingDescription* getSettingPtr(const ESP3DSettingIndex index);
   const char* GetFirmwareTargetShortName(ESP3DTargetFirmware index);
+  // changes each time settings may have been written
+  uint32_t getChangeId() { return _change_id; }
 
  private:
+  uint32_t _change_id;
   const char* IPUInt32toString(uint32_t ip_int);
   uint32_t StringtoIPUInt32(const char* s);
 };
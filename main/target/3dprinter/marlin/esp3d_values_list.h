@@ -62,6 +62,9 @@ enum class ESP3DValuesIndex : uint16_t {
   job_progress,
   job_duration,
   job_id,
+  update_progress,
+  job_layer,
+  job_remaining,
   unknown_index
 };
 
@@ -23,6 +23,7 @@
 #include "esp3d_log.h"
 #include "esp3d_string.h"
 #include "esp3d_values.h"
+#include "history/esp3d_history.h"
 
 ESP3DGCodeParserService esp3dGcodeParser;
 
@@ -146,6 +147,7 @@ bool ESP3DGCodeParserService::processCommand(const char* data) {
         // Dispatch values
         esp3dTftValues.set_string_value(ESP3DValuesIndex::ext_0_temperature,
                                         ptrt0);
+        esp3dHistory.push(ESP3DHistoryChannel::ext_0_temperature, ptrt0);
         esp3dTftValues.set_string_value(
             ESP3DValuesIndex::ext_0_target_temperature, ptrtt);
         esp3d_log("T0: %s / %s", ptrt0, ptrtt);
@@ -176,6 +178,7 @@ bool ESP3DGCodeParserService::processCommand(const char* data) {
         // Dispatch values
         esp3dTftValues.set_string_value(ESP3DValuesIndex::ext_1_temperature,
                                         ptrt1);
+        esp3dHistory.push(ESP3DHistoryChannel::ext_1_temperature, ptrt1);
         esp3dTftValues.set_string_value(
             ESP3DValuesIndex::ext_1_target_temperature, ptrtt);
         esp3d_log("T1: %s / %s", ptrt1, ptrtt);
@@ -204,6 +207,7 @@ bool ESP3DGCodeParserService::processCommand(const char* data) {
         // Dispatch values
         esp3dTftValues.set_string_value(ESP3DValuesIndex::ext_0_temperature,
                                         ptrt);
+        esp3dHistory.push(ESP3DHistoryChannel::ext_0_temperature, ptrt);
         esp3dTftValues.set_string_value(
             ESP3DValuesIndex::ext_0_target_temperature, ptrtt);
 
@@ -230,6 +234,7 @@ bool ESP3DGCodeParserService::processCommand(const char* data) {
         // Dispatch values
         esp3dTftValues.set_string_value(ESP3DValuesIndex::bed_temperature,
                                         ptrb);
+        esp3dHistory.push(ESP3DHistoryChannel::bed_temperature, ptrb);
         esp3dTftValues.set_string_value(
             ESP3DValuesIndex::bed_target_temperature, ptrtt);
         esp3d_log("Bed: %s / %s", ptrb, ptrtt);
@@ -265,6 +270,7 @@ bool ESP3DGCodeParserService::processCommand(const char* data) {
         esp3dTftValues.set_string_value(ESP3DValuesIndex::position_x, ptrx);
         esp3dTftValues.set_string_value(ESP3DValuesIndex::position_y, ptry);
         esp3dTftValues.set_string_value(ESP3DValuesIndex::position_z, ptrz);
+        esp3dHistory.push(ESP3DHistoryChannel::position_z, ptrz);
         setPollingCommandsLastRun(
             ESP3D_POLLING_COMMANDS_INDEX_TEMPERATURE_POSITION,
             esp3d_hal::millis());
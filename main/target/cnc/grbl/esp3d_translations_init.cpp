@@ -24,7 +24,8 @@
 #include "translations/esp3d_translation_service.h"
 
 void ESP3DTranslationService::init() {
-  _translations = {
+  // texts stay in flash, only pointers are stored
+  static const ESP3DTranslationEntry default_translations[] = {
       {ESP3DLabel::language, "English"},
       {ESP3DLabel::version, "Version"},
       {ESP3DLabel::size_for_update, "Size for updates"},
@@ -83,4 +84,7 @@ void ESP3DTranslationService::init() {
       {ESP3DLabel::stream_error, "Stream failed: '%s'"},
       {ESP3DLabel::target_firmware, "Target firmware"},
   };
+  for (const ESP3DTranslationEntry &entry : default_translations) {
+    _default_texts[static_cast<uint16_t>(entry.label)] = entry.text;
+  }
 }
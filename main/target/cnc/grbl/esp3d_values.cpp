@@ -228,6 +228,30 @@ bool ESP3DValues::intialize() {
       std::string("0"),
       nullptr,
   });
+  //  firmware update progress
+  _values.push_back({
+      ESP3DValuesIndex::update_progress,
+      ESP3DValuesType::integer_t,
+      0,  // precision
+      std::string("0"),
+      nullptr,
+  });
+  //  job current layer, from G-code analysis
+  _values.push_back({
+      ESP3DValuesIndex::job_layer,
+      ESP3DValuesType::integer_t,
+      0,  // precision
+      std::string("0"),
+      nullptr,
+  });
+  //  job estimated remaining duration
+  _values.push_back({
+      ESP3DValuesIndex::job_remaining,
+      ESP3DValuesType::integer_t,
+      0,  // precision
+      std::string("0"),
+      nullptr,
+  });
 
 #endif  // ESP3D_DISPLAY_FEATURE
   return true;
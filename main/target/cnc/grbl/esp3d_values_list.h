@@ -63,6 +63,9 @@ enum class ESP3DValuesIndex : uint16_t {
   job_id,
   state,
   state_comment,
+  update_progress,
+  job_layer,
+  job_remaining,
   unknown_index
 };
 
@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+
+import os
+import struct
+import sys
+# Path: scripts/language_packs/build_language_pack.py
+# Convert a text language pack (ui_<code>.lng) into a compiled language pack
+# that is loaded in one block and looked up by label index without parsing
+#
+# Usage: build_language_pack.py <input.lng> [output.lng]
+# if no output is provided, input file name is used in current directory
+#
+# Format (little endian), must match esp3d_translation_service.h:
+# header:  char magic[4] = "ELPK", uint16 version, uint16 count,
+#          uint32 blob_size
+# offsets: uint32 offsets[count], one per label index, 0xFFFFFFFF if the label
+#          is not translated (default text is used)
+# blob:    null terminated utf-8 strings
+
+MAGIC = b"ELPK"
+VERSION = 1
+NO_ENTRY = 0xFFFFFFFF
+TRANSLATIONS_SECTION = "translations"
+
+
+def parse_text_pack(filename):
+    translations = {}
+    section = ""
+    fi_handle = open(filename, "r", encoding="utf-8")
+    Lines = fi_handle.readlines()
+    fi_handle.close()
+    for line in Lines:
+        line = line.strip()
+        # same rules as ESP3DConfigFile: comments start with ';' or '#'
+        if len(line) == 0 or line[0] == ";" or line[0] == "#":
+            continue
+        if line[0] == "[" and line[-1] == "]":
+            section = line[1:-1].strip().lower()
+            continue
+        if section != TRANSLATIONS_SECTION:
+            continue
+        p = line.find("=")
+        if p == -1:
+            continue
+        key = line[:p].strip()
+        value = line[p + 1:].strip()
+        if not key.startswith("l_") or len(value) == 0:
+            continue
+        translations[int(key[2:])] = value
+    return translations
+
+
+def build_pack(translations):
+    count = max(translations.keys()) + 1 if translations else 0
+    offsets = [NO_ENTRY] * count
+    blob = b""
+    for index in sorted(translations.keys()):
+        offsets[index] = len(blob)
+        blob += translations[index].encode("utf-8") + b"\0"
+    data = MAGIC + struct.pack("<HHI", VERSION, count, len(blob))
+    data += struct.pack("<" + "I" * count, *offsets)
+    data += blob
+    return data
+
+
+if len(sys.argv) < 2:
+    print("Usage: {} <input.lng> [output.lng]".format(sys.argv[0]))
+    sys.exit(1)
+input_file = sys.argv[1]
+output_file = os.path.basename(input_file)
+if len(sys.argv) > 2:
+    output_file = sys.argv[2]
+if os.path.abspath(input_file) == os.path.abspath(output_file):
+    print("Output file must be different from input file")
+    sys.exit(1)
+translations = parse_text_pack(input_file)
+if len(translations) == 0:
+    print("No translation found in {}".format(input_file))
+    sys.exit(1)
+data = build_pack(translations)
+f = open(output_file, "wb")
+f.write(data)
+f.close()
+print("{}: {} entries, {} bytes".format(output_file, len(translations),
+                                        len(data)))
@@ -0,0 +1,124 @@
+#!/usr/bin/python
+# Stress telnet server with idle and slow clients while one client measures
+# the time to get answers
+# slow clients only get broadcasted messages (printer output), so run it
+# while printer sends data (printing or temperature polling)
+# usage: telnet_stress.py <ip> [port] [idle clients] [slow clients] [commands]
+import socket
+import sys
+import threading
+import time
+
+
+class bcolors:
+    COL_GREEN = '\033[92m'
+    COL_ORANGE = '\033[93m'
+    COL_RED = '\033[91m'
+    END_COL = '\033[0m'
+
+
+def current_milli_time():
+    return round(time.time() * 1000)
+
+
+def connect(host, port, rcvbuf=0):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    if rcvbuf:
+        # small receive window so server queue fills quickly
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, rcvbuf)
+    sock.settimeout(5)
+    sock.connect((host, port))
+    return sock
+
+
+def slow_reader(sock, stats, stop):
+    # read few bytes per second, server must not wait for it
+    sock.settimeout(1)
+    while not stop.is_set():
+        try:
+            data = sock.recv(16)
+            if not data:
+                stats["closed"] += 1
+                return
+        except socket.timeout:
+            pass
+        except OSError:
+            stats["closed"] += 1
+            return
+        time.sleep(1)
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("usage: telnet_stress.py <ip> [port] [idle clients] "
+              "[slow clients] [commands]")
+        return
+    host = sys.argv[1]
+    port = int(sys.argv[2]) if len(sys.argv) > 2 else 23
+    nb_idle = int(sys.argv[3]) if len(sys.argv) > 3 else 1
+    nb_slow = int(sys.argv[4]) if len(sys.argv) > 4 else 1
+    nb_commands = int(sys.argv[5]) if len(sys.argv) > 5 else 200
+    idle_clients = []
+    slow_clients = []
+    stats = {"closed": 0}
+    stop = threading.Event()
+    try:
+        for i in range(nb_idle):
+            # connected but never read nor write
+            idle_clients.append(connect(host, port))
+        for i in range(nb_slow):
+            sock = connect(host, port, 1024)
+            slow_clients.append(sock)
+            threading.Thread(target=slow_reader, args=(sock, stats, stop),
+                             daemon=True).start()
+        main_client = connect(host, port)
+    except OSError as e:
+        print(bcolors.COL_RED + "Connection failed: " + str(e) +
+              bcolors.END_COL)
+        stop.set()
+        return
+    print(bcolors.COL_GREEN + "Connected: {} idle, {} slow, 1 main".format(
+        nb_idle, nb_slow) + bcolors.END_COL)
+    # skip welcome message
+    time.sleep(1)
+    main_client.settimeout(0.5)
+    try:
+        while main_client.recv(1024):
+            pass
+    except socket.timeout:
+        pass
+    durations = []
+    timeouts = 0
+    main_client.settimeout(5)
+    for i in range(nb_commands):
+        start = current_milli_time()
+        # answer ends with "ok" line
+        main_client.sendall(b"[ESP800]json=no\n")
+        answer = b""
+        try:
+            while b"ok" not in answer:
+                data = main_client.recv(1024)
+                if not data:
+                    break
+                answer += data
+            durations.append(current_milli_time() - start)
+        except socket.timeout:
+            timeouts += 1
+    stop.set()
+    if durations:
+        durations.sort()
+        print(bcolors.COL_GREEN + "{} answers, min {} ms, median {} ms, "
+              "max {} ms".format(len(durations), durations[0],
+                                 durations[len(durations) // 2],
+                                 durations[-1]) + bcolors.END_COL)
+    if timeouts:
+        print(bcolors.COL_RED + "{} commands without answer".format(timeouts)
+              + bcolors.END_COL)
+    print(bcolors.COL_ORANGE + "{} slow clients closed by server".format(
+        stats["closed"]) + bcolors.END_COL)
+    for sock in idle_clients + slow_clients + [main_client]:
+        sock.close()
+
+
+if __name__ == "__main__":
+    main()